@@ -0,0 +1,523 @@
+// 这是单线程微基准测试程序
+// 作者：大一学生
+// 功能：逐项测量指令分发、look、地图绘制（含生成的大地图）、秘境生成新的一层、与每种怪物的一场完整战斗、掉落结算、商店进货、
+//       存档读档往返、会话休眠再恢复和Game的构造，给出每次操作的纳秒数和堆分配次数（用Metrics.cpp里替换的
+//       operator new计数）。结果写成JSON，并与仓库里的基准线 bench/baseline.json 比较，
+//       超出容差的项目逐条列出，程序以1退出。全部在本机运行，不需要任何外部服务
+// 用法：haida_bench [--filter 名称子串] [--min-time 每项最少秒数=0.2] [--output 结果文件=haida_bench.json]
+//                   [--baseline 基准线文件] [--ns-tolerance 0.5] [--alloc-tolerance 0.1] [--update-baseline]
+//       容差是相对值：0.5 表示比基准线慢50%以内都算通过。基准线文件里的同名字段是默认容差，
+//       单项也可以写自己的 ns_tolerance / alloc_tolerance；命令行给出的容差优先。
+//       耗时与机器和编译选项有关，换机器或换构建类型后请用 --update-baseline 重新生成基准线；
+//       结果文件记录构建类型和编译器，与基准线不一致时给出警告，耗时只显示不判定，只比较分配次数。
+//       分配次数与机器无关，通常应当完全一致
+
+#include "Game.hpp"          // 游戏
+#include "Metrics.hpp"       // 分配计数
+#include "SaveLoad.hpp"      // 存档读档
+#include "Output.hpp"        // 输出重定向
+#include <algorithm>         // sort
+#include <chrono>            // 计时
+#include <cstdio>            // printf/remove
+#include <cstdlib>           // strtod
+#include <fstream>           // 读写JSON文件
+#include <functional>        // function
+#include <set>               // 去重的怪物名
+#include <sstream>           // 字符串流
+#include <streambuf>         // 丢弃输出的缓冲区
+#include <string>            // 字符串
+#include <vector>            // 向量容器
+
+#ifndef HAIDA_BUILD_TYPE
+#define HAIDA_BUILD_TYPE ""
+#endif
+#ifndef HAIDA_COMPILER
+#define HAIDA_COMPILER "unknown"
+#endif
+
+#ifndef HAIDA_BENCH_BASELINE
+#define HAIDA_BENCH_BASELINE "bench/baseline.json"
+#endif
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// 接收并丢弃所有输出：游戏文字照常格式化（那也是开销的一部分），只是不写到终端
+class DiscardBuffer : public std::streambuf {
+protected:
+    int_type overflow(int_type c) override { return traits_type::not_eof(c); }
+    std::streamsize xsputn(const char*, std::streamsize n) override { return n; }
+};
+
+struct Result {
+    std::string name;
+    std::uint64_t iterations{0};
+    double ns_per_op{0};
+    double allocs_per_op{0};
+    double bytes_per_op{0};
+};
+
+// ---------------- 运行 ----------------
+
+class Runner {
+public:
+    Runner(std::string filter, double min_time) : filter_(std::move(filter)), min_time_(min_time) {}
+
+    // 先跑一次预热，然后每批次数翻倍，直到一批用时超过 min_time，以最后一批为准
+    // setup 在每批之前调用，不计时
+    void run(const std::string& name, const std::function<void()>& op,
+             const std::function<void()>& setup = nullptr) {
+        if (!filter_.empty() && name.find(filter_) == std::string::npos) return;
+        if (setup) setup();
+        op();
+        std::uint64_t batch = 1;
+        for (;;) {
+            if (setup) setup();
+            hx::AllocationCounter before = hx::threadAllocations();
+            Clock::time_point begin = Clock::now();
+            for (std::uint64_t i = 0; i < batch; ++i) op();
+            double seconds = std::chrono::duration<double>(Clock::now() - begin).count();
+            hx::AllocationCounter after = hx::threadAllocations();
+            if (seconds >= min_time_ || batch >= (1ull << 30)) {
+                Result r;
+                r.name = name;
+                r.iterations = batch;
+                double n = static_cast<double>(batch);
+                r.ns_per_op = seconds * 1e9 / n;
+                r.allocs_per_op = static_cast<double>(after.count - before.count) / n;
+                r.bytes_per_op = static_cast<double>(after.bytes - before.bytes) / n;
+                std::fprintf(stderr, "  %-32s %12.0f ns/op %10.1f allocs/op\n", name.c_str(), r.ns_per_op, r.allocs_per_op);
+                results_.push_back(r);
+                return;
+            }
+            // 按这一批的速度估计还需要多少次，至少翻倍，最多放大10倍
+            double scale = seconds > 0 ? min_time_ * 1.2 / seconds : 10.0;
+            scale = std::max(2.0, std::min(10.0, scale));
+            batch = static_cast<std::uint64_t>(static_cast<double>(batch) * scale);
+        }
+    }
+
+    const std::vector<Result>& results() const { return results_; }
+
+private:
+    std::string filter_;
+    double min_time_;
+    std::vector<Result> results_;
+};
+
+// 生成 n×n 个地点的方格地图，每个地点与东南西北的邻居相连
+hx::Map makeGridMap(int n) {
+    hx::Map map;
+    for (int y = 0; y < n; ++y) {
+        for (int x = 0; x < n; ++x) {
+            hx::Location loc;
+            loc.id = "r" + std::to_string(x) + "_" + std::to_string(y);
+            loc.name = "房间" + std::to_string(x) + "-" + std::to_string(y);
+            loc.coord = {x, y};
+            if (x + 1 < n) loc.exits.push_back({"东", "r" + std::to_string(x + 1) + "_" + std::to_string(y)});
+            if (y + 1 < n) loc.exits.push_back({"南", "r" + std::to_string(x) + "_" + std::to_string(y + 1)});
+            map.addLocation(loc);
+        }
+    }
+    return map;
+}
+
+// 跳过开场剧情，站在图书馆
+void enterWorld(hx::Game& game) {
+    game.start();
+    game.handleLine("翻阅古籍");
+    game.handleLine("");
+}
+
+void runAll(Runner& runner) {
+    hx::Game game(1);
+    enterWorld(game);
+    hx::GameState& state = game.state();
+
+    // 指令分发：几条不改变状态的日常指令轮流输入
+    const char* const kDispatch[] = {"stats", "inv", "task", "monsters"};
+    size_t next = 0;
+    runner.run("dispatch", [&] { game.handleLine(kDispatch[next++ % 4]); });
+    runner.run("look", [&] { game.handleLine("look"); });
+
+    // 地图绘制
+    std::string rendered;
+    runner.run("render_main_map", [&] { rendered = state.map.renderViewport("library"); });
+    runner.run("render_teaching_map", [&] { rendered = state.map.renderViewport("teach_2"); });
+    // 生成的大地图（200×200个相连的地点）：视口渲染的耗时应当和上面差不多，与地点总数无关
+    hx::Map large = makeGridMap(200);
+    runner.run("render_viewport_large", [&] { rendered = large.renderViewport("r100_100"); });
+
+    // 秘境：每次走进一个新的层（生成、放进地图，超过常驻上限时淘汰最久没用的一层）
+    hx::Map depths;
+    hx::Dungeon dungeon;
+    dungeon.setSeed(1);
+    dungeon.setCatalog(state.map);
+    int floor = 0;
+    runner.run("dungeon_floor", [&] { dungeon.enter(depths, floor++ % hx::Dungeon::kMaxFloor + 1); });
+
+    // 与每种怪物打一场完整的战斗（固定的中等强度角色，每场开始前恢复属性）
+    hx::Player fighter("基准测试");
+    hx::Attributes stats = fighter.attr();
+    stats.max_hp = stats.hp = 400;
+    stats.atk = 35;
+    stats.def_ = 25;
+    stats.spd = 15;
+    fighter.setLevel(10);
+    std::vector<std::string> ids;
+    for (const auto& kv : state.map.locations()) ids.push_back(kv.first);
+    std::sort(ids.begin(), ids.end());
+    std::set<std::string> seen;
+    std::string log;
+    for (const std::string& id : ids) {
+        for (const hx::Enemy& proto : state.map.get(id)->enemies) {
+            if (!seen.insert(proto.name()).second) continue;
+            runner.run("combat/" + proto.name(), [&] {
+                fighter.setAttr(stats);
+                hx::Enemy enemy = proto;
+                game.combat().fight(fighter, enemy, log);
+            });
+        }
+    }
+
+    // 掉落结算：主地图上第一个有掉落表的怪物，以及教学区的装备掉落
+    const hx::Enemy* dropper = nullptr;
+    const hx::Enemy* teaching = nullptr;
+    for (const std::string& id : ids) {
+        for (const hx::Enemy& e : state.map.get(id)->enemies) {
+            if (!dropper && !e.getDropItems().empty() && !state.map.isTeachingAreaLocation(id)) dropper = &e;
+            if (!teaching && state.map.isTeachingAreaLocation(id)) teaching = &e;
+        }
+    }
+    auto clearInventory = [&] { state.player.inventory().setFromSimple({}); };
+    if (dropper) {
+        runner.run("drops/main", [&] { game.processEnemyDrops(*dropper); }, clearInventory);
+    }
+    if (teaching) {
+        state.in_teaching_detail = true;
+        runner.run("drops/teaching", [&] { game.processEnemyDrops(*teaching); }, clearInventory);
+        state.in_teaching_detail = false;
+    }
+    clearInventory();
+
+    // 商店进货
+    std::vector<hx::Item> shelf;
+    runner.run("shop_refresh", [&] { state.shop_system.refreshShop(shelf); });
+
+    // 存档读档往返（写到当前目录的临时文件）
+    const std::string path = "haida_bench_save.dat";
+    hx::Game loaded(2);
+    runner.run("save_load_roundtrip", [&] {
+        hx::SaveLoad::save(state, path);
+        hx::SaveLoad::load(loaded.state(), path);
+    });
+    std::remove(path.c_str());
+
+    // 会话休眠再恢复：存成休眠数据，用同一个种子新建Game再读入（休眠的会话收到下一行输入时多花的时间）
+    hx::Game sleeper(3);
+    runner.run("hibernate_restore", [&] {
+        std::string blob = sleeper.hibernate();
+        hx::Game woken(3);
+        woken.restore(blob);
+    });
+
+    // 构造一局新游戏（建立整个世界）
+    std::uint32_t seed = 1;
+    runner.run("game_construct", [&] { hx::Game fresh(seed++); });
+}
+
+// ---------------- JSON ----------------
+
+// 最小的JSON读取：只支持基准线文件用到的对象、数组、字符串、数字、布尔
+struct Json {
+    enum class Type { NUL, BOOL, NUMBER, STRING, ARRAY, OBJECT } type{Type::NUL};
+    double number{0};
+    bool boolean{false};
+    std::string text;
+    std::vector<Json> items;
+    std::vector<std::pair<std::string, Json>> fields;
+
+    const Json* get(const std::string& key) const {
+        for (const auto& f : fields) if (f.first == key) return &f.second;
+        return nullptr;
+    }
+    double numberOr(const std::string& key, double fallback) const {
+        const Json* v = get(key);
+        return v && v->type == Type::NUMBER ? v->number : fallback;
+    }
+};
+
+class JsonParser {
+public:
+    explicit JsonParser(const std::string& s) : s_(s) {}
+
+    bool parse(Json& out) {
+        if (!value(out)) return false;
+        skip();
+        return pos_ == s_.size();
+    }
+
+private:
+    void skip() {
+        while (pos_ < s_.size() && (s_[pos_] == ' ' || s_[pos_] == '\n' || s_[pos_] == '\r' || s_[pos_] == '\t')) ++pos_;
+    }
+    bool literal(const char* word) {
+        size_t n = std::char_traits<char>::length(word);
+        if (s_.compare(pos_, n, word) != 0) return false;
+        pos_ += n;
+        return true;
+    }
+    bool string(std::string& out) {
+        if (pos_ >= s_.size() || s_[pos_] != '"') return false;
+        ++pos_;
+        while (pos_ < s_.size() && s_[pos_] != '"') {
+            char c = s_[pos_++];
+            if (c == '\\') {
+                if (pos_ >= s_.size()) return false;
+                char e = s_[pos_++];
+                if (e == 'n') out += '\n';
+                else if (e == 't') out += '\t';
+                else if (e == 'u') return false;  // 基准线里不会出现
+                else out += e;
+            } else {
+                out += c;
+            }
+        }
+        if (pos_ >= s_.size()) return false;
+        ++pos_;
+        return true;
+    }
+    bool value(Json& out) {
+        skip();
+        if (pos_ >= s_.size()) return false;
+        char c = s_[pos_];
+        if (c == '{') {
+            out.type = Json::Type::OBJECT;
+            ++pos_;
+            skip();
+            if (pos_ < s_.size() && s_[pos_] == '}') { ++pos_; return true; }
+            for (;;) {
+                skip();
+                std::string key;
+                if (!string(key)) return false;
+                skip();
+                if (pos_ >= s_.size() || s_[pos_++] != ':') return false;
+                Json v;
+                if (!value(v)) return false;
+                out.fields.emplace_back(std::move(key), std::move(v));
+                skip();
+                if (pos_ < s_.size() && s_[pos_] == ',') { ++pos_; continue; }
+                if (pos_ < s_.size() && s_[pos_] == '}') { ++pos_; return true; }
+                return false;
+            }
+        }
+        if (c == '[') {
+            out.type = Json::Type::ARRAY;
+            ++pos_;
+            skip();
+            if (pos_ < s_.size() && s_[pos_] == ']') { ++pos_; return true; }
+            for (;;) {
+                Json v;
+                if (!value(v)) return false;
+                out.items.push_back(std::move(v));
+                skip();
+                if (pos_ < s_.size() && s_[pos_] == ',') { ++pos_; continue; }
+                if (pos_ < s_.size() && s_[pos_] == ']') { ++pos_; return true; }
+                return false;
+            }
+        }
+        if (c == '"') {
+            out.type = Json::Type::STRING;
+            return string(out.text);
+        }
+        if (literal("true")) { out.type = Json::Type::BOOL; out.boolean = true; return true; }
+        if (literal("false")) { out.type = Json::Type::BOOL; return true; }
+        if (literal("null")) return true;
+        const char* begin = s_.c_str() + pos_;
+        char* end = nullptr;
+        out.number = std::strtod(begin, &end);
+        if (end == begin) return false;
+        out.type = Json::Type::NUMBER;
+        pos_ += static_cast<size_t>(end - begin);
+        return true;
+    }
+
+    const std::string& s_;
+    size_t pos_{0};
+};
+
+std::string jsonEscape(const std::string& s) {
+    std::string out;
+    for (char c : s) {
+        if (c == '"' || c == '\\') out += '\\';
+        out += c;
+    }
+    return out;
+}
+
+// 这次构建的构建类型（没有指定时CMake给出空串，记作None）和编译器
+std::string buildType() {
+    std::string type = HAIDA_BUILD_TYPE;
+    return type.empty() ? "None" : type;
+}
+
+bool writeResults(const std::string& path, const std::vector<Result>& results, double ns_tolerance, double alloc_tolerance) {
+    std::ofstream out(path, std::ios::trunc);
+    if (!out) return false;
+    char row[512];
+    out << "{\n  \"build_type\": \"" << jsonEscape(buildType()) << "\",\n  \"compiler\": \""
+        << jsonEscape(HAIDA_COMPILER) << "\",\n";
+    std::snprintf(row, sizeof(row), "  \"ns_tolerance\": %.2f,\n  \"alloc_tolerance\": %.2f,\n  \"benchmarks\": [\n",
+                  ns_tolerance, alloc_tolerance);
+    out << row;
+    for (size_t i = 0; i < results.size(); ++i) {
+        const Result& r = results[i];
+        std::snprintf(row, sizeof(row),
+                      "    {\"name\": \"%s\", \"iterations\": %llu, \"ns_per_op\": %.1f, \"allocs_per_op\": %.2f, \"bytes_per_op\": %.1f}%s\n",
+                      jsonEscape(r.name).c_str(), static_cast<unsigned long long>(r.iterations),
+                      r.ns_per_op, r.allocs_per_op, r.bytes_per_op, i + 1 < results.size() ? "," : "");
+        out << row;
+    }
+    out << "  ]\n}\n";
+    return static_cast<bool>(out);
+}
+
+// ---------------- 与基准线比较 ----------------
+
+// 返回超出容差的项目数；baseline 读不到时返回-1。ns_compared 返回耗时是否参与了判定
+int compare(const std::vector<Result>& results, const std::string& path,
+            double ns_tolerance_flag, double alloc_tolerance_flag, bool& ns_compared) {
+    ns_compared = false;
+    std::ifstream in(path);
+    if (!in) {
+        std::printf("找不到基准线文件 %s（可以用 --update-baseline 生成）\n", path.c_str());
+        return -1;
+    }
+    std::stringstream buffer;
+    buffer << in.rdbuf();
+    std::string text = buffer.str();
+    Json root;
+    if (!JsonParser(text).parse(root) || root.type != Json::Type::OBJECT) {
+        std::printf("基准线文件 %s 格式不对\n", path.c_str());
+        return -1;
+    }
+    double ns_default = ns_tolerance_flag >= 0 ? ns_tolerance_flag : root.numberOr("ns_tolerance", 0.5);
+    double alloc_default = alloc_tolerance_flag >= 0 ? alloc_tolerance_flag : root.numberOr("alloc_tolerance", 0.1);
+    const Json* list = root.get("benchmarks");
+    if (!list || list->type != Json::Type::ARRAY) {
+        std::printf("基准线文件 %s 没有 benchmarks 数组\n", path.c_str());
+        return -1;
+    }
+
+    // 构建类型或编译器不同（或者基准线没有记录）时耗时没有可比性：照常显示，但不算退步
+    const Json* base_type = root.get("build_type");
+    const Json* base_compiler = root.get("compiler");
+    std::string base_type_text = base_type ? base_type->text : "未记录";
+    std::string base_compiler_text = base_compiler ? base_compiler->text : "未记录";
+    bool comparable_ns = base_type_text == buildType() && base_compiler_text == HAIDA_COMPILER;
+    ns_compared = comparable_ns;
+    if (!comparable_ns) {
+        std::printf("\n警告：基准线是 %s / %s 构建测得的，这次是 %s / %s，耗时不作比较，只比较分配次数\n",
+                    base_type_text.c_str(), base_compiler_text.c_str(), buildType().c_str(), HAIDA_COMPILER);
+    }
+
+    std::printf("\n与基准线 %s 比较（容差：耗时 +%.0f%%，分配 +%.0f%%）\n", path.c_str(), ns_default * 100, alloc_default * 100);
+    std::printf("  %-32s %12s %12s %8s %10s %10s  %s\n", "benchmark", "ns/op", "baseline", "change", "allocs/op", "baseline", "");
+    int regressions = 0;
+    for (const Result& r : results) {
+        const Json* base = nullptr;
+        for (const Json& item : list->items) {
+            const Json* name = item.get("name");
+            if (name && name->text == r.name) { base = &item; break; }
+        }
+        if (!base) {
+            std::printf("  %-32s %12.0f %12s %8s %10.1f %10s  新项目\n", r.name.c_str(), r.ns_per_op, "-", "-", r.allocs_per_op, "-");
+            continue;
+        }
+        // 命令行给出的容差优先，其次是单项自己的容差，最后是文件的默认容差
+        double ns_tol = ns_tolerance_flag >= 0 ? ns_tolerance_flag : base->numberOr("ns_tolerance", ns_default);
+        double alloc_tol = alloc_tolerance_flag >= 0 ? alloc_tolerance_flag : base->numberOr("alloc_tolerance", alloc_default);
+        double base_ns = base->numberOr("ns_per_op", 0);
+        double base_allocs = base->numberOr("allocs_per_op", 0);
+        double change = base_ns > 0 ? (r.ns_per_op / base_ns - 1.0) * 100.0 : 0.0;
+        bool slow = comparable_ns && base_ns > 0 && r.ns_per_op > base_ns * (1.0 + ns_tol);
+        // 分配次数另给0.5次的绝对余量，避免基准线接近0时因为取平均而误报
+        bool allocs = r.allocs_per_op > base_allocs * (1.0 + alloc_tol) + 0.5;
+        std::string verdict = "ok";
+        if (slow || allocs) {
+            ++regressions;
+            verdict = "退步:";
+            if (slow) verdict += " 变慢";
+            if (allocs) verdict += " 分配变多";
+        } else if (comparable_ns && base_ns > 0 && r.ns_per_op < base_ns / (1.0 + ns_tol)) {
+            verdict = "变快（可以更新基准线）";
+        }
+        std::printf("  %-32s %12.0f %12.0f %+7.1f%% %10.1f %10.1f  %s\n", r.name.c_str(), r.ns_per_op, base_ns, change,
+                    r.allocs_per_op, base_allocs, verdict.c_str());
+    }
+    return regressions;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    std::string filter, output = "haida_bench.json", baseline = HAIDA_BENCH_BASELINE;
+    double min_time = 0.2;
+    double ns_tolerance = -1.0, alloc_tolerance = -1.0;  // 负数表示使用基准线文件里的容差
+    bool update = false;
+    for (int i = 1; i < argc; ++i) {
+        std::string flag = argv[i];
+        if (flag == "--update-baseline") { update = true; continue; }
+        if (i + 1 >= argc) {
+            std::fprintf(stderr, "参数 %s 缺少取值\n", flag.c_str());
+            return 2;
+        }
+        std::string value = argv[++i];
+        if (flag == "--filter") filter = value;
+        else if (flag == "--min-time") min_time = std::strtod(value.c_str(), nullptr);
+        else if (flag == "--output") output = value;
+        else if (flag == "--baseline") baseline = value;
+        else if (flag == "--ns-tolerance") ns_tolerance = std::strtod(value.c_str(), nullptr);
+        else if (flag == "--alloc-tolerance") alloc_tolerance = std::strtod(value.c_str(), nullptr);
+        else {
+            std::fprintf(stderr, "未知参数: %s\n", flag.c_str());
+            return 2;
+        }
+    }
+
+    Runner runner(filter, min_time);
+    {
+        DiscardBuffer discard;
+        std::ostream sink(&discard);
+        hx::ConsoleScope quiet(sink);
+        runAll(runner);
+    }
+    const std::vector<Result>& results = runner.results();
+
+    if (!writeResults(output, results, 0.5, 0.1)) {
+        std::fprintf(stderr, "无法写入 %s\n", output.c_str());
+        return 2;
+    }
+    std::printf("%zu 项结果已写入 %s\n", results.size(), output.c_str());
+
+    if (update) {
+        if (!writeResults(baseline, results, ns_tolerance >= 0 ? ns_tolerance : 0.5,
+                          alloc_tolerance >= 0 ? alloc_tolerance : 0.1)) {
+            std::fprintf(stderr, "无法写入基准线 %s\n", baseline.c_str());
+            return 2;
+        }
+        std::printf("基准线已更新: %s\n", baseline.c_str());
+        return 0;
+    }
+
+    bool ns_compared = false;
+    int regressions = compare(results, baseline, ns_tolerance, alloc_tolerance, ns_compared);
+    if (regressions < 0) return 2;
+    if (regressions > 0) {
+        std::printf("\n!!! %d 项超出基准线容差 !!!\n", regressions);
+        return 1;
+    }
+    std::printf(ns_compared ? "\n全部在容差以内\n" : "\n分配次数全部在容差以内（耗时未比较）\n");
+    return 0;
+}
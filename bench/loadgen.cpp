@@ -0,0 +1,382 @@
+// 这是多会话模式的压力测试程序
+// 作者：大一学生
+// 功能：在一个进程里打开N个会话（服务端模式的会话调度器），每个会话由一个客户端驱动：
+//       自动玩家（见Bot.hpp）或者回放录好的记录文件。客户端收到上一条指令的完整响应后才发下一条，
+//       可以限定所有客户端合计每秒发多少条指令。结束后按指令类别（移动、查看、战斗、对话、商店、存档）
+//       输出吞吐量和 p50/p90/p99/p999 延迟。全部在本机离线运行，不需要网络
+// 用法：haida_loadgen [--clients 200] [--workers CPU核数] [--drivers 2] [--rate 每秒指令数，0为不限]
+//                     [--duration 秒数] [--bot balanced|aggressive|cautious|mixed] [--transcript 记录文件]...
+//                     [--seed 起始种子] [--metrics-file 文件]（定期写出服务端各子系统的 Prometheus 指标）
+//                     [--trace 文件]（记录各工作线程的时间线，结束时导出为 Chrome/Perfetto JSON）
+//                     [--hibernate-after 毫秒]（会话空闲这么久后休眠，0为不休眠；限速时客户端两条指令之间是空闲的）
+
+#include "Bot.hpp"               // 自动玩家
+#include "Histogram.hpp"         // 延迟直方图
+#include "Metrics.hpp"           // 运行指标
+#include "MpscQueue.hpp"         // 多生产者单消费者队列
+#include "Replay.hpp"            // 记录文件
+#include "SessionScheduler.hpp"  // 会话调度器
+#include "Trace.hpp"             // 时间线跟踪
+#include <algorithm>             // max
+#include <atomic>                // 原子操作
+#include <chrono>                // 计时
+#include <cstdio>                // printf
+#include <cstdlib>               // strtoul/strtod/strtoll
+#include <functional>            // greater
+#include <memory>                // 智能指针
+#include <queue>                 // 优先队列
+#include <shared_mutex>          // 读写锁
+#include <string>                // 字符串
+#include <string_view>           // 不复制的字符串片段
+#include <thread>                // 线程
+#include <unordered_map>         // 哈希映射
+#include <vector>                // 向量容器
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// 指令类别
+enum Category { MOVE, LOOK, FIGHT, TALK, SHOP, SAVE, OTHER, CATEGORY_COUNT };
+const char* const kCategoryNames[CATEGORY_COUNT] = {"move", "look", "fight", "talk", "shop", "save", "other"};
+
+bool endsWith(std::string_view s, std::string_view suffix) {
+    return s.size() >= suffix.size() && s.substr(s.size() - suffix.size()) == suffix;
+}
+
+// 按指令本身和它回答的提示语分类（商店、对话菜单里的数字算作商店、对话）
+Category classify(std::string_view line, std::string_view last_output) {
+    if (endsWith(last_output, "'sell' 出售装备（10金币/件）： ")) return SHOP;
+    if (endsWith(last_output, "请选择 (输入数字或命令): ") || endsWith(last_output, "输入编号或NPC名字（back返回）：")) {
+        return TALK;
+    }
+    std::string_view verb = line.substr(0, line.find(' '));
+    for (std::string_view v : {"w", "a", "s", "d", "东", "西", "南", "北", "enter", "exit"}) {
+        if (line == v) return MOVE;
+    }
+    if (verb == "fight" || verb == "战斗" || line.substr(0, std::string_view("挑战").size()) == "挑战") return FIGHT;
+    if (verb == "talk" || verb == "对话") return TALK;
+    if (verb == "buy" || verb == "shop") return SHOP;
+    if (verb == "save" || verb == "load" || verb == "存档" || verb == "读档") return SAVE;
+    for (std::string_view v : {"look", "l", "map", "stats", "inv", "i", "task", "monsters", "help", "查看", "地图", "属性", "背包"}) {
+        if (verb == v) return LOOK;
+    }
+    return OTHER;
+}
+
+// 一个客户端：同一时刻只有一条指令在等响应
+struct Client {
+    size_t index{0};
+    hx::Session::Id id{0};
+    std::uint32_t generation{0};          // 第几局（一局结束后重新开一个会话）
+    std::unique_ptr<hx::Bot> bot;
+    const hx::Transcript* transcript{nullptr};
+    size_t next_line{0};
+    std::string output;                   // 这次响应累积的输出（调度器回调写入，响应完整后交给驱动线程）
+    Clock::time_point intended;           // 这条指令计划发出的时间
+    Clock::time_point responded;          // 收到完整响应的时间
+    int category{-1};                     // 等待响应的指令类别，-1表示开场剧情（不计入统计）
+};
+
+// 等到时间再发的指令（限速时）
+struct Pending {
+    Clock::time_point due;
+    Client* client;
+    std::string line;
+    bool operator>(const Pending& o) const { return due > o.due; }
+};
+
+// 驱动线程：处理一部分客户端的响应、决定下一条指令并发出；延迟记在自己的直方图里，最后合并
+struct Driver {
+    hx::MpscQueue<Client*> responses;
+    std::priority_queue<Pending, std::vector<Pending>, std::greater<Pending>> pacing;
+    std::vector<hx::Histogram> latency{CATEGORY_COUNT};
+    std::uint64_t commands{0};
+    std::uint64_t games{0};
+    std::thread thread;
+};
+
+struct Options {
+    size_t clients{200};
+    size_t workers{std::thread::hardware_concurrency()};
+    size_t drivers{2};
+    double rate{0.0};
+    double duration{10.0};
+    std::string bot{"mixed"};
+    std::vector<std::string> transcripts;
+    std::uint32_t seed{1};
+    std::string metrics_file;
+    std::string trace_file;
+    long long hibernate_after_ms{0};
+};
+
+class LoadGenerator {
+public:
+    LoadGenerator(const Options& options, std::vector<hx::Transcript> transcripts)
+        : options_(options), transcripts_(std::move(transcripts)), scheduler_(options.workers) {
+        interval_ = options.rate > 0
+            ? std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(
+                  static_cast<double>(options.clients) / options.rate))
+            : Clock::duration::zero();
+        for (size_t i = 0; i < options.drivers; ++i) drivers_.push_back(std::make_unique<Driver>());
+        scheduler_.setOutputHandler([this](hx::Session::Id id, const std::string& text, bool idle) {
+            onOutput(id, text, idle);
+        });
+        scheduler_.setHibernateAfter(std::chrono::milliseconds(options.hibernate_after_ms));
+    }
+
+    void run() {
+        begin_ = Clock::now();
+        clients_.resize(options_.clients);
+        for (size_t i = 0; i < clients_.size(); ++i) {
+            clients_[i].index = i;
+            openSession(clients_[i]);
+        }
+        for (auto& d : drivers_) {
+            Driver* driver = d.get();
+            driver->thread = std::thread([this, driver]() { driverLoop(*driver); });
+        }
+        std::this_thread::sleep_for(std::chrono::duration<double>(options_.duration));
+        stopping_.store(true, std::memory_order_release);
+        for (auto& d : drivers_) d->thread.join();
+        end_ = Clock::now();
+        scheduler_.stop();
+    }
+
+    void report() const {
+        double seconds = std::chrono::duration<double>(end_ - begin_).count();
+        hx::Histogram all;
+        std::uint64_t commands = 0;
+        std::uint64_t games = 0;
+        std::vector<hx::Histogram> merged(CATEGORY_COUNT);
+        for (const auto& d : drivers_) {
+            commands += d->commands;
+            games += d->games;
+            for (int c = 0; c < CATEGORY_COUNT; ++c) {
+                merged[static_cast<size_t>(c)].merge(d->latency[static_cast<size_t>(c)]);
+                all.merge(d->latency[static_cast<size_t>(c)]);
+            }
+        }
+        std::printf("完成指令 %llu，用时 %.2f s，吞吐 %.0f 指令/秒，打完 %llu 局\n",
+                    static_cast<unsigned long long>(commands), seconds,
+                    seconds > 0 ? static_cast<double>(commands) / seconds : 0.0,
+                    static_cast<unsigned long long>(games));
+        std::printf("%-8s %10s %10s %10s %10s %10s %10s   (延迟单位：微秒)\n",
+                    "类别", "次数", "p50", "p90", "p99", "p999", "最大");
+        auto row = [](const char* name, const hx::Histogram& h) {
+            if (h.count() == 0) return;
+            auto us = [](std::uint64_t ns) { return static_cast<double>(ns) / 1000.0; };
+            std::printf("%-8s %10llu %10.1f %10.1f %10.1f %10.1f %10.1f\n", name,
+                        static_cast<unsigned long long>(h.count()), us(h.percentile(50)), us(h.percentile(90)),
+                        us(h.percentile(99)), us(h.percentile(99.9)), us(h.max()));
+        };
+        for (int c = 0; c < CATEGORY_COUNT; ++c) row(kCategoryNames[c], merged[static_cast<size_t>(c)]);
+        row("all", all);
+        if (options_.hibernate_after_ms > 0) {
+            std::printf("会话休眠 %llu 次，恢复 %llu 次\n",
+                        static_cast<unsigned long long>(scheduler_.hibernations()),
+                        static_cast<unsigned long long>(scheduler_.rehydrations()));
+        }
+    }
+
+private:
+    // 调度器回调（工作线程）：累积输出，会话空闲时把客户端交给它的驱动线程
+    void onOutput(hx::Session::Id id, const std::string& text, bool idle) {
+        Client* client = nullptr;
+        {
+            std::shared_lock<std::shared_mutex> lock(registry_mutex_);
+            auto it = registry_.find(id);
+            if (it == registry_.end()) return;
+            client = it->second;
+        }
+        client->output += text;
+        if (!idle) return;
+        client->responded = Clock::now();
+        drivers_[client->index % drivers_.size()]->responses.push(client);
+    }
+
+    // 为客户端开一局新游戏（登记在开会话之前加锁，开场剧情的回调一定能找到客户端）
+    void openSession(Client& client) {
+        std::uint32_t seed = options_.seed + static_cast<std::uint32_t>(client.index) +
+                             client.generation * static_cast<std::uint32_t>(options_.clients);
+        client.next_line = 0;
+        client.bot.reset();
+        client.transcript = nullptr;
+        if (!transcripts_.empty()) {
+            client.transcript = &transcripts_[client.index % transcripts_.size()];
+            seed = client.transcript->seed;
+        } else {
+            hx::BotConfig config;
+            config.seed = seed;
+            if (options_.bot == "mixed") {
+                config.strategy = static_cast<hx::BotStrategy>(client.index % 3);
+            } else {
+                hx::parseBotStrategy(options_.bot, config.strategy);
+            }
+            client.bot = std::make_unique<hx::Bot>(config);
+        }
+        client.output.clear();
+        client.category = -1;
+        client.intended = Clock::now();
+        inflight_.fetch_add(1, std::memory_order_relaxed);
+        std::unique_lock<std::shared_mutex> lock(registry_mutex_);
+        client.id = scheduler_.open(seed);
+        registry_[client.id] = &client;
+    }
+
+    // 一局结束（bot看完结局、记录放完、会话已关闭）：关掉旧会话再开一局
+    void reopen(Client& client) {
+        scheduler_.close(client.id);
+        {
+            std::unique_lock<std::shared_mutex> lock(registry_mutex_);
+            registry_.erase(client.id);
+        }
+        ++client.generation;
+        openSession(client);
+    }
+
+    void send(Client& client, const std::string& line) {
+        inflight_.fetch_add(1, std::memory_order_relaxed);
+        if (!scheduler_.post(client.id, line)) {
+            inflight_.fetch_sub(1, std::memory_order_relaxed);
+            reopen(client);
+        }
+    }
+
+    void onResponse(Driver& driver, Client& client) {
+        std::string text = std::move(client.output);
+        client.output.clear();
+        if (client.category >= 0) {
+            // 从计划发出的时间算起：限速时服务端慢了，后面的指令也跟着晚发，这段等待同样计入延迟
+            auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(client.responded - client.intended).count();
+            driver.latency[static_cast<size_t>(client.category)].record(static_cast<std::uint64_t>(std::max<long long>(0, ns)));
+            ++driver.commands;
+        }
+        inflight_.fetch_sub(1, std::memory_order_relaxed);
+        if (stopping_.load(std::memory_order_acquire)) return;
+
+        std::string line;
+        bool more;
+        if (client.bot) {
+            more = client.bot->next(text, line);
+        } else {
+            more = client.next_line < client.transcript->lines.size();
+            if (more) line = client.transcript->lines[client.next_line++].text;
+        }
+        if (!more) {
+            ++driver.games;
+            reopen(client);
+            return;
+        }
+        client.category = classify(line, text);
+
+        Clock::time_point now = Clock::now();
+        Clock::time_point due = interval_ == Clock::duration::zero() ? now : client.intended + interval_;
+        client.intended = due;
+        if (due <= now) {
+            send(client, line);
+        } else {
+            driver.pacing.push(Pending{due, &client, std::move(line)});
+        }
+    }
+
+    void driverLoop(Driver& driver) {
+        while (true) {
+            bool worked = false;
+            Client* client = nullptr;
+            while (driver.responses.pop(client)) {
+                onResponse(driver, *client);
+                worked = true;
+            }
+            bool stopping = stopping_.load(std::memory_order_acquire);
+            Clock::time_point now = Clock::now();
+            while (!driver.pacing.empty() && (stopping || driver.pacing.top().due <= now)) {
+                Pending p = driver.pacing.top();
+                driver.pacing.pop();
+                if (!stopping) send(*p.client, p.line);
+                worked = true;
+            }
+            if (stopping && inflight_.load(std::memory_order_acquire) == 0) break;
+            if (!worked) std::this_thread::sleep_for(std::chrono::microseconds(50));
+        }
+    }
+
+    Options options_;
+    std::vector<hx::Transcript> transcripts_;
+    hx::SessionScheduler scheduler_;
+    Clock::duration interval_;  // 每个客户端两条指令之间的计划间隔（不限速时为0）
+    std::vector<std::unique_ptr<Driver>> drivers_;
+    std::vector<Client> clients_;
+    std::shared_mutex registry_mutex_;
+    std::unordered_map<hx::Session::Id, Client*> registry_;
+    std::atomic<long long> inflight_{0};  // 已发出、还没收到完整响应的指令（包括开场剧情）
+    std::atomic<bool> stopping_{false};
+    Clock::time_point begin_;
+    Clock::time_point end_;
+};
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string flag = argv[i];
+        std::string value = argv[i + 1];
+        if (flag == "--clients") options.clients = std::strtoul(value.c_str(), nullptr, 10);
+        else if (flag == "--workers") options.workers = std::strtoul(value.c_str(), nullptr, 10);
+        else if (flag == "--drivers") options.drivers = std::strtoul(value.c_str(), nullptr, 10);
+        else if (flag == "--rate") options.rate = std::strtod(value.c_str(), nullptr);
+        else if (flag == "--duration") options.duration = std::strtod(value.c_str(), nullptr);
+        else if (flag == "--bot") options.bot = value;
+        else if (flag == "--transcript") options.transcripts.push_back(value);
+        else if (flag == "--seed") options.seed = static_cast<std::uint32_t>(std::strtoul(value.c_str(), nullptr, 10));
+        else if (flag == "--metrics-file") options.metrics_file = value;
+        else if (flag == "--trace") options.trace_file = value;
+        else if (flag == "--hibernate-after") options.hibernate_after_ms = std::strtoll(value.c_str(), nullptr, 10);
+        else {
+            std::fprintf(stderr, "未知参数: %s\n", flag.c_str());
+            return 2;
+        }
+    }
+    if (options.clients == 0) options.clients = 1;
+    if (options.workers == 0) options.workers = 1;
+    if (options.drivers == 0) options.drivers = 1;
+    hx::BotStrategy strategy;
+    if (options.transcripts.empty() && options.bot != "mixed" && !hx::parseBotStrategy(options.bot, strategy)) {
+        std::fprintf(stderr, "未知打法: %s（可选 balanced/aggressive/cautious/mixed）\n", options.bot.c_str());
+        return 2;
+    }
+
+    std::vector<hx::Transcript> transcripts;
+    for (const std::string& path : options.transcripts) {
+        hx::Transcript t;
+        if (!t.load(path) || t.lines.empty()) {
+            std::fprintf(stderr, "无法读取记录文件: %s\n", path.c_str());
+            return 2;
+        }
+        transcripts.push_back(std::move(t));
+    }
+
+    std::printf("客户端 %zu，工作线程 %zu，驱动线程 %zu，目标速率 ", options.clients, options.workers, options.drivers);
+    if (options.rate > 0) std::printf("%.0f 指令/秒", options.rate);
+    else std::printf("不限");
+    std::printf("，时长 %.1f s，", options.duration);
+    if (transcripts.empty()) std::printf("bot打法 %s\n", options.bot.c_str());
+    else std::printf("回放 %zu 个记录文件\n", transcripts.size());
+
+    std::unique_ptr<hx::MetricsExporter> exporter;
+    if (!options.metrics_file.empty()) exporter = std::make_unique<hx::MetricsExporter>(options.metrics_file, 1.0);
+
+    if (!options.trace_file.empty()) hx::setTracing(true);
+
+    LoadGenerator generator(options, std::move(transcripts));
+    generator.run();
+    generator.report();
+    if (!options.trace_file.empty()) {
+        hx::setTracing(false);
+        if (hx::writeChromeTraceFile(options.trace_file)) {
+            std::printf("时间线已导出到 %s（%zu 个跟踪点）\n", options.trace_file.c_str(), hx::traceEventCount());
+        }
+    }
+    return 0;
+}
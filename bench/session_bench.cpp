@@ -0,0 +1,98 @@
+// 这是会话调度器的性能测试程序
+// 作者：大一学生
+// 功能：用同样数量的会话和指令，分别在1、2、4…N个工作线程上运行，
+//       输出每秒执行的指令数，观察吞吐量随核数的扩展情况
+// 用法：haida_session_bench [会话数=256] [每个会话的指令数=200] [最多线程数=CPU核数]
+
+#include "SessionScheduler.hpp"  // 会话调度器
+#include <atomic>                // 原子操作
+#include <chrono>                // 计时
+#include <cstdio>                // printf
+#include <cstdlib>               // atoi
+#include <string>                // 字符串
+#include <thread>                // 线程
+#include <vector>                // 向量容器
+
+namespace {
+
+// 不会进入战斗的日常指令（战斗结果随机，会让各轮测试的工作量不同）
+const char* const kCommandMix[] = {
+    "look", "stats", "inv", "task", "a", "look", "d", "monsters", "talk", "back",
+};
+
+// 等待调度器执行完指定数量的指令
+void waitForCommands(const hx::SessionScheduler& scheduler, std::uint64_t target) {
+    while (scheduler.commandsExecuted() < target) {
+        std::this_thread::sleep_for(std::chrono::microseconds(200));
+    }
+}
+
+struct Result {
+    size_t workers;
+    double seconds;
+    double commands_per_second;
+    std::uint64_t steals;
+    std::uint64_t output_bytes;
+};
+
+Result runOnce(size_t workers, size_t sessions, size_t commands_per_session) {
+    hx::SessionScheduler scheduler(workers);
+    std::atomic<std::uint64_t> output_bytes{0};
+    scheduler.setOutputHandler([&output_bytes](hx::Session::Id, const std::string& text, bool) {
+        output_bytes.fetch_add(text.size(), std::memory_order_relaxed);
+    });
+
+    // 预热：创建会话并走完开场剧情（不计入时间）
+    std::vector<hx::Session::Id> ids;
+    for (size_t i = 0; i < sessions; ++i) {
+        hx::Session::Id id = scheduler.open();
+        scheduler.post(id, "翻阅古籍");
+        scheduler.post(id, "");
+        ids.push_back(id);
+    }
+    waitForCommands(scheduler, 2 * sessions);
+    std::uint64_t warmup = scheduler.commandsExecuted();
+    std::uint64_t steals_before = scheduler.steals();
+
+    const size_t mix = sizeof(kCommandMix) / sizeof(kCommandMix[0]);
+    auto begin = std::chrono::steady_clock::now();
+    for (size_t c = 0; c < commands_per_session; ++c) {
+        for (hx::Session::Id id : ids) {
+            scheduler.post(id, kCommandMix[(c + id) % mix]);
+        }
+    }
+    waitForCommands(scheduler, warmup + sessions * commands_per_session);
+    auto end = std::chrono::steady_clock::now();
+    scheduler.stop();
+
+    double seconds = std::chrono::duration<double>(end - begin).count();
+    return Result{workers, seconds,
+                  static_cast<double>(sessions * commands_per_session) / seconds,
+                  scheduler.steals() - steals_before, output_bytes.load()};
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    size_t sessions = argc > 1 ? static_cast<size_t>(std::atoi(argv[1])) : 256;
+    size_t commands = argc > 2 ? static_cast<size_t>(std::atoi(argv[2])) : 200;
+    size_t max_workers = argc > 3 ? static_cast<size_t>(std::atoi(argv[3])) : std::thread::hardware_concurrency();
+    if (sessions == 0) sessions = 1;
+    if (max_workers == 0) max_workers = 1;
+
+    std::vector<size_t> worker_counts;
+    for (size_t w = 1; w < max_workers; w *= 2) worker_counts.push_back(w);
+    worker_counts.push_back(max_workers);
+
+    std::printf("会话数 %zu，每个会话 %zu 条指令\n", sessions, commands);
+    std::printf("%8s %10s %14s %8s %10s %12s\n", "线程", "耗时(s)", "指令/秒", "加速比", "窃取", "输出(MB)");
+    double baseline = 0.0;
+    for (size_t w : worker_counts) {
+        Result r = runOnce(w, sessions, commands);
+        if (baseline == 0.0) baseline = r.commands_per_second;
+        std::printf("%8zu %10.3f %14.0f %7.2fx %10llu %12.1f\n", r.workers, r.seconds, r.commands_per_second,
+                    r.commands_per_second / baseline, static_cast<unsigned long long>(r.steals),
+                    static_cast<double>(r.output_bytes) / (1024.0 * 1024.0));
+    }
+    return 0;
+}
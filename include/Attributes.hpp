@@ -2,6 +2,7 @@
 #pragma once
 #include <cstdint>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <unordered_map>
 
@@ -16,6 +17,17 @@ enum class StatusEffect {
     SHIELD        // 护盾：DEF+30%
 };
 
+// 可以分配属性点的属性
+enum class Stat {
+    HP,
+    ATK,
+    DEF,
+    SPD
+};
+
+// 解析属性名（hp/atk/def/spd，不区分大小写），无法识别时返回false
+bool parseStat(std::string_view name, Stat& out);
+
 // 状态效果信息
 struct StatusInfo {
     StatusEffect type;
@@ -48,7 +60,7 @@ struct Attributes {
     // 状态效果管理
     void addStatus(StatusEffect effect, int duration);
     void removeStatus(StatusEffect effect);
-    void updateStatuses();
+    void updateStatuses(int turns = 1); // 经过 turns 个回合：持续时间减少，到期的移除
     bool hasStatus(StatusEffect effect) const;
     int getStatusDuration(StatusEffect effect) const;
     
@@ -59,6 +71,7 @@ struct Attributes {
     
     // 属性点分配
     bool allocatePoint(const std::string& stat);
+    bool allocatePoint(Stat stat);
     void addAvailablePoints(int points);
     
     // 等级提升
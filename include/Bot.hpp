@@ -0,0 +1,155 @@
+// 这是自动玩家（bot）的头文件
+// 作者：大一学生
+// 功能：一个只看游戏输出、只输入指令的自动玩家，像真人一样从开场剧情一路玩到结局：
+//       找林清漪领新手装备、在各地刷怪升级、去钱道然那里买药水和硕士装备、
+//       进教学区拿启智笔、最后闯文心潭击败三个心魔并查看结局。
+//       bot不读取Game内部状态，所以既能在进程内直接驱动Game，也能接在会话调度器的输出回调后面，
+//       成千上万个bot就是一套指令组合接近真实玩家的压力测试
+
+#pragma once
+#include <cstdint>      // 定宽整数
+#include <deque>        // 待执行的指令
+#include <ostream>      // 输出流
+#include <random>       // 随机数
+#include <string>       // 字符串
+#include <string_view>  // 不复制的字符串片段
+#include <unordered_map> // 哈希映射
+#include <unordered_set> // 哈希集合
+#include <vector>       // 向量容器
+
+namespace hx {
+
+class TranscriptWriter; // 输入记录（见Replay.hpp）
+
+// bot的打法
+enum class BotStrategy {
+    BALANCED,    // 攻击和生命轮流加点，按自身等级挑怪
+    AGGRESSIVE,  // 全加攻击，越级挑怪，少买药水，早进文心潭
+    CAUTIOUS     // 加生命和防御，只打低一级的怪，多带药水和复活符
+};
+
+// 打法名称（balanced/aggressive/cautious）与枚举互相转换
+const char* botStrategyName(BotStrategy strategy);
+bool parseBotStrategy(std::string_view text, BotStrategy& out);
+
+// bot的配置
+struct BotConfig {
+    std::uint32_t seed{1};                       // bot自己的随机种子（闲聊指令、答题、同级怪的选择）
+    BotStrategy strategy{BotStrategy::BALANCED};
+    size_t max_commands{20000};                  // 最多输入多少行，到达后放弃
+    double chatter{0.05};                        // 每一步插入一条闲逛指令（look/inv/task…）的概率
+};
+
+// bot走到了游戏的哪一阶段
+enum class BotStage {
+    INTRO,        // 开场剧情
+    STARTER_GEAR, // 领新手装备
+    TRAINING,     // 刷怪升级、买装备
+    WENXINTAN,    // 文心潭三个心魔
+    ENDING,       // 查看结局
+    DONE          // 已看到结局
+};
+
+const char* botStageName(BotStage stage);
+
+// 自动玩家
+// 功能：每次读入游戏自上一行输入以来的全部输出（以提示语结尾），更新自己对角色的了解，给出下一行输入
+class Bot {
+public:
+    explicit Bot(const BotConfig& config);
+
+    // 根据输出决定下一行输入；看到结局或指令数用完时返回false
+    bool next(std::string_view output, std::string& line);
+
+    BotStage stage() const { return stage_; }
+    size_t commands() const { return commands_; }
+    int level() const { return level_; }
+    int deaths() const { return deaths_; }
+    int keys() const { return static_cast<int>(bosses_beaten_.size()); }
+    bool finished() const { return stage_ == BotStage::DONE; }
+
+private:
+    // 当前等待的输入类型（由输出末尾的提示语判断）
+    enum class Prompt { COMMAND, DIALOGUE, SHOP, NPC_MENU, ACCESSORY_SLOT, QUIZ, OTHER };
+    // 这次对话想做的事
+    enum class TalkGoal { NONE, STARTER_GEAR, SHOP };
+
+    struct Option {
+        int number;
+        std::string text;
+        int price;  // 商店货架上的价格，对话选项为0
+    };
+
+    void observe(const std::string& text);          // 从输出中更新角色状态
+    void observeLine(std::string_view row);
+    static Prompt detectPrompt(std::string_view output);
+    std::string decide();                           // 在指令提示符下决定下一步
+    std::string answerDialogue();
+    std::string answerShop();
+    std::string routeTo(const std::string& place);  // 去某地的下一步；已经在那里时返回空
+    std::string chooseTarget(std::string& place);   // 选一个要打的怪，place 为它所在的地点
+    std::string allocateCommand();
+    bool wantsShopping() const;
+    bool needsGear() const;  // 该攒钱买高品质装备了
+    int heroicGear() const { return (master_weapon_ ? 1 : 0) + (master_armor_ ? 1 : 0); }
+
+    BotConfig config_;
+    std::mt19937 rng_;
+    BotStage stage_{BotStage::INTRO};
+    size_t commands_{0};
+    int intro_step_{0};
+
+    // bot对角色的了解（全部来自游戏输出）
+    std::string location_;
+    int level_{1};
+    int hp_{60};
+    int max_hp_{60};
+    int coins_{0};
+    int points_{0};
+    int potions_{0};
+    int scrolls_{0};
+    int deaths_{0};
+    bool stats_stale_{true};      // 需要输入stats刷新属性
+    bool master_weapon_{false};   // 已装备硕士及以上品质的武器
+    bool master_armor_{false};    // 已装备硕士及以上品质的护甲
+    bool has_pen_{false};         // 已获得启智笔
+    bool wenxin_refused_{false};  // 上次尝试进入文心潭被拒
+    bool ending_seen_{false};
+    std::unordered_set<std::string> bosses_beaten_;
+
+    // 刷怪节奏：自己数回合（移动、胜利各算一回合），怪物被打光时记下什么时候再来
+    std::uint64_t turns_{0};
+    std::string target_;                                   // 上一次挑战的怪物
+    std::unordered_map<std::string, std::uint64_t> blocked_; // 怪物名 -> 再次尝试的回合
+    std::unordered_map<std::string, int> respect_;           // 输过的怪物名 -> 再次挑战需要的等级
+
+    // 菜单内容（最近一次输出里解析出来的编号选项）
+    std::vector<Option> options_;
+    TalkGoal talk_goal_{TalkGoal::NONE};
+    bool goal_chosen_{false};
+    bool followup_taken_{false};
+    bool starter_gear_{false};
+    int shop_visited_coins_{0};  // 上次进商店时的金币
+    bool shop_fresh_{false};     // 上次进商店之后商店进了新货
+    size_t allocations_{0};      // 加过几次点（轮流选择属性）
+    std::deque<std::string> pending_;  // 已经决定好、接下来依次输入的指令
+};
+
+// 一个bot玩一局的结果
+struct BotReport {
+    size_t commands{0};
+    BotStage stage{BotStage::INTRO};
+    int level{0};
+    int deaths{0};
+    int keys{0};
+    bool finished{false};
+    double seconds{0.0};
+    std::uint64_t state_hash{0};
+};
+
+// 在进程内用一个新的Game（种子为 game_seed）跑一个bot
+// output 不为空时写入游戏的全部输出；recorder 不为空时记录每行输入，之后可以用 --replay 回放
+BotReport runBot(const BotConfig& config, std::uint32_t game_seed,
+                 std::ostream* output = nullptr, TranscriptWriter* recorder = nullptr);
+
+} // namespace hx
@@ -5,6 +5,7 @@
 #include "Player.hpp"     // 玩家类
 #include "Enemy.hpp"      // 敌人类
 #include <random>         // 随机数生成
+#include <sstream>        // 字符串流
 #include <string>         // 字符串
 #include <vector>         // 向量容器
 #include <functional>     // 函数对象
@@ -34,12 +35,55 @@ struct Skill {
     std::function<void(Player&, Enemy&, std::string&)> effect;          // 技能效果函数
 };
 
+// 进行中的战斗
+// 功能：保存一场战斗回合之间的全部状态。CombatSystem::advance 每次推进若干回合就返回，
+//       下次从同一回合继续；战斗日志可以分段取出，边打边显示
+struct CombatEncounter {
+    CombatEncounter(Player& p, const Enemy& e) : player(&p), enemy(e), ea(e.attr()) {}
+
+    Player* player;
+    Enemy enemy;                  // 敌人（战斗结束后用于结算奖励）
+    Attributes ea;                // 敌人战斗中的属性副本
+    int tier{1};                  // 动态难度层级：0=新手 1=默认 2=熟练
+    int turn{0};                  // 已进行的回合数
+    int reading_buff_turns{0};    // 文献综述怪阅读增防
+    bool is_failed_revive{false}; // 是否为实验失败妖·复苏
+    int summoned_minions{0};      // 复苏Boss召唤的小怪数量
+    int summon_cooldown{0};       // 距离下次召唤的回合数
+    bool finished{false};         // 战斗是否已结束
+    bool won{false};              // 玩家是否获胜（finished 后有效）
+
+    // 取出上次取出之后产生的战斗日志
+    std::string takeLog() {
+        std::string text = log.str();
+        log.str(std::string());
+        return text;
+    }
+
+    std::ostringstream log;
+};
+
 class CombatSystem {
 public:
     explicit CombatSystem(unsigned seed = std::random_device{}());
     void setGameState(class GameState* gs) { game_state_ = gs; }
+    // 重新设置随机种子（录制回放时让战斗结果可重现）
+    void seed(unsigned s) { rng_.seed(s); }
+    // 随机数引擎（会话休眠时从中抽出恢复后的种子）
+    std::mt19937& engine() { return rng_; }
     
+    // 一次打完整场战斗，返回玩家是否获胜
     bool fight(Player& player, Enemy& enemy, std::string& log);
+    
+    // 开始一场战斗：计算难度层级、触发开场装备效果
+    CombatEncounter begin(Player& player, const Enemy& enemy);
+    // 玩家当前对应的动态难度层级：0=新手 1=默认 2=熟练
+    int tierFor(const Player& player) const;
+    // 模拟一整场战斗（胜率预估用）：不写战斗日志、不计入任何统计，也不改动游戏状态，
+    // 只改动传入的 player（调用方传副本）；turns 返回打了几回合。超过 max_turns 回合算作失败
+    bool simulate(Player& player, const Enemy& enemy, int tier, int& turns, int max_turns = 1000);
+    // 推进战斗最多 max_turns 回合（<=0 表示打到结束），返回战斗是否已结束
+    bool advance(CombatEncounter& encounter, int max_turns);
     bool processPlayerAction(Player& player, Enemy& enemy, CombatAction action, 
                            const std::string& target, std::string& log);
     
@@ -51,7 +95,9 @@ public:
     int calculatePhysicalDamage(const Player& player, const Enemy& enemy, double random_factor = 1.0);
     int calculateSkillDamage(const Skill& skill, const Player& player, const Enemy& enemy);
     
-    int updateCombatStatuses(Player& player, Enemy& enemy);
+    int updateCombatStatuses(Player& player, Enemy& enemy, int turn);
+    // 一件装备让玩家对这个敌人的普攻伤害乘上的倍率（钢勺护符对实验失败妖×1.3，其它为1）
+    static double equipmentDamageMultiplier(const Item& item, const Enemy& enemy);
     bool attemptFlee(const Player& player, const Enemy& enemy);
 
 private:
@@ -65,6 +111,9 @@ private:
     bool rollHit(int attacker_spd, int defender_spd);
     
     void initializeSkills();
+    void open(CombatEncounter& c);       // 开场：开场装备效果、复苏Boss的召唤节律
+    void playTurn(CombatEncounter& c);   // 进行一个回合
+    void finishEncounter(CombatEncounter& c); // 战斗结束结算（失败提示、S3统计）
     
     void skillKnowledgeTheft(Player& player, Enemy& enemy, std::string& log);
     void skillDeadlineRush(Player& player, Enemy& enemy, std::string& log);
@@ -0,0 +1,39 @@
+// 这是战前胜率预估的头文件
+// 作者：大一学生
+// 功能：在战斗菜单里给每个敌人标上预估胜率和平均回合数。
+//       做法是用 CombatSystem::simulate 把同一场战斗模拟几千次（蒙特卡洛），分成固定的若干组，
+//       放到进程共用的线程池里并行跑（见 WorkerPool.hpp）；
+//       每组的随机种子只由缓存键和组号决定，所以结果与线程数无关，
+//       同样的局面总是给出同样的数字，也不会动到游戏自己的随机数（录制回放照样能重现）。
+//       结果按（玩家属性、状态和装备的签名，怪物，难度层级）缓存在进程里，所有会话共用，
+//       其中生命值按最大生命的二十分之一分档，模拟也从所在档的上沿开打，
+//       同一局面第二次查看时直接取缓存
+
+#pragma once
+#include <cstddef>  // size_t
+#include <cstdint>  // 定宽整数
+
+namespace hx {
+
+class Player;
+class Enemy;
+
+// 一次预估的结果
+struct CombatForecast {
+    double win_rate{0.0};        // 胜率（0~1）
+    double expected_turns{0.0};  // 平均回合数（输赢都算）
+    int trials{0};               // 模拟了多少场
+};
+
+// 预估玩家以当前状态挑战 enemy 的结果；tier 为动态难度层级（见 CombatSystem::tierFor）
+CombatForecast forecastCombat(const Player& player, const Enemy& enemy, int tier);
+
+// 缓存统计
+struct ForecastCacheStats {
+    std::uint64_t hits{0};
+    std::uint64_t misses{0};
+    size_t entries{0};
+};
+ForecastCacheStats forecastCacheStats();
+
+} // namespace hx
@@ -1,20 +1,60 @@
+// 这是命令系统的头文件
+// 作者：大一学生
+// 功能：把玩家输入的一行切分成指令词和参数，并把编号等参数解析成对应的类型
+
 #pragma once
-#include <string>
-#include <vector>
-#include <functional>
-#include <unordered_map>
+#include <array>          // 固定大小数组
+#include <string>         // 字符串
+#include <string_view>    // 不复制的字符串片段
+#include <vector>         // 向量容器
+#include <functional>     // std::function
+#include <unordered_map>  // 哈希映射
 
 namespace hx {
 class Game; // fwd
 
+// 一行指令的切分结果
+// 功能：把输入规范化到复用的缓冲区里（全角空格、全角数字转成半角，去掉首尾空白，
+//       连续空白合并成一个，指令词里的英文字母转小写），再按空格切成若干个词；
+//       词都是指向缓冲区的 string_view，下一次 parse 之前有效。
+//       缓冲区容量够用之后，切分过程不再申请内存
+class CommandLine {
+public:
+    static constexpr size_t kMaxWords = 16;  // 超出的部分并入最后一个词
+
+    void parse(std::string_view raw);
+
+    // 规范化之后的整行
+    const std::string& text() const { return buf_; }
+    size_t size() const { return count_; }
+    bool empty() const { return count_ == 0; }
+    // 第 i 个词，不存在时为空
+    std::string_view word(size_t i) const { return i < count_ ? words_[i] : std::string_view{}; }
+    // 指令词（第一个词）
+    std::string_view verb() const { return word(0); }
+    // 从第 i 个词到行尾的内容（物品名、任务名中间可以有空格）
+    std::string_view rest(size_t i = 1) const;
+
+private:
+    std::string buf_;
+    std::array<std::string_view, kMaxWords> words_{};
+    size_t count_{0};
+};
+
+// 编号参数：整段都是数字时成功（半角、全角数字都可以），不会抛异常
+bool parseIndex(std::string_view s, int& out);
+
 class CommandRouter {
 public:
-    using Handler = std::function<void(Game&, const std::vector<std::string>&)>;
+    using Handler = std::function<void(Game&, const CommandLine&)>;
     void add(const std::string& name, Handler h);
     bool route(Game& g, const std::string& line);
+    // 堆上占用的字节数（会话内存统计用，见MemoryUsage.hpp）
+    size_t heapBytes() const;
 
 private:
     std::unordered_map<std::string, Handler> handlers_;
+    CommandLine line_;
 };
 
 std::vector<std::string> splitWords(const std::string& line);
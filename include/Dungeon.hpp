@@ -0,0 +1,95 @@
+// 这是秘境（无尽地下城）的头文件
+// 作者：大一学生
+// 功能：文心潭下面的无尽秘境。每一层都由（世界种子, 层数）确定地生成：房间的布局和出口、
+//       从怪物原型表里挑出并按层数加强的怪物、怪物身上的掉落，同样的种子和层数总是得到同样的一层。
+//       - 只有玩家附近用到的几层放在地图里，按最近使用排成LRU，层数或估算的内存超过上限时
+//         淘汰最久没用的层（把它的房间从地图里移除）；
+//       - 被淘汰的层只留下一份很小的改动记录（哪些房间的怪物已经被击败），再次走到时重新生成、
+//         套用改动记录，和淘汰前一样；
+//       所以不管玩家走到多深，常驻的房间数都不超过上限，内存不会越走越多。
+//       地点ID：第 n 层的入口是 "mj<n>_0"，下楼的阶梯是 "mj<n>_down"，其余房间是 "mj<n>_<编号>"；
+//       第 n 层放在地图层 kLayerBase+n 上，视口地图照常显示
+
+#pragma once
+#include "Enemy.hpp"     // 敌人类（怪物原型）
+#include "Location.hpp"  // 地点类
+#include <cstddef>       // size_t
+#include <cstdint>       // 定宽整数
+#include <list>          // 常驻层的LRU
+#include <map>           // 改动记录（按层数排序，存档和哈希的顺序固定）
+#include <string>        // 字符串
+#include <vector>        // 向量容器
+
+namespace hx {
+
+class Map;
+
+// 秘境
+// 功能：管理秘境各层的生成、常驻和淘汰，以及玩家在各层留下的改动
+class Dungeon {
+public:
+    static constexpr int kLayerBase = 100;              // 第 n 层用地图层 kLayerBase+n
+    static constexpr int kMaxFloor = 9999;              // 最深的一层（地图层号要放得进空间索引）
+    static constexpr size_t kMaxResidentFloors = 8;     // 最多同时放在地图里的层数
+    static constexpr size_t kMaxResidentBytes = 96 * 1024; // 常驻层合计的内存上限（估算，见MemoryUsage.hpp）
+    static constexpr const char* kGateId = "wenxintan"; // 秘境的入口所在的地点
+    static constexpr const char* kDownLabel = "下楼";   // 去下一层的出口
+    static constexpr const char* kUpLabel = "上楼";     // 回上一层的出口
+
+    // 世界种子：各层的内容只由它和层数决定
+    void setSeed(std::uint32_t seed) { seed_ = seed; }
+    std::uint32_t seed() const { return seed_; }
+
+    // 怪物原型表：建立世界时从地图上的普通怪物里收集（文心潭的试炼之敌和太弱的怪物不算）
+    void setCatalog(const Map& map);
+    const std::vector<Enemy>& catalog() const { return catalog_; }
+
+    // 在入口地点加上通往第1层的出口（建立世界和读档后调用，旧存档的出口表里没有它）
+    void attach(Map& map) const;
+
+    // 地点ID
+    static std::string entranceId(int floor);
+    static std::string stairsId(int floor);
+    // 地点ID属于秘境的第几层（不是秘境的房间返回0）
+    static int floorOf(const std::string& location_id);
+
+    // 确保第 floor 层在地图里（不在就生成并套用改动记录），记为最近使用；
+    // 然后按上限淘汰最久没用的层，floor 和 keep 两层不淘汰（keep 通常是玩家正在离开的那一层）
+    void enter(Map& map, int floor, int keep = 0);
+
+    // 秘境房间里的怪物被击败：从房间移除，记入这一层的改动记录；不是秘境房间时返回false
+    bool onMonsterDefeated(Map& map, const std::string& location_id);
+
+    // 把所有常驻层移出地图，清空改动记录（读档前调用）
+    void reset(Map& map);
+    // 读档：恢复到过的最深层数和改动记录（层数 -> 已清理的房间编号）
+    void restore(int deepest, std::map<int, std::vector<int>> cleared);
+
+    int deepest() const { return deepest_; }                                 // 到过的最深层数
+    const std::map<int, std::vector<int>>& cleared() const { return cleared_; } // 改动记录
+    size_t residentFloors() const { return resident_.size(); }
+    size_t residentBytes() const { return resident_bytes_; }
+    // 原型表、改动记录和LRU本身占用的堆内存（常驻层的房间在地图里，按地图计）
+    size_t heapBytes() const;
+
+private:
+    // 一个常驻层：层数、按生成顺序的房间ID（改动记录里的房间编号就是这里的下标）、估算的内存
+    struct Floor {
+        int number;
+        std::vector<std::string> rooms;
+        size_t bytes;
+    };
+
+    std::uint32_t seed_{0};
+    std::vector<Enemy> catalog_;            // 怪物原型（按等级和名称排序）
+    std::list<Floor> resident_;             // 常驻层，前面的是最近用过的
+    size_t resident_bytes_{0};
+    std::map<int, std::vector<int>> cleared_; // 改动记录：每层已经清理掉怪物的房间编号
+    int deepest_{0};
+
+    std::vector<Location> generate(int floor) const; // 生成一层（不含改动）
+    Enemy makeMonster(const Enemy& prototype, int floor, bool guardian) const; // 按层数加强原型
+    void evict(Map& map, std::list<Floor>::iterator it);
+};
+
+} // namespace hx
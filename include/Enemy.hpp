@@ -18,8 +18,9 @@ public:
     int coinReward() const { return coin_reward_; }
     int xpReward() const { return xp_reward_; }
     
-    // 获取怪物等级（基于属性估算）
+    // 获取怪物等级（指定过等级时用指定的，否则基于名称和属性估算）
     int getLevel() const;
+    void setLevel(int level) { level_ = level; }
     
     // 特殊技能相关
     void setSpecialSkill(const std::string& skill_name, const std::string& description);
@@ -60,6 +61,7 @@ public:
 private:
     int coin_reward_{0};
     int xp_reward_{0};
+    int level_{0}; // 指定的等级，0表示估算
     std::string special_skill_;
     std::string special_skill_description_;
     std::vector<DropItem> drop_items_;
@@ -0,0 +1,87 @@
+// 这是名称模糊匹配索引的头文件
+// 作者：大一学生
+// 功能：按UTF-8字符（而不是字节）给名称建立单字和双字索引，把玩家随手输入的
+//       NPC名、怪物名、物品名、指令解析成最相关的条目，并按相关度排序
+
+#pragma once
+#include <cstdint>        // 定宽整数
+#include <functional>     // std::function
+#include <string>         // 字符串
+#include <string_view>    // 查询时不复制输入
+#include <unordered_map>  // 哈希映射
+#include <vector>         // 向量容器
+
+namespace hx {
+
+// 名称模糊匹配索引
+// 功能：条目由调用者给定的键标识，可以随时增删（背包物品变化时增量更新）；
+//       查询时只看与输入共享字的条目，耗时与条目总数无关
+class FuzzyIndex {
+public:
+    using Key = std::uint32_t;
+
+    // 匹配类型，越靠前越相关
+    enum class MatchKind {
+        EXACT,      // 名称与输入相同
+        PREFIX,     // 名称以输入开头
+        CONTAINS,   // 名称包含输入
+        CONTAINED,  // 输入包含名称（例如"我要挑战迷糊书虫"）
+        SIMILAR     // 字面相似（错字、漏字）
+    };
+
+    struct Match {
+        Key key;
+        MatchKind kind;
+        double similarity;  // 双字重合度（Dice系数），0~1
+    };
+
+    // 添加条目；键已存在时替换名称
+    void insert(Key key, const std::string& name);
+    // 删除条目
+    void erase(Key key);
+    void clear();
+
+    bool contains(Key key) const { return slot_of_.count(key) != 0; }
+    size_t size() const { return slot_of_.size(); }
+    // 堆上占用的字节数（会话内存统计用，见MemoryUsage.hpp）
+    size_t heapBytes() const;
+    // 条目的名称（键必须存在）
+    const std::string& name(Key key) const;
+
+    // 按相关度返回匹配结果，最多 limit 个（0表示不限）
+    // 同类匹配中相似度高的在前，再按键从小到大
+    std::vector<Match> search(std::string_view query, size_t limit = 0,
+                              double min_similarity = kDefaultSimilarity) const;
+
+    // 最相关的条目；accept 不为空时只考虑它接受的条目；没有匹配时返回false
+    // 边统计边比较，不生成结果列表
+    bool best(std::string_view query, Key& out,
+              const std::function<bool(Key)>& accept = nullptr,
+              double min_similarity = kDefaultSimilarity) const;
+
+    static constexpr double kDefaultSimilarity = 0.5;
+    // 用作 min_similarity 时不接受只是字面相似的匹配（相似度最大为1）
+    static constexpr double kNoSimilar = 2.0;
+
+private:
+    struct Entry {
+        Key key{0};
+        std::string name;
+        std::vector<std::uint64_t> grams;  // 去重后的单字和双字
+        std::uint32_t unigrams{0};         // 不同单字的个数
+        std::uint32_t bigrams{0};          // 不同双字的个数
+        bool used{false};
+    };
+
+    // 统计与输入共享字的条目，对每个够得上的条目调用 visit(const Match&)
+    template <class Visit>
+    void scan(std::string_view query, double min_similarity, Visit&& visit) const;
+
+    std::vector<Entry> entries_;
+    std::vector<std::uint32_t> free_;                                       // 空出来的位置
+    std::unordered_map<Key, std::uint32_t> slot_of_;                        // 键 → 位置
+    std::unordered_map<std::uint64_t, std::vector<std::uint32_t>> postings_; // 字 → 含有它的位置
+    std::unordered_map<std::uint64_t, std::vector<std::uint32_t>> short_postings_; // 只有一个字的名称
+};
+
+} // namespace hx
@@ -6,71 +6,234 @@
 #include "GameState.hpp" // 游戏状态
 #include "Map.hpp"       // 地图系统
 #include "Player.hpp"    // 玩家类
-#include "Quest.hpp"     // 任务系统
 #include "Combat.hpp"    // 战斗系统
 #include "Command.hpp"   // 命令系统
+#include "InputFlow.hpp" // 交互流程
+#include "FuzzyIndex.hpp" // 名称模糊匹配
+#include "StateHash.hpp"  // 状态哈希
+#include "MemoryUsage.hpp" // 会话内存统计
+#include "OfflineProgress.hpp" // 离线进度补算
+#include <cstdint>       // 定宽整数
+#include <functional>    // std::function
+#include <memory>        // 智能指针
+#include <random>        // 随机数
+#include <vector>        // 向量容器
 
 namespace hx {
+class TranscriptWriter; // 输入记录（见Replay.hpp）
+
 // 游戏主类
 // 管理整个游戏的运行，包括地图、玩家、战斗、任务等
 class Game {
 public:
     // 构造函数
-    // 初始化游戏，设置世界和战斗系统
-    Game();
+    // 初始化游戏，设置世界和战斗系统；seed 决定这一局所有的随机结果（战斗、掉落、商店进货）
+    explicit Game(std::uint32_t seed = std::random_device{}());
+    ~Game();
+    Game(const Game&) = delete;
+    Game& operator=(const Game&) = delete;
     
     // 运行游戏主循环
-    // 开始游戏，处理玩家输入和游戏逻辑
-    void run();
+    // 开始游戏，处理玩家输入和游戏逻辑；recorder 不为空时把每行输入记录下来
+    void run(TranscriptWriter* recorder = nullptr);
+    
+    // 这一局的随机种子（同一个种子加上同样的输入，得到同样的游戏过程）
+    std::uint32_t seed() const { return seed_; }
+    
+    // 开始游戏：显示标题和开场剧情（开场剧情会等待后续输入）
+    void start();
+    
+    // 处理一行玩家输入；输入quit时返回false
+    // 交互流程只在等待输入时保存状态，不占用调用线程
+    // 用分号隔开的多条指令（"w; w; fight 1"）作为批处理：这里只执行第一条，其余的由resume逐条执行；
+    // 以 "quiet " 开头时只保留最后一条指令的输出
+    // at_ms 是这行输入到达的真实时刻（system_clock，毫秒），-1 表示取当前时刻；
+    // 距上一行输入够久时先做离线补算（见OfflineProgress.hpp），回放按记录里的时刻传入
+    bool handleLine(const std::string& line, std::int64_t at_ms = -1);
+    
+    // 读取下一行之前应显示的提示语（战斗或批处理还没完成时为空）
+    std::string prompt() const;
+    
+    // 是否有战斗还没打完（设置了战斗回合预算时，战斗会分多段进行），或批处理还有指令没执行
+    bool busy() const { return combat_run_ != nullptr || batching(); }
+    
+    // 是否有战斗还没打完
+    bool inCombat() const { return combat_run_ != nullptr; }
+    
+    // 是否在执行批处理（多会话时，批处理全部完成后才送出这段输出）
+    bool batching() const { return batch_.next < batch_.text.size(); }
+    
+    // 继续未完成的工作：进行中的战斗推进一段回合并输出这段日志，打完时结算胜负；
+    // 没有战斗时执行批处理的下一条指令。批处理中输入quit时返回false
+    bool resume();
+    
+    // 每段最多推进的战斗回合数；0表示一次打完（终端版默认）
+    void setCombatTurnBudget(int turns) { combat_turn_budget_ = turns; }
+    
+    // 当前游戏状态的内容哈希（回放校验、缓存键）
+    StateDigest stateHash() const { return hashState(state_); }
+    
+    // 这一局各部分占用的内存（现算，见MemoryUsage.hpp）
+    MemoryReport memoryUsage() const;
     
+    // 结算一个敌人的掉落，放进玩家背包（战斗胜利时调用，基准测试也单独测它）
+    void processEnemyDrops(const Enemy& enemy);
+    
+    // 离线补算：一次推进 turns 个世界回合（刷新点、商店、状态效果），所在地点的普通怪物按挂机刷怪结算
+    // 输出全部静默，结果由返回值汇总（见OfflineProgress.hpp）；玩家离开后回来的第一行输入和读档时调用
+    OfflineReport catchUp(std::uint64_t turns);
+
+    // 会话休眠（见SessionScheduler.hpp）：空闲的一局存成内存里的一段紧凑数据，整个Game随后释放，
+    // 下一行输入到达时在用同一个种子新建的Game上恢复。战斗、批处理没完成，
+    // 或者商店、对话、菜单在等待输入时不能休眠
+    bool canHibernate() const { return !busy() && !flow_.waiting(); }
+    std::string hibernate();
+    // 恢复休眠数据（输出全部静默）；数据损坏时返回false。
+    // 最后一次输入的时刻在存档部分里，离线补算和没休眠时一样在下一行输入到达时做
+    bool restore(const std::string& blob);
+
+    // 存档位：save/load 指令读写这个字符串而不是当前目录的save.dat（为空指针时用save.dat）。
+    // 多会话时每个会话有自己的存档位，玩家之间读不到彼此的存档，也不会读到别人写了一半的文件
+    void setSaveSlot(std::string* slot) { save_slot_ = slot; }
+
     GameState& state() { return state_; }
     CombatSystem& combat() { return combat_; }
     
     // 初始化NPC对话
     void initializeNPCDialogues();
 private:
+    std::uint32_t seed_;
+    std::mt19937 rng_;  // 掉落等游戏逻辑使用的随机数（战斗和商店各有自己的）
     GameState state_{};
     CombatSystem combat_{};
     CommandRouter router_{};
+    CommandLine command_{};  // 当前这一行输入的切分结果（缓冲区复用）
     bool in_teaching_detail_ = false;
+    std::string* save_slot_{nullptr};  // 存档位（见setSaveSlot）
+    bool saveGame() const;             // 执行save指令的存档
+    bool loadGame();                   // 执行load指令的读档
+
+    // 离线补算的时间：当前这行输入的时刻，以及离开了还没补算的回合
+    // （回来时正在商店、对话等菜单里，等菜单结束后的下一行输入再补算）
+    std::int64_t input_ms_{0};
+    std::uint64_t away_turns_{0};
+    void noteInputTime(std::int64_t now_ms); // 记下这行输入的时刻，离开够久的话累计要补算的回合
+    void settleAway();                       // 不在菜单里时补算累计的回合并显示结果
+    
+    // 交互流程：商店、对话、选择菜单等待输入时的下一步
+    InputFlow flow_{};
+    std::string shop_npc_;                 // 正在浏览的商店
+    std::function<void()> shop_on_close_;  // 离开商店后继续的流程
+    
+    // 对话流程的状态（等待玩家选择时保存在这里）
+    struct TalkSession {
+        std::string npc_name;
+        std::string dialogue_id;
+        int player_favor{0};
+        std::vector<size_t> available_options;  // 当前显示的选项（重新编号后）
+    };
+    TalkSession talk_{};
+    
+    // 进行中的战斗（分段进行时在两段之间保存在这里）
+    struct ActiveCombat {
+        CombatEncounter encounter;
+        int old_xp;
+        int old_coins;
+        int old_level;
+        bool notify_wenxin_fail;  // 失败时是否触发文心潭的失败反馈
+    };
+    std::unique_ptr<ActiveCombat> combat_run_;
+    int combat_turn_budget_ = 0;
+    void advanceCombat(); // 推进进行中的战斗一段回合
+    
+    // 批处理：一行里用分号隔开的多条指令
+    struct Batch {
+        std::string text;      // 去掉静默前缀后的整行，各条指令在执行时从中取出
+        size_t next{0};        // 下一条指令的起点；等于 text.size() 时批处理已完成
+        size_t executed{0};    // 已执行的指令数
+        bool quiet{false};     // 只保留最后一条指令的输出
+        bool muted{false};     // 当前这条指令（以及它引起的战斗）的输出被丢弃
+    };
+    Batch batch_{};
+    bool execute(std::string_view line);         // 执行一条指令；quit时返回false
+    bool nextBatchCommand(std::string_view& out); // 取出批处理的下一条指令
+    bool batchHasMore() const;                    // 批处理后面是否还有指令
+    
+    // 名称模糊匹配索引（建立世界时建立一次）
+    FuzzyIndex npc_names_{};
+    FuzzyIndex monster_names_{};
+    FuzzyIndex command_hints_{};  // 指令别名（未知指令时给出建议）
+    FuzzyIndex location_names_{}; // 地点名（自动寻路；秘境的层会增删，地图变了以后寻路前重建）
+    std::uint64_t location_names_revision_{0}; // 建索引时地图的 revision()
+    
+    // 计入所有会话合计的内存（见MemoryUsage.hpp）：每隔一些指令重新统计一次，报告差值
+    void publishMemory();
+    MemoryReport memory_published_{};
+    unsigned commands_since_memory_{0};
     
     void setupWorld();
+    void buildNameIndexes(); // 建立NPC、怪物、指令的模糊匹配索引
+    void buildLocationIndex(); // 建立地点名索引
+    std::string resolveName(const FuzzyIndex& index, std::string_view input,
+                            const std::vector<std::string>& candidates) const; // 在候选名称中找与输入最相关的
+    const Enemy* matchEnemy(const Location& loc, std::string_view input) const; // 在地点的怪物中找与输入最相关的
     void createLocations();
     void createNPCs();
     void createItems();
     void createTasks();
     void printBanner() const;
     void look() const;
-    void move(const std::string& label);
+    void move(const std::string& label, bool render = true); // 沿出口移动；render为false时不清屏、不显示到达的地点
+    void travelTo(std::string_view target); // 自动寻路：按路由表一步步走到目标地点，只在终点显示一次
     void talk(const std::string& npc_name);
+    NPC* talkingNPC(); // 当前对话的NPC
+    void showDialogue(); // 显示当前对话节点并等待选择
+    void onDialogueInput(const std::string& input); // 处理对话选择
+    void onDialogueErrorInput(const std::string& input); // 对话内容缺失时处理输入
+    void endTalk(); // 结束对话
     void switchToTeachingDetail(); // 切换到教学区详细地图
     void switchToMainMap(); // 切换回主地图
-    void renderTeachingDetailMap() const; // 渲染教学区详细地图
-    void renderMainMap() const; // 渲染主地图
+    void renderMap() const; // 渲染玩家附近的地图（视口）
     void handlePlayerDeath(); // 处理玩家死亡逻辑
-    void openShop(const std::string& npc_name); // 打开商店
+    void openShop(const std::string& npc_name, std::function<void()> on_close = nullptr); // 打开商店
+    void showShopPage(); // 显示商店页面并等待输入
+    void onShopInput(const std::string& input); // 处理商店输入
+    void closeShop(); // 离开商店
     void showQuest(const std::string& npc_name); // 显示任务
     void handleSpecialRewards(const std::string& npc_name, const std::string& dialogue_id, 
                              int choice, const NPC* npc); // 处理特殊奖励
     void showOpeningStory(); // 显示开场剧情
-    void processEnemyDrops(const Enemy& enemy); // 处理敌人掉落物品
+    void awaitOpeningKeyword(); // 等待输入"翻阅古籍"
+    void showOpeningChapter2(); // 开场剧情第二章
+    void showOpeningGuide(); // 新手引导
     void showContextualHelp(); // 显示上下文相关帮助
     void showSmartActions() const; // 显示智能操作提示
     void showAtmosphereDescription(const std::string& locationId) const; // 显示氛围描述
     void showEnhancedOperations() const; // 显示增强版操作指南
     void renderEnhancedMainMap() const; // 渲染增强版主地图
     void renderEnhancedTeachingDetailMap() const; // 渲染增强版教学区地图
-    void printCombatSummary(const Enemy& enemy, int old_xp, int old_coins, int old_level); // 打印战斗小结
-    void handleCombatVictory(const Enemy& enemy, int old_xp, int old_coins, int old_level); // 统一的战斗胜利处理
+    void printCombatSummary(int old_level); // 打印战斗小结
+    void handleCombatVictory(const Enemy& enemy, int old_level); // 统一的战斗胜利处理
     void triggerChapter4Transition(); // 触发第四章过渡界面
+    void registerEventListeners(); // 订阅游戏事件（击败怪物、获得物品、对话选择等的后续反应）
+    void askDebateQuestion(size_t index, int correct); // S4对话挑战：第index题
     void talkAuto(); // 无参数对话：弹出可选NPC菜单/模糊匹配
     void fightAuto(); // 无参数战斗：列出敌人并选择
+    void fightMonster(const std::string& monster_name); // 与选定的怪物战斗
+    void beginCombat(const Enemy& en, bool notify_wenxin_fail); // 显示战斗开场并开始战斗
+    void finishCombat(); // 战斗结束：胜利结算或死亡惩罚
     void equipAuto(); // 无参数装备：列出可装备物品
+    void equipNamed(const std::string& item_name, std::function<void(bool)> on_result); // 装备（必要时询问饰品槽位）
     void unequipAuto(); // 无参数卸下：列出可卸下槽位
+    void recommendLoadout(std::string_view target); // 配装建议：对指定怪物（空为同级对手）找出最好的装备搭配
+    void farmSpawn(size_t index, std::uint64_t from, std::uint64_t to, OfflineReport& report); // 离线补算：在一个刷新点挂机刷怪
+    void printOfflineReport(const OfflineReport& report) const; // 显示离线补算的结果
     
     // 怪物管理系统
     void initializeMonsterSpawns(); // 初始化怪物刷新信息
-    void updateMonsterSpawns(); // 更新怪物刷新状态
+    void scheduleWorldTimers(); // 安排世界定时任务（状态效果、商店刷新、怪物刷新）
+    void scheduleRespawn(size_t index); // 为刷新点安排重生任务
+    void respawnMonster(size_t index); // 怪物重生（由调度器调用）
     bool canSpawnMonster(const std::string& location_id, const std::string& monster_name) const; // 检查是否可以生成怪物
     int getAvailableMonsterCount(const std::string& location_id, const std::string& monster_name) const; // 获取可用怪物数量
     void onMonsterDefeated(const std::string& location_id, const std::string& monster_name); // 怪物被击败时的处理
@@ -0,0 +1,109 @@
+// 这是游戏事件总线的头文件
+// 作者：大一学生
+// 功能：定义游戏内的类型化事件（击败怪物、获得物品、进入地点、好感变化、升级、对话选择）
+//       以及按事件类型分组的监听器表，事件只分发给订阅了它的监听器
+
+#pragma once
+#include <functional>  // std::function
+#include <string>      // 字符串
+#include <tuple>       // 按类型存放监听器表
+#include <type_traits> // decay_t
+#include <utility>     // std::move
+#include <vector>      // 向量容器
+
+namespace hx {
+
+class Enemy; // 前向声明
+class NPC;   // 前向声明
+struct Item; // 前向声明
+
+// 击败怪物
+struct MonsterDefeatedEvent {
+    const Enemy& enemy;           // 被击败的敌人
+    const std::string& location;  // 战斗发生的地点ID
+    int old_level;                // 战斗前的等级（战斗小结显示升级用）
+};
+
+// 获得物品（掉落、奖励、购买）
+struct ItemGainedEvent {
+    const Item& item;
+    int count;
+};
+
+// 进入地点
+struct LocationEnteredEvent {
+    const std::string& from;  // 离开的地点ID
+    const std::string& to;    // 进入的地点ID
+};
+
+// NPC好感度变化
+struct FavorChangedEvent {
+    const std::string& npc_name;
+    int old_favor;
+    int new_favor;
+};
+
+// 升级
+struct LevelUpEvent {
+    int old_level;
+    int new_level;
+};
+
+// 对话中选择了一个选项（选项自带的好感变化和行动已执行）
+struct DialogueChoiceEvent {
+    const std::string& npc_name;
+    const std::string& dialogue_id;  // 选择时所在的对话节点
+    int choice;                      // 选项编号（从1开始）
+    const NPC* npc;
+};
+
+// 事件总线
+// 功能：每种事件一张监听器表，订阅在初始化时完成，发布时只遍历该事件的表
+class EventBus {
+public:
+    template <typename Event>
+    using Listener = std::function<void(const Event&)>;
+
+    // 订阅某一类事件
+    template <typename Event>
+    void subscribe(Listener<Event> listener) {
+        listenersOf<Event>().push_back(std::move(listener));
+    }
+
+    // 发布事件，按订阅顺序依次调用监听器
+    // 用下标遍历：监听器内部再次发布或订阅时不会使迭代器失效
+    template <typename Event>
+    void publish(const Event& event) const {
+        const auto& listeners = std::get<std::vector<Listener<Event>>>(listeners_);
+        for (size_t i = 0; i < listeners.size(); ++i) {
+            listeners[i](event);
+        }
+    }
+
+    // 清空所有监听器
+    void clear() {
+        std::apply([](auto&... lists) { (lists.clear(), ...); }, listeners_);
+    }
+
+    // 堆上占用的字节数（会话内存统计用；监听器捕获的内容不计入）
+    size_t heapBytes() const {
+        return std::apply([](const auto&... lists) {
+            return (size_t{0} + ... + (lists.capacity() * sizeof(typename std::decay_t<decltype(lists)>::value_type)));
+        }, listeners_);
+    }
+
+private:
+    template <typename Event>
+    std::vector<Listener<Event>>& listenersOf() {
+        return std::get<std::vector<Listener<Event>>>(listeners_);
+    }
+
+    std::tuple<std::vector<Listener<MonsterDefeatedEvent>>,
+               std::vector<Listener<ItemGainedEvent>>,
+               std::vector<Listener<LocationEnteredEvent>>,
+               std::vector<Listener<FavorChangedEvent>>,
+               std::vector<Listener<LevelUpEvent>>,
+               std::vector<Listener<DialogueChoiceEvent>>> listeners_;
+};
+
+} // namespace hx
@@ -5,9 +5,12 @@
 #pragma once
 #include "Player.hpp"     // 玩家类
 #include "Map.hpp"        // 地图类
-#include "Quest.hpp"      // 任务类
-#include "Task.hpp"       // 任务管理器
+#include "Task.hpp"       // 任务管理器（唯一的任务存储）
 #include "ShopSystem.hpp" // 商店系统
+#include "GameEvents.hpp" // 事件总线
+#include "TickScheduler.hpp" // 回合调度器
+#include "Dungeon.hpp"    // 秘境
+#include <cstdint>        // 定宽整数
 #include <unordered_map>  // 哈希映射
 #include <unordered_set>  // 哈希集合
 
@@ -19,8 +22,8 @@ struct GameState {
     bool in_teaching_detail = false; // 是否在教学区详细地图中
     Player player{}; 
     Map map; 
-    QuestLog quests; 
     TaskManager task_manager; // 任务管理器
+    EventBus events; // 本世界的事件总线
     // 主线与结局相关状态
     int wenxintan_fail_streak{0};
     bool key_i_obtained{false};
@@ -36,12 +39,16 @@ struct GameState {
     bool s4_reward_given{false};
     bool math_difficulty_spirit_first_kill{false}; // 首次击败高数难题精标记
     
+    // 玩家最后一次输入的真实时刻（system_clock，毫秒），离线补算从这里算起；0表示没有记录
+    std::int64_t last_active_ms{0};
+    
     // 对话记忆系统 - 记录已选择过的对话选项
     std::unordered_map<std::string, std::unordered_set<std::string>> dialogue_memory;
     
-    // 回合计数器和商店系统
-    int turn_counter{0}; // 游戏回合计数器
+    // 回合调度器和商店系统
+    TickScheduler scheduler; // 世界回合时钟，状态效果、怪物刷新、商店刷新都挂在这里
     ShopSystem shop_system; // 商店系统
+    Dungeon dungeon; // 秘境：常驻的层在地图里，这里是LRU和玩家在各层留下的改动
     
     // 怪物刷新系统
     struct MonsterSpawnInfo {
@@ -50,11 +57,16 @@ struct GameState {
         int max_count;          // 最大数量
         int current_count;      // 当前数量
         int respawn_turns;      // 重生回合数
-        int turns_until_respawn; // 距离重生的回合数
+        std::uint64_t respawn_turn; // 重生发生的世界回合，0表示不在刷新倒计时中
         int recommended_level;  // 推荐等级
         int challenge_count;    // 当前刷新周期内已挑战次数
         int max_challenges;     // 每次刷新周期内最大挑战次数
     };
     std::vector<MonsterSpawnInfo> monster_spawns;
+    
+    // 距离重生还需的回合数（不在倒计时中返回0）
+    int turnsUntilRespawn(const MonsterSpawnInfo& spawn) const {
+        return spawn.respawn_turn > scheduler.now() ? static_cast<int>(spawn.respawn_turn - scheduler.now()) : 0;
+    }
 }; 
 }
@@ -0,0 +1,43 @@
+// 这是延迟直方图的头文件
+// 作者：大一学生
+// 功能：HDR风格（对数分段、段内线性）的直方图，记录纳秒到小时范围的数值，
+//       每个值的相对误差不超过1/64，内存固定、记录只需几次位运算，适合统计指令延迟的p50/p99/p999
+
+#pragma once
+#include <cstddef>  // size_t
+#include <cstdint>  // 定宽整数
+#include <vector>   // 向量容器
+
+namespace hx {
+
+// 延迟直方图
+// 功能：0..127 每个值单独一格；更大的值按最高位分段，每段再等分成64格。
+//       不是线程安全的：每个线程记自己的直方图，最后用 merge 合并
+class Histogram {
+public:
+    Histogram();
+
+    void record(std::uint64_t value);
+    void merge(const Histogram& other);
+    void clear();
+
+    std::uint64_t count() const { return count_; }
+    std::uint64_t min() const { return count_ ? min_ : 0; }
+    std::uint64_t max() const { return max_; }
+    double mean() const { return count_ ? static_cast<double>(sum_) / static_cast<double>(count_) : 0.0; }
+
+    // 百分位数（0~100），返回该格能代表的最大值（与HdrHistogram相同的约定）
+    std::uint64_t percentile(double p) const;
+
+private:
+    static size_t indexOf(std::uint64_t value);
+    static std::uint64_t highestInBucket(size_t index);
+
+    std::vector<std::uint64_t> counts_;
+    std::uint64_t count_{0};
+    std::uint64_t sum_{0};
+    std::uint64_t min_{~std::uint64_t(0)};
+    std::uint64_t max_{0};
+};
+
+} // namespace hx
@@ -0,0 +1,53 @@
+// 这是交互流程的头文件
+// 作者：大一学生
+// 功能：商店、对话、选择菜单等需要"等玩家再输入一行"的流程不再自己循环调用getline，
+//       而是打印内容后登记下一步；下一行输入到达时由Game::handleLine交给这一步处理
+
+#pragma once
+#include <functional>  // std::function
+#include <string>      // 字符串
+#include <utility>     // std::move
+
+namespace hx {
+
+// 交互流程
+// 功能：保存"等待输入"的下一步（提示语 + 处理函数），同一时间最多一个
+class InputFlow {
+public:
+    using Step = std::function<void(const std::string&)>;
+
+    // 登记下一步：prompt 在读取下一行之前打印
+    void await(std::string prompt, Step step) {
+        prompt_ = std::move(prompt);
+        step_ = std::move(step);
+    }
+
+    // 是否有流程在等待输入
+    bool waiting() const { return static_cast<bool>(step_); }
+
+    // 等待输入时的提示语
+    const std::string& prompt() const { return prompt_; }
+
+    // 把一行输入交给等待中的步骤；没有流程在等待时返回false
+    // 先取出步骤再执行，步骤内部可以继续登记下一步
+    bool feed(const std::string& line) {
+        if (!step_) return false;
+        Step step = std::move(step_);
+        step_ = nullptr;
+        prompt_.clear();
+        step(line);
+        return true;
+    }
+
+    // 放弃当前流程（读档、重新开始时使用）
+    void cancel() {
+        step_ = nullptr;
+        prompt_.clear();
+    }
+
+private:
+    std::string prompt_;
+    Step step_;
+};
+
+} // namespace hx
@@ -1,22 +1,79 @@
 // 背包系统
+// 物品存放在固定槽位里，槽位编号（句柄）在物品留在背包期间不变；
+// 按ID建了精确索引，名称放在模糊匹配索引里，查找不随背包大小变慢
 #pragma once
+#include <cstdint>        // 定宽整数
 #include <unordered_map>
 #include <string>
+#include <string_view>
 #include <vector>
+#include "FuzzyIndex.hpp"
 #include "Item.hpp"
 
 namespace hx {
 
 class Inventory {
 public:
+    using Handle = std::uint32_t;              // 槽位编号
+    static constexpr Handle kNone = UINT32_MAX; // 没有找到
+
+    // 只读遍历背包里的物品（不复制）
+    class const_iterator {
+    public:
+        const_iterator(const Inventory* inv, Handle h) : inv_(inv), h_(h) { skipEmpty(); }
+        const Item& operator*() const { return inv_->slots_[h_].item; }
+        const Item* operator->() const { return &inv_->slots_[h_].item; }
+        const_iterator& operator++() { ++h_; skipEmpty(); return *this; }
+        bool operator==(const const_iterator& o) const { return h_ == o.h_; }
+        bool operator!=(const const_iterator& o) const { return h_ != o.h_; }
+        Handle handle() const { return h_; }
+    private:
+        void skipEmpty() {
+            while (h_ < inv_->slots_.size() && !inv_->slots_[h_].used) ++h_;
+        }
+        const Inventory* inv_;
+        Handle h_;
+    };
+
     void add(const Item& item, int qty = 1);
     bool remove(const std::string& id, int qty = 1);
-    int quantity(const std::string& id) const;
+    int quantity(std::string_view id) const;
+
+    // 按ID精确查找
+    Handle find(std::string_view id) const;
+    // 按玩家输入查找：ID相同的优先，其次是名称相同、以输入开头、包含输入或被输入包含的；
+    // 只是字面相似的不算，使用、装备会改动背包，打错字不能换成别的物品
+    Handle match(std::string_view text) const;
+    // match 找不到时名称字面最相近的物品，只用来提示"你是不是要找…"
+    Handle suggest(std::string_view text) const;
+    // 名称索引（自动补全、列出候选时使用）
+    const FuzzyIndex& names() const { return names_; }
+    // 取槽位里的物品；句柄无效时返回nullptr
+    const Item* get(Handle h) const;
+
+    const_iterator begin() const { return const_iterator(this, 0); }
+    const_iterator end() const { return const_iterator(this, static_cast<Handle>(slots_.size())); }
+    size_t size() const { return id_index_.size(); }
+    bool empty() const { return id_index_.empty(); }
+
+    // 复制出所有物品（需要保存一份快照时使用，平时请直接遍历）
     std::vector<Item> list() const;
     std::vector<Item> rawList() const { return list(); }
     std::vector<Item> asSimpleItems() const;
     void setFromSimple(const std::vector<Item>& items);
+
+    // 堆上占用的字节数（会话内存统计用，见MemoryUsage.hpp）
+    size_t heapBytes() const;
 private:
-    std::unordered_map<std::string, std::pair<Item,int>> data_;
+    struct Slot {
+        Item item;         // item.count 就是数量
+        bool used{false};
+    };
+
+    std::vector<Slot> slots_;
+    std::vector<Handle> free_;                                   // 空出来的槽位
+    // ID的哈希 → 槽位（按哈希存，查找时不用为输入构造std::string；取到后再比较ID）
+    std::unordered_multimap<std::size_t, Handle> id_index_;
+    FuzzyIndex names_;                                           // 名称 → 槽位（随增删增量更新）
 };
 } // namespace hx
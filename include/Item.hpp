@@ -80,6 +80,9 @@ struct Item {
     int level_requirement{0};
     int favor_requirement{0};
     
+    // 堆上占用的字节数（会话内存统计用，见MemoryUsage.hpp）
+    size_t heapBytes() const;
+    
     // 创建预设物品的静态方法
     static Item createConsumable(const std::string& id, const std::string& name, 
                                 const std::string& description, int heal, int price);
@@ -123,6 +126,9 @@ public:
     std::vector<Item> getEquippedItems() const;
     void setEquippedItems(const std::vector<Item>& items);
 
+    // 堆上占用的字节数（会话内存统计用，见MemoryUsage.hpp）
+    size_t heapBytes() const;
+
 private:
     std::unordered_map<EquipmentSlot, Item> equipped_items_;
 };
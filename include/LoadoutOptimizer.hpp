@@ -0,0 +1,49 @@
+// 这是配装优化的头文件
+// 作者：大一学生
+// 功能：在背包和身上的全部装备里，为武器、护甲、两个饰品槽找出对某个敌人最好的搭配。
+//       评分是一场战斗的期望值估算：每回合玩家的期望伤害和受到的期望伤害（命中率、防御减伤、
+//       学霸两件套倍率、钢勺护符这类对特定敌人的伤害倍率、闪避、每回合回复、周期护盾、鼓舞），
+//       得分 = 能支撑的回合数 / 击败敌人需要的回合数，大于1说明占优。
+//       搜索用分支限界：先定武器，再定护甲，最后在预先合计好的饰品组合里挑；
+//       每一层用“剩下的槽位各取最好的一项”算出得分上界，上界不超过目前最好的就整枝剪掉。
+//       组合很多时按武器分给几个线程并行搜索，共享目前最好的得分；超过时间预算就停下，
+//       返回已经找到的最好搭配
+
+#pragma once
+#include "Player.hpp"  // 玩家类（StatLine）
+#include "Item.hpp"    // 物品
+#include <chrono>      // 时间预算
+#include <cstddef>     // size_t
+#include <vector>      // 向量容器
+
+namespace hx {
+
+class Enemy;
+
+// 一套配装的估算结果
+struct LoadoutScore {
+    StatLine stats;             // 换上这套装备后的四项属性（已含两件套倍率）
+    float set_bonus{1.0f};      // 学霸两件套倍率（1表示没有触发）
+    double kill_turns{0.0};     // 预计击败敌人需要的回合数
+    double survive_turns{0.0};  // 预计能支撑的回合数
+    double score{0.0};          // survive_turns / kill_turns
+};
+
+// 搜索结果
+struct LoadoutPlan {
+    std::vector<Item> items;     // 推荐的装备，equip_slot 为要放的槽位（空槽不列出）
+    LoadoutScore best;           // 推荐配装的估算
+    LoadoutScore current;        // 身上现有配装的估算
+    size_t evaluated{0};         // 完整评估过的组合数
+    size_t candidates{0};        // 参与搜索的装备件数
+    bool exhaustive{true};       // 是否在时间预算内搜完（没搜完时给出的是目前最好的）
+};
+
+// 为 player 找出对 enemy 最好的配装；tier 为动态难度层级（见 CombatSystem::tierFor）
+LoadoutPlan optimizeLoadout(const Player& player, const Enemy& enemy, int tier,
+                            std::chrono::milliseconds budget = std::chrono::milliseconds(50));
+
+// 只估算身上现有的配装
+LoadoutScore scoreLoadout(const Player& player, const Enemy& enemy, int tier);
+
+} // namespace hx
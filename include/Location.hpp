@@ -24,6 +24,10 @@ struct Coord {
     int y;  // Y坐标
 };
 
+// 地图层：主地图和教学区详细地图各用一套坐标（x向东增大，y向南增大）
+constexpr int kMainLayer = 0;      // 主地图
+constexpr int kTeachingLayer = 1;  // 教学区详细地图
+
 // 地点类
 // 功能：表示游戏中的一个地点，包含所有相关信息
 class Location {
@@ -32,6 +36,7 @@ public:
     std::string name;
     std::string desc;
     Coord coord{0,0};
+    int layer{kMainLayer};  // 所在的地图层
     std::vector<Exit> exits;
     std::vector<Enemy> enemies;
     std::vector<Item> shop;
@@ -3,10 +3,12 @@
 // 功能：定义游戏中的地图系统，包括地图渲染和导航
 
 #pragma once
+#include <cstdint>        // 定宽整数
 #include <unordered_map>  // 哈希映射
 #include <string>         // 字符串
 #include <vector>         // 向量容器
 #include "Location.hpp"   // 地点类
+#include "SpatialGrid.hpp" // 空间索引
 
 namespace hx {
 // 地图类
@@ -14,38 +16,68 @@ namespace hx {
 class Map {
 public:
     void addLocation(const Location& loc);
+    void removeLocation(const std::string& id); // 移除地点（秘境淘汰不用的层时调用）
     const Location* get(const std::string& id) const;
     Location* get(const std::string& id);
     std::vector<Location> allLocations() const;
-    // build simple ASCII map bounded by min/max coords
-    std::string renderAsciiWithHighlight(const std::string& currentId) const;
-    
-    // 新增：主地图渲染
-    std::string renderMainMap(const std::string& currentId) const;
-    
-    // 新增：教学区子地图渲染
-    std::string renderTeachingDetailMap(const std::string& currentId) const;
+    // 所有地点（不复制，遍历顺序不固定）
+    const std::unordered_map<std::string, Location>& locations() const { return data_; }
+    // 视口地图：只画玩家所在地图层里、以当前位置为中心 kViewRadiusX×kViewRadiusY 范围内的地点，
+    // 相邻且有出口相连的地点之间画上连线；地点再多，每次也只看视口覆盖的那几个索引桶
+    std::string renderViewport(const std::string& currentId) const;
+    static constexpr int kViewRadiusX = 6;
+    static constexpr int kViewRadiusY = 4;
+    // 地图层的标题（视口地图的第一行）；主地图和教学区地图有默认标题，空标题表示恢复默认
+    void setLayerTitle(int layer, std::string title);
     
     // 新增：增强版地图渲染
     std::string renderEnhancedMainMap(const std::string& currentId) const;
     std::string renderEnhancedTeachingDetailMap(const std::string& currentId) const;
     
-    // 新增：检查是否为教学区地点
+    // 检查是否为教学区地点（地点在教学区详细地图层上）
     bool isTeachingAreaLocation(const std::string& locationId) const;
     
+    // 自动寻路：站在 from 想去 to 时下一步走哪个出口；已经在 to 或走不到时返回nullptr
+    // 路由表（从每个地点做一次BFS得到的“下一跳”表）在出口变化后第一次查询时重建
+    const Exit* nextHop(const std::string& from, const std::string& to) const;
+    // 从 from 到 to 要走几步（走不到返回-1）
+    int routeLength(const std::string& from, const std::string& to) const;
+    // 地点的出口、名称或坐标被修改后调用，寻路表和地图视图下次用到时重建
+    // （addLocation 会自动调用；读档直接改写地点，需要手动调用）
+    void invalidateIndexes() { routes_valid_ = false; view_valid_ = false; ++revision_; }
+    // 每次 invalidateIndexes 加一；地图外面按地点建的索引（例如地点名索引）靠它判断是否过期
+    std::uint64_t revision() const { return revision_; }
+    // 寻路表、地图视图缓存和地图层标题占用的堆内存（见MemoryUsage.hpp）
+    size_t indexHeapBytes() const;
+    // 出口实际通往的地点（“进入教学区”“退出教学区”两个出口的目标不是地点ID）
+    static const std::string& exitDestination(const Exit& exit);
+    
 private:
     std::unordered_map<std::string, Location> data_;
+    std::unordered_map<int, std::string> layer_titles_; // 另外设置的地图层标题
+    std::uint64_t revision_ = 0;
     
-    // 主地图地点ID列表
-    std::vector<std::string> mainMapLocations_ = {
-        "north_playground", "canteen", "activity_center", "gymnasium", 
-        "plaza_36", "teaching_area", "info_building", "library", "wenxintan"
-    };
+    // 路由表：地点编号 i 到 j 的下一跳是 i 的第几个出口（-1表示走不到或已到达），以及步数
+    mutable bool routes_valid_ = false;
+    mutable std::unordered_map<std::string, int> route_index_;  // 地点ID -> 编号
+    mutable std::vector<int> next_hop_;                          // n*n
+    mutable std::vector<int> hops_;                              // n*n，-1表示走不到
+    void buildRoutes() const;
     
-    // 教学区子地图地点ID列表
-    std::vector<std::string> teachingAreaLocations_ = {
-        "teach_2", "teach_3", "teach_4", "jiuzhutan", 
-        "teach_5", "teach_6", "teach_7", "tree_space"
+    // 地图视图的缓存：每个地点一个格子（地名和它占的列数），加上按坐标分桶的空间索引
+    struct Tile {
+        const Location* loc;
+        int width;  // 地名占的列数
+    };
+    struct LayerBounds {
+        int min_x, min_y, max_x, max_y;
     };
+    mutable bool view_valid_ = false;
+    mutable std::vector<Tile> tiles_;
+    mutable std::unordered_map<std::string, size_t> tile_index_;  // 地点ID -> 格子下标
+    mutable std::unordered_map<int, LayerBounds> layer_bounds_;   // 每层的坐标范围
+    mutable SpatialGrid grid_;
+    void buildView() const;
+    bool linked(const Location& a, const Location& b) const; // 两个地点之间有没有出口相连
 };
 } // namespace hx
@@ -0,0 +1,104 @@
+// 这是会话内存统计的头文件
+// 作者：大一学生
+// 功能：统计一个会话（一局游戏）各部分占用的内存：GameState本身、地图和地点、NPC对话表、
+//       背包、装备、任务、对话记忆、商店货架，以及Game自己的索引和缓冲区。
+//       做法是沿着数据结构走一遍，按容器的容量（不是元素个数）累加：
+//       vector按 capacity*元素大小，string超出短字符串缓冲区时按 capacity+1，
+//       哈希表按桶数组加每个元素一个节点（指针+元素+缓存的哈希值）估计。
+//       malloc自己的簿记开销和 std::function 捕获的内容不计入，所以结果略偏小，
+//       但同一份代码前后对比时能准确反映世界内容或数据结构带来的变化
+
+#pragma once
+#include <cstddef>  // size_t
+#include <cstdint>  // 定宽整数
+#include <string>   // 字符串
+#include <vector>   // 向量容器
+
+namespace hx {
+
+struct GameState;
+
+// 会话内存的组成部分
+enum class MemoryPart : unsigned {
+    STATE,            // GameState对象本身、玩家基本数据、怪物刷新表、回合调度器、事件总线
+    MAP,              // 地点、出口、地点上的敌人和NPC基本信息，秘境的原型表和改动记录
+    NPC_DIALOGUE,     // NPC对话表（对话节点和选项）
+    INVENTORY,        // 背包（槽位、ID索引、名称索引）
+    EQUIPMENT,        // 已穿戴的装备
+    TASKS,            // 任务定义、进度表、任务索引
+    DIALOGUE_MEMORY,  // 对话记忆（玩家选过的选项、NPC看过的节点和记住的事）
+    SHOP,             // 商店货架、NPC商品、商店进货池
+    SESSION,          // Game自己的部分：名称索引、指令缓冲区等
+    COUNT
+};
+
+constexpr size_t kMemoryPartCount = static_cast<size_t>(MemoryPart::COUNT);
+
+// 部分名称（state/map/npc_dialogue/…）
+const char* memoryPartName(MemoryPart part);
+
+// 一次统计的结果（字节）
+struct MemoryReport {
+    std::uint64_t bytes[kMemoryPartCount]{};
+
+    std::uint64_t& operator[](MemoryPart part) { return bytes[static_cast<size_t>(part)]; }
+    std::uint64_t operator[](MemoryPart part) const { return bytes[static_cast<size_t>(part)]; }
+    std::uint64_t total() const;
+};
+
+// 统计一个GameState（不含Game自己的部分，见 Game::memoryUsage）
+MemoryReport measureMemory(const GameState& state);
+
+// 所有活着的会话的合计：每个会话定期报告自己与上次报告的差值
+void publishSessionMemory(const MemoryReport& previous, const MemoryReport& current);
+void addLiveSession(int delta);
+MemoryReport liveSessionMemory();
+long long liveSessions();
+
+// 休眠的会话（见SessionScheduler.hpp）：不计入上面的会话数和内存，只留一段休眠数据
+void addHibernatedSession(int delta, std::int64_t bytes);
+long long hibernatedSessions();
+std::uint64_t hibernatedBytes();
+
+// 给玩家看的表格；sessions>1 时另外给出所有会话的平均值
+std::string formatMemoryReport(const MemoryReport& mine, const MemoryReport& all, long long sessions);
+
+// ---------------- 计算容器占用的工具 ----------------
+namespace memory {
+
+// 字符串在堆上的部分：短字符串放在对象内部，不占堆
+inline size_t bytes(const std::string& s) {
+    static const size_t kInline = std::string().capacity();
+    return s.capacity() > kInline ? s.capacity() + 1 : 0;
+}
+
+// vector：元素数组按容量计；element 给出每个元素自己在堆上的部分
+template <class T>
+size_t bytes(const std::vector<T>& v) {
+    return v.capacity() * sizeof(T);
+}
+
+template <class T, class Element>
+size_t bytes(const std::vector<T>& v, Element&& element) {
+    size_t n = v.capacity() * sizeof(T);
+    for (const T& e : v) n += element(e);
+    return n;
+}
+
+// 哈希表（unordered_map/set）：桶数组 + 每个元素一个节点
+template <class Table>
+size_t tableBytes(const Table& table) {
+    using Value = typename Table::value_type;
+    return table.bucket_count() * sizeof(void*) + table.size() * (sizeof(void*) + sizeof(Value) + sizeof(size_t));
+}
+
+template <class Table, class Element>
+size_t tableBytes(const Table& table, Element&& element) {
+    size_t n = tableBytes(table);
+    for (const auto& e : table) n += element(e);
+    return n;
+}
+
+} // namespace memory
+
+} // namespace hx
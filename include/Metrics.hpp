@@ -0,0 +1,123 @@
+// 这是运行指标（耗时与内存分配统计）的头文件
+// 作者：大一学生
+// 功能：给指令分发和几个主要子系统（战斗、存档读档、地图绘制、世界时钟、对话）计数、
+//       记录耗时分布和内存分配次数。每个线程写自己的一份，读取时再合并，
+//       可以用管理指令 metrics 查看，也可以定期写成 Prometheus 文本格式的文件
+
+#pragma once
+#include <chrono>    // 计时
+#include <cstddef>   // size_t
+#include <cstdint>   // 定宽整数
+#include <memory>    // 智能指针
+#include <ostream>   // 输出流
+#include <string>    // 字符串
+#include <vector>    // 向量容器
+
+namespace hx {
+
+// 统计项：前一段是指令（按动词归类），后一段是子系统
+enum class Metric : unsigned {
+    // 指令
+    CMD_MOVE,       // w/a/s/d、enter、exit、goto、下楼/上楼
+    CMD_LOOK,       // look、查看
+    CMD_MAP,        // map
+    CMD_STATS,      // stats、属性
+    CMD_INVENTORY,  // inv、背包
+    CMD_TASK,       // task、任务
+    CMD_FIGHT,      // fight、挑战
+    CMD_TALK,       // talk、对话
+    CMD_BUY,        // buy
+    CMD_ITEM,       // use/equip/unequip
+    CMD_ALLOCATE,   // allocate
+    CMD_SAVE,       // save
+    CMD_LOAD,       // load
+    CMD_HELP,       // help
+    CMD_MENU,       // 对话、商店、答题等菜单里的输入
+    CMD_OTHER,      // 其余指令
+    // 子系统
+    COMBAT,         // 战斗回合推进
+    SAVE,           // 写存档
+    LOAD,           // 读存档
+    MAP_RENDER,     // 地图绘制
+    WORLD_TICK,     // 世界时钟推进（怪物刷新、商店补货、状态效果）
+    TALK,           // 对话节点的显示与选择
+    COUNT
+};
+
+constexpr size_t kMetricCount = static_cast<size_t>(Metric::COUNT);
+
+// 指令类返回 true，子系统类返回 false
+bool isCommandMetric(Metric metric);
+// 标签名（move/look/…、combat/save/…）
+const char* metricName(Metric metric);
+
+// 耗时分桶的上界（纳秒），与 Prometheus 的 le 标签一一对应，最后还有一个 +Inf
+constexpr size_t kMetricBuckets = 20;
+extern const std::uint64_t kMetricBucketBounds[kMetricBuckets];
+
+// 一项统计合并后的结果
+struct MetricSeries {
+    std::uint64_t count{0};
+    std::uint64_t total_ns{0};
+    std::uint64_t allocations{0};     // 期间 operator new 的次数
+    std::uint64_t allocated_bytes{0}; // 期间申请的字节数
+    std::uint64_t buckets[kMetricBuckets + 1]{}; // 每个桶自己的次数（不是累计）
+    std::uint64_t min_ns{0};          // 记录到的最短、最长耗时（count 为0时无意义）
+    std::uint64_t max_ns{0};
+
+    double meanMicros() const;
+    // 按桶内线性插值估计百分位数（0~100），单位微秒；
+    // 桶很宽（相邻上界差2～2.5倍），结果限制在实际记录到的最短和最长耗时之间
+    double percentileMicros(double p) const;
+};
+
+// 合并所有线程后的快照，下标为 Metric
+std::vector<MetricSeries> snapshotMetrics();
+// 清零（只用于基准测试的分段统计）
+void resetMetrics();
+
+// 记录一次
+void recordMetric(Metric metric, std::uint64_t nanos, std::uint64_t allocations, std::uint64_t bytes);
+
+// 当前线程累计的内存分配（全局 operator new 在每次分配时累加）
+struct AllocationCounter {
+    std::uint64_t count{0};
+    std::uint64_t bytes{0};
+};
+AllocationCounter threadAllocations();
+
+// 作用域计时器：构造时开始，析构时把耗时和这段时间里的分配记到 metric 上
+class MetricTimer {
+public:
+    explicit MetricTimer(Metric metric);
+    ~MetricTimer();
+    MetricTimer(const MetricTimer&) = delete;
+    MetricTimer& operator=(const MetricTimer&) = delete;
+
+private:
+    Metric metric_;
+    std::chrono::steady_clock::time_point start_;
+    AllocationCounter allocs_;
+};
+
+// 给玩家看的表格（管理指令 metrics）
+std::string formatMetricsTable();
+// Prometheus 文本格式（另附所有会话的内存合计，见MemoryUsage.hpp）
+void writePrometheus(std::ostream& out);
+// 写到 path（先写临时文件再改名，读的一方不会看到写了一半的文件）
+bool writePrometheusFile(const std::string& path);
+
+// 定期导出：后台线程每 interval 秒写一次文件，析构时停止并最后写一次
+class MetricsExporter {
+public:
+    MetricsExporter(std::string path, double interval_seconds);
+    ~MetricsExporter();
+    MetricsExporter(const MetricsExporter&) = delete;
+    MetricsExporter& operator=(const MetricsExporter&) = delete;
+
+private:
+    struct State;
+    std::unique_ptr<State> state_;
+};
+
+} // namespace hx
@@ -0,0 +1,73 @@
+// 这是多生产者单消费者队列的头文件
+// 作者：大一学生
+// 功能：无锁队列，任意线程都可以push，只有一个线程pop（会话的输入队列）
+//       生产者只做一次原子交换，不会因为其它生产者或消费者阻塞
+
+#pragma once
+#include <atomic>   // 原子操作
+#include <cstddef>  // size_t
+#include <utility>  // std::move
+
+namespace hx {
+
+// 多生产者单消费者队列
+// 功能：链表实现，head_ 由生产者交换，tail_ 只由消费者访问；T 需要可默认构造
+//       size_ 供任意线程判断是否还有元素（会话交还执行权后检查有无新输入）
+template <typename T>
+class MpscQueue {
+public:
+    MpscQueue() {
+        Node* stub = new Node();
+        head_.store(stub, std::memory_order_relaxed);
+        tail_ = stub;
+    }
+
+    ~MpscQueue() {
+        T ignored;
+        while (pop(ignored)) {}
+        delete tail_;
+    }
+
+    MpscQueue(const MpscQueue&) = delete;
+    MpscQueue& operator=(const MpscQueue&) = delete;
+
+    // 入队（任意线程）
+    void push(T value) {
+        Node* node = new Node();
+        node->value = std::move(value);
+        // 先计数再链接：计数不为零时消费者可能暂时还取不到，但不会漏掉
+        size_.fetch_add(1, std::memory_order_seq_cst);
+        Node* prev = head_.exchange(node, std::memory_order_acq_rel);
+        prev->next.store(node, std::memory_order_release);
+    }
+
+    // 出队（仅消费者线程）；队列为空时返回false
+    // 生产者交换head_后还没来得及链接时，也会暂时返回false
+    bool pop(T& out) {
+        Node* tail = tail_;
+        Node* next = tail->next.load(std::memory_order_acquire);
+        if (!next) return false;
+        out = std::move(next->value);
+        tail_ = next;
+        delete tail;
+        size_.fetch_sub(1, std::memory_order_seq_cst);
+        return true;
+    }
+
+    // 是否为空（任意线程；只读计数，不访问链表）
+    bool empty() const {
+        return size_.load(std::memory_order_seq_cst) == 0;
+    }
+
+private:
+    struct Node {
+        std::atomic<Node*> next{nullptr};
+        T value{};
+    };
+
+    std::atomic<Node*> head_;  // 最新入队的节点
+    Node* tail_;               // 已出队的哨兵节点
+    std::atomic<size_t> size_{0}; // 已入队、尚未出队的元素数
+};
+
+} // namespace hx
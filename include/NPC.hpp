@@ -9,6 +9,7 @@
 #include <unordered_set>  // 哈希集合
 #include <functional>     // 函数对象
 #include "Item.hpp"       // 物品类
+#include "Inventory.hpp"  // 背包
 
 namespace hx {
 
@@ -71,6 +72,7 @@ public:
     void addShopItem(const ShopItem& item);
     std::vector<ShopItem> getAvailableItems(int player_favor) const;
     bool hasShop() const { return !shop_items_.empty(); }
+    const std::vector<ShopItem>& shopItems() const { return shop_items_; }
     
     // 任务相关
     bool hasQuest() const { return !quest_id_.empty(); }
@@ -84,7 +86,7 @@ public:
     // 对话条件检查
     bool canAccessDialogue(const std::string& dialogue_id, int player_favor) const;
     bool canChooseOption(const DialogueOption& option, int player_favor, 
-                        const std::unordered_map<std::string, int>& player_inventory) const;
+                        const Inventory& player_inventory) const;
     
     // 对话记忆系统
     void markDialogueVisited(const std::string& dialogue_id);
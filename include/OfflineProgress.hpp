@@ -0,0 +1,46 @@
+// 这是离线进度补算的头文件
+// 作者：大一学生
+// 功能：玩家离开一段时间再回来时，一次算出这段时间里世界和角色的变化。离开的时间按真实时间计：
+//       每行输入都记下时刻（GameState::last_active_ms，也写进存档），下一行输入距它
+//       kMinAwayTurns 个回合以上就算离开过，每 kSecondsPerOfflineTurn 秒算一个世界回合。
+//       终端版、多会话、会话休眠过与否都一样；读档时从存档里记的时刻算起，
+//       这个时刻读一次就清零，同一个存档反复读不会重复补算。玩家不能自己要求补算。
+//       补算不按回合逐个推进调度器：
+//       - 状态效果的持续时间直接减去N，商店按期间跨过的进货时刻数决定是否进货；
+//       - 各刷新点只在“可以挑战”的时刻结算（刚回来时、每次重生时），中间的回合直接跳过；
+//       - 玩家所在地点的普通怪物按挂机刷怪处理：每场战斗不真正模拟，而是用战前胜率预估
+//         （见CombatForecast.hpp，有缓存）给出的胜率抽一次胜负，胜利照常拿经验、金币和掉落；
+//       - 最后把世界回合设为 起点+N，按新的回合重建定时任务；离开超过 kRestTurns 个回合时回来已休整好（生命回满）。
+//       离开一周（一万多个回合）也只要几毫秒
+
+#pragma once
+#include <cstdint>  // 定宽整数
+#include <string>   // 字符串
+#include <utility>  // pair
+#include <vector>   // 向量容器
+
+namespace hx {
+
+constexpr std::uint64_t kSecondsPerOfflineTurn = 60;  // 离开时每过这么多秒算一个世界回合（一周约10080回合）
+constexpr std::uint64_t kMinAwayTurns = 5;            // 两行输入隔了这么多回合（五分钟）以上才算离开过，看剧情、想下一步不算
+constexpr std::uint64_t kMaxOfflineTurns = 525600;    // 一次最多补算的回合数（约一年）
+constexpr std::uint64_t kRestTurns = 60;              // 离开这么多回合（约一小时）以上，回来时生命回满
+
+// 当前的真实时刻（system_clock，毫秒），输入时刻都用它记
+std::int64_t wallClockMillis();
+
+// 一次离线补算的结果
+struct OfflineReport {
+    std::uint64_t turns{0};          // 补算的回合数
+    int fights{0};                   // 挂机战斗场数
+    int wins{0};                     // 其中胜利的场数
+    int xp{0};                       // 获得的经验
+    int coins{0};                    // 获得的金币
+    int levels{0};                   // 提升的等级数
+    int respawns{0};                 // 期间怪物重生的次数
+    std::uint64_t shop_restocks{0};  // 期间商店进货的次数（货架在下次打开商店时刷新一次）
+    bool rested{false};              // 离开得足够久，生命已回满
+    std::vector<std::pair<std::string, int>> items;  // 掉落获得的物品（名称, 数量）
+};
+
+} // namespace hx
@@ -0,0 +1,33 @@
+// 这是游戏输出的头文件
+// 作者：大一学生
+// 功能：游戏文字统一写到 console()。单人游戏时它就是std::cout；
+//       会话调度器执行某个会话时，把当前线程的输出切换到该会话自己的缓冲区
+
+#pragma once
+#include <ostream>  // 输出流
+
+namespace hx {
+
+// 当前线程的游戏输出流
+std::ostream& console();
+
+// 清屏（写入当前输出流，多会话时只清该会话的屏幕）
+void clearScreen();
+
+// 丢弃所有写入内容的流（每个线程一个），批处理静默执行时把 console() 指向它
+std::ostream& nullConsole();
+
+// 输出重定向
+// 功能：在作用域内把当前线程的 console() 指向指定的流，离开作用域时恢复
+class ConsoleScope {
+public:
+    explicit ConsoleScope(std::ostream& os);
+    ~ConsoleScope();
+    ConsoleScope(const ConsoleScope&) = delete;
+    ConsoleScope& operator=(const ConsoleScope&) = delete;
+
+private:
+    std::ostream* previous_;
+};
+
+} // namespace hx
@@ -5,9 +5,11 @@
 #include "Entity.hpp"      // 实体基类
 #include "Inventory.hpp"   // 背包系统
 #include "Item.hpp"        // 物品系统
+#include "GameEvents.hpp"  // 事件总线
 #include <vector>          // 向量容器
 #include <memory>          // 智能指针
 #include <string>          // 字符串
+#include <string_view>     // 不复制的字符串片段
 #include <unordered_map>   // 哈希映射
 
 namespace hx {
@@ -18,20 +20,12 @@ struct SimpleItem {
     int count;
 };
 
-enum class QuestStatus {
-    NOT_STARTED,
-    IN_PROGRESS,
-    COMPLETED,
-    FAILED
-};
-
-struct QuestInfo {
-    std::string id;                           // 任务ID
-    std::string name;                         // 任务名称
-    std::string description;                  // 任务描述
-    QuestStatus status;                       // 任务状态
-    std::vector<std::string> objectives;      // 任务目标列表
-    std::vector<std::string> rewards;         // 任务奖励列表
+// 四项主属性（基础属性、装备加成的合计）
+struct StatLine {
+    int atk{0};
+    int def_{0};
+    int spd{0};
+    int max_hp{0};
 };
 
 class Player : public Entity {
@@ -44,13 +38,24 @@ public:
     void addCoins(int amount);
     bool spendCoins(int amount);
     Inventory& inventory() { return *inventory_; }
+    const Inventory& inventory() const { return *inventory_; }
+    // 获得物品：放入背包并发布获得物品事件（装备卸下、读档等内部搬运仍直接操作背包）
+    void gainItem(const Item& item, int count);
+    
+    // 事件总线（由Game在初始化时设置，可为空）
+    void setEventBus(EventBus* events) { events_ = events; }
     
     // 装备系统
     Equipment& equipment() { return equipment_; }
     const Equipment& equipment() const { return equipment_; }
-    bool equipItem(const std::string& item_id);
+    bool equipItem(std::string_view item_id, EquipmentSlot accessory_slot = EquipmentSlot::ACCESSORY1);
+    bool needsAccessorySlotChoice(std::string_view item_id) const; // 两个饰品槽同品质时需要玩家选择
     bool unequipItem(EquipmentSlot slot);
     void updateAttributesFromEquipment();
+    // 不含装备的基础属性（由等级和加点决定）
+    StatLine baseStats() const;
+    // 学霸两件套倍率：武器与护甲同品质时 本科1.1 硕士1.15 博士1.2，否则为1
+    static float twoPieceBonus(const Item* weapon, const Item* armor);
     
     // 死亡复活系统
     void onDeathPenalty();
@@ -62,16 +67,7 @@ public:
     int getNPCFavor(const std::string& npc_name) const;
     void addNPCFavor(const std::string& npc_name, int amount);
     void setNPCFavor(const std::string& npc_name, int favor);
-    std::unordered_map<std::string, int> getAllFavors() const { return npc_favors_; }
-    
-    // 任务系统
-    void startQuest(const std::string& quest_id, const std::string& quest_name, 
-                   const std::string& description, const std::vector<std::string>& objectives);
-    void completeQuest(const std::string& quest_id);
-    void failQuest(const std::string& quest_id);
-    QuestStatus getQuestStatus(const std::string& quest_id) const;
-    std::vector<QuestInfo> getActiveQuests() const;
-    std::vector<QuestInfo> getAllQuests() const;
+    const std::unordered_map<std::string, int>& getAllFavors() const { return npc_favors_; }
     
     // 结局系统
     enum class Ending {
@@ -95,7 +91,7 @@ public:
     int getXPNeededForNextLevel() const;
     
     // 物品使用
-    bool useItem(const std::string& item_id);
+    bool useItem(std::string_view item_id);
     
     const std::string& getName() const { return name_; }
     void setName(const std::string& n) { name_ = n; }
@@ -108,9 +104,6 @@ public:
     
     void setNPCFavors(const std::unordered_map<std::string, int>& favors) { npc_favors_ = favors; }
     
-    void setQuests(const std::unordered_map<std::string, QuestInfo>& quests) { quests_ = quests; }
-    std::unordered_map<std::string, QuestInfo> getQuests() const { return quests_; }
-    
     void setWenxinFailures(int failures) { wenxin_failures_ = failures; }
 
 private:
@@ -121,8 +114,8 @@ private:
     Equipment equipment_;
     
     std::unordered_map<std::string, int> npc_favors_;
-    std::unordered_map<std::string, QuestInfo> quests_;
     int wenxin_failures_{0};
+    EventBus* events_{nullptr};
     
     static const std::string REVIVAL_SCROLL_ID;
     static const std::string LIBRARY_LOCATION_ID;
@@ -0,0 +1,70 @@
+// 这是录制与回放的头文件
+// 作者：大一学生
+// 功能：把一局游戏的随机种子和玩家输入的每一行（带时间）记成文本文件；
+//       回放时用同一个种子新建Game，不读终端、不等待，把输入一口气送进去，
+//       输出可以丢弃、保存，也可以和以前保存的输出逐行比较（重构战斗、存档、建世界代码后的回归检查）
+
+#pragma once
+#include <chrono>    // 记录时间
+#include <cstdint>   // 定宽整数
+#include <fstream>   // 文件流
+#include <ostream>   // 输出流
+#include <string>    // 字符串
+#include <vector>    // 向量容器
+
+namespace hx {
+
+// 一局游戏的输入记录
+// 文件格式：
+//   # haida-mud transcript
+//   seed <随机种子>
+//   <距开始的毫秒数>\t<输入的一行>
+struct Transcript {
+    struct Line {
+        std::uint64_t at_ms{0};  // 距开始录制的毫秒数
+        std::string text;        // 输入的内容
+    };
+
+    std::uint32_t seed{0};
+    std::vector<Line> lines;
+
+    // 读取记录文件，格式不对时返回false
+    bool load(const std::string& path);
+    bool save(const std::string& path) const;
+};
+
+// 边玩边记录
+// 功能：每行输入立即写入文件，游戏中途崩溃时已经记下的部分也能回放
+class TranscriptWriter {
+public:
+    TranscriptWriter(const std::string& path, std::uint32_t seed);
+
+    // 文件是否成功打开
+    bool ok() const { return static_cast<bool>(out_); }
+
+    // 返回这行输入的真实时刻（毫秒，和记下的毫秒数对应），交给 Game::handleLine，
+    // 回放时按记录的毫秒数推出同样的间隔，离线补算的结果和录制时一样
+    std::int64_t record(const std::string& line);
+
+private:
+    std::ofstream out_;
+    std::chrono::steady_clock::time_point start_;
+    std::int64_t start_wall_ms_;  // 开始录制的真实时刻
+};
+
+// 回放的结果
+struct ReplayResult {
+    size_t lines{0};      // 执行了多少行输入
+    bool quit{false};     // 是否因为输入quit而结束
+    double seconds{0.0};  // 耗时
+    std::uint64_t state_hash{0};  // 回放结束时的状态哈希（见StateHash.hpp）
+};
+
+// 回放一局游戏
+// 功能：输出和终端游玩时一样（包括每行之前的提示语），output 为nullptr时丢弃
+ReplayResult replay(const Transcript& transcript, std::ostream* output);
+
+// 逐行比较两段输出，返回第一处不同的行号（从1开始），完全相同时返回0
+size_t firstDifference(const std::string& expected, const std::string& actual);
+
+} // namespace hx
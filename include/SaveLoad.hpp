@@ -1,13 +1,24 @@
 // 存档读档系统
 #pragma once
 #include "GameState.hpp"
+#include <cstdint>
+#include <iosfwd>
 #include <string>
 
 namespace hx {
 
 class SaveLoad { 
 public: 
+    // 存档格式的版本号（写在存档开头，读档时不一致就拒绝）
+    static constexpr std::uint32_t kFormatVersion = 2;
+
     static bool save(const GameState& state, const std::string& filename="save.dat"); 
     static bool load(GameState& state, const std::string& filename="save.dat"); 
+    // 写到/读自任意的二进制流（会话休眠时存成内存里的一段数据，见SessionScheduler.hpp）
+    static bool save(const GameState& state, std::ostream& out); 
+    static bool load(GameState& state, std::istream& in); 
+    // 把存档里记的最后输入时刻清零（读档补算过离线进度之后调用，见OfflineProgress.hpp）
+    static bool clearLastActive(const std::string& filename="save.dat");
+    static void clearLastActive(std::string& blob);
 };
 }
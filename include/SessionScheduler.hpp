@@ -0,0 +1,161 @@
+// 这是会话调度器的头文件
+// 作者：大一学生
+// 功能：一个进程里同时运行多个游戏会话。每个会话有自己的Game（状态、战斗、输出），
+//       输入经无锁队列送达；工作线程池执行会话，空闲线程从繁忙线程那里"偷"就绪会话。
+//       开启休眠后，空闲超过一定时间的会话把Game存成一段休眠数据（见Game::hibernate，约三十几KB）
+//       并释放整个Game，下一行输入到达时在工作线程上透明地恢复（离线进度照常由这行输入补算），
+//       常驻内存因此只和正在玩的玩家数成正比，而不是和连着的玩家数成正比
+
+#pragma once
+#include "Game.hpp"       // 游戏类
+#include "MpscQueue.hpp"  // 多生产者单消费者队列
+#include <atomic>         // 原子操作
+#include <chrono>         // 时间片预算
+#include <condition_variable> // 条件变量
+#include <cstdint>        // 定宽整数
+#include <deque>          // 双端队列
+#include <functional>     // std::function
+#include <memory>         // 智能指针
+#include <mutex>          // 互斥锁
+#include <random>         // 随机种子
+#include <shared_mutex>   // 读写锁
+#include <sstream>        // 字符串流
+#include <string>         // 字符串
+#include <thread>         // 线程
+#include <unordered_map>  // 哈希映射
+#include <vector>         // 向量容器
+
+namespace hx {
+
+// 游戏会话
+// 功能：一个玩家的完整游戏。同一时刻最多被一个工作线程执行（scheduled_ 充当串行化的strand），
+//       所以Game内部不需要加锁
+class Session {
+public:
+    using Id = std::uint64_t;
+
+    explicit Session(Id id) : Session(id, std::random_device{}()) {}
+    Session(Id id, std::uint32_t seed) : id_(id), seed_(seed), game_(std::make_unique<Game>(seed)) {}
+    ~Session();
+
+    Id id() const { return id_; }
+    bool closed() const { return closed_.load(std::memory_order_acquire); }
+    bool hibernated() const { return hibernated_.load(std::memory_order_acquire); }
+
+private:
+    friend class SessionScheduler;
+
+    Id id_;
+    std::uint32_t seed_;                    // 恢复时用同一个种子新建Game
+    std::unique_ptr<Game> game_;            // 休眠时为空
+    std::string blob_;                      // 休眠数据（只由持有执行权的线程访问）
+    std::atomic<bool> hibernated_{false};
+    std::atomic<std::int64_t> last_active_{0}; // 上次执行结束的时刻（steady_clock的计数）
+    MpscQueue<std::string> inbox_;          // 待执行的输入行
+    std::atomic<bool> scheduled_{false};    // 已在某个就绪队列中或正在执行
+    std::atomic<bool> closed_{false};
+    bool started_{false};                   // 开场剧情是否已显示
+    std::string save_slot_;                 // 这个会话的存档（save/load 指令读写这里，不用共享的save.dat）
+    std::ostringstream output_;             // 本次执行产生的输出（只由执行它的线程访问）
+};
+
+// 会话调度器
+// 功能：每个工作线程有自己的就绪队列，从队头取会话执行；自己的队列空了就从其它线程队尾偷取。
+//       会话每次最多执行 commands_per_slice 行输入（或战斗的一段回合），并受时间预算限制，
+//       剩余的重新排队，避免一个会话（例如一场很长的Boss战）长期占用线程
+class SessionScheduler {
+public:
+    // 输出回调：在工作线程上调用，参数为会话ID、本次执行产生的输出，以及会话是否已空闲
+    // （一行批处理即使分几次执行，输出也在全部完成后合成一段送出）
+    // 空闲表示这段输出以下一行输入的提示语结尾：战斗和批处理都已完成，可以用来计算指令的响应时间
+    using OutputHandler = std::function<void(Session::Id, const std::string&, bool idle)>;
+
+    explicit SessionScheduler(size_t workers = std::thread::hardware_concurrency(),
+                              size_t commands_per_slice = 16);
+    ~SessionScheduler();
+
+    SessionScheduler(const SessionScheduler&) = delete;
+    SessionScheduler& operator=(const SessionScheduler&) = delete;
+
+    // 设置输出回调（应在打开会话之前设置）
+    void setOutputHandler(OutputHandler handler) { output_handler_ = std::move(handler); }
+
+    // 每个会话一次执行的时间预算，用完后让出线程（应在打开会话之前设置）
+    void setSliceBudget(std::chrono::microseconds budget) { slice_budget_ = budget; }
+
+    // 战斗每段推进的回合数，打完一段就输出这段日志（应在打开会话之前设置）
+    void setCombatTurnsPerSlice(int turns) { combat_turns_per_slice_ = turns; }
+
+    // 会话空闲多久后休眠（0表示不休眠，默认）；开启后由一个后台线程定期检查
+    void setHibernateAfter(std::chrono::milliseconds idle);
+
+    // 让空闲超过 idle 的会话立即休眠，返回这次休眠的会话数（后台线程定期调用，也可以直接调用）。
+    // 正在执行、还有输入没执行、战斗或批处理没完成、商店对话等在等输入、开场剧情还没显示的会话跳过
+    size_t hibernateIdle(std::chrono::milliseconds idle);
+
+    // 打开新会话，开场剧情在工作线程上显示；seed 为这局游戏的随机种子（不指定时随机）
+    Session::Id open();
+    Session::Id open(std::uint32_t seed);
+
+    // 向会话投递一行输入（任意线程可调用）；会话不存在或已关闭时返回false
+    bool post(Session::Id id, std::string line);
+
+    // 关闭会话（尚未执行的输入被丢弃）
+    void close(Session::Id id);
+
+    // 停止所有工作线程（析构时自动调用）
+    void stop();
+
+    size_t workerCount() const { return workers_.size(); }
+    size_t sessionCount() const;
+    std::uint64_t commandsExecuted() const { return commands_executed_.load(std::memory_order_relaxed); }
+    std::uint64_t steals() const { return steals_.load(std::memory_order_relaxed); }
+    std::uint64_t hibernations() const { return hibernations_.load(std::memory_order_relaxed); }
+    std::uint64_t rehydrations() const { return rehydrations_.load(std::memory_order_relaxed); }
+
+private:
+    struct Worker {
+        std::mutex mutex;
+        std::deque<std::shared_ptr<Session>> ready;  // 就绪会话：自己从队头取，别人从队尾偷
+        std::thread thread;
+    };
+
+    void workerLoop(size_t index);
+    std::shared_ptr<Session> takeLocal(size_t index);
+    std::shared_ptr<Session> steal(size_t index);
+    void enqueue(std::shared_ptr<Session> session);
+    void runSlice(const std::shared_ptr<Session>& session);
+    void release(const std::shared_ptr<Session>& session, bool unfinished); // 交还执行权，需要时重新排队
+    bool rehydrate(Session& session); // 恢复休眠的会话；恢复失败时返回false
+    void hibernateLoop();
+    std::shared_ptr<Session> find(Session::Id id) const;
+
+    size_t commands_per_slice_;
+    std::chrono::microseconds slice_budget_{2000};
+    int combat_turns_per_slice_{4};
+    std::vector<std::unique_ptr<Worker>> workers_;
+    std::atomic<size_t> next_worker_{0};   // 外部线程投递时轮流选择工作线程
+
+    mutable std::shared_mutex sessions_mutex_;
+    std::unordered_map<Session::Id, std::shared_ptr<Session>> sessions_;
+    Session::Id next_id_{1};
+
+    std::mutex idle_mutex_;
+    std::condition_variable idle_cv_;
+    std::atomic<size_t> pending_{0};       // 所有就绪队列中的会话总数
+    std::atomic<size_t> sleepers_{0};      // 正在等待的工作线程数
+    std::atomic<bool> stopping_{false};
+
+    std::atomic<std::int64_t> hibernate_after_{0}; // 毫秒
+    std::thread hibernator_;
+    std::mutex hibernate_mutex_;
+    std::condition_variable hibernate_cv_;
+
+    std::atomic<std::uint64_t> commands_executed_{0};
+    std::atomic<std::uint64_t> steals_{0};
+    std::atomic<std::uint64_t> hibernations_{0};
+    std::atomic<std::uint64_t> rehydrations_{0};
+    OutputHandler output_handler_;
+};
+
+} // namespace hx
@@ -28,14 +28,25 @@ class ShopSystem {
 public:
     ShopSystem();
     
+    // 重新设置随机种子（录制回放时让进货结果可重现）
+    void seed(unsigned s) { gen_.seed(s); }
+    // 随机数引擎（会话休眠时从中抽出恢复后的种子）
+    std::mt19937& engine() { return gen_; }
+    
     // 初始化商店物品池
     void initializeItemPool();
     
-    // 检查是否需要刷新商店（每5个回合）
-    bool shouldRefresh(int turn_counter) const;
+    // 商店刷新间隔（世界回合）
+    static constexpr int kRefreshInterval = 5;
+    
+    // 标记商店需要刷新（由回合调度器每kRefreshInterval回合调用）
+    void markRefreshDue() { refresh_due_ = true; }
     
-    // 刷新商店物品
-    void refreshShop(std::vector<Item>& shop_items, int turn_counter);
+    // 检查是否需要刷新商店
+    bool refreshDue() const { return refresh_due_; }
+    
+    // 刷新商店物品，并清除刷新标记
+    void refreshShop(std::vector<Item>& shop_items);
     
     // 获取复活符已购买次数
     int getRevivalScrollPurchases() const { return revival_scroll_purchases_; }
@@ -58,10 +69,14 @@ public:
     // 根据ID创建Item（用于商店购买）
     Item createItemFromId(const std::string& item_id) const;
 
+    // 堆上占用的字节数（会话内存统计用，见MemoryUsage.hpp）
+    size_t heapBytes() const;
+
 private:
     std::vector<ShopItemPool> equipment_pool_; // 装备池
     std::vector<ShopItemPool> consumable_pool_; // 消耗品池
     int revival_scroll_purchases_; // 复活符购买次数
+    bool refresh_due_{true}; // 是否待刷新（开局时商店需要进货）
     mutable std::random_device rd_;
     mutable std::mt19937 gen_;
     
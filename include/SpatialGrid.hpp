@@ -0,0 +1,64 @@
+// 这是空间索引的头文件
+// 作者：大一学生
+// 功能：把地点按坐标分到固定大小的格子桶里（每个地图层各一套），
+//       查询一个矩形范围时只看它覆盖的那几个桶，耗时只和范围大小有关，和世界有多大无关。
+//       画地图时用它找出玩家附近的地点
+
+#pragma once
+#include "Location.hpp"   // 坐标
+#include <cstddef>        // size_t
+#include <cstdint>        // 定宽整数
+#include <unordered_map>  // 桶
+#include <vector>         // 向量容器
+
+namespace hx {
+
+// 网格分桶的空间索引
+// 功能：条目是调用者自己的编号（例如地点数组的下标），索引只记它在哪一层、哪个坐标
+class SpatialGrid {
+public:
+    static constexpr int kCellSize = 8;  // 一个桶覆盖 kCellSize×kCellSize 个坐标
+    static constexpr size_t npos = static_cast<size_t>(-1);
+
+    void clear() { buckets_.clear(); count_ = 0; }
+    void insert(int layer, Coord pos, size_t item);
+
+    // 对矩形 [x0,x1]×[y0,y1]（含边界）里的每个条目调用 fn(pos, item)
+    template <class Fn>
+    void forEachIn(int layer, int x0, int y0, int x1, int y1, Fn&& fn) const {
+        for (int cy = cellOf(y0); cy <= cellOf(y1); ++cy) {
+            for (int cx = cellOf(x0); cx <= cellOf(x1); ++cx) {
+                auto it = buckets_.find(bucketKey(layer, cx, cy));
+                if (it == buckets_.end()) continue;
+                for (const Entry& e : it->second) {
+                    if (e.pos.x >= x0 && e.pos.x <= x1 && e.pos.y >= y0 && e.pos.y <= y1) fn(e.pos, e.item);
+                }
+            }
+        }
+    }
+
+    // 正好在 pos 上的条目（没有返回 npos，有多个时返回先加入的）
+    size_t at(int layer, Coord pos) const;
+
+    size_t size() const { return count_; }
+    size_t heapBytes() const; // 桶占用的堆内存（见MemoryUsage.hpp）
+
+private:
+    struct Entry {
+        Coord pos;
+        size_t item;
+    };
+
+    // 坐标所在的桶（向下取整，负坐标也对）
+    static int cellOf(int v) { return v >= 0 ? v / kCellSize : -((-v + kCellSize - 1) / kCellSize); }
+    static std::uint64_t bucketKey(int layer, int cx, int cy) {
+        return (static_cast<std::uint64_t>(static_cast<std::uint16_t>(layer)) << 48) |
+               (static_cast<std::uint64_t>(static_cast<std::uint32_t>(cx) & 0xFFFFFFu) << 24) |
+               (static_cast<std::uint64_t>(static_cast<std::uint32_t>(cy) & 0xFFFFFFu));
+    }
+
+    std::unordered_map<std::uint64_t, std::vector<Entry>> buckets_;
+    size_t count_{0};
+};
+
+} // namespace hx
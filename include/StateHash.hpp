@@ -0,0 +1,69 @@
+// 这是游戏状态哈希的头文件
+// 作者：大一学生
+// 功能：给GameState算一个稳定的64位内容哈希，用来确认回放或重构之后世界完全一样，
+//       也可以作为渲染、预览结果的缓存键。哈希只和内容有关：
+//       与容器的遍历顺序、背包槽位的先后、进程和平台都无关
+
+#pragma once
+#include <cstddef>      // size_t
+#include <cstdint>      // 定宽整数
+#include <string>       // 字符串
+#include <string_view>  // 不复制的字符串片段
+
+namespace hx {
+
+struct GameState;
+struct Attributes;
+struct Item;
+
+// 64位哈希器
+// 功能：按顺序喂入整数和字符串。字节按8字节一组分给4条互不依赖的通道，
+//       每组只做异或、乘法和移位，编译器可以把4条通道并行展开；最后再把通道混合到一起
+class StateHasher {
+public:
+    explicit StateHasher(std::uint64_t seed = 0);
+
+    void add(std::uint64_t value);
+    void add(std::int64_t value) { add(static_cast<std::uint64_t>(value)); }
+    void add(int value) { add(static_cast<std::uint64_t>(static_cast<std::int64_t>(value))); }
+    void add(bool value) { add(static_cast<std::uint64_t>(value ? 1 : 0)); }
+    void add(double value);
+    void add(std::string_view text);  // 先写长度再写内容，"ab"+"c" 与 "a"+"bc" 不同
+    void addBytes(const void* data, size_t size);
+
+    std::uint64_t digest() const;
+
+private:
+    void word(std::uint64_t w);
+
+    std::uint64_t lanes_[4];
+    std::uint64_t tail_{0};   // 凑不满8字节的部分
+    size_t tail_size_{0};
+    size_t next_lane_{0};
+    std::uint64_t length_{0};
+};
+
+// 分块的状态哈希：每块单独一个值，不一致时能看出是哪一块变了
+struct StateDigest {
+    std::uint64_t player{0};     // 等级、经验、金币、属性、状态效果
+    std::uint64_t inventory{0};  // 背包物品
+    std::uint64_t equipment{0};  // 已装备的物品
+    std::uint64_t favors{0};     // NPC好感
+    std::uint64_t tasks{0};      // 任务状态和目标文本
+    std::uint64_t dialogue{0};   // 对话记忆
+    std::uint64_t spawns{0};     // 怪物刷新
+    std::uint64_t flags{0};      // 位置、剧情标记、世界回合、商店计数
+    std::uint64_t world{0};      // 各地点当前的商店货架
+    std::uint64_t total{0};      // 以上各块合在一起
+
+    bool operator==(const StateDigest& o) const { return total == o.total; }
+    bool operator!=(const StateDigest& o) const { return total != o.total; }
+};
+
+// 计算整个游戏状态的哈希
+StateDigest hashState(const GameState& state);
+
+// 哈希值的16位十六进制文本
+std::string hashToHex(std::uint64_t hash);
+
+} // namespace hx
@@ -3,8 +3,11 @@
 // 功能：定义游戏中的任务系统，包括任务和任务管理器
 
 #pragma once
-#include <string>  // 字符串
-#include <vector>  // 向量容器
+#include <cstdint>        // 定宽整数
+#include <string>         // 字符串
+#include <unordered_map>  // 哈希映射
+#include <utility>        // pair
+#include <vector>         // 向量容器
 
 namespace hx {
 
@@ -13,7 +16,7 @@ class Player;
 
 // 任务状态枚举
 // 功能：定义任务的不同状态
-enum class TaskStatus {
+enum class TaskStatus : std::uint8_t {
     NOT_STARTED,    // 未接取
     IN_PROGRESS,    // 进行中
     COMPLETED,      // 已完成
@@ -21,7 +24,7 @@ enum class TaskStatus {
 };
 
 // 任务类型
-enum class TaskType {
+enum class TaskType : std::uint8_t {
     MAIN,           // 主线任务
     SIDE,           // 支线任务
     DAILY           // 日常任务
@@ -37,7 +40,15 @@ struct TaskReward {
     std::string description;
 };
 
+// 任务进度
+// 功能：紧凑状态表中的一行，只记录会变化的数据（状态 + 被改写过的目标文本）
+struct TaskProgress {
+    TaskStatus status{TaskStatus::NOT_STARTED};
+    std::vector<std::pair<std::uint8_t, std::string>> objective_overrides; // (目标序号, 当前文本)
+};
+
 // 任务类
+// 功能：任务的静态定义（名称、描述、奖励、初始目标），运行期状态统一保存在TaskManager中
 class Task {
 public:
     Task(const std::string& id, const std::string& name, const std::string& description,
@@ -48,13 +59,6 @@ public:
     const std::string& getName() const { return name_; }
     const std::string& getDescription() const { return description_; }
     TaskType getType() const { return type_; }
-    TaskStatus getStatus() const { return status_; }
-    
-    // 状态管理
-    void start();
-    void complete();
-    void fail();
-    void setStatus(TaskStatus status) { status_ = status; }
     
     // 奖励
     const std::vector<TaskReward>& getRewards() const { return rewards_; }
@@ -62,45 +66,44 @@ public:
     // 完成条件
     void addObjective(const std::string& objective);
     const std::vector<std::string>& getObjectives() const { return objectives_; }
-    bool isCompleted() const { return status_ == TaskStatus::COMPLETED; }
-    // 更新单条目标文本（用于显示实时进度）
-    void setObjective(size_t index, const std::string& text);
     
     // 任务信息显示
-    std::string getStatusString() const;
     std::string getTypeString() const;
-    std::string getFullInfo() const;
+    std::string getFullInfo(const TaskProgress& progress) const;
 
 private:
     std::string id_;
     std::string name_;
     std::string description_;
     TaskType type_;
-    TaskStatus status_;
     std::vector<TaskReward> rewards_;
     std::vector<std::string> objectives_;
 };
 
+// 任务状态文字与图标
+const char* taskStatusString(TaskStatus status);
+const char* taskStatusIcon(TaskStatus status);
+
 // 任务管理器
+// 功能：唯一的任务存储。定义与进度分开存放，按下标一一对应，
+//       每次进度变化只写状态表中的一行
 class TaskManager {
 public:
     TaskManager();
     
     // 任务管理
     void addTask(const Task& task);
-    Task* getTask(const std::string& task_id);
     const Task* getTask(const std::string& task_id) const;
     
     // 任务状态
+    TaskStatus getStatus(const std::string& task_id) const;
     void startTask(const std::string& task_id);
-    void completeTask(const std::string& task_id);
+    // announce为false时不打印【任务完成】提示（由调用方自行输出剧情文本）
+    void completeTask(const std::string& task_id, bool announce = true);
     void failTask(const std::string& task_id);
     
-    // 任务查询
-    std::vector<Task*> getActiveTasks();
-    std::vector<Task*> getCompletedTasks();
-    std::vector<Task*> getTasksByType(TaskType type);
-    std::vector<Task*> getAllTasks();
+    // 更新单条目标文本（用于显示实时进度）
+    void setObjective(const std::string& task_id, size_t index, const std::string& text);
     
     // 任务进度
     bool hasActiveTask(const std::string& task_id) const;
@@ -112,12 +115,22 @@ public:
     void showTaskList(const Player& player) const;
     void showTaskDetails(const std::string& task_id) const;
     
-    // 序列化方法
-    std::vector<Task> getAllTasksData() const;
-    void setAllTasksData(const std::vector<Task>& tasks);
+    // 序列化：只保存状态表，定义由createTasks重建
+    const std::vector<Task>& tasks() const { return tasks_; }
+    const std::vector<TaskProgress>& progressTable() const { return progress_; }
+    bool restoreProgress(const std::string& task_id, const TaskProgress& progress);
+
+    // 堆上占用的字节数（会话内存统计用，见MemoryUsage.hpp）
+    size_t heapBytes() const;
 
 private:
-    std::vector<Task> tasks_;
+    TaskProgress* findProgress(const std::string& task_id);
+    const TaskProgress* findProgress(const std::string& task_id) const;
+    void printTaskSections() const;
+
+    std::vector<Task> tasks_;                               // 任务定义
+    std::vector<TaskProgress> progress_;                    // 紧凑状态表，与tasks_下标对应
+    std::unordered_map<std::string, size_t> index_;         // 任务ID -> 下标
 };
 
 } // namespace hx
@@ -0,0 +1,22 @@
+// 这是终端显示宽度的头文件
+// 作者：大一学生
+// 功能：按终端里实际占的列数计算字符串宽度（中文、全角符号和大部分表情占两列，
+//       组合符号、变体选择符占零列，ANSI颜色控制序列不占列），画地图时用来对齐
+
+#pragma once
+#include <cstdint>      // 定宽整数
+#include <string>       // 字符串
+#include <string_view>  // 不复制输入
+
+namespace hx {
+
+// 一个码点占的列数（0、1或2）
+int codepointWidth(std::uint32_t cp);
+
+// 一段UTF-8文本占的列数；不合法的字节按一列算
+int displayWidth(std::string_view text);
+
+// 在右边补空格到 width 列（已经够宽时原样返回）
+std::string padRight(std::string_view text, int width);
+
+} // namespace hx
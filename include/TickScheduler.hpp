@@ -0,0 +1,80 @@
+// 这是回合调度器的头文件
+// 作者：大一学生
+// 功能：按"世界回合"调度定时任务（状态效果、怪物刷新、商店刷新等），
+//       使用分层时间轮实现，推进回合时只处理到期的任务
+
+#pragma once
+#include <array>       // 定长数组
+#include <cstdint>     // 定宽整数
+#include <functional>  // std::function
+#include <vector>      // 向量容器
+
+namespace hx {
+
+// 回合调度器
+// 功能：每个游戏世界各自拥有一个，没有进程级共享的静态状态
+class TickScheduler {
+public:
+    using TimerId = std::uint64_t;  // 0 表示无效任务
+    using Callback = std::function<void()>;
+
+    TickScheduler() = default;
+
+    // 当前回合
+    std::uint64_t now() const { return now_; }
+
+    // 清空所有任务并把时钟设置到指定回合（读档时使用）
+    void reset(std::uint64_t now = 0);
+
+    // delay 回合后执行一次（delay 至少为1）
+    TimerId schedule(std::uint64_t delay, Callback callback);
+
+    // 每隔 interval 回合执行一次，首次在 first_delay 回合后（为0时取 interval）
+    TimerId scheduleEvery(std::uint64_t interval, Callback callback, std::uint64_t first_delay = 0);
+
+    // 取消任务；任务不存在或已执行完毕时返回false
+    bool cancel(TimerId id);
+
+    // 距离任务到期还有多少回合；任务不存在时返回0
+    std::uint64_t remaining(TimerId id) const;
+
+    // 推进 ticks 个回合，依次执行到期任务
+    void advance(std::uint64_t ticks = 1);
+
+    // 尚未执行的任务数量
+    size_t pending() const { return active_count_; }
+
+    // 堆上占用的字节数（会话内存统计用；回调捕获的内容不计入）
+    size_t heapBytes() const;
+
+private:
+    static constexpr int kSlotBits = 6;
+    static constexpr std::uint64_t kSlots = 1ull << kSlotBits;  // 每层64个槽
+    static constexpr int kLevels = 4;                            // 4层覆盖 2^24 个回合
+
+    struct Timer {
+        std::uint64_t due{0};
+        std::uint64_t interval{0};    // 0 表示一次性任务
+        std::uint32_t generation{0};  // 槽位复用时区分新旧任务
+        bool active{false};
+        Callback callback;
+    };
+
+    static TimerId makeId(std::uint32_t index, std::uint32_t generation) {
+        return (static_cast<TimerId>(generation) << 32) | (static_cast<TimerId>(index) + 1);
+    }
+    const Timer* find(TimerId id) const;
+    std::uint32_t allocate();
+    void release(std::uint32_t index);
+    void place(TimerId id);
+    void tick();
+
+    std::uint64_t now_{0};
+    size_t active_count_{0};
+    std::vector<Timer> timers_;
+    std::vector<std::uint32_t> free_;
+    std::array<std::array<std::vector<TimerId>, kSlots>, kLevels> wheel_;
+    std::vector<TimerId> overflow_;  // 超出时间轮范围的远期任务
+};
+
+} // namespace hx
@@ -0,0 +1,26 @@
+// 这是进程共用的辅助线程池的头文件
+// 作者：大一学生
+// 功能：胜率预估、配装搜索这类"一次算很多份、可以分给几个线程"的计算共用的一组线程。
+//       线程数固定（不超过CPU核数），第一次用到时才创建，以后一直留着；
+//       会话越多也不会多开线程，忙不过来时调用线程自己把活干完
+
+#pragma once
+
+namespace hx {
+
+// 让 work 在调用线程和最多 helpers 个池里的线程上同时运行
+// 功能：work 应自己从共享的计数器领取任务，领完就返回（各线程跑的是同一个 work）。
+//       调用线程先自己跑 work；返回前等已经开始的辅助线程跑完，还没轮到的辅助任务直接作废，
+//       所以池里排队很长时也不会干等
+void runShared(unsigned helpers, void (*work)(void*), void* arg);
+
+// 方便传 lambda 的写法
+template <typename Work>
+void runShared(unsigned helpers, Work& work) {
+    runShared(helpers, [](void* arg) { (*static_cast<Work*>(arg))(); }, &work);
+}
+
+// 池里的线程数（至少1）
+unsigned sharedPoolThreads();
+
+} // namespace hx
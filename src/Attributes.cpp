@@ -49,11 +49,11 @@ void Attributes::removeStatus(StatusEffect effect) {
     active_statuses.erase(effect);
 }
 
-void Attributes::updateStatuses() {
+void Attributes::updateStatuses(int turns) {
     std::vector<StatusEffect> to_remove;
     
     for (auto& [effect, info] : active_statuses) {
-        info.duration--;
+        info.duration -= turns;
         if (info.duration <= 0) {
             to_remove.push_back(effect);
         }
@@ -115,29 +115,54 @@ int Attributes::getEffectiveSPD() const {
 
 // 属性点分配
 bool Attributes::allocatePoint(const std::string& stat) {
+    Stat which;
+    return parseStat(stat, which) && allocatePoint(which);
+}
+
+bool Attributes::allocatePoint(Stat stat) {
     if (available_points <= 0) return false;
     
-    if (stat == "hp" || stat == "HP") {
+    switch (stat) {
+    case Stat::HP:
         total_hp_points++;
         max_hp += 5;
         hp += 5;
-    } else if (stat == "atk" || stat == "ATK") {
+        break;
+    case Stat::ATK:
         total_atk_points++;
         atk += 2;
-    } else if (stat == "def" || stat == "DEF") {
+        break;
+    case Stat::DEF:
         total_def_points++;
         def_ += 2;
-    } else if (stat == "spd" || stat == "SPD") {
+        break;
+    case Stat::SPD:
         total_spd_points++;
         spd += 2;
-    } else {
-        return false;
+        break;
     }
     
     available_points--;
     return true;
 }
 
+// 解析属性名
+bool parseStat(std::string_view name, Stat& out) {
+    if (name.size() < 2 || name.size() > 3) return false;
+    char lower[3] = {0, 0, 0};
+    for (size_t i = 0; i < name.size(); ++i) {
+        char c = name[i];
+        lower[i] = (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+    }
+    std::string_view key(lower, name.size());
+    if (key == "hp") out = Stat::HP;
+    else if (key == "atk") out = Stat::ATK;
+    else if (key == "def") out = Stat::DEF;
+    else if (key == "spd") out = Stat::SPD;
+    else return false;
+    return true;
+}
+
 void Attributes::addAvailablePoints(int points) {
     available_points += points;
 }
@@ -0,0 +1,625 @@
+// 这是自动玩家（bot）的实现文件
+// 作者：大一学生
+// 功能：解析游戏输出（属性、位置、菜单、战斗结果），按打法选择下一条指令，
+//       以及在进程内驱动一局游戏的 runBot
+
+#include "Bot.hpp"     // 自动玩家头文件
+#include "Game.hpp"    // 游戏类
+#include "Output.hpp"  // 游戏输出
+#include "Replay.hpp"  // 输入记录
+#include <algorithm>   // 查找
+#include <chrono>      // 计时
+#include <cstdlib>     // strtol
+#include <sstream>     // 字符串流
+
+namespace hx {
+
+namespace {
+
+// 不同打法的参数
+struct Tactics {
+    int level_margin;    // 挑战比自己高几级的怪（负数表示只打低级怪）
+    int heal_percent;    // 生命低于上限的百分之多少时喝药
+    int potion_stock;    // 身上常备几瓶药水
+    int wenxin_level;    // 几级开始挑战文心潭（游戏要求至少9级）
+    int scrolls;         // 买几张复活符
+    const char* stats[2]; // 升级后轮流加点的属性
+};
+
+const Tactics& tacticsFor(BotStrategy strategy) {
+    static const Tactics balanced{0, 50, 3, 10, 0, {"atk", "hp"}};
+    static const Tactics aggressive{1, 30, 1, 9, 0, {"atk", "atk"}};
+    static const Tactics cautious{-1, 70, 5, 11, 1, {"hp", "def"}};
+    switch (strategy) {
+        case BotStrategy::AGGRESSIVE: return aggressive;
+        case BotStrategy::CAUTIOUS: return cautious;
+        default: return balanced;
+    }
+}
+
+// bot记得的地图：地点名（输出里显示的）和地点ID，以及每条路要输入的指令
+struct Place { const char* name; const char* id; };
+struct Road { const char* from; const char* to; const char* command; };
+
+const Place kPlaces[] = {
+    {"秘境图书馆", "library"}, {"文心潭", "wenxintan"}, {"信息楼", "info_building"},
+    {"教学区", "teaching_area"}, {"三六广场", "plaza_36"}, {"体育馆", "gymnasium"},
+    {"大学生活动中心", "activity_center"}, {"荒废北操场", "north_playground"}, {"食堂", "canteen"},
+    {"九珠坛", "jiuzhutan"}, {"教学楼二区", "teach_2"}, {"教学楼三区", "teach_3"},
+    {"教学楼四区", "teach_4"}, {"教学楼五区", "teach_5"}, {"教学楼六区", "teach_6"},
+    {"教学楼七区", "teach_7"}, {"树下空间", "tree_space"},
+};
+
+const Road kRoads[] = {
+    {"library", "wenxintan", "d"}, {"library", "info_building", "a"},
+    {"wenxintan", "library", "a"},
+    {"info_building", "library", "d"}, {"info_building", "teaching_area", "a"},
+    {"teaching_area", "info_building", "d"}, {"teaching_area", "plaza_36", "a"},
+    {"teaching_area", "jiuzhutan", "enter"},
+    {"plaza_36", "teaching_area", "d"}, {"plaza_36", "gymnasium", "a"},
+    {"gymnasium", "plaza_36", "d"}, {"gymnasium", "activity_center", "a"},
+    {"activity_center", "gymnasium", "d"}, {"activity_center", "north_playground", "w"},
+    {"north_playground", "canteen", "d"}, {"north_playground", "activity_center", "s"},
+    {"canteen", "north_playground", "a"},
+    {"jiuzhutan", "teach_4", "d"}, {"jiuzhutan", "teach_3", "a"}, {"jiuzhutan", "teaching_area", "exit"},
+    {"teach_2", "teach_3", "d"},
+    {"teach_3", "jiuzhutan", "d"}, {"teach_3", "teach_2", "a"}, {"teach_3", "teach_5", "s"},
+    {"teach_4", "jiuzhutan", "a"},
+    {"teach_5", "teach_6", "d"}, {"teach_5", "teach_3", "w"},
+    {"teach_6", "teach_5", "a"}, {"teach_6", "teach_7", "d"}, {"teach_6", "tree_space", "s"},
+    {"teach_7", "teach_6", "a"},
+    {"tree_space", "teach_6", "w"},
+};
+
+// 练级用的怪物（地点、名字、推荐等级）
+struct Prey { const char* place; const char* name; int level; };
+const Prey kPrey[] = {
+    {"gymnasium", "迷糊书虫", 1}, {"gymnasium", "拖延小妖", 2},
+    {"plaza_36", "水波幻影", 3}, {"plaza_36", "学业焦虑影", 4},
+    {"north_playground", "夜行怠惰魔", 6}, {"north_playground", "压力黑雾", 7},
+    {"teach_7", "实验失败妖·群", 8}, {"tree_space", "答辩紧张魔", 8},
+    {"teach_5", "高数难题精", 9},
+};
+
+// 文心潭的三个心魔，依次挑战
+const char* const kBosses[] = {"文献综述怪", "实验失败妖·复苏", "答辩紧张魔·强化"};
+
+// 硕士及以上品质的装备：商店里买得到的武器和护甲（启智笔由高数难题精首杀获得）
+const char* const kHeroicWeapons[] = {"启智笔", "二手吉他", "博士大论文"};
+const char* const kHeroicArmors[] = {"学士袍", "灵能护甲", "实验服"};
+
+// 闲逛指令：真实玩家会时不时看看周围、背包和任务
+const char* const kChatter[] = {"look", "inv", "task", "monsters", "map", "stats"};
+
+const char* const kPotion = "生命药水";
+const char* const kScroll = "复活符";
+
+template <size_t N>
+bool listed(const char* const (&names)[N], std::string_view name) {
+    for (const char* n : names) if (name == n) return true;
+    return false;
+}
+
+const char* placeId(std::string_view name) {
+    for (const Place& p : kPlaces) if (name == p.name) return p.id;
+    return nullptr;
+}
+
+bool startsWith(std::string_view s, std::string_view prefix) {
+    return s.substr(0, prefix.size()) == prefix;
+}
+
+bool endsWith(std::string_view s, std::string_view suffix) {
+    return s.size() >= suffix.size() && s.substr(s.size() - suffix.size()) == suffix;
+}
+
+// 去掉颜色、清屏等终端控制序列
+std::string stripAnsi(std::string_view text) {
+    std::string out;
+    out.reserve(text.size());
+    for (size_t i = 0; i < text.size(); ++i) {
+        if (text[i] == '\x1b' && i + 1 < text.size() && text[i + 1] == '[') {
+            i += 2;
+            while (i < text.size() && !(text[i] >= '@' && text[i] <= '~')) ++i;
+            continue;
+        }
+        out += text[i];
+    }
+    return out;
+}
+
+// 读取 s 中 pos 开始的整数（可以有负号），pos 移到数字后面
+bool readInt(std::string_view s, size_t& pos, int& out) {
+    while (pos < s.size() && s[pos] == ' ') ++pos;
+    size_t begin = pos;
+    if (pos < s.size() && s[pos] == '-') ++pos;
+    while (pos < s.size() && s[pos] >= '0' && s[pos] <= '9') ++pos;
+    if (pos == begin || (pos == begin + 1 && s[begin] == '-')) return false;
+    out = static_cast<int>(std::strtol(std::string(s.substr(begin, pos - begin)).c_str(), nullptr, 10));
+    return true;
+}
+
+// "标签a/b" 形式的两个数
+bool readPair(std::string_view s, std::string_view label, int& a, int& b) {
+    size_t at = s.find(label);
+    if (at == std::string_view::npos) return false;
+    size_t pos = at + label.size();
+    if (!readInt(s, pos, a) || pos >= s.size() || s[pos] != '/') return false;
+    ++pos;
+    return readInt(s, pos, b);
+}
+
+// 标签后面的一个数
+bool readAfter(std::string_view s, std::string_view label, int& out) {
+    size_t at = s.find(label);
+    if (at == std::string_view::npos) return false;
+    size_t pos = at + label.size();
+    return readInt(s, pos, out);
+}
+
+// 两个标记之间的文字
+std::string_view between(std::string_view s, std::string_view open, std::string_view close) {
+    size_t a = s.find(open);
+    if (a == std::string_view::npos) return {};
+    a += open.size();
+    size_t b = s.find(close, a);
+    if (b == std::string_view::npos) return {};
+    return s.substr(a, b - a);
+}
+
+} // namespace
+
+const char* botStrategyName(BotStrategy strategy) {
+    switch (strategy) {
+        case BotStrategy::AGGRESSIVE: return "aggressive";
+        case BotStrategy::CAUTIOUS: return "cautious";
+        default: return "balanced";
+    }
+}
+
+bool parseBotStrategy(std::string_view text, BotStrategy& out) {
+    for (BotStrategy s : {BotStrategy::BALANCED, BotStrategy::AGGRESSIVE, BotStrategy::CAUTIOUS}) {
+        if (text == botStrategyName(s)) {
+            out = s;
+            return true;
+        }
+    }
+    return false;
+}
+
+const char* botStageName(BotStage stage) {
+    switch (stage) {
+        case BotStage::INTRO: return "开场剧情";
+        case BotStage::STARTER_GEAR: return "领取新手装备";
+        case BotStage::TRAINING: return "练级";
+        case BotStage::WENXINTAN: return "文心潭";
+        case BotStage::ENDING: return "结局判定";
+        case BotStage::DONE: return "已通关";
+    }
+    return "";
+}
+
+Bot::Bot(const BotConfig& config) : config_(config), rng_(config.seed) {}
+
+bool Bot::next(std::string_view output, std::string& line) {
+    std::string text = stripAnsi(output);
+    observe(text);
+    if (ending_seen_) stage_ = BotStage::DONE;
+    if (stage_ == BotStage::DONE || commands_ >= config_.max_commands) return false;
+
+    // 开场剧情：输入关键词，再按回车看新手引导
+    if (intro_step_ < 2) {
+        line = intro_step_ == 0 ? "翻阅古籍" : "";
+        ++intro_step_;
+        ++commands_;
+        return true;
+    }
+
+    switch (detectPrompt(text)) {
+        case Prompt::COMMAND:
+            line = decide();
+            break;
+        case Prompt::DIALOGUE:
+            line = answerDialogue();
+            break;
+        case Prompt::SHOP:
+            line = answerShop();
+            break;
+        case Prompt::NPC_MENU:
+            line = talk_goal_ == TalkGoal::STARTER_GEAR ? "林清漪"
+                 : talk_goal_ == TalkGoal::SHOP ? "钱道然" : "back";
+            break;
+        case Prompt::ACCESSORY_SLOT:
+            line = "1";
+            break;
+        case Prompt::QUIZ:
+            line = std::string(1, static_cast<char>('A' + std::uniform_int_distribution<int>(0, 2)(rng_)));
+            break;
+        case Prompt::OTHER:
+            line = "back";
+            break;
+    }
+    ++commands_;
+    return true;
+}
+
+Bot::Prompt Bot::detectPrompt(std::string_view output) {
+    if (endsWith(output, "请选择 (输入数字或命令): ")) return Prompt::DIALOGUE;
+    if (endsWith(output, "'sell' 出售装备（10金币/件）： ")) return Prompt::SHOP;
+    if (endsWith(output, "输入编号或NPC名字（back返回）：")) return Prompt::NPC_MENU;
+    if (endsWith(output, "请选择 (1/2): ")) return Prompt::ACCESSORY_SLOT;
+    if (endsWith(output, "\n> ")) {
+        // 答题的提示语也以 "> " 结尾，前一行是最后一个选项
+        std::string_view rest = output.substr(0, output.size() - 3);
+        size_t row = rest.rfind('\n');
+        std::string_view last = row == std::string_view::npos ? rest : rest.substr(row + 1);
+        return startsWith(last, " C) ") ? Prompt::QUIZ : Prompt::COMMAND;
+    }
+    return Prompt::OTHER;
+}
+
+void Bot::observe(const std::string& text) {
+    std::string_view all(text);
+    size_t start = 0;
+    while (start <= all.size()) {
+        size_t end = all.find('\n', start);
+        if (end == std::string_view::npos) end = all.size();
+        observeLine(all.substr(start, end - start));
+        start = end + 1;
+    }
+}
+
+void Bot::observeLine(std::string_view row) {
+    std::string_view s = row;
+    while (!s.empty() && s.front() == ' ') s.remove_prefix(1);
+    if (s.empty()) return;
+
+    // 编号菜单（对话选项、商店货架、NPC列表）：看到1号时重新开始收集
+    if (s.front() >= '0' && s.front() <= '9') {
+        size_t pos = 0;
+        int number = 0;
+        if (readInt(s, pos, number) && startsWith(s.substr(pos), ". ")) {
+            if (number == 1) options_.clear();
+            Option option{number, std::string(s.substr(pos + 2)), 0};
+            size_t dash = option.text.find("  - ");
+            if (dash != std::string::npos) {
+                size_t price_pos = dash + 4;
+                readInt(option.text, price_pos, option.price);
+                option.text.erase(dash);
+            }
+            options_.push_back(std::move(option));
+            return;
+        }
+    }
+
+    int a = 0;
+    int b = 0;
+    if (startsWith(s, "📍 【")) {
+        if (const char* id = placeId(between(s, "【", "】"))) location_ = id;
+    } else if (startsWith(s, "📍 位置: ")) {
+        if (const char* id = placeId(s.substr(std::string_view("📍 位置: ").size()))) location_ = id;
+    } else if (startsWith(s, "等级: ")) {
+        // stats 的第一行；没有"未分配属性点"一行时说明点数已经用完
+        readAfter(s, "等级: ", level_);
+        readAfter(s, "金币: ", coins_);
+        points_ = 0;
+    } else if (startsWith(s, "金币: ")) {
+        readAfter(s, "金币: ", coins_);  // 商店页头
+    } else if (readPair(s, "生命: ", a, b) || readPair(s, "你的HP: ", a, b) ||
+               readPair(s, "当前血量: ", a, b) || readPair(s, "当前生命值: ", a, b)) {
+        hp_ = a;
+        max_hp_ = b;
+    } else if (startsWith(s, "未分配属性点: ")) {
+        readAfter(s, "未分配属性点: ", points_);
+    } else if (startsWith(s, "【属性点】获得 ")) {
+        readAfter(s, "【属性点】获得 ", points_);
+    } else if (startsWith(s, "【升级】等级提升至 ")) {
+        readAfter(s, "【升级】等级提升至 ", level_);
+        hp_ = max_hp_;
+        stats_stale_ = true;
+    } else if (startsWith(s, "【死亡惩罚】") || startsWith(s, "【复活符】你使用了复活符")) {
+        ++deaths_;
+        if (startsWith(s, "【复活符】")) --scrolls_;
+        // 吃过亏的怪，等比这次高一级再来
+        if (!target_.empty()) respect_[target_] = std::max(respect_[target_], level_ + 1);
+        stats_stale_ = true;
+        target_.clear();
+    } else if (startsWith(s, "你击败了 ")) {
+        std::string name(between(s, "你击败了 ", "！"));
+        ++turns_;
+        if (listed(kBosses, name)) bosses_beaten_.insert(name);
+        stats_stale_ = true;
+    } else if (s.find("暂时不在这个区域") != std::string_view::npos) {
+        if (!target_.empty()) blocked_[target_] = turns_ + 6;
+    } else if (s.find("【商店刷新】") != std::string_view::npos) {
+        shop_fresh_ = true;
+    } else if (startsWith(s, "这里没有这个敌人")) {
+        // 怪物被打光后会从地点里消失；也可能是位置记错了，看一眼再走
+        if (!target_.empty()) blocked_[target_] = turns_ + 6;
+        location_.clear();
+    } else if (startsWith(s, "购买了 ")) {
+        std::string name(between(s, "购买了 ", "！"));
+        if (name == kPotion) ++potions_;
+        else if (name == kScroll) ++scrolls_;
+        else pending_.push_back("equip " + name);
+    } else if (s.find("使用了") != std::string_view::npos && s.find(kPotion) != std::string_view::npos) {
+        if (potions_ > 0) --potions_;
+    } else if (startsWith(s, "未找到物品: ") || startsWith(s, "物品数量不足: ")) {
+        potions_ = 0;
+    } else if (startsWith(s, "金币不足")) {
+        stats_stale_ = true;
+    } else if (startsWith(s, "装备了 ")) {
+        std::string name(s.substr(std::string_view("装备了 ").size()));
+        if (!name.empty() && endsWith(name, "。")) name.erase(name.size() - std::string_view("。").size());
+        if (listed(kHeroicWeapons, name)) master_weapon_ = true;
+        if (listed(kHeroicArmors, name)) master_armor_ = true;
+    } else if (s.find("启智笔") != std::string_view::npos && s.find("获得") != std::string_view::npos && !has_pen_) {
+        has_pen_ = true;
+        pending_.push_back("equip 启智笔");
+    } else if (s.find("【获得装备】") != std::string_view::npos || s.find("装备我已经给过你了") != std::string_view::npos) {
+        starter_gear_ = true;
+    } else if (readAfter(s, "高品质装备件数(≥硕士): ", a)) {
+        // 文心潭门口的判定告诉我们实际装备了几件高品质装备
+        if (a < heroicGear()) {
+            if (a == 0) master_weapon_ = false;
+            master_armor_ = false;
+        }
+    } else if (startsWith(s, "未满足进入条件")) {
+        wenxin_refused_ = true;
+        stats_stale_ = true;
+    } else if (startsWith(s, "=== 进入文心潭")) {
+        wenxin_refused_ = false;
+    } else if (s.find("结局") != std::string_view::npos && (startsWith(s, "💔") || startsWith(s, "⚖️") ||
+               startsWith(s, "🌟 结局") || startsWith(s, "🎓") || startsWith(s, "🌅"))) {
+        ending_seen_ = true;
+    }
+}
+
+// 在指令提示符下：先处理已经排好的指令，再依次考虑属性、加点、喝药、买东西、打怪
+std::string Bot::decide() {
+    const Tactics& t = tacticsFor(config_.strategy);
+
+    if (!pending_.empty()) {
+        std::string line = std::move(pending_.front());
+        pending_.pop_front();
+        return line;
+    }
+    if (stats_stale_) {
+        stats_stale_ = false;
+        return "stats";
+    }
+    if (points_ > 0) return allocateCommand();
+    if (std::uniform_real_distribution<double>(0.0, 1.0)(rng_) < config_.chatter) {
+        const size_t n = sizeof(kChatter) / sizeof(kChatter[0]);
+        return kChatter[std::uniform_int_distribution<size_t>(0, n - 1)(rng_)];
+    }
+    if (location_.empty()) return "look";
+
+    if (bosses_beaten_.size() == sizeof(kBosses) / sizeof(kBosses[0])) {
+        stage_ = BotStage::ENDING;
+        return "ending";
+    }
+
+    if (!starter_gear_) {
+        stage_ = BotStage::STARTER_GEAR;
+        std::string step = routeTo("library");
+        if (!step.empty()) return step;
+        talk_goal_ = TalkGoal::STARTER_GEAR;
+        goal_chosen_ = false;
+        followup_taken_ = false;
+        return "talk";
+    }
+
+    if (hp_ * 100 < t.heal_percent * max_hp_ && potions_ > 0) {
+        stats_stale_ = true;
+        return std::string("use ") + kPotion;
+    }
+
+    if (wantsShopping()) {
+        std::string step = routeTo("library");
+        if (!step.empty()) return step;
+        talk_goal_ = TalkGoal::SHOP;
+        goal_chosen_ = false;
+        followup_taken_ = false;
+        shop_visited_coins_ = coins_;
+        shop_fresh_ = false;
+        return "talk";
+    }
+
+    std::string place;
+    std::string target;
+    bool heroic = level_ >= t.wenxin_level && heroicGear() >= 2 && !wenxin_refused_;
+    if (heroic) {
+        stage_ = BotStage::WENXINTAN;
+        for (const char* boss : kBosses) {
+            auto it = blocked_.find(boss);
+            if (bosses_beaten_.count(boss) || (it != blocked_.end() && it->second > turns_)) continue;
+            target = boss;
+            place = "wenxintan";
+            break;
+        }
+    } else {
+        stage_ = BotStage::TRAINING;
+        wenxin_refused_ = false;
+    }
+    if (target.empty()) target = chooseTarget(place);
+
+    if (target.empty()) {
+        // 附近的怪都打光了：随便走一步，等刷新
+        for (const Road& r : kRoads) {
+            if (location_ == r.from) {
+                ++turns_;
+                return r.command;
+            }
+        }
+        return "look";
+    }
+
+    std::string step = routeTo(place);
+    if (!step.empty()) return step;
+    target_ = target;
+    return "fight " + target;
+}
+
+std::string Bot::answerDialogue() {
+    std::string_view goal = talk_goal_ == TalkGoal::STARTER_GEAR ? "给予装备"
+                          : talk_goal_ == TalkGoal::SHOP ? "打开商店" : "";
+    if (!goal.empty() && !goal_chosen_) {
+        goal_chosen_ = true;
+        for (const Option& o : options_) {
+            if (o.text.find(goal) != std::string::npos) return std::to_string(o.number);
+        }
+    }
+    // 领装备时还要在下一句道谢才真正拿到
+    if (talk_goal_ == TalkGoal::STARTER_GEAR && !followup_taken_ && !options_.empty()) {
+        followup_taken_ = true;
+        return "1";
+    }
+    if (talk_goal_ == TalkGoal::STARTER_GEAR) {
+        starter_gear_ = true;
+        pending_.push_back("equip 普通学子服");
+        pending_.push_back("equip 竹简笔记");
+    }
+    talk_goal_ = TalkGoal::NONE;
+    return "back";
+}
+
+// 商店：先补药水（身上没药时），再买缺的高品质装备，然后补满药水和复活符，最后离开
+std::string Bot::answerShop() {
+    const Tactics& t = tacticsFor(config_.strategy);
+    const Option* leave = nullptr;
+    const Option* potion = nullptr;
+    const Option* scroll = nullptr;
+    const Option* gear = nullptr;
+    for (const Option& o : options_) {
+        if (o.text == "我不买了") leave = &o;
+        else if (o.text == kPotion) potion = &o;
+        else if (o.text == kScroll) scroll = &o;
+        else if (o.price > 0 && o.price <= coins_ &&
+                 ((!master_weapon_ && !has_pen_ && listed(kHeroicWeapons, o.text)) ||
+                  (!master_armor_ && listed(kHeroicArmors, o.text)))) {
+            gear = &o;
+        }
+    }
+    bool bought_gear = std::any_of(pending_.begin(), pending_.end(),
+                                   [](const std::string& p) { return startsWith(p, "equip "); });
+    if (potion && potions_ == 0 && coins_ >= potion->price) return std::to_string(potion->number);
+    if (gear && !bought_gear) return std::to_string(gear->number);
+    bool saving = needsGear();
+    if (potion && potions_ < t.potion_stock && coins_ >= potion->price && !saving) {
+        return std::to_string(potion->number);
+    }
+    if (scroll && scrolls_ < t.scrolls && coins_ >= scroll->price && !saving) {
+        return std::to_string(scroll->number);
+    }
+    return leave ? std::to_string(leave->number) : "back";
+}
+
+bool Bot::needsGear() const {
+    return level_ >= 7 && heroicGear() < 2;
+}
+
+bool Bot::wantsShopping() const {
+    const Tactics& t = tacticsFor(config_.strategy);
+    if (potions_ == 0 && coins_ >= 30) return true;
+    // 钱比上次来时多了不少或商店刚进了货才再去看看，免得在图书馆来回打转
+    if (!shop_fresh_ && coins_ < shop_visited_coins_ + 100) return false;
+    if (needsGear()) return coins_ >= 220;
+    if (potions_ < t.potion_stock && coins_ >= 30 * (t.potion_stock - potions_)) return true;
+    return scrolls_ < t.scrolls && coins_ >= 300 + 30 * t.potion_stock;
+}
+
+std::string Bot::allocateCommand() {
+    const Tactics& t = tacticsFor(config_.strategy);
+    std::string line = std::string("allocate ") + t.stats[allocations_++ % 2] + " " + std::to_string(points_);
+    points_ = 0;
+    stats_stale_ = true;
+    return line;
+}
+
+std::string Bot::chooseTarget(std::string& place) {
+    const Tactics& t = tacticsFor(config_.strategy);
+    // 生命不多又没有药时先挑低一级的
+    int limit = std::max(1, level_ + t.level_margin - (hp_ * 100 < t.heal_percent * max_hp_ ? 1 : 0));
+    // 还没有启智笔时，到了8级就去试试高数难题精
+    std::vector<const Prey*> best;
+    int best_level = 0;
+    for (const Prey& p : kPrey) {
+        bool pen_hunt = !has_pen_ && std::string_view(p.name) == "高数难题精" && level_ >= 8;
+        if (p.level > limit && !pen_hunt) continue;
+        auto it = blocked_.find(p.name);
+        if (it != blocked_.end() && it->second > turns_) continue;
+        auto lost = respect_.find(p.name);
+        if (lost != respect_.end() && level_ < lost->second) continue;
+        int rank = pen_hunt ? 100 : p.level;
+        if (rank > best_level) {
+            best.clear();
+            best_level = rank;
+        }
+        if (rank == best_level) best.push_back(&p);
+    }
+    if (best.empty()) return {};
+    const Prey* pick = best[std::uniform_int_distribution<size_t>(0, best.size() - 1)(rng_)];
+    place = pick->place;
+    return pick->name;
+}
+
+// 按记得的地图做广度优先搜索，给出第一步
+std::string Bot::routeTo(const std::string& place) {
+    if (location_ == place) return {};
+    std::vector<std::string> frontier{place};
+    std::unordered_set<std::string> seen{place};
+    for (size_t i = 0; i < frontier.size(); ++i) {
+        for (const Road& r : kRoads) {
+            if (frontier[i] != r.to || seen.count(r.from)) continue;
+            seen.insert(r.from);
+            if (location_ == r.from) {
+                ++turns_;
+                return r.command;
+            }
+            frontier.push_back(r.from);
+        }
+    }
+    return "look";
+}
+
+BotReport runBot(const BotConfig& config, std::uint32_t game_seed, std::ostream* output, TranscriptWriter* recorder) {
+    BotReport report;
+    auto begin = std::chrono::steady_clock::now();
+    Bot bot(config);
+    std::ostringstream chunk;
+    {
+        ConsoleScope scope(chunk);
+        Game game(game_seed);
+        // 存档写进自己的存档位，不覆盖玩家的save.dat（回放时也一样，见 replay）
+        std::string save_slot;
+        game.setSaveSlot(&save_slot);
+        game.start();
+        std::string line;
+        while (true) {
+            // bot看到的输出以提示语结尾；bot不再输入时不写最后的提示语，和回放的输出保持一致
+            std::string text = chunk.str();
+            chunk.str(std::string());
+            size_t body = text.size();
+            text += game.prompt();
+            bool more = bot.next(text, line);
+            if (output) *output << (more ? std::string_view(text) : std::string_view(text).substr(0, body));
+            if (!more) break;
+            std::int64_t at_ms = recorder ? recorder->record(line) : -1;
+            bool alive = game.handleLine(line, at_ms);
+            while (alive && game.busy()) alive = game.resume();
+            if (!alive) break;
+        }
+        report.state_hash = game.stateHash().total;
+    }
+    report.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    report.commands = bot.commands();
+    report.stage = bot.stage();
+    report.level = bot.level();
+    report.deaths = bot.deaths();
+    report.keys = bot.keys();
+    report.finished = bot.finished();
+    return report;
+}
+
+} // namespace hx
@@ -3,6 +3,8 @@
 
 #include "Combat.hpp"    // 战斗系统头文件
 #include "GameState.hpp"  // 游戏状态头文件
+#include "Metrics.hpp"    // 运行指标
+#include "Trace.hpp"      // 时间线跟踪
 #include <sstream>        // 字符串流
 #include <algorithm>      // 算法库
 #include <cmath>          // 数学函数
@@ -37,31 +39,46 @@ bool CombatSystem::rollHit(int attacker_spd, int defender_spd) {
     return rollPercent() <= hit_chance;
 }
 
-// 主要战斗函数
+// 主要战斗函数：一次打完整场战斗
 bool CombatSystem::fight(Player& player, Enemy& enemy, std::string& log) {
-    std::ostringstream L;
-    auto& pa = player.attr();
-    auto ea = enemy.attr(); // copy enemy attr (so we can mutate)
-
-    // 隐式动态难度层级计算：0=新手 1=默认 2=熟练
-    auto calcTier = [this,&player]() -> int {
-        int tier = 1;
-        if (!game_state_) return 1;
-        int level = player.level();
-        int qualityScore = 0;
-        for (const auto& it : player.equipment().getEquippedItems()) {
-            if (it.quality == EquipmentQuality::MASTER) qualityScore += 1;
-            else if (it.quality == EquipmentQuality::DOCTOR) qualityScore += 2;
-        }
-        int keys = 0;
-        keys += game_state_->key_i_obtained ? 1 : 0;
-        keys += game_state_->key_ii_obtained ? 1 : 0;
-        keys += game_state_->key_iii_obtained ? 1 : 0;
-        if (level < 6 || (qualityScore <= 0 && level < 9)) tier = 0;
-        if (level >= 10 || qualityScore >= 3 || keys >= 2) tier = 2;
-        return tier;
-    };
-    int tier = calcTier();
+    CombatEncounter c = begin(player, enemy);
+    advance(c, 0);
+    log = c.takeLog();
+    return c.won;
+}
+
+// 动态难度层级
+int CombatSystem::tierFor(const Player& player) const {
+    int tier = 1;
+    if (!game_state_) return 1;
+    int level = player.level();
+    int qualityScore = 0;
+    for (const auto& it : player.equipment().getEquippedItems()) {
+        if (it.quality == EquipmentQuality::MASTER) qualityScore += 1;
+        else if (it.quality == EquipmentQuality::DOCTOR) qualityScore += 2;
+    }
+    int keys = 0;
+    keys += game_state_->key_i_obtained ? 1 : 0;
+    keys += game_state_->key_ii_obtained ? 1 : 0;
+    keys += game_state_->key_iii_obtained ? 1 : 0;
+    if (level < 6 || (qualityScore <= 0 && level < 9)) tier = 0;
+    if (level >= 10 || qualityScore >= 3 || keys >= 2) tier = 2;
+    return tier;
+}
+
+// 开始战斗
+CombatEncounter CombatSystem::begin(Player& player, const Enemy& enemy) {
+    CombatEncounter c(player, enemy);
+    c.tier = tierFor(player);
+    open(c);
+    return c;
+}
+
+// 开场
+void CombatSystem::open(CombatEncounter& c) {
+    std::ostringstream& L = c.log;
+    Player& player = *c.player;
+    const Enemy& enemy = c.enemy;
 
     L << "遭遇敌人：" << enemy.name() << "\n";
     L << "战斗开始！\n";
@@ -76,221 +93,270 @@ bool CombatSystem::fight(Player& player, Enemy& enemy, std::string& log) {
         L << "【校徽】你在战斗开始进入专注状态。\n";
     }
 
-    auto turn = 0;
-    int reading_buff_turns = 0; // 文献综述怪阅读增防
-    bool is_failed_revive = (enemy.name() == "实验失败妖·复苏");
-    int summoned_minions = is_failed_revive ? (tier==0?2:3) : 0; // 层级0开场2只，其它3只
-    int summon_cooldown = is_failed_revive ? 3 : 0;   // 每3回合+1
-    while (pa.hp > 0 && ea.hp > 0) {
-        ++turn; 
-        L << "\n—— 回合 " << turn << " ——\n";
-        L << "你的HP: " << pa.hp << "/" << pa.max_hp << " | " << enemy.name() << " HP: " << ea.hp << "/" << ea.max_hp << "\n";
-        
-        // 更新状态效果
-        player.attr().updateStatuses(); // 更新玩家状态持续时间
-        int heal_amount = updateCombatStatuses(player, enemy);
-        if (heal_amount > 0) {
-            L << "【床上的被子】恢复了 " << heal_amount << " 点生命值。\n";
+    c.is_failed_revive = (enemy.name() == "实验失败妖·复苏");
+    c.summoned_minions = c.is_failed_revive ? (c.tier==0?2:3) : 0; // 层级0开场2只，其它3只
+    c.summon_cooldown = c.is_failed_revive ? 3 : 0;   // 每3回合+1
+}
+
+// 模拟一整场战斗
+// 日志流置为出错状态，所有 << 在格式化之前就直接返回，不产生任何文字和分配；
+// 统计和文心潭失败计数都挂在 game_state_ 上，模拟用的战斗系统不设置它
+bool CombatSystem::simulate(Player& player, const Enemy& enemy, int tier, int& turns, int max_turns) {
+    GameState* saved = game_state_;
+    game_state_ = nullptr;
+    CombatEncounter c(player, enemy);
+    c.log.setstate(std::ios::badbit);
+    c.tier = tier;
+    open(c);
+    while (player.attr().hp > 0 && c.ea.hp > 0 && c.turn < max_turns) playTurn(c);
+    game_state_ = saved;
+    turns = c.turn;
+    return player.attr().hp > 0 && c.ea.hp <= 0;
+}
+
+// 推进战斗：最多 max_turns 回合后返回，剩下的回合下次继续
+bool CombatSystem::advance(CombatEncounter& c, int max_turns) {
+    MetricTimer timer(Metric::COMBAT);
+    int played = 0;
+    while (!c.finished) {
+        // 有一方倒下就立即结算，不必为了结算再多等一次
+        if (c.player->attr().hp <= 0 || c.ea.hp <= 0) {
+            finishEncounter(c);
+            break;
         }
-        // 文献综述怪：层级0每4回合，其它每3回合进入阅读，持续2回合
-        if (enemy.name() == "文献综述怪") {
-            int freq = (tier==0?4:3);
-            if ((turn - 1) % freq == 0) {
-                reading_buff_turns = 2;
-                L << "【阅读】文献综述怪进入阅读状态，防御提升！\n";
-            }
+        if (max_turns > 0 && played >= max_turns) break;
+        HX_TRACE_SPAN("combat_turn");  // 只跟踪真正的战斗回合，模拟的回合不记
+        playTurn(c);
+        ++played;
+    }
+    return c.finished;
+}
+
+// 进行一个回合
+void CombatSystem::playTurn(CombatEncounter& c) {
+    std::ostringstream& L = c.log;
+    Player& player = *c.player;
+    Enemy& enemy = c.enemy;
+    auto& pa = player.attr();
+    auto& ea = c.ea;
+    const int tier = c.tier;
+    const bool is_failed_revive = c.is_failed_revive;
+    int& reading_buff_turns = c.reading_buff_turns;
+    int& summoned_minions = c.summoned_minions;
+    int& summon_cooldown = c.summon_cooldown;
+    int turn = ++c.turn;
+
+    L << "\n—— 回合 " << turn << " ——\n";
+    L << "你的HP: " << pa.hp << "/" << pa.max_hp << " | " << enemy.name() << " HP: " << ea.hp << "/" << ea.max_hp << "\n";
+    
+    // 更新状态效果
+    player.attr().updateStatuses(); // 更新玩家状态持续时间
+    int heal_amount = updateCombatStatuses(player, enemy, turn);
+    if (heal_amount > 0) {
+        L << "【床上的被子】恢复了 " << heal_amount << " 点生命值。\n";
+    }
+    // 文献综述怪：层级0每4回合，其它每3回合进入阅读，持续2回合
+    if (enemy.name() == "文献综述怪") {
+        int freq = (tier==0?4:3);
+        if ((turn - 1) % freq == 0) {
+            reading_buff_turns = 2;
+            L << "【阅读】文献综述怪进入阅读状态，防御提升！\n";
         }
-        // 复苏Boss：召唤节律
-        if (is_failed_revive) {
-            summon_cooldown -= 1;
-            if (summon_cooldown <= 0) {
-                if (tier >= 1) {
-                    summoned_minions += 1; // 层级0不再追加
-                }
-                summon_cooldown = 3;
-                L << "【召唤】又有一只失败实验体小怪加入战场！（当前：" << summoned_minions << ")\n";
+    }
+    // 复苏Boss：召唤节律
+    if (is_failed_revive) {
+        summon_cooldown -= 1;
+        if (summon_cooldown <= 0) {
+            if (tier >= 1) {
+                summoned_minions += 1; // 层级0不再追加
             }
+            summon_cooldown = 3;
+            L << "【召唤】又有一只失败实验体小怪加入战场！（当前：" << summoned_minions << ")\n";
         }
-        
-        // Determine order by SPD（首回合先攻加成）
-        bool playerFirst = pa.getEffectiveSPD() >= ea.spd;
-        if (turn == 1 && player.equipment().hasEffect("first_turn_priority")) {
-            playerFirst = true;
-        }
-        
-        if (playerFirst) {
-            // 玩家行动
-            if (pa.hp > 0) {
-                // 动态防御修正（阅读+50%防御）与钢勺护符克制
-                int enemy_def_for_calc = enemy.attr().def_;
-                if (reading_buff_turns > 0) enemy_def_for_calc = (int)(enemy_def_for_calc * 1.5);
-                double rf = rollRandomFactor();
-                double base_damage = player.attr().getEffectiveATK() * rf;
-                if (enemy.name().find("实验失败妖") != std::string::npos) {
-                    // 钢勺护符：对实验失败妖×1.3
-                    for (const auto& eq : player.equipment().getEquippedItems()) {
-                        if (eq.id == "steel_spoon") { base_damage *= 1.3; break; }
-                    }
-                }
-                int dmg = std::max(1, (int)(base_damage * (1.0 - (double)enemy_def_for_calc / (enemy_def_for_calc + 120.0))));
-                // S3统计：攻击实验失败妖次数
-                if (game_state_ && enemy.name().find("实验失败妖") != std::string::npos) {
-                    game_state_->failed_experiment_attack_count++;
+    }
+    
+    // Determine order by SPD（首回合先攻加成）
+    bool playerFirst = pa.getEffectiveSPD() >= ea.spd;
+    if (turn == 1 && player.equipment().hasEffect("first_turn_priority")) {
+        playerFirst = true;
+    }
+    
+    if (playerFirst) {
+        // 玩家行动
+        if (pa.hp > 0) {
+            // 动态防御修正（阅读+50%防御）与钢勺护符克制
+            int enemy_def_for_calc = enemy.attr().def_;
+            if (reading_buff_turns > 0) enemy_def_for_calc = (int)(enemy_def_for_calc * 1.5);
+            double rf = rollRandomFactor();
+            double base_damage = player.attr().getEffectiveATK() * rf;
+            // 钢勺护符：对实验失败妖×1.3
+            for (const auto& eq : player.equipment().getEquippedItems()) {
+                double mul = equipmentDamageMultiplier(eq, enemy);
+                if (mul != 1.0) { base_damage *= mul; break; }
+            }
+            int dmg = std::max(1, (int)(base_damage * (1.0 - (double)enemy_def_for_calc / (enemy_def_for_calc + 120.0))));
+            // S3统计：攻击实验失败妖次数
+            if (game_state_ && enemy.name().find("实验失败妖") != std::string::npos) {
+                game_state_->failed_experiment_attack_count++;
+            }
+            bool guaranteed = player.attr().hasStatus(StatusEffect::FOCUS);
+            if (guaranteed || rollHit(pa.getEffectiveSPD(), ea.spd)) {
+                ea.hp -= dmg; 
+                L << "你命中，造成 " << dmg << " 伤害。\n";
+                if (guaranteed) {
+                    player.attr().removeStatus(StatusEffect::FOCUS);
                 }
-                bool guaranteed = player.attr().hasStatus(StatusEffect::FOCUS);
-                if (guaranteed || rollHit(pa.getEffectiveSPD(), ea.spd)) {
-                    ea.hp -= dmg; 
-                    L << "你命中，造成 " << dmg << " 伤害。\n";
-                    if (guaranteed) {
-                        player.attr().removeStatus(StatusEffect::FOCUS);
-                    }
-                    // 二手吉他：30%几率获得鼓舞2回合
-                    if (player.equipment().hasEffect("on_attack_inspiration")) {
-                        int chance = (int)(player.equipment().getEffectValue("on_attack_inspiration") * 100);
-                        if (rollPercent() <= chance) {
-                            player.attr().addStatus(StatusEffect::INSPIRATION, 2);
-                            L << "音乐激励了你，你获得了鼓舞！\n";
-                        }
+                // 二手吉他：30%几率获得鼓舞2回合
+                if (player.equipment().hasEffect("on_attack_inspiration")) {
+                    int chance = (int)(player.equipment().getEffectValue("on_attack_inspiration") * 100);
+                    if (rollPercent() <= chance) {
+                        player.attr().addStatus(StatusEffect::INSPIRATION, 2);
+                        L << "音乐激励了你，你获得了鼓舞！\n";
                     }
-                } else {
-                    L << "你的攻击落空了。\n";
                 }
+            } else {
+                L << "你的攻击落空了。\n";
+            }
+        }
+        
+        // 敌人行动
+        if (ea.hp > 0) {
+            int enemy_atk_for_calc = ea.atk;
+            double atkMul = (tier==0?0.9:(tier==2?1.1:1.0));
+            enemy_atk_for_calc = (int)std::round(enemy_atk_for_calc * atkMul);
+            if (enemy.name().find("答辩紧张魔") != std::string::npos && ea.hp * 2 < ea.max_hp) {
+                enemy_atk_for_calc = (int)(enemy_atk_for_calc * 1.3);
             }
-            
-            // 敌人行动
-            if (ea.hp > 0) {
-                int enemy_atk_for_calc = ea.atk;
-                double atkMul = (tier==0?0.9:(tier==2?1.1:1.0));
-                enemy_atk_for_calc = (int)std::round(enemy_atk_for_calc * atkMul);
-                if (enemy.name().find("答辩紧张魔") != std::string::npos && ea.hp * 2 < ea.max_hp) {
-                    enemy_atk_for_calc = (int)(enemy_atk_for_calc * 1.3);
+            int dmg = calculatePhysicalDamage(enemy_atk_for_calc, pa.getEffectiveDEF());
+            bool enemyHit = rollHit(ea.spd, pa.getEffectiveSPD());
+            if (enemyHit && player.equipment().hasEffect("extra_evasion")) {
+                if (rollPercent() <= (int)(player.equipment().getEffectValue("extra_evasion") * 100)) {
+                    enemyHit = false; // 额外闪避
                 }
-                int dmg = calculatePhysicalDamage(enemy_atk_for_calc, pa.getEffectiveDEF());
-                bool enemyHit = rollHit(ea.spd, pa.getEffectiveSPD());
-                if (enemyHit && player.equipment().hasEffect("extra_evasion")) {
-                    if (rollPercent() <= (int)(player.equipment().getEffectValue("extra_evasion") * 100)) {
-                        enemyHit = false; // 额外闪避
+            }
+            if (enemyHit) {
+                pa.hp -= dmg; 
+                L << enemy.name() << " 命中，造成 " << dmg << " 伤害。\n";
+                
+                // 检查怪物特殊技能
+                {
+                    int slowChance = (tier==0?30:(tier==2?70:50));
+                    if (enemy.hasSlowSkill() && rollPercent() <= slowChance) {
+                        player.attr().addStatus(StatusEffect::SLOW, 2);
+                        L << "【迟缓攻击】你被施加了迟缓状态！\n";
                     }
                 }
-                if (enemyHit) {
-                    pa.hp -= dmg; 
-                    L << enemy.name() << " 命中，造成 " << dmg << " 伤害。\n";
-                    
-                    // 检查怪物特殊技能
-                    {
-                        int slowChance = (tier==0?30:(tier==2?70:50));
-                        if (enemy.hasSlowSkill() && rollPercent() <= slowChance) {
-                            player.attr().addStatus(StatusEffect::SLOW, 2);
-                            L << "【迟缓攻击】你被施加了迟缓状态！\n";
-                        }
-                    }
-                    // 答辩紧张魔：每回合60%施加紧张
-                    if (enemy.name().find("答辩紧张魔") != std::string::npos) {
-                        int tensionChance = (tier==2?70:60);
-                        if (rollPercent() <= tensionChance) {
-                            player.attr().addStatus(StatusEffect::TENSION, 3);
-                            L << "【紧张施压】你被施加了紧张状态！\n";
-                        }
-                    } else if (enemy.hasTensionSkill()) {
-                        int tChance = (tier==0?20:(tier==2?60:40));
-                        if (rollPercent() <= tChance) {
-                            player.attr().addStatus(StatusEffect::TENSION, 3);
-                            L << "【紧张施压】你被施加了紧张状态！\n";
-                        }
+                // 答辩紧张魔：每回合60%施加紧张
+                if (enemy.name().find("答辩紧张魔") != std::string::npos) {
+                    int tensionChance = (tier==2?70:60);
+                    if (rollPercent() <= tensionChance) {
+                        player.attr().addStatus(StatusEffect::TENSION, 3);
+                        L << "【紧张施压】你被施加了紧张状态！\n";
                     }
-                // 小怪群追加攻击
-                if (is_failed_revive && summoned_minions > 0 && pa.hp > 0) {
-                    int total = 0;
-                    for (int i=0;i<summoned_minions;i++) {
-                        int minionAtk = (tier==0?18:(tier==2?22:20));
-                        int md = calculatePhysicalDamage(minionAtk, pa.getEffectiveDEF());
-                        // 钢勺护符降低小怪伤害
-                        for (const auto& eq : player.equipment().getEquippedItems()) {
-                            if (eq.id == "steel_spoon") { md = (int)(md * 0.7); break; }
-                        }
-                        total += md;
+                } else if (enemy.hasTensionSkill()) {
+                    int tChance = (tier==0?20:(tier==2?60:40));
+                    if (rollPercent() <= tChance) {
+                        player.attr().addStatus(StatusEffect::TENSION, 3);
+                        L << "【紧张施压】你被施加了紧张状态！\n";
                     }
-                    if (total>0) {
-                        pa.hp -= total;
-                        L << "【小怪群】失败实验体群造成追加伤害 " << total << "。\n";
+                }
+            // 小怪群追加攻击
+            if (is_failed_revive && summoned_minions > 0 && pa.hp > 0) {
+                int total = 0;
+                for (int i=0;i<summoned_minions;i++) {
+                    int minionAtk = (tier==0?18:(tier==2?22:20));
+                    int md = calculatePhysicalDamage(minionAtk, pa.getEffectiveDEF());
+                    // 钢勺护符降低小怪伤害
+                    for (const auto& eq : player.equipment().getEquippedItems()) {
+                        if (eq.id == "steel_spoon") { md = (int)(md * 0.7); break; }
                     }
+                    total += md;
                 }
-                } else {
-                    L << enemy.name() << " 攻击落空了。\n";
+                if (total>0) {
+                    pa.hp -= total;
+                    L << "【小怪群】失败实验体群造成追加伤害 " << total << "。\n";
                 }
             }
-        } else {
-            // 敌人先行动
-            if (ea.hp > 0) {
-                int enemy_atk_for_calc = ea.atk;
-                double atkMul = (tier==0?0.9:(tier==2?1.1:1.0));
-                enemy_atk_for_calc = (int)std::round(enemy_atk_for_calc * atkMul);
-                int dmg = calculatePhysicalDamage(enemy_atk_for_calc, pa.getEffectiveDEF());
-                bool enemyHit = rollHit(ea.spd, pa.getEffectiveSPD());
-                if (enemyHit && player.equipment().hasEffect("extra_evasion")) {
-                    if (rollPercent() <= (int)(player.equipment().getEffectValue("extra_evasion") * 100)) {
-                        enemyHit = false;
-                    }
+            } else {
+                L << enemy.name() << " 攻击落空了。\n";
+            }
+        }
+    } else {
+        // 敌人先行动
+        if (ea.hp > 0) {
+            int enemy_atk_for_calc = ea.atk;
+            double atkMul = (tier==0?0.9:(tier==2?1.1:1.0));
+            enemy_atk_for_calc = (int)std::round(enemy_atk_for_calc * atkMul);
+            int dmg = calculatePhysicalDamage(enemy_atk_for_calc, pa.getEffectiveDEF());
+            bool enemyHit = rollHit(ea.spd, pa.getEffectiveSPD());
+            if (enemyHit && player.equipment().hasEffect("extra_evasion")) {
+                if (rollPercent() <= (int)(player.equipment().getEffectValue("extra_evasion") * 100)) {
+                    enemyHit = false;
                 }
-                if (enemyHit) {
-                    pa.hp -= dmg; 
-                    L << enemy.name() << " 命中，造成 " << dmg << " 伤害。\n";
-                    
-                    // 检查怪物特殊技能
-                    {
-                        int slowChance = (tier==0?30:(tier==2?70:50));
-                        if (enemy.hasSlowSkill() && rollPercent() <= slowChance) {
-                            player.attr().addStatus(StatusEffect::SLOW, 2);
-                            L << "【迟缓攻击】你被施加了迟缓状态！\n";
-                        }
+            }
+            if (enemyHit) {
+                pa.hp -= dmg; 
+                L << enemy.name() << " 命中，造成 " << dmg << " 伤害。\n";
+                
+                // 检查怪物特殊技能
+                {
+                    int slowChance = (tier==0?30:(tier==2?70:50));
+                    if (enemy.hasSlowSkill() && rollPercent() <= slowChance) {
+                        player.attr().addStatus(StatusEffect::SLOW, 2);
+                        L << "【迟缓攻击】你被施加了迟缓状态！\n";
                     }
-                    if (enemy.hasTensionSkill()) {
-                        int tChance = (tier==0?20:(tier==2?60:40));
-                        if (rollPercent() <= tChance) {
-                            player.attr().addStatus(StatusEffect::TENSION, 3);
-                            L << "【紧张施压】你被施加了紧张状态！\n";
-                        }
+                }
+                if (enemy.hasTensionSkill()) {
+                    int tChance = (tier==0?20:(tier==2?60:40));
+                    if (rollPercent() <= tChance) {
+                        player.attr().addStatus(StatusEffect::TENSION, 3);
+                        L << "【紧张施压】你被施加了紧张状态！\n";
                     }
-                } else {
-                    L << enemy.name() << " 攻击落空了。\n";
                 }
+            } else {
+                L << enemy.name() << " 攻击落空了。\n";
             }
-            
-            // 玩家行动
-            if (pa.hp > 0) {
-                int enemy_def_for_calc2 = enemy.attr().def_;
-                if (reading_buff_turns > 0) enemy_def_for_calc2 = (int)(enemy_def_for_calc2 * 1.5);
-                double rf2 = rollRandomFactor();
-                double base_damage2 = player.attr().getEffectiveATK() * rf2;
-                if (enemy.name().find("实验失败妖") != std::string::npos) {
-                    for (const auto& eq : player.equipment().getEquippedItems()) {
-                        if (eq.id == "steel_spoon") { base_damage2 *= 1.3; break; }
-                    }
+        }
+        
+        // 玩家行动
+        if (pa.hp > 0) {
+            int enemy_def_for_calc2 = enemy.attr().def_;
+            if (reading_buff_turns > 0) enemy_def_for_calc2 = (int)(enemy_def_for_calc2 * 1.5);
+            double rf2 = rollRandomFactor();
+            double base_damage2 = player.attr().getEffectiveATK() * rf2;
+            for (const auto& eq : player.equipment().getEquippedItems()) {
+                double mul = equipmentDamageMultiplier(eq, enemy);
+                if (mul != 1.0) { base_damage2 *= mul; break; }
+            }
+            int dmg = std::max(1, (int)(base_damage2 * (1.0 - (double)enemy_def_for_calc2 / (enemy_def_for_calc2 + 120.0))));
+            bool guaranteed = player.attr().hasStatus(StatusEffect::FOCUS);
+            if (guaranteed || rollHit(pa.getEffectiveSPD(), ea.spd)) {
+                ea.hp -= dmg; 
+                L << "你命中，造成 " << dmg << " 伤害。\n";
+                if (guaranteed) {
+                    player.attr().removeStatus(StatusEffect::FOCUS);
                 }
-                int dmg = std::max(1, (int)(base_damage2 * (1.0 - (double)enemy_def_for_calc2 / (enemy_def_for_calc2 + 120.0))));
-                bool guaranteed = player.attr().hasStatus(StatusEffect::FOCUS);
-                if (guaranteed || rollHit(pa.getEffectiveSPD(), ea.spd)) {
-                    ea.hp -= dmg; 
-                    L << "你命中，造成 " << dmg << " 伤害。\n";
-                    if (guaranteed) {
-                        player.attr().removeStatus(StatusEffect::FOCUS);
+                if (player.equipment().hasEffect("on_attack_inspiration")) {
+                    int chance = (int)(player.equipment().getEffectValue("on_attack_inspiration") * 100);
+                    if (rollPercent() <= chance) {
+                        player.attr().addStatus(StatusEffect::INSPIRATION, 2);
+                        L << "音乐激励了你，你获得了鼓舞！\n";
                     }
-                    if (player.equipment().hasEffect("on_attack_inspiration")) {
-                        int chance = (int)(player.equipment().getEffectValue("on_attack_inspiration") * 100);
-                        if (rollPercent() <= chance) {
-                            player.attr().addStatus(StatusEffect::INSPIRATION, 2);
-                            L << "音乐激励了你，你获得了鼓舞！\n";
-                        }
-                    }
-                } else {
-                    L << "你的攻击落空了。\n";
                 }
+            } else {
+                L << "你的攻击落空了。\n";
             }
         }
-        if (reading_buff_turns > 0) reading_buff_turns -= 1;
     }
-    
-    if (pa.hp <= 0) { 
+    if (reading_buff_turns > 0) reading_buff_turns -= 1;
+}
+
+// 战斗结束结算
+void CombatSystem::finishEncounter(CombatEncounter& c) {
+    std::ostringstream& L = c.log;
+    const Enemy& enemy = c.enemy;
+    c.finished = true;
+    if (c.player->attr().hp <= 0) { 
         L << "\n你被击败了……\n"; 
         if (game_state_ && game_state_->current_loc == std::string("wenxintan")) {
             game_state_->wenxintan_fail_streak++;
@@ -303,8 +369,8 @@ bool CombatSystem::fight(Player& player, Enemy& enemy, std::string& log) {
                 L << "秘境的波光渐冷。它在期待你以更完善的准备归来。\n";
             }
         }
-        log = L.str(); 
-        return false; 
+        c.won = false;
+        return; 
     }
     
     L << "\n你击败了 " << enemy.name() << "！\n";
@@ -313,8 +379,7 @@ bool CombatSystem::fight(Player& player, Enemy& enemy, std::string& log) {
     if (game_state_ && enemy.name().find("实验失败妖") != std::string::npos) {
         game_state_->failed_experiment_kill_count++;
     }
-    log = L.str(); 
-    return true;
+    c.won = true;
 }
 
 // 处理玩家行动
@@ -413,6 +478,12 @@ int CombatSystem::calculateSkillDamage(const Skill& skill, const Player& player,
     return std::max(1, (int)mitigation);
 }
 
+// 装备对敌人的伤害倍率
+double CombatSystem::equipmentDamageMultiplier(const Item& item, const Enemy& enemy) {
+    if (item.id == "steel_spoon" && enemy.name().find("实验失败妖") != std::string::npos) return 1.3;
+    return 1.0;
+}
+
 // 逃跑判定
 bool CombatSystem::attemptFlee(const Player& player, const Enemy& enemy) {
     int player_spd = player.attr().getEffectiveSPD();
@@ -422,7 +493,7 @@ bool CombatSystem::attemptFlee(const Player& player, const Enemy& enemy) {
 }
 
 // 更新战斗状态
-int CombatSystem::updateCombatStatuses(Player& player, Enemy& enemy) {
+int CombatSystem::updateCombatStatuses(Player& player, Enemy& enemy, int turn) {
     // 回合开始状态维护
     int heal_amount = 0;
     // 每回合回复（被子）
@@ -433,10 +504,8 @@ int CombatSystem::updateCombatStatuses(Player& player, Enemy& enemy) {
         player.attr().hp = std::min(player.attr().max_hp, player.attr().hp + heal);
         heal_amount = player.attr().hp - old_hp;
     }
-    // 周期护盾（灵能护甲）：每3回合赋予1回合护盾
-    static int turnCounter = 0;
-    turnCounter++;
-    if (player.equipment().hasEffect("periodic_shield") && turnCounter % 3 == 0) {
+    // 周期护盾（灵能护甲）：本场战斗每3回合赋予1回合护盾
+    if (player.equipment().hasEffect("periodic_shield") && turn % 3 == 0) {
         player.attr().addStatus(StatusEffect::SHIELD, 1);
     }
     return heal_amount;
@@ -0,0 +1,145 @@
+// 这是战前胜率预估的实现文件
+// 作者：大一学生
+// 功能：计算缓存键、把模拟分组交给共用线程池并行跑、汇总结果并放进进程共用的缓存
+
+#include "CombatForecast.hpp"  // 战前胜率预估头文件
+#include "Combat.hpp"          // 战斗系统（模拟战斗）
+#include "StateHash.hpp"       // 计算缓存键
+#include "Trace.hpp"           // 时间线跟踪
+#include "WorkerPool.hpp"      // 共用的辅助线程池
+#include <algorithm>           // sort/min
+#include <atomic>              // 分组领取计数
+#include <mutex>               // 缓存的锁
+#include <unordered_map>       // 缓存
+#include <utility>             // pair
+#include <vector>              // 向量容器
+
+namespace hx {
+
+namespace {
+
+constexpr int kTrials = 2000;          // 每次预估模拟的场数
+constexpr int kGroups = 16;            // 分成的组数（每组一个固定的随机种子）
+constexpr size_t kMaxEntries = 4096;   // 缓存上限，满了整个清空重来
+constexpr int kHpBuckets = 20;         // 生命值按最大生命的 1/20 分档
+
+struct Cache {
+    std::mutex mutex;
+    std::unordered_map<std::uint64_t, CombatForecast> entries;
+    std::uint64_t hits{0};
+    std::uint64_t misses{0};
+};
+
+Cache& cache() {
+    static Cache* instance = new Cache(); // 故意不释放：会话线程可能在静态对象析构之后才结束
+    return *instance;
+}
+
+// 模拟用的开场生命：向上取到所在档的上沿（满血仍是满血）。
+// 打完一仗掉了几点血时还落在同一档，战斗菜单不必重新模拟
+int forecastHp(const Attributes& a) {
+    if (a.max_hp <= 0 || a.hp <= 0) return a.hp;
+    long long hp = std::min(a.hp, a.max_hp);
+    long long bucket = (hp * kHpBuckets + a.max_hp - 1) / a.max_hp;
+    return static_cast<int>(a.max_hp * bucket / kHpBuckets);
+}
+
+// 缓存键：决定战斗结果的全部输入。生命值按档计（见 forecastHp），
+// 装备按ID排序（装备表是哈希表，遍历顺序不固定），
+// 状态效果按类型排序；玩家的等级、背包等与战斗无关的部分不计入
+std::uint64_t forecastKey(const Player& player, const Enemy& enemy, int tier) {
+    StateHasher h(0x666f726563617374ull);
+    const Attributes& pa = player.attr();
+    h.add(forecastHp(pa)); h.add(pa.max_hp); h.add(pa.atk); h.add(pa.def_); h.add(pa.spd);
+    std::vector<std::pair<int, int>> statuses;
+    for (const auto& kv : pa.active_statuses) statuses.emplace_back(static_cast<int>(kv.first), kv.second.duration);
+    std::sort(statuses.begin(), statuses.end());
+    h.add(static_cast<int>(statuses.size()));
+    for (const auto& s : statuses) { h.add(s.first); h.add(s.second); }
+    std::vector<std::string> equipped;
+    for (const Item& item : player.equipment().getEquippedItems()) equipped.push_back(item.id);
+    std::sort(equipped.begin(), equipped.end());
+    h.add(static_cast<int>(equipped.size()));
+    for (const std::string& id : equipped) h.add(id);
+
+    const Attributes& ea = enemy.attr();
+    h.add(enemy.name());
+    h.add(ea.hp); h.add(ea.max_hp); h.add(ea.atk); h.add(ea.def_); h.add(ea.spd);
+    h.add(enemy.hasSlowSkill()); h.add(enemy.hasTensionSkill());
+    h.add(tier);
+    return h.digest();
+}
+
+// 跑完全部分组：线程轮流领取下一个组号，每组用自己的战斗系统和玩家副本
+CombatForecast simulateAll(const Player& player, const Enemy& enemy, int tier, std::uint64_t key) {
+    struct GroupResult { int wins{0}; long long turns{0}; };
+    std::vector<GroupResult> groups(kGroups);
+    std::atomic<int> next{0};
+    auto work = [&]() {
+        CombatSystem combat;
+        // 战斗只用到属性、等级和装备，背包等部分不必复制
+        Player sim(player.name());
+        sim.setLevel(player.level());
+        sim.equipment() = player.equipment();
+        Attributes start = player.attr();
+        start.hp = forecastHp(start);
+        for (int g = next.fetch_add(1); g < kGroups; g = next.fetch_add(1)) {
+            combat.seed(static_cast<unsigned>(key ^ (key >> 32)) + static_cast<unsigned>(g) * 0x9e3779b9u);
+            int begin = kTrials * g / kGroups, end = kTrials * (g + 1) / kGroups;
+            GroupResult& r = groups[static_cast<size_t>(g)];
+            for (int i = begin; i < end; ++i) {
+                sim.attr() = start;
+                int turns = 0;
+                if (combat.simulate(sim, enemy, tier, turns)) ++r.wins;
+                r.turns += turns;
+            }
+        }
+    };
+
+    // 调用线程自己也干活；池里忙时少几个帮手，结果不变
+    runShared(kGroups - 1, work);
+
+    int wins = 0;
+    long long turns = 0;
+    for (const GroupResult& r : groups) { wins += r.wins; turns += r.turns; }
+    CombatForecast f;
+    f.trials = kTrials;
+    f.win_rate = static_cast<double>(wins) / kTrials;
+    f.expected_turns = static_cast<double>(turns) / kTrials;
+    return f;
+}
+
+} // namespace
+
+CombatForecast forecastCombat(const Player& player, const Enemy& enemy, int tier) {
+    HX_TRACE_SPAN("forecast");
+    std::uint64_t key = forecastKey(player, enemy, tier);
+    Cache& c = cache();
+    {
+        std::lock_guard<std::mutex> lock(c.mutex);
+        auto it = c.entries.find(key);
+        if (it != c.entries.end()) {
+            ++c.hits;
+            return it->second;
+        }
+        ++c.misses;
+    }
+    // 模拟期间不持有锁：别的会话同时算同一个键时各算各的，结果相同，后放进去的覆盖先放的
+    CombatForecast f = simulateAll(player, enemy, tier, key);
+    std::lock_guard<std::mutex> lock(c.mutex);
+    if (c.entries.size() >= kMaxEntries) c.entries.clear();
+    c.entries[key] = f;
+    return f;
+}
+
+ForecastCacheStats forecastCacheStats() {
+    Cache& c = cache();
+    std::lock_guard<std::mutex> lock(c.mutex);
+    ForecastCacheStats s;
+    s.hits = c.hits;
+    s.misses = c.misses;
+    s.entries = c.entries.size();
+    return s;
+}
+
+} // namespace hx
@@ -1,12 +1,107 @@
 // 这是命令系统的实现文件
 // 作者：大一学生
-// 功能：实现游戏的命令路由系统，处理玩家的输入命令
+// 功能：实现输入行的规范化与切分、编号参数的解析，以及游戏的命令路由系统
 
 #include "Command.hpp"  // 命令系统头文件
-#include <sstream>       // 字符串流
-#include <cctype>        // 字符类型判断
+#include "MemoryUsage.hpp" // 内存统计工具
 
 namespace hx {
+
+namespace {
+bool isSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '\v' || c == '\f';
+}
+
+// 全角空格 U+3000 的UTF-8编码
+bool isWideSpace(std::string_view s, size_t i) {
+    return i + 2 < s.size() && s[i] == '\xE3' && s[i + 1] == '\x80' && s[i + 2] == '\x80';
+}
+
+// 全角数字 U+FF10~U+FF19 的UTF-8编码是 EF BC 90~99；是的话写出对应的半角数字
+bool wideDigit(std::string_view s, size_t i, char& digit) {
+    if (i + 2 >= s.size() || s[i] != '\xEF' || s[i + 1] != '\xBC') return false;
+    unsigned char c = static_cast<unsigned char>(s[i + 2]);
+    if (c < 0x90 || c > 0x99) return false;
+    digit = static_cast<char>('0' + (c - 0x90));
+    return true;
+}
+} // namespace
+
+// 规范化并切分一行输入
+void CommandLine::parse(std::string_view raw) {
+    buf_.clear();
+    count_ = 0;
+    bool pending_space = false;
+    size_t i = 0;
+    while (i < raw.size()) {
+        char digit;
+        if (isSpace(raw[i])) {
+            pending_space = true;
+            ++i;
+            continue;
+        }
+        if (isWideSpace(raw, i)) {
+            pending_space = true;
+            i += 3;
+            continue;
+        }
+        if (pending_space && !buf_.empty()) buf_.push_back(' ');
+        pending_space = false;
+        if (wideDigit(raw, i, digit)) {
+            buf_.push_back(digit);
+            i += 3;
+        } else {
+            buf_.push_back(raw[i]);
+            ++i;
+        }
+    }
+
+    // 指令词不区分英文大小写
+    for (char& c : buf_) {
+        if (c == ' ') break;
+        if (c >= 'A' && c <= 'Z') c = static_cast<char>(c - 'A' + 'a');
+    }
+
+    // 按空格切词；到达上限后剩下的内容都算最后一个词
+    std::string_view text(buf_);
+    size_t start = 0;
+    while (start < text.size()) {
+        size_t end = text.find(' ', start);
+        if (end == std::string_view::npos || count_ + 1 == kMaxWords) end = text.size();
+        words_[count_++] = text.substr(start, end - start);
+        start = end + 1;
+    }
+}
+
+// 从第 i 个词到行尾的内容
+std::string_view CommandLine::rest(size_t i) const {
+    if (i >= count_) return {};
+    std::string_view text(buf_);
+    return text.substr(static_cast<size_t>(words_[i].data() - buf_.data()));
+}
+
+// 解析编号参数
+bool parseIndex(std::string_view s, int& out) {
+    if (s.empty()) return false;
+    int value = 0;
+    size_t digits = 0;
+    size_t i = 0;
+    while (i < s.size()) {
+        char digit = s[i];
+        if (digit >= '0' && digit <= '9') {
+            ++i;
+        } else if (wideDigit(s, i, digit)) {
+            i += 3;
+        } else {
+            return false;
+        }
+        if (++digits > 9) return false;  // 编号不会这么大，也避免溢出
+        value = value * 10 + (digit - '0');
+    }
+    out = value;
+    return true;
+}
+
 // 添加命令处理器
 // 参数：name(命令名称), h(处理函数)
 // 功能：将命令名称和处理函数绑定
@@ -14,18 +109,26 @@ void CommandRouter::add(const std::string& name, Handler h) {
     handlers_[name] = std::move(h);  // 将处理函数存储到映射中
 }
 
-static std::string toLower(std::string s){ for(auto& c:s) c = static_cast<char>(std::tolower(static_cast<unsigned char>(c))); return s; }
-
 bool CommandRouter::route(Game& g, const std::string& line) {
-    auto words = splitWords(line);
-    if (words.empty()) return false;
-    auto it = handlers_.find(toLower(words[0]));
+    line_.parse(line);
+    if (line_.empty()) return false;
+    auto it = handlers_.find(std::string(line_.verb()));
     if (it == handlers_.end()) return false;
-    it->second(g, words);
+    it->second(g, line_);
     return true;
 }
 
 std::vector<std::string> splitWords(const std::string& line) {
-    std::istringstream iss(line); std::vector<std::string> out; std::string w; while(iss>>w) out.push_back(w); return out;
+    CommandLine cmd;
+    cmd.parse(line);
+    std::vector<std::string> out;
+    out.reserve(cmd.size());
+    for (size_t i = 0; i < cmd.size(); ++i) out.emplace_back(cmd.word(i));
+    return out;
+}
+
+size_t CommandRouter::heapBytes() const {
+    return memory::tableBytes(handlers_, [](const auto& kv) { return memory::bytes(kv.first); })
+         + memory::bytes(line_.text());
 }
 } // namespace hx
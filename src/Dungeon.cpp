@@ -0,0 +1,305 @@
+// 这是秘境（无尽地下城）的实现文件
+// 作者：大一学生
+// 功能：秘境各层的确定性生成、常驻层的LRU淘汰和改动记录
+
+#include "Dungeon.hpp"      // 秘境头文件
+#include "Map.hpp"          // 地图类
+#include "MemoryUsage.hpp"  // 内存统计工具（估算一层的大小）
+#include <algorithm>        // find/max/min
+#include <random>           // mt19937/seed_seq
+
+namespace hx {
+
+namespace {
+
+// 房间的名称和描述（入口和阶梯另有固定的名字）
+struct RoomTheme {
+    const char* name;
+    const char* desc;
+};
+const RoomTheme kRoomThemes[] = {
+    {"幽暗书廊", "两侧的书架一直延伸到黑暗里，书脊上的字迹在你走近时才慢慢浮现。"},
+    {"回声长廊", "每走一步都有好几声回响，分不清哪一声才是自己的脚步。"},
+    {"遗忘自习室", "桌上摊着写了一半的笔记，台灯还亮着，座位却都空着。"},
+    {"尘封档案室", "铁皮柜里塞满了泛黄的卷宗，空气里全是纸张和灰尘的味道。"},
+    {"镜面阅览室", "四壁都是镜子，镜中的你比你慢了半拍。"},
+    {"低语实验室", "试管架上的液体轻轻冒泡，像是在小声讨论什么。"},
+    {"倒影天井", "抬头是潭水一样的天空，水面上倒映着你来时的路。"},
+    {"断电机房", "机柜的指示灯一闪一灭，风扇的声音时有时无。"},
+    {"无尽楼梯间", "楼梯向上也向下，转过几个弯之后又回到了原处。"},
+    {"沉默讲堂", "阶梯教室里坐满了模糊的人影，讲台上却没有人。"},
+    {"考场残影", "整齐的课桌上压着试卷，钟声似乎随时会响起。"},
+    {"星图穹顶", "穹顶上画着陌生的星图，星星的位置每次抬头都不一样。"},
+};
+constexpr size_t kThemeCount = sizeof(kRoomThemes) / sizeof(kRoomThemes[0]);
+
+// 四个方向：出口标签、反方向的标签、坐标变化（x向东增大，y向南增大）
+struct Direction {
+    const char* label;
+    const char* back;
+    int dx, dy;
+};
+const Direction kDirections[] = {
+    {"北", "南", 0, -1}, {"南", "北", 0, 1}, {"西", "东", -1, 0}, {"东", "西", 1, 0},
+};
+
+constexpr int kMinPrototypeLevel = 6;  // 原型表只收这个等级以上的普通怪物
+constexpr int kBaseLevel = 9;          // 第 n 层怪物的等级是 kBaseLevel+n（文心潭要求Lv9）
+
+// 随机数只用 mt19937 的原始输出取模：标准库的分布和 shuffle 在不同实现上结果可能不同，
+// 这样同一个种子在任何平台上都生成同样的一层
+size_t pick(std::mt19937& rng, size_t n) { return static_cast<size_t>(rng() % n); }
+
+// 估算一层放进地图后占的内存：地点表的节点加上地点里的字符串、出口、怪物
+size_t floorBytes(const std::vector<Location>& rooms) {
+    size_t n = 0;
+    for (const Location& loc : rooms) {
+        n += sizeof(void*) + sizeof(std::pair<const std::string, Location>) + sizeof(size_t)
+           + 2 * memory::bytes(loc.id) + memory::bytes(loc.name) + memory::bytes(loc.desc)
+           + memory::bytes(loc.exits, [](const Exit& e) { return memory::bytes(e.label) + memory::bytes(e.to); })
+           + memory::bytes(loc.enemies, [](const Enemy& e) {
+                 return memory::bytes(e.name()) + memory::bytes(e.getSpecialSkill())
+                      + memory::bytes(e.getSpecialSkillDescription())
+                      + memory::bytes(e.getDropItems(), [](const Enemy::DropItem& d) {
+                            return memory::bytes(d.item_id) + memory::bytes(d.item_name);
+                        });
+             });
+    }
+    return n;
+}
+
+} // namespace
+
+// 收集怪物原型
+// 功能：同名的怪物只收一次，按等级和名称排序（地点表是哈希表，遍历顺序不固定）
+void Dungeon::setCatalog(const Map& map) {
+    catalog_.clear();
+    for (const auto& kv : map.locations()) {
+        if (kv.first == kGateId || floorOf(kv.first) > 0) continue;
+        for (const Enemy& en : kv.second.enemies) {
+            if (en.getLevel() < kMinPrototypeLevel) continue;
+            bool seen = std::any_of(catalog_.begin(), catalog_.end(),
+                                    [&en](const Enemy& e) { return e.name() == en.name(); });
+            if (!seen) catalog_.push_back(en);
+        }
+    }
+    std::sort(catalog_.begin(), catalog_.end(), [](const Enemy& a, const Enemy& b) {
+        return a.getLevel() != b.getLevel() ? a.getLevel() < b.getLevel() : a.name() < b.name();
+    });
+}
+
+void Dungeon::attach(Map& map) const {
+    Location* gate = map.get(kGateId);
+    if (!gate || gate->findExitByLabel(kDownLabel)) return;
+    gate->exits.push_back({kDownLabel, entranceId(1)});
+    map.invalidateIndexes();
+}
+
+std::string Dungeon::entranceId(int floor) { return "mj" + std::to_string(floor) + "_0"; }
+std::string Dungeon::stairsId(int floor) { return "mj" + std::to_string(floor) + "_down"; }
+
+int Dungeon::floorOf(const std::string& location_id) {
+    if (location_id.size() < 4 || location_id[0] != 'm' || location_id[1] != 'j') return 0;
+    int floor = 0;
+    size_t i = 2;
+    for (; i < location_id.size() && location_id[i] >= '0' && location_id[i] <= '9'; ++i) {
+        floor = floor * 10 + (location_id[i] - '0');
+        if (floor > kMaxFloor) return 0;
+    }
+    return i > 2 && i < location_id.size() && location_id[i] == '_' ? floor : 0;
+}
+
+// 按层数加强原型
+// 功能：第 n 层的怪物等级为 kBaseLevel+n，生命、攻击、防御和奖励按“目标等级/原型等级”放大，
+//       各怪物原来的强弱搭配（高防、高攻、群体）保留；守着阶梯的怪物再强一些，多掉一瓶咖啡因灵液
+Enemy Dungeon::makeMonster(const Enemy& prototype, int floor, bool guardian) const {
+    const int level = kBaseLevel + floor;
+    const double scale = static_cast<double>(level) / std::max(1, prototype.getLevel()) * (guardian ? 1.25 : 1.0);
+    Attributes attr = prototype.attr();
+    attr.max_hp = static_cast<int>(attr.max_hp * scale);
+    attr.hp = attr.max_hp;
+    attr.atk = static_cast<int>(attr.atk * scale);
+    attr.def_ = static_cast<int>(attr.def_ * scale);
+    Enemy monster(prototype.name(), attr, static_cast<int>(prototype.coinReward() * scale),
+                  static_cast<int>(prototype.xpReward() * scale));
+    monster.setLevel(level);
+    if (prototype.hasSpecialSkill()) {
+        monster.setSpecialSkill(prototype.getSpecialSkill(), prototype.getSpecialSkillDescription());
+    }
+    monster.setHasSlowSkill(prototype.hasSlowSkill());
+    monster.setHasTensionSkill(prototype.hasTensionSkill());
+    monster.setHasExplosionMechanic(prototype.hasExplosionMechanic());
+    monster.setIsGroupEnemy(prototype.isGroupEnemy(), prototype.getGroupCount());
+    // 掉落：越深药水越多（原型的任务物品不带进秘境）
+    monster.addDropItem("health_potion", "生命药水", 1, 1 + floor / 10,
+                        std::min(0.5f, 0.15f + 0.01f * static_cast<float>(floor)));
+    if (guardian) monster.addDropItem("caffeine_elixir", "咖啡因灵液", 1, 1, 0.5f);
+    return monster;
+}
+
+// 生成一层
+// 功能：入口放在(0,0)，之后每个房间接在一个已有房间的空邻格上，出口连成一棵树；
+//       离入口最远的房间是下楼的阶梯，由一只加强的怪物守着，其余房间六成有怪物
+std::vector<Location> Dungeon::generate(int floor) const {
+    std::seed_seq seq{seed_, static_cast<std::uint32_t>(floor)};
+    std::mt19937 rng(seq);
+    const size_t count = 6 + static_cast<size_t>(std::min(floor, 12) / 3) + pick(rng, 3);
+
+    // 布局：parent[i] 是房间 i 接在哪个房间上，dir[i] 是从 parent 过去的方向
+    std::vector<Coord> coords{{0, 0}};
+    std::vector<size_t> parent(count, 0), dir(count, 0), depth(count, 0);
+    auto occupied = [&coords](Coord c) {
+        return std::any_of(coords.begin(), coords.end(), [c](Coord o) { return o.x == c.x && o.y == c.y; });
+    };
+    for (size_t i = 1; i < count; ++i) {
+        for (;;) {
+            size_t p = pick(rng, i), d = pick(rng, 4);
+            Coord c{coords[p].x + kDirections[d].dx, coords[p].y + kDirections[d].dy};
+            if (occupied(c)) continue;
+            coords.push_back(c);
+            parent[i] = p;
+            dir[i] = d;
+            depth[i] = depth[p] + 1;
+            break;
+        }
+    }
+    const size_t stairs = static_cast<size_t>(std::max_element(depth.begin(), depth.end()) - depth.begin());
+
+    // 房间名不重复：把名称表洗一遍依次取用
+    size_t themes[kThemeCount];
+    for (size_t i = 0; i < kThemeCount; ++i) themes[i] = i;
+    for (size_t i = kThemeCount - 1; i > 0; --i) std::swap(themes[i], themes[pick(rng, i + 1)]);
+
+    int min_x = 0, min_y = 0;
+    for (Coord c : coords) { min_x = std::min(min_x, c.x); min_y = std::min(min_y, c.y); }
+    const std::string where = "（秘境第" + std::to_string(floor) + "层）";
+    std::vector<Location> rooms(count);
+    for (size_t i = 0, theme = 0; i < count; ++i) {
+        Location& room = rooms[i];
+        room.layer = kLayerBase + floor;
+        room.coord = {coords[i].x - min_x, coords[i].y - min_y};
+        if (i == 0) {
+            room.id = entranceId(floor);
+            room.name = "秘境入口";
+            room.desc = "石阶尽头的一小块平地，头顶传来上一层隐约的水声。" + where;
+        } else if (i == stairs) {
+            room.id = stairsId(floor);
+            room.name = "下行阶梯";
+            room.desc = "一道盘旋向下的石阶，越往下越暗，守在这里的心魔格外强大。" + where;
+        } else {
+            const RoomTheme& t = kRoomThemes[themes[theme++ % kThemeCount]];
+            room.id = "mj" + std::to_string(floor) + "_" + std::to_string(i);
+            room.name = t.name;
+            room.desc = t.desc + where;
+        }
+    }
+    for (size_t i = 1; i < count; ++i) {
+        const Direction& d = kDirections[dir[i]];
+        rooms[parent[i]].exits.push_back({d.label, rooms[i].id});
+        rooms[i].exits.push_back({d.back, rooms[parent[i]].id});
+    }
+    rooms[0].exits.push_back({kUpLabel, floor == 1 ? std::string(kGateId) : stairsId(floor - 1)});
+    if (floor < kMaxFloor) rooms[stairs].exits.push_back({kDownLabel, entranceId(floor + 1)});
+
+    // 怪物：按房间顺序从原型表里抽
+    if (!catalog_.empty()) {
+        for (size_t i = 1; i < count; ++i) {
+            bool guardian = i == stairs;
+            if (!guardian && pick(rng, 100) >= 60) continue;
+            rooms[i].enemies.push_back(makeMonster(catalog_[pick(rng, catalog_.size())], floor, guardian));
+        }
+    }
+    return rooms;
+}
+
+// 进入一层
+// 功能：常驻的层移到LRU最前面；不常驻的重新生成并套用改动记录。之后超过层数或内存上限时，
+//       从最久没用的一端开始淘汰
+void Dungeon::enter(Map& map, int floor, int keep) {
+    if (floor < 1 || floor > kMaxFloor) return;
+    auto it = std::find_if(resident_.begin(), resident_.end(), [floor](const Floor& f) { return f.number == floor; });
+    if (it != resident_.end()) {
+        resident_.splice(resident_.begin(), resident_, it);
+    } else {
+        std::vector<Location> rooms = generate(floor);
+        auto changes = cleared_.find(floor);
+        if (changes != cleared_.end()) {
+            for (int room : changes->second) {
+                if (room >= 0 && static_cast<size_t>(room) < rooms.size()) rooms[static_cast<size_t>(room)].enemies.clear();
+            }
+        }
+        Floor f{floor, {}, floorBytes(rooms)};
+        f.rooms.reserve(rooms.size());
+        for (const Location& room : rooms) {
+            f.rooms.push_back(room.id);
+            map.addLocation(room);
+        }
+        map.setLayerTitle(kLayerBase + floor, "秘境第" + std::to_string(floor) + "层");
+        resident_bytes_ += f.bytes;
+        resident_.push_front(std::move(f));
+    }
+    deepest_ = std::max(deepest_, floor);
+
+    while (resident_.size() > kMaxResidentFloors || resident_bytes_ > kMaxResidentBytes) {
+        auto victim = resident_.end();
+        for (auto rit = resident_.rbegin(); rit != resident_.rend(); ++rit) {
+            if (rit->number != floor && rit->number != keep) {
+                victim = std::prev(rit.base());
+                break;
+            }
+        }
+        if (victim == resident_.end()) break;
+        evict(map, victim);
+    }
+}
+
+void Dungeon::evict(Map& map, std::list<Floor>::iterator it) {
+    for (const std::string& id : it->rooms) map.removeLocation(id);
+    map.setLayerTitle(kLayerBase + it->number, "");
+    resident_bytes_ -= it->bytes;
+    resident_.erase(it);
+}
+
+bool Dungeon::onMonsterDefeated(Map& map, const std::string& location_id) {
+    const int floor = floorOf(location_id);
+    if (floor == 0) return false;
+    auto it = std::find_if(resident_.begin(), resident_.end(), [floor](const Floor& f) { return f.number == floor; });
+    if (it != resident_.end()) {
+        auto room = std::find(it->rooms.begin(), it->rooms.end(), location_id);
+        if (room != it->rooms.end()) {
+            std::vector<int>& changes = cleared_[floor];
+            int index = static_cast<int>(room - it->rooms.begin());
+            if (std::find(changes.begin(), changes.end(), index) == changes.end()) changes.push_back(index);
+        }
+    }
+    if (Location* loc = map.get(location_id)) loc->enemies.clear();
+    return true;
+}
+
+void Dungeon::reset(Map& map) {
+    while (!resident_.empty()) evict(map, resident_.begin());
+    cleared_.clear();
+    deepest_ = 0;
+}
+
+void Dungeon::restore(int deepest, std::map<int, std::vector<int>> cleared) {
+    deepest_ = deepest;
+    cleared_ = std::move(cleared);
+}
+
+size_t Dungeon::heapBytes() const {
+    size_t n = memory::bytes(catalog_, [](const Enemy& e) {
+        return memory::bytes(e.name()) + memory::bytes(e.getSpecialSkill()) + memory::bytes(e.getSpecialSkillDescription())
+             + memory::bytes(e.getDropItems(), [](const Enemy::DropItem& d) {
+                   return memory::bytes(d.item_id) + memory::bytes(d.item_name);
+               });
+    });
+    for (const Floor& f : resident_) {
+        n += 2 * sizeof(void*) + sizeof(Floor) + memory::bytes(f.rooms, [](const std::string& s) { return memory::bytes(s); });
+    }
+    // std::map的节点：三个指针加颜色，按四个指针估计
+    for (const auto& kv : cleared_) n += 4 * sizeof(void*) + sizeof(kv) + memory::bytes(kv.second);
+    return n;
+}
+
+} // namespace hx
@@ -22,6 +22,9 @@ void Enemy::addDropItem(const std::string& item_id, const std::string& item_name
 // 获取敌人的等级
 // 根据敌人名称或属性估算等级，返回1-15级
 int Enemy::getLevel() const {
+    // 秘境里按层数加强过的怪物直接指定了等级
+    if (level_ > 0) return level_;
+    
     // 基于怪物名称和属性估算等级
     const std::string& name = this->name();
     
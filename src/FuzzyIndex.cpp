@@ -0,0 +1,227 @@
+// 这是名称模糊匹配索引的实现文件
+// 作者：大一学生
+// 功能：UTF-8拆字、单字/双字倒排表的维护，以及查询时的候选统计与排序
+
+#include "FuzzyIndex.hpp"  // 模糊匹配索引头文件
+#include "MemoryUsage.hpp" // 内存统计工具
+#include <algorithm>       // 排序、去重
+
+namespace hx {
+
+namespace {
+// 单字直接用码点；双字在最高位打标记，两个码点各占21位
+constexpr std::uint64_t kBigramFlag = 1ull << 63;
+
+std::uint64_t bigram(std::uint32_t a, std::uint32_t b) {
+    return kBigramFlag | (static_cast<std::uint64_t>(a) << 21) | b;
+}
+
+// 把UTF-8字符串拆成码点；不合法的字节单独成字（放到Unicode范围之外）
+void splitUtf8(std::string_view s, std::vector<std::uint32_t>& out) {
+    size_t i = 0;
+    while (i < s.size()) {
+        unsigned char c = static_cast<unsigned char>(s[i]);
+        size_t len = c < 0x80 ? 1 : (c >> 5) == 0x6 ? 2 : (c >> 4) == 0xE ? 3 : (c >> 3) == 0x1E ? 4 : 0;
+        std::uint32_t cp = c;
+        if (len > 1 && i + len <= s.size()) {
+            cp = c & (0x7Fu >> len);
+            for (size_t k = 1; k < len; ++k) {
+                unsigned char cc = static_cast<unsigned char>(s[i + k]);
+                if ((cc & 0xC0) != 0x80) { len = 0; break; }
+                cp = (cp << 6) | (cc & 0x3Fu);
+            }
+        } else if (len != 1) {
+            len = 0;
+        }
+        if (len == 0) {
+            cp = 0x110000u + c;
+            len = 1;
+        }
+        out.push_back(cp);
+        i += len;
+    }
+}
+
+// 生成去重后的单字和双字
+void makeGrams(std::string_view s, std::vector<std::uint64_t>& grams,
+               std::uint32_t& unigrams, std::uint32_t& bigrams) {
+    static thread_local std::vector<std::uint32_t> chars;
+    chars.clear();
+    splitUtf8(s, chars);
+    grams.clear();
+    for (size_t i = 0; i < chars.size(); ++i) {
+        grams.push_back(chars[i]);
+        if (i + 1 < chars.size()) grams.push_back(bigram(chars[i], chars[i + 1]));
+    }
+    std::sort(grams.begin(), grams.end());
+    grams.erase(std::unique(grams.begin(), grams.end()), grams.end());
+    // 排序后单字都在前面（没有最高位标记）
+    auto first_bigram = std::lower_bound(grams.begin(), grams.end(), kBigramFlag);
+    unigrams = static_cast<std::uint32_t>(first_bigram - grams.begin());
+    bigrams = static_cast<std::uint32_t>(grams.end() - first_bigram);
+}
+
+// 两组字的重合度：都有双字时比较双字，否则比较单字
+double dice(std::uint32_t shared_uni, std::uint32_t shared_bi,
+            std::uint32_t uni_a, std::uint32_t bi_a, std::uint32_t uni_b, std::uint32_t bi_b) {
+    if (bi_a > 0 && bi_b > 0) return 2.0 * shared_bi / (bi_a + bi_b);
+    if (uni_a + uni_b == 0) return 0.0;
+    return 2.0 * shared_uni / (uni_a + uni_b);
+}
+
+// 查询时的计数缓冲区，按线程复用
+struct Scratch {
+    std::vector<std::uint32_t> shared_uni;
+    std::vector<std::uint32_t> shared_bi;
+    std::vector<std::uint32_t> touched;
+    std::vector<std::uint64_t> grams;
+};
+} // namespace
+
+void FuzzyIndex::insert(Key key, const std::string& name) {
+    erase(key);
+    std::uint32_t slot;
+    if (!free_.empty()) {
+        slot = free_.back();
+        free_.pop_back();
+    } else {
+        slot = static_cast<std::uint32_t>(entries_.size());
+        entries_.emplace_back();
+    }
+    Entry& e = entries_[slot];
+    e.key = key;
+    e.name = name;
+    e.used = true;
+    makeGrams(name, e.grams, e.unigrams, e.bigrams);
+    for (std::uint64_t g : e.grams) postings_[g].push_back(slot);
+    if (e.bigrams == 0) {
+        for (std::uint64_t g : e.grams) short_postings_[g].push_back(slot);
+    }
+    slot_of_[key] = slot;
+}
+
+void FuzzyIndex::erase(Key key) {
+    auto it = slot_of_.find(key);
+    if (it == slot_of_.end()) return;
+    std::uint32_t slot = it->second;
+    Entry& e = entries_[slot];
+    auto unlink = [slot](std::unordered_map<std::uint64_t, std::vector<std::uint32_t>>& postings, std::uint64_t g) {
+        auto p = postings.find(g);
+        if (p == postings.end()) return;
+        auto pos = std::find(p->second.begin(), p->second.end(), slot);
+        if (pos != p->second.end()) p->second.erase(pos);
+        if (p->second.empty()) postings.erase(p);
+    };
+    for (std::uint64_t g : e.grams) {
+        unlink(postings_, g);
+        if (e.bigrams == 0) unlink(short_postings_, g);
+    }
+    e = Entry{};
+    free_.push_back(slot);
+    slot_of_.erase(it);
+}
+
+void FuzzyIndex::clear() {
+    entries_.clear();
+    free_.clear();
+    slot_of_.clear();
+    postings_.clear();
+    short_postings_.clear();
+}
+
+const std::string& FuzzyIndex::name(Key key) const {
+    return entries_[slot_of_.at(key)].name;
+}
+
+// 排序规则：类型靠前的优先，同类中相似度高的优先，再按键从小到大
+static bool moreRelevant(const FuzzyIndex::Match& a, const FuzzyIndex::Match& b) {
+    if (a.kind != b.kind) return a.kind < b.kind;
+    if (a.similarity != b.similarity) return a.similarity > b.similarity;
+    return a.key < b.key;
+}
+
+template <class Visit>
+void FuzzyIndex::scan(std::string_view query, double min_similarity, Visit&& visit) const {
+    if (query.empty() || entries_.empty()) return;
+
+    static thread_local Scratch scratch;
+    Scratch& s = scratch;
+    std::uint32_t q_uni = 0;
+    std::uint32_t q_bi = 0;
+    makeGrams(query, s.grams, q_uni, q_bi);
+    if (s.shared_uni.size() < entries_.size()) {
+        s.shared_uni.resize(entries_.size(), 0);
+        s.shared_bi.resize(entries_.size(), 0);
+    }
+
+    // 统计每个条目与输入共享多少个单字和双字
+    // 输入有双字时只查双字倒排表（常用字的单字表可能很长），单字名称另外从短名称表里查
+    const bool by_bigram = q_bi > 0;
+    s.touched.clear();
+    for (std::uint64_t g : s.grams) {
+        bool is_bigram = (g & kBigramFlag) != 0;
+        const auto& postings = (by_bigram && !is_bigram) ? short_postings_ : postings_;
+        auto p = postings.find(g);
+        if (p == postings.end()) continue;
+        for (std::uint32_t slot : p->second) {
+            if (s.shared_uni[slot] == 0 && s.shared_bi[slot] == 0) s.touched.push_back(slot);
+            if (is_bigram) ++s.shared_bi[slot]; else ++s.shared_uni[slot];
+        }
+    }
+
+    for (std::uint32_t slot : s.touched) {
+        const Entry& e = entries_[slot];
+        std::uint32_t su = s.shared_uni[slot];
+        std::uint32_t sb = s.shared_bi[slot];
+        s.shared_uni[slot] = 0;
+        s.shared_bi[slot] = 0;
+
+        double sim = dice(su, sb, q_uni, q_bi, e.unigrams, e.bigrams);
+        std::string_view name(e.name);
+        // 只有输入的字全部出现在名称里，名称才可能包含输入；反过来也一样
+        // （两个字以上时双字全部出现就说明单字也全部出现）
+        bool may_contain = by_bigram ? sb == q_bi : su == q_uni;
+        bool may_be_contained = e.bigrams > 0 ? sb == e.bigrams : su == e.unigrams;
+        MatchKind kind;
+        if (may_contain && name == query) kind = MatchKind::EXACT;
+        else if (may_contain && name.substr(0, query.size()) == query) kind = MatchKind::PREFIX;
+        else if (may_contain && name.find(query) != std::string_view::npos) kind = MatchKind::CONTAINS;
+        else if (may_be_contained && query.find(name) != std::string_view::npos) kind = MatchKind::CONTAINED;
+        else if (sim >= min_similarity) kind = MatchKind::SIMILAR;
+        else continue;
+        visit(Match{e.key, kind, sim});
+    }
+}
+
+std::vector<FuzzyIndex::Match> FuzzyIndex::search(std::string_view query, size_t limit,
+                                                  double min_similarity) const {
+    std::vector<Match> result;
+    scan(query, min_similarity, [&result](const Match& m) { result.push_back(m); });
+    std::sort(result.begin(), result.end(), moreRelevant);
+    if (limit > 0 && result.size() > limit) result.resize(limit);
+    return result;
+}
+
+bool FuzzyIndex::best(std::string_view query, Key& out,
+                      const std::function<bool(Key)>& accept, double min_similarity) const {
+    bool found = false;
+    Match top{};
+    scan(query, min_similarity, [&](const Match& m) {
+        if (accept && !accept(m.key)) return;
+        if (!found || moreRelevant(m, top)) {
+            top = m;
+            found = true;
+        }
+    });
+    if (found) out = top.key;
+    return found;
+}
+
+size_t FuzzyIndex::heapBytes() const {
+    auto posting = [](const auto& kv) { return memory::bytes(kv.second); };
+    return memory::bytes(entries_, [](const Entry& e) { return memory::bytes(e.name) + memory::bytes(e.grams); })
+         + memory::bytes(free_) + memory::tableBytes(slot_of_)
+         + memory::tableBytes(postings_, posting) + memory::tableBytes(short_postings_, posting);
+}
+
+} // namespace hx
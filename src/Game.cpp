@@ -4,13 +4,23 @@
 #include "Game.hpp"        // 游戏类的头文件
 #include "SaveLoad.hpp"     // 存档读档功能
 #include "ItemDefinitions.hpp"  // 物品定义
+#include "Output.hpp"       // 游戏输出
+#include "Replay.hpp"       // 输入记录
+#include "Metrics.hpp"      // 运行指标
+#include "Trace.hpp"        // 时间线跟踪
+#include "CombatForecast.hpp" // 战前胜率预估
+#include "LoadoutOptimizer.hpp" // 配装优化
 #include <iostream>         // 输入输出流
+#include <cmath>            // lround
+#include <cstdio>           // snprintf
 #include <cstdlib>          // 标准库函数
 #include <algorithm>        // 算法库
 #include <limits>           // 数值限制
 #include <sstream>          // 字符串流
 #include <numeric>          // 数值算法
 #include <set>              // 集合容器
+#include <optional>         // 可选值
+#include <unordered_map>    // 哈希映射
 
 namespace hx {
 // 快速创建地点的辅助函数
@@ -24,15 +34,77 @@ static Location mk(const std::string& id, const std::string& name, const std::st
 }
 
 // 构造函数
-Game::Game() { 
+Game::Game(std::uint32_t seed) : seed_(seed), rng_(seed) { 
+    // 战斗和商店用从同一个种子派生出来的不同种子
+    std::seed_seq seq{seed};
+    std::uint32_t derived[2];
+    seq.generate(derived, derived + 2);
+    combat_.seed(derived[0]);
+    state_.shop_system.seed(derived[1]);
+    state_.dungeon.setSeed(seed); // 秘境各层用（种子, 层数）各自派生，不占上面两路随机数
     setupWorld();
     combat_.setGameState(&state_);
+    state_.player.setEventBus(&state_.events);
+    registerEventListeners();
+    scheduleWorldTimers();
+    addLiveSession(1);
+    publishMemory();
+}
+
+Game::~Game() {
+    publishSessionMemory(memory_published_, MemoryReport{});
+    addLiveSession(-1);
+}
+
+// 会话内存：重新统计，把与上次的差值计入所有会话的合计
+void Game::publishMemory() {
+    MemoryReport now = memoryUsage();
+    publishSessionMemory(memory_published_, now);
+    memory_published_ = now;
+    commands_since_memory_ = 0;
+}
+
+// 存档：有存档位时写进存档位，否则写到当前目录的save.dat
+bool Game::saveGame() const {
+    if (!save_slot_) return SaveLoad::save(state_);
+    std::ostringstream out(std::ios::binary);
+    if (!SaveLoad::save(state_, out)) return false;
+    *save_slot_ = out.str();
+    return true;
+}
+
+// 读档：存档里记的最后输入时刻只用一次，读完就在存档里清零，再读同一个存档不会重复补算离线进度
+bool Game::loadGame() {
+    if (!save_slot_) {
+        if (!SaveLoad::load(state_)) return false;
+        if (state_.last_active_ms != 0) SaveLoad::clearLastActive();
+        return true;
+    }
+    if (save_slot_->empty()) {
+        console() << "还没有存档。" << std::endl;
+        return false;
+    }
+    std::istringstream in(*save_slot_, std::ios::binary);
+    if (!SaveLoad::load(state_, in)) return false;
+    if (state_.last_active_ms != 0) SaveLoad::clearLastActive(*save_slot_);
+    return true;
+}
+
+MemoryReport Game::memoryUsage() const {
+    MemoryReport r = measureMemory(state_);
+    // Game除GameState以外的部分：战斗系统、名称索引、指令缓冲区、交互状态
+    r[MemoryPart::SESSION] = sizeof(Game) - sizeof(GameState)
+        + router_.heapBytes() + memory::bytes(command_.text()) + memory::bytes(shop_npc_)
+        + memory::bytes(talk_.npc_name) + memory::bytes(talk_.dialogue_id) + memory::bytes(talk_.available_options)
+        + memory::bytes(batch_.text) + (save_slot_ ? memory::bytes(*save_slot_) : 0)
+        + npc_names_.heapBytes() + monster_names_.heapBytes() + command_hints_.heapBytes();
+    return r;
 }
 
 // 显示游戏标题
 void Game::printBanner() const { 
-    std::cout << "\n=== 海大修仙秘：文心潭秘录 ===\n"; 
-    std::cout << "输入 help 查看指令。\n"; 
+    console() << "\n=== 海大修仙秘：文心潭秘录 ===\n"; 
+    console() << "输入 help 查看指令。\n"; 
 }
 
 // 世界设置函数现在在GameWorld.cpp中实现
@@ -40,10 +112,11 @@ void Game::printBanner() const {
 // 查看当前地点的信息
 // 会显示NPC、敌人、地图等所有东西
 void Game::look() const{
+    HX_TRACE_SPAN("look");
     // 找到当前所在的位置
     const auto* loc = state_.map.get(state_.current_loc);
     // 如果找不到位置就报错
-    if(!loc){ std::cout<<"未知地点。\n"; return; }
+    if(!loc){ console()<<"未知地点。\n"; return; }
     
     // 第四章之后就不显示位置信息了
     if (state_.chapter4_shown) {
@@ -51,33 +124,33 @@ void Game::look() const{
     }
     
     // 显示地点名称和描述
-    std::cout << "\n📍 【" << loc->name << "】\n";
-    std::cout << loc->desc << "\n";
+    console() << "\n📍 【" << loc->name << "】\n";
+    console() << loc->desc << "\n";
     
     // 显示NPC
     if(!loc->npcs.empty()){ 
-        std::cout << "npc：\n";
+        console() << "npc：\n";
         // 把每个NPC的名字都显示出来
         for(const auto& npc:loc->npcs) {
-            std::cout << "   • " << npc.name() << "\n";
+            console() << "   • " << npc.name() << "\n";
         }
     }
     
     // 显示敌人
     if(!loc->enemies.empty()){ 
-        std::cout << "敌人：\n";
+        console() << "敌人：\n";
         // 把每个敌人都显示出来
         for(auto &en:loc->enemies) {
             // 看看这个敌人能不能打
             bool can_fight = canSpawnMonster(state_.current_loc, en.name());
-            std::cout << "   • " << formatMonsterName(en);
+            console() << "   • " << formatMonsterName(en);
             // 显示能不能挑战
             if (!can_fight) {
-                std::cout << "（不可挑战）";
+                console() << "（不可挑战）";
             } else {
-                std::cout << "（可挑战）";
+                console() << "（可挑战）";
             }
-            std::cout << "\n";
+            console() << "\n";
         }
     }
     
@@ -85,59 +158,54 @@ void Game::look() const{
     showEnhancedOperations();
     
     // 显示地图
-    std::cout << "\n🗺️ 地图导航\n";
+    console() << "\n🗺️ 地图导航\n";
     
-    // 根据位置显示不同的地图
-    if(state_.in_teaching_detail) {
-        // 在教学区就显示教学区地图
-        renderTeachingDetailMap();
-    } else {
-        // 不在教学区就显示主地图
-        renderMainMap();
-    }
-}
-
-// 显示主地图
-void Game::renderMainMap() const {
-    std::cout << state_.map.renderMainMap(state_.current_loc);
+    // 显示所在地图层里附近的地点
+    renderMap();
 }
 
-// 显示教学区地图
-void Game::renderTeachingDetailMap() const {
-    std::cout << state_.map.renderTeachingDetailMap(state_.current_loc);
+// 显示玩家附近的地图（主地图或教学区地图，取决于所在的地图层）
+void Game::renderMap() const {
+    MetricTimer timer(Metric::MAP_RENDER);
+    HX_TRACE_SPAN("render_map");
+    console() << state_.map.renderViewport(state_.current_loc);
 }
 
 // 显示增强版主地图
 void Game::renderEnhancedMainMap() const {
-    std::cout << state_.map.renderEnhancedMainMap(state_.current_loc);
+    MetricTimer timer(Metric::MAP_RENDER);
+    HX_TRACE_SPAN("render_map");
+    console() << state_.map.renderEnhancedMainMap(state_.current_loc);
 }
 
 // 显示增强版教学区地图
 void Game::renderEnhancedTeachingDetailMap() const {
-    std::cout << state_.map.renderEnhancedTeachingDetailMap(state_.current_loc);
+    MetricTimer timer(Metric::MAP_RENDER);
+    HX_TRACE_SPAN("render_map");
+    console() << state_.map.renderEnhancedTeachingDetailMap(state_.current_loc);
 }
 
 void Game::showAtmosphereDescription(const std::string& locationId) const {
     if(locationId == "library") {
-        std::cout << "古老的书籍散发着墨香，静谧中仿佛能听到知识的低语。";
+        console() << "古老的书籍散发着墨香，静谧中仿佛能听到知识的低语。";
     } else if(locationId == "gymnasium") {
-        std::cout << "空旷的场地回响着脚步声，空气中弥漫着汗水和努力的味道。";
+        console() << "空旷的场地回响着脚步声，空气中弥漫着汗水和努力的味道。";
     } else if(locationId == "canteen") {
-        std::cout << "食物的香气与嘈杂的人声交织，这里是校园最有人气的地方。";
+        console() << "食物的香气与嘈杂的人声交织，这里是校园最有人气的地方。";
     } else if(locationId == "teaching_area") {
-        std::cout << "教学楼群庄严肃穆，每一扇窗户都透出求知的渴望。";
+        console() << "教学楼群庄严肃穆，每一扇窗户都透出求知的渴望。";
     } else if(locationId == "wenxintan") {
-        std::cout << "潭水幽深如镜，倒映着天空的云彩，神秘而宁静。";
+        console() << "潭水幽深如镜，倒映着天空的云彩，神秘而宁静。";
     } else if(locationId == "jiuzhutan") {
-        std::cout << "九根石柱环绕，每一根都散发着不同学科的气息。";
+        console() << "九根石柱环绕，每一根都散发着不同学科的气息。";
     } else if(locationId == "teach_5") {
-        std::cout << "走廊里试卷飞舞，每一道题都化作幻影，考验着智慧。";
+        console() << "走廊里试卷飞舞，每一道题都化作幻影，考验着智慧。";
     } else if(locationId == "teach_7") {
-        std::cout << "实验器材散落一地，失败的实验化作怪物，考验着坚韧。";
+        console() << "实验器材散落一地，失败的实验化作怪物，考验着坚韧。";
     } else if(locationId == "tree_space") {
-        std::cout << "古树参天，树荫下辩论声此起彼伏，考验着表达能力。";
+        console() << "古树参天，树荫下辩论声此起彼伏，考验着表达能力。";
     } else {
-        std::cout << "空气中弥漫着未知的气息，等待着探索者的到来。";
+        console() << "空气中弥漫着未知的气息，等待着探索者的到来。";
     }
 }
 
@@ -145,50 +213,59 @@ void Game::showEnhancedOperations() const {
     const auto* loc = state_.map.get(state_.current_loc);
     if(!loc) return;
     
-    std::cout << "\n🎮 操作指南\n";
+    console() << "\n🎮 操作指南\n";
     
     // 交互操作
     if(!loc->npcs.empty()) {
-        std::cout << "💬 对话：\n";
-        std::cout << "   📝 talk/对话 - 与NPC交谈\n";
+        console() << "💬 对话：\n";
+        console() << "   📝 talk/对话 - 与NPC交谈\n";
     }
     
     if(!loc->enemies.empty()) {
-        std::cout << "⚔️ 战斗：\n";
-        std::cout << "   🗡️ fight/战斗 - 开始战斗\n";
+        console() << "⚔️ 战斗：\n";
+        console() << "   🗡️ fight/战斗 - 开始战斗\n";
+    }
+    
+    // 秘境的阶梯
+    bool down = loc->findExitByLabel(Dungeon::kDownLabel) != nullptr;
+    bool up = loc->findExitByLabel(Dungeon::kUpLabel) != nullptr;
+    if(down || up) {
+        console() << "🌀 秘境：\n";
+        if(down) console() << "   ⬇️ down/下楼 - 前往秘境更深的一层\n";
+        if(up) console() << "   ⬆️ up/上楼 - 返回上一层\n";
     }
     
     // 系统操作
-    std::cout << "📋 系统：\n";
-    std::cout << "   📊 stats - 查看属性    🎒 inv - 查看背包\n";
-    std::cout << "   📋 task - 查看任务     ❓ help - 帮助\n";
+    console() << "📋 系统：\n";
+    console() << "   📊 stats - 查看属性    🎒 inv - 查看背包\n";
+    console() << "   📋 task - 查看任务     ❓ help - 帮助\n";
 }
 
 void Game::showSmartActions() const {
     const auto* loc = state_.map.get(state_.current_loc);
     if(!loc) return;
     
-    std::cout << "\n🎮 操作: ";
+    console() << "\n🎮 操作: ";
     
     // 显示核心操作选项
     if(!loc->exits.empty()) {
-        std::cout << "移动(";
+        console() << "移动(";
         for(size_t i = 0; i < loc->exits.size(); ++i) {
-            if(i > 0) std::cout << "/";
-            std::cout << loc->exits[i].label;
+            if(i > 0) console() << "/";
+            console() << loc->exits[i].label;
         }
-        std::cout << ") ";
+        console() << ") ";
     }
     
     if(!loc->npcs.empty()) {
-        std::cout << "对话(talk) ";
+        console() << "对话(talk) ";
     }
     
     if(!loc->enemies.empty()) {
-        std::cout << "战斗(fight) ";
+        console() << "战斗(fight) ";
     }
     
-    std::cout << "其他(stats/inv/task/help)\n";
+    console() << "其他(stats/inv/task/help)\n";
 }
 
 void Game::handlePlayerDeath() {
@@ -196,29 +273,22 @@ void Game::handlePlayerDeath() {
     if(state_.player.hasRevivalScroll()) {
         // 使用复活符，免惩罚
         state_.player.useRevivalScroll();
-        std::cout<<"【复活符】你使用了复活符，免除了死亡惩罚！\n";
-        std::cout<<"【复活符】你的生命值已完全恢复。\n";
+        console()<<"【复活符】你使用了复活符，免除了死亡惩罚！\n";
+        console()<<"【复活符】你的生命值已完全恢复。\n";
     } else {
         // 没有复活符，执行死亡惩罚
         state_.player.onDeathPenalty();
-        std::cout<<"【死亡惩罚】等级-1，金币-10%，生命值已恢复。\n";
+        console()<<"【死亡惩罚】等级-1，金币-10%，生命值已恢复。\n";
     }
     
     // 无论是否有复活符，都传送到秘境图书馆
-    std::cout<<"你被传送回了秘境图书馆。\n";
+    console()<<"你被传送回了秘境图书馆。\n";
     state_.current_loc = "library";
     state_.in_teaching_detail = false; // 确保回到主地图模式
     look();
 }
 
-// 处理文心潭三战后的钥匙与失败计数
-static void onWenxinBossDefeated(GameState& state, const std::string& boss_name) {
-    if (boss_name == "文献综述怪") state.key_i_obtained = true;
-    if (boss_name == "实验失败妖·复苏") state.key_ii_obtained = true;
-    if (boss_name == "答辩紧张魔·强化") state.key_iii_obtained = true;
-    state.wenxintan_fail_streak = 0;
-}
-
+// 处理文心潭失败计数（击败三战的钥匙标记见GameEvents.cpp）
 static void onWenxinFail(GameState& state) {
     state.wenxintan_fail_streak += 1;
 }
@@ -228,31 +298,31 @@ void Game::triggerChapter4Transition() {
     state_.chapter4_shown = true;
 
     // 清屏效果
-    std::cout << "\n" << std::string(60, '=') << "\n";
-    std::cout << "重大事件触发\n";
-    std::cout << std::string(60, '=') << "\n\n";
+    console() << "\n" << std::string(60, '=') << "\n";
+    console() << "重大事件触发\n";
+    console() << std::string(60, '=') << "\n\n";
 
     // 章节标题
-    std::cout << "第四章：真相·秘境之源\n";
-    std::cout << "━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━\n\n";
+    console() << "第四章：真相·秘境之源\n";
+    console() << "━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━\n\n";
 
     // 整合的剧情描述
-    std::cout << "水镜觉醒\n";
-    std::cout << "━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━\n";
-    std::cout << "三把秘钥合而为一，水面剧烈震荡，最终凝成一面清澈的水镜。历代学子的身影浮现：\n";
-    std::cout << "焦灼的夜晚，灯光下的书影婆娑；堆积如山的资料，压得人喘不过气；失败后的迷茫，\n";
-    std::cout << "徘徊在十字路口。你忽然明白，秘境并非囚笼，而是将无形压力化为可见心魔的'练功房'。\n";
-    std::cout << "你看见自己一路走来的痕迹：面对、理解、拆解、克服。水镜最后显现《文心潭秘录》的\n";
-    std::cout << "封页：如此，你已可做出最终抉择。\n\n";
-    
-    std::cout << "输入 'ending' 进行结局判定\n";
-    std::cout << "━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━\n\n";
-    
-    std::cout << "成就达成：文心三钥集齐者\n";
-    std::cout << "━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━\n";
+    console() << "水镜觉醒\n";
+    console() << "━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━\n";
+    console() << "三把秘钥合而为一，水面剧烈震荡，最终凝成一面清澈的水镜。历代学子的身影浮现：\n";
+    console() << "焦灼的夜晚，灯光下的书影婆娑；堆积如山的资料，压得人喘不过气；失败后的迷茫，\n";
+    console() << "徘徊在十字路口。你忽然明白，秘境并非囚笼，而是将无形压力化为可见心魔的'练功房'。\n";
+    console() << "你看见自己一路走来的痕迹：面对、理解、拆解、克服。水镜最后显现《文心潭秘录》的\n";
+    console() << "封页：如此，你已可做出最终抉择。\n\n";
+    
+    console() << "输入 'ending' 进行结局判定\n";
+    console() << "━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━\n\n";
+    
+    console() << "成就达成：文心三钥集齐者\n";
+    console() << "━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━\n";
 }
 
-void Game::openShop(const std::string& npc_name) {
+void Game::openShop(const std::string& npc_name, std::function<void()> on_close) {
     auto* loc = state_.map.get(state_.current_loc);
     if(!loc) return;
     
@@ -260,184 +330,201 @@ void Game::openShop(const std::string& npc_name) {
     if(!npc) return;
     
     // 检查是否需要刷新商店（每5个回合）或商店为空
-    if (state_.shop_system.shouldRefresh(state_.turn_counter) || loc->shop.empty()) {
-        // 检查是否已经刷新过（避免重复刷新）
-        static int last_refresh_turn = -1;
-        if (last_refresh_turn != state_.turn_counter) {
-            // 刷新商店物品
-            state_.shop_system.refreshShop(loc->shop, state_.turn_counter);
-            last_refresh_turn = state_.turn_counter;
-        }
+    if (state_.shop_system.refreshDue() || loc->shop.empty()) {
+        // 刷新商店物品（刷新后标记清除，同一周期内不会重复刷新）
+        state_.shop_system.refreshShop(loc->shop);
     }
     
-    // 商店主循环
-    while(true) {
-        std::cout<<"\n"<<std::string(50,'=')<<"\n";
-        std::cout<<"🛒 "<<npc_name<<" 的商店\n";
-        std::cout<<std::string(50,'=')<<"\n";
-        std::cout<<"金币: " << state_.player.coins() << "\n\n";
+    shop_npc_ = npc_name;
+    shop_on_close_ = std::move(on_close);
+    showShopPage();
+}
+
+// 显示商店页面并等待玩家输入
+void Game::showShopPage() {
+    auto* loc = state_.map.get(state_.current_loc);
+    if(!loc) { closeShop(); return; }
+    
+    console()<<"\n"<<std::string(50,'=')<<"\n";
+    console()<<"🛒 "<<shop_npc_<<" 的商店\n";
+    console()<<std::string(50,'=')<<"\n";
+    console()<<"金币: " << state_.player.coins() << "\n\n";
+    
+    if(loc->shop.empty()) {
+        console()<<"商店暂时没有商品。\n";
+        flow_.await("\n输入 'back' 返回： ", [this](const std::string& input) {
+            if(input == "back") closeShop();
+            else showShopPage();
+        });
+        return;
+    }
+    
+    for(size_t i = 0; i < loc->shop.size(); ++i) {
+        const auto& item = loc->shop[i];
+        std::string display_name = item.name;
+        // 为装备类型的ShopItem着色
+        if (item.type == ItemType::EQUIPMENT) {
+            Item temp_item;
+            temp_item.name = item.name;
+            temp_item.quality = item.quality;
+            temp_item.type = ItemType::EQUIPMENT;
+            // 检查是否为饰品，设置正确的装备类型
+            if (item.id == "steel_spoon_amulet" || item.id == "speech_words_amulet" || 
+                item.id == "goggles_amulet" || item.id == "hnu_badge_amulet" || 
+                item.id == "ecard_amulet" || item.id == "seat_all_lib_amulet") {
+                temp_item.equip_type = EquipmentType::ACCESSORY;
+            }
+            display_name = getColoredItemName(temp_item);
+        }
+        // 紧凑一行：编号 名称 [品质色] 价格/折扣/限购
+        console()<<(i+1)<<". "<<display_name;
+        console()<<"  - "<<item.price<<"金币";
         
-        if(loc->shop.empty()) {
-            std::cout<<"商店暂时没有商品。\n";
-            std::cout<<"\n输入 'back' 返回： ";
-            std::string input;
-            std::getline(std::cin, input);
-            if(input == "back") return;
-            continue;
+        // 复活符显示剩余购买次数
+        if(item.id == "revival_scroll") {
+            int remaining = 2 - state_.shop_system.getRevivalScrollPurchases();
+            console()<<" [剩余购买次数: " << remaining << "]";
         }
         
-        for(size_t i = 0; i < loc->shop.size(); ++i) {
-            const auto& item = loc->shop[i];
-            std::string display_name = item.name;
-            // 为装备类型的ShopItem着色
-            if (item.type == ItemType::EQUIPMENT) {
-                Item temp_item;
-                temp_item.name = item.name;
-                temp_item.quality = item.quality;
-                temp_item.type = ItemType::EQUIPMENT;
-                // 检查是否为饰品，设置正确的装备类型
-                if (item.id == "steel_spoon_amulet" || item.id == "speech_words_amulet" || 
-                    item.id == "goggles_amulet" || item.id == "hnu_badge_amulet" || 
-                    item.id == "ecard_amulet" || item.id == "seat_all_lib_amulet") {
-                    temp_item.equip_type = EquipmentType::ACCESSORY;
-                }
-                display_name = getColoredItemName(temp_item);
-            }
-            // 紧凑一行：编号 名称 [品质色] 价格/折扣/限购
-            std::cout<<(i+1)<<". "<<display_name;
-            std::cout<<"  - "<<item.price<<"金币";
-            
-            // 复活符显示剩余购买次数
-            if(item.id == "revival_scroll") {
-                int remaining = 2 - state_.shop_system.getRevivalScrollPurchases();
-                std::cout<<" [剩余购买次数: " << remaining << "]";
-            }
-            
-            // 若未来扩展限购字段，可在此处输出
-            if(item.favor_requirement > 0) std::cout<<"  需要好感:"<<item.favor_requirement;
-            std::cout<<"\n";
-        }
-        // 添加第5个选项：我不买了
-        std::cout<<(loc->shop.size()+1)<<". 我不买了\n";
-        std::cout<<"\n输入数字购买；输入 '详情 <编号>' 查看描述；'sell' 出售装备（10金币/件）： ";
-        std::string input;
-        std::getline(std::cin, input);
-        
-        if(input.rfind("详情 ",0)==0){
-            try{
-                int idx = std::stoi(input.substr(7));
-                if(idx>0 && idx<=static_cast<int>(loc->shop.size())){
-                    const auto& it = loc->shop[idx-1];
-                    std::cout<<"\n"<<std::string(50,'-')<<"\n";
-                    std::cout<<it.name<<"："<<it.description<<"\n";
-                    std::cout<<std::string(50,'-')<<"\n";
-                }
-            }catch(...){ }
-            continue; // 查看详情后继续商店循环
+        // 若未来扩展限购字段，可在此处输出
+        if(item.favor_requirement > 0) console()<<"  需要好感:"<<item.favor_requirement;
+        console()<<"\n";
+    }
+    // 添加第5个选项：我不买了
+    console()<<(loc->shop.size()+1)<<". 我不买了\n";
+    flow_.await("\n输入数字购买；输入 '详情 <编号>' 查看描述；'sell' 出售装备（10金币/件）： ",
+                [this](const std::string& input) { onShopInput(input); });
+}
+
+// 处理商店页面的一行输入
+void Game::onShopInput(const std::string& input) {
+    auto* loc = state_.map.get(state_.current_loc);
+    if(!loc) { closeShop(); return; }
+    
+    if(input.rfind("详情 ",0)==0){
+        int idx = 0;
+        if(parseIndex(std::string_view(input).substr(std::string_view("详情 ").size()), idx) &&
+           idx>0 && idx<=static_cast<int>(loc->shop.size())){
+            const auto& it = loc->shop[idx-1];
+            console()<<"\n"<<std::string(50,'-')<<"\n";
+            console()<<it.name<<"："<<it.description<<"\n";
+            console()<<std::string(50,'-')<<"\n";
+        }
+        showShopPage(); // 查看详情后回到商店
+        return;
+    }
+    
+    if(input == "sell") {
+        // 出售装备：列出背包中的装备并选择出售
+        std::vector<Item> equipments;
+        for (const auto& it : state_.player.inventory()) {
+            if (it.type == ItemType::EQUIPMENT) equipments.push_back(it);
         }
-        
-        if(input == "sell") {
-            // 出售装备：列出背包中的装备并选择出售
-            auto items = state_.player.inventory().list();
-            std::vector<Item> equipments;
-            for (const auto& it : items) {
-                if (it.type == ItemType::EQUIPMENT) equipments.push_back(it);
-            }
-            if (equipments.empty()) {
-                std::cout<<"你没有可出售的装备。\n";
-                continue;
-            }
-            std::cout<<"可出售的装备：\n";
-            for (size_t i = 0; i < equipments.size(); ++i) {
-                std::cout<< (i+1) << ". " << getColoredItemName(equipments[i]) << " x" << equipments[i].count << "\n";
-            }
-            std::cout<<"输入编号出售（每件10金币），或输入 'cancel' 取消：";
-            std::string sellInput;
-            std::getline(std::cin, sellInput);
-            if (sellInput == "cancel") continue;
-            try {
-                int idx = std::stoi(sellInput);
-                if (idx > 0 && idx <= static_cast<int>(equipments.size())) {
-                    const Item& chosen = equipments[idx-1];
-                    if (state_.player.inventory().remove(chosen.id, 1)) {
-                        state_.player.addCoins(10);
-                        std::cout<<"回收了 "<< chosen.name <<"，获得10金币。\n";
+        if (equipments.empty()) {
+            console()<<"你没有可出售的装备。\n";
+            showShopPage();
+            return;
+        }
+        console()<<"可出售的装备：\n";
+        for (size_t i = 0; i < equipments.size(); ++i) {
+            console()<< (i+1) << ". " << getColoredItemName(equipments[i]) << " x" << equipments[i].count << "\n";
+        }
+        flow_.await("输入编号出售（每件10金币），或输入 'cancel' 取消：",
+                    [this, equipments](const std::string& sellInput) {
+            if (sellInput != "cancel") {
+                int idx = 0;
+                if (!parseIndex(sellInput, idx)) {
+                    console()<<"无效输入。\n";
+                } else {
+                    if (idx > 0 && idx <= static_cast<int>(equipments.size())) {
+                        const Item& chosen = equipments[idx-1];
+                        if (state_.player.inventory().remove(chosen.id, 1)) {
+                            state_.player.addCoins(10);
+                            console()<<"回收了 "<< chosen.name <<"，获得10金币。\n";
+                        } else {
+                            console()<<"出售失败。\n";
+                        }
                     } else {
-                        std::cout<<"出售失败。\n";
+                        console()<<"无效选择。\n";
                     }
-                } else {
-                    std::cout<<"无效选择。\n";
                 }
-            } catch(...) {
-                std::cout<<"无效输入。\n";
             }
-            continue;
+            showShopPage();
+        });
+        return;
+    }
+    
+    // 购买逻辑
+    try {
+        int choice = std::stoi(input);
+        // 检查是否选择了"我不买了"选项
+        if(choice == static_cast<int>(loc->shop.size()) + 1) {
+            console()<<"好的，欢迎下次再来！\n";
+            closeShop();
+            return;
         }
-        
-        // 购买逻辑
-        try {
-            int choice = std::stoi(input);
-            // 检查是否选择了"我不买了"选项
-            if(choice == static_cast<int>(loc->shop.size()) + 1) {
-                std::cout<<"好的，欢迎下次再来！\n";
+        if(choice > 0 && choice <= static_cast<int>(loc->shop.size())) {
+            const auto& item = loc->shop[choice - 1];
+            
+            // 复活符最多购买2次：检查商店系统的购买次数
+            if(item.id == "revival_scroll" && !state_.shop_system.canPurchaseRevivalScroll()) {
+                console()<<"复活符已达购买上限（2）。\n";
+                showShopPage();
                 return;
             }
-            if(choice > 0 && choice <= static_cast<int>(loc->shop.size())) {
-                const auto& item = loc->shop[choice - 1];
+            int final_price = item.price;
+            if (state_.player.equipment().hasEffect("shop_discount")) {
+                final_price = std::max(1, (int)std::floor(item.price * state_.player.equipment().getEffectValue("shop_discount")));
+            }
+            if(state_.player.spendCoins(final_price)) {
+                // 创建物品并添加到背包
+                Item shop_item;
                 
-                if(item.id == "revival_scroll") {
-                    // 复活符最多购买2次：检查商店系统的购买次数
-                    if (!state_.shop_system.canPurchaseRevivalScroll()) {
-                        std::cout<<"复活符已达购买上限（2）。\n";
-                        continue;
-                    }
-                }
-                int final_price = item.price;
-                if (state_.player.equipment().hasEffect("shop_discount")) {
-                    final_price = std::max(1, (int)std::floor(item.price * state_.player.equipment().getEffectValue("shop_discount")));
-                }
-                if(state_.player.spendCoins(final_price)) {
-                    // 创建物品并添加到背包
-                    Item shop_item;
+                // 根据物品类型创建对应的Item
+                if (item.type == ItemType::EQUIPMENT) {
+                    // 装备类型，使用ShopSystem的createItem方法
+                    shop_item = state_.shop_system.createItemFromId(item.id);
+                    shop_item.price = final_price; // 使用最终价格（考虑折扣）
+                } else {
+                    // 消耗品类型
+                    shop_item.id = item.id;
+                    shop_item.name = item.name;
+                    shop_item.description = item.description;
+                    shop_item.price = final_price;
+                    shop_item.type = ItemType::CONSUMABLE;
                     
-                    // 根据物品类型创建对应的Item
-                    if (item.type == ItemType::EQUIPMENT) {
-                        // 装备类型，使用ShopSystem的createItem方法
-                        shop_item = state_.shop_system.createItemFromId(item.id);
-                        shop_item.price = final_price; // 使用最终价格（考虑折扣）
-                    } else {
-                        // 消耗品类型
-                        shop_item.id = item.id;
-                        shop_item.name = item.name;
-                        shop_item.description = item.description;
-                        shop_item.price = final_price;
-                        shop_item.type = ItemType::CONSUMABLE;
-                        
-                        // 根据物品ID设置特殊属性
-                        if(item.id == "health_potion") {
-                            shop_item.heal_amount = 30;
-                            shop_item.use_message = "使用了生命药水，恢复了30点生命值。";
-                        } else if(item.id == "revival_scroll") {
-                            shop_item.is_quest_item = true;
-                            // 更新复活符购买次数
-                            state_.shop_system.incrementRevivalScrollPurchases();
-                        } else if(item.id == "caffeine_elixir") {
-                            shop_item.use_message = "你饮下了咖啡因灵液。";
-                        }
+                    // 根据物品ID设置特殊属性
+                    if(item.id == "health_potion") {
+                        shop_item.heal_amount = 30;
+                        shop_item.use_message = "使用了生命药水，恢复了30点生命值。";
+                    } else if(item.id == "revival_scroll") {
+                        shop_item.is_quest_item = true;
+                        // 更新复活符购买次数
+                        state_.shop_system.incrementRevivalScrollPurchases();
+                    } else if(item.id == "caffeine_elixir") {
+                        shop_item.use_message = "你饮下了咖啡因灵液。";
                     }
-                    
-                    state_.player.inventory().add(shop_item, 1);
-                    std::cout<<"购买了 "<<item.name<<"！\n";
-                } else {
-                    std::cout<<"金币不足！\n";
                 }
+                
+                state_.player.gainItem(shop_item, 1);
+                console()<<"购买了 "<<item.name<<"！\n";
             } else {
-                std::cout<<"无效选择。\n";
+                console()<<"金币不足！\n";
             }
-        } catch(...) {
-            std::cout<<"无效输入。\n";
+        } else {
+            console()<<"无效选择。\n";
         }
-    } // 结束商店主循环
+    } catch(...) {
+        console()<<"无效输入。\n";
+    }
+    showShopPage();
+}
+
+// 离开商店，继续打开商店之前的流程
+void Game::closeShop() {
+    std::function<void()> on_close = std::move(shop_on_close_);
+    shop_on_close_ = nullptr;
+    if (on_close) on_close();
 }
 
 void Game::showQuest(const std::string& npc_name) {
@@ -447,12 +534,12 @@ void Game::showQuest(const std::string& npc_name) {
     const NPC* npc = loc->findNPC(npc_name);
     if(!npc || !npc->hasQuest()) return;
     
-    std::cout<<"\n=== "<<npc_name<<" 的任务 ===\n";
-    std::cout<<"任务ID: "<<npc->getQuestId()<<"\n";
+    console()<<"\n=== "<<npc_name<<" 的任务 ===\n";
+    console()<<"任务ID: "<<npc->getQuestId()<<"\n";
     
     // 这里可以根据任务ID显示具体的任务信息
     // 暂时显示通用信息
-    std::cout<<"任务详情请与NPC对话了解。\n";
+    console()<<"任务详情请与NPC对话了解。\n";
 }
 
 void Game::handleSpecialRewards(const std::string& npc_name, const std::string& dialogue_id, 
@@ -472,18 +559,17 @@ void Game::handleSpecialRewards(const std::string& npc_name, const std::string&
                     "古老的竹简，记载着学习心得。", 
                     EquipmentType::WEAPON, EquipmentSlot::WEAPON, 5, 0, 2, 0, 30);
                 
-                state_.player.inventory().add(student_uniform, 1);
-                state_.player.inventory().add(bamboo_notes, 1);
-                std::cout<<"【获得：普通学子服(DEF+5,HP+15) x1，竹简笔记(ATK+5,SPD+2) x1】\n";
+                state_.player.gainItem(student_uniform, 1);
+                state_.player.gainItem(bamboo_notes, 1);
+                console()<<"【获得：普通学子服(DEF+5,HP+15) x1，竹简笔记(ATK+5,SPD+2) x1】\n";
                 
                 // 第一次给装备时增加好感度
                 state_.player.addNPCFavor(npc_name, 10);
-                std::cout<<"【好感度 +10】\n";
                 
                 // 标记已给过奖励
                 const_cast<NPC*>(npc)->setGivenReward(true);
             } else {
-                std::cout<<"【林清漪】\"这些装备我已经给过你了，要好好珍惜哦。\"\n";
+                console()<<"【林清漪】\"这些装备我已经给过你了，要好好珍惜哦。\"\n";
             }
         }
         // 第一次询问信息的好感度奖励
@@ -493,7 +579,6 @@ void Game::handleSpecialRewards(const std::string& npc_name, const std::string&
             if(current_favor == 0) {
                 // 第一次询问信息，增加好感度
                 state_.player.addNPCFavor(npc_name, 5);
-                std::cout<<"【好感度 +5】\n";
             }
         }
     }
@@ -509,13 +594,13 @@ void Game::handleSpecialRewards(const std::string& npc_name, const std::string&
             steel_spoon.effect_target = "失败实验体";
             steel_spoon.effect_value = 1.3f;
             
-            state_.player.inventory().add(steel_spoon, 1);
-            std::cout<<"【获得：钢勺护符 x1】\n";
+            state_.player.gainItem(steel_spoon, 1);
+            console()<<"【获得：钢勺护符 x1】\n";
             
             // 标记已给过奖励
             const_cast<NPC*>(npc)->setGivenReward(true);
         } else {
-            std::cout<<"【苏小萌】\"护符已经给你了，要好好使用哦！\"\n";
+            console()<<"【苏小萌】\"护符已经给你了，要好好使用哦！\"\n";
         }
     }
     
@@ -528,163 +613,171 @@ void Game::handleSpecialRewards(const std::string& npc_name, const std::string&
                 EquipmentType::ACCESSORY, EquipmentSlot::ACCESSORY2, 0, 10, 0, 5, 90);
             weight_bracelet.description = "毅力试炼的奖励，能增强体魄。戴上它，你感觉自己的力量增加了。";
             
-            state_.player.inventory().add(weight_bracelet, 1);
-            std::cout<<"【获得：负重护腕 x1】\n";
+            state_.player.gainItem(weight_bracelet, 1);
+            console()<<"【获得：负重护腕 x1】\n";
             
             // 标记已给过奖励
             const_cast<NPC*>(npc)->setGivenReward(true);
         } else {
-            std::cout<<"【陆天宇】\"护腕已经给你了，要好好使用哦！\"\n";
+            console()<<"【陆天宇】\"护腕已经给你了，要好好使用哦！\"\n";
         }
     }
 }
 
 void Game::showOpeningStory() {
     // 清屏效果和游戏标题
-    std::cout << "\n" << std::string(60, '=') << "\n";
-    std::cout << "海大修仙秘：文心潭秘录\n";
-    std::cout << std::string(60, '=') << "\n\n";
+    console() << "\n" << std::string(60, '=') << "\n";
+    console() << "海大修仙秘：文心潭秘录\n";
+    console() << std::string(60, '=') << "\n\n";
 
     // 章节标题
-    std::cout << "第一章：缘起·古籍现世\n";
-    std::cout << "━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━\n\n";
+    console() << "第一章：缘起·古籍现世\n";
+    console() << "━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━\n\n";
 
     // 场景描述
-    std::cout << "场景：海大图书馆古籍区\n";
-    std::cout << "━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━\n\n";
+    console() << "场景：海大图书馆古籍区\n";
+    console() << "━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━\n\n";
 
     // 剧情描述
-    std::cout << "期末考试周，你为了准备《海洋文化概论》的论文，来到图书馆古籍区查找资料。\n\n";
+    console() << "期末考试周，你为了准备《海洋文化概论》的论文，来到图书馆古籍区查找资料。\n\n";
 
-    std::cout << "在书架角落，你意外发现一本蓝色封皮、线装订的古籍——《文心潭秘录》。\n\n";
+    console() << "在书架角落，你意外发现一本蓝色封皮、线装订的古籍——《文心潭秘录》。\n\n";
 
-    std::cout << "当你翻开书页时，书中突然散发出柔和的光芒，周围的景象开始扭曲变化……\n\n";
+    console() << "当你翻开书页时，书中突然散发出柔和的光芒，周围的景象开始扭曲变化……\n\n";
 
     // 交互提示
-    std::cout << "输入 '翻阅古籍' 继续...\n";
-    std::cout << "━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━\n";
-    
-    std::string input;
-    while(true) {
-        std::cout << "\n> ";
-        std::getline(std::cin, input);
+    console() << "输入 '翻阅古籍' 继续...\n";
+    console() << "━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━\n";
+    awaitOpeningKeyword();
+}
+
+// 等待玩家输入"翻阅古籍"继续剧情
+void Game::awaitOpeningKeyword() {
+    flow_.await("\n> ", [this](const std::string& input) {
         if(input == "翻阅古籍") {
-            break;
+            showOpeningChapter2();
         } else {
-            std::cout << "请输入 '翻阅古籍' 继续剧情。\n";
+            console() << "请输入 '翻阅古籍' 继续剧情。\n";
+            awaitOpeningKeyword();
         }
-    }
-    
+    });
+}
+
+// 开场剧情第二章
+void Game::showOpeningChapter2() {
     // 章节标题
-    std::cout << "第二章：初识·秘境指引\n";
-    std::cout << "━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━\n\n";
+    console() << "第二章：初识·秘境指引\n";
+    console() << "━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━\n\n";
 
     // 场景描述
-    std::cout << "场景：秘境图书馆\n";
-    std::cout << "━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━\n\n";
+    console() << "场景：秘境图书馆\n";
+    console() << "━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━\n\n";
 
     // 剧情描述
-    std::cout << "光芒散去，一位身着青衫的学姐出现，自称林清漪。\n";
-    std::cout << "她解释这里是文心秘境，学业压力具象化为心魔，必须修炼才能找到回归现实的方法。\n\n";
+    console() << "光芒散去，一位身着青衫的学姐出现，自称林清漪。\n";
+    console() << "她解释这里是文心秘境，学业压力具象化为心魔，必须修炼才能找到回归现实的方法。\n\n";
 
     // NPC对话
-    std::cout << "【林清漪】\"欢迎来到文心秘境，这里是学业与灵魂的投影。\"\n";
-    std::cout << "\"你需要自由探索五个区域，击败心魔收集修为，最终挑战文心潭。\"\n";
-    std::cout << "\"现在，让我为你准备一些装备吧。\"\n\n";
+    console() << "【林清漪】\"欢迎来到文心秘境，这里是学业与灵魂的投影。\"\n";
+    console() << "\"你需要自由探索五个区域，击败心魔收集修为，最终挑战文心潭。\"\n";
+    console() << "\"现在，让我为你准备一些装备吧。\"\n\n";
 
     // 交互提示
-    std::cout << "按回车键开始你的秘境之旅...\n";
-    std::cout << "━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━\n";
-    std::getline(std::cin, input);
-    
+    console() << "按回车键开始你的秘境之旅...\n";
+    console() << "━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━\n";
+    flow_.await("", [this](const std::string&) { showOpeningGuide(); });
+}
+
+// 新手引导
+void Game::showOpeningGuide() {
     // 新手引导
-    std::cout << "\n新手引导 - 文心秘境生存指南\n";
-    std::cout << "━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━\n\n";
-
-    std::cout << "基础操作：\n";
-    std::cout << "   • 输入 'look' 查看当前位置和可用操作\n";
-    std::cout << "   • 输入 'help' 查看所有可用指令\n";
-    std::cout << "   • 输入 'stats' 查看你的属性和等级\n";
-    std::cout << "   • 输入 'inv' 查看背包中的物品\n";
-    std::cout << "   • 输入 'task' 查看当前任务和目标\n\n";
-
-    std::cout << "移动系统：\n";
-    std::cout << "   • 使用 w/a/s/d 快速移动\n";
-    std::cout << "   • 或输入方向名称（如'东'、'西'、'南'、'北'）\n";
-    std::cout << "   • 输入 'map' 查看当前地图\n\n";
-
-    std::cout << "对话系统：\n";
-    std::cout << "   • 输入 'talk' 打开对话菜单\n";
-    std::cout << "   • 或直接输入 'talk <NPC名>' 与特定NPC对话\n";
-    std::cout << "   • 每个NPC都有独特的背景故事和任务\n\n";
-
-    std::cout << "⚔️ 战斗系统：\n";
-    std::cout << "   • 输入 'fight' 打开战斗菜单\n";
-    std::cout << "   • 或直接输入 'fight <敌人名>' 挑战特定敌人\n";
-    std::cout << "   • 击败敌人获得经验值、金币和装备\n\n";
-
-    std::cout << "游戏目标：\n";
-    std::cout << "   • 完成三个试炼：智力、毅力、表达\n";
-    std::cout << "   • 提升等级至9级以上\n";
-    std::cout << "   • 收集硕士品质装备\n";
-    std::cout << "   • 挑战文心潭最终试炼\n";
-    std::cout << "   • 集齐三把文心秘钥揭开真相\n\n";
-
-    std::cout << "重要提示：\n";
-    std::cout << "   • 与林清漪对话了解游戏背景和获得新手装备\n";
-    std::cout << "   • 在钱道然那里购买生命药水和复活符\n";
-    std::cout << "   • 完成苏小萌和陆天宇的任务获得特殊装备\n";
-    std::cout << "   • 输入 'help' 可随时查看指令帮助\n";
-    std::cout << "   • 死亡有惩罚，建议购买复活符\n\n";
-
-    std::cout << "开始你的秘境之旅吧！\n";
-    std::cout << std::string(60, '=') << "\n\n";
+    console() << "\n新手引导 - 文心秘境生存指南\n";
+    console() << "━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━\n\n";
+
+    console() << "基础操作：\n";
+    console() << "   • 输入 'look' 查看当前位置和可用操作\n";
+    console() << "   • 输入 'help' 查看所有可用指令\n";
+    console() << "   • 输入 'stats' 查看你的属性和等级\n";
+    console() << "   • 输入 'inv' 查看背包中的物品\n";
+    console() << "   • 输入 'task' 查看当前任务和目标\n\n";
+
+    console() << "移动系统：\n";
+    console() << "   • 使用 w/a/s/d 快速移动\n";
+    console() << "   • 或输入方向名称（如'东'、'西'、'南'、'北'）\n";
+    console() << "   • 输入 'map' 查看当前地图\n\n";
+
+    console() << "对话系统：\n";
+    console() << "   • 输入 'talk' 打开对话菜单\n";
+    console() << "   • 或直接输入 'talk <NPC名>' 与特定NPC对话\n";
+    console() << "   • 每个NPC都有独特的背景故事和任务\n\n";
+
+    console() << "⚔️ 战斗系统：\n";
+    console() << "   • 输入 'fight' 打开战斗菜单\n";
+    console() << "   • 或直接输入 'fight <敌人名>' 挑战特定敌人\n";
+    console() << "   • 击败敌人获得经验值、金币和装备\n\n";
+
+    console() << "游戏目标：\n";
+    console() << "   • 完成三个试炼：智力、毅力、表达\n";
+    console() << "   • 提升等级至9级以上\n";
+    console() << "   • 收集硕士品质装备\n";
+    console() << "   • 挑战文心潭最终试炼\n";
+    console() << "   • 集齐三把文心秘钥揭开真相\n\n";
+
+    console() << "重要提示：\n";
+    console() << "   • 与林清漪对话了解游戏背景和获得新手装备\n";
+    console() << "   • 在钱道然那里购买生命药水和复活符\n";
+    console() << "   • 完成苏小萌和陆天宇的任务获得特殊装备\n";
+    console() << "   • 输入 'help' 可随时查看指令帮助\n";
+    console() << "   • 死亡有惩罚，建议购买复活符\n\n";
+
+    console() << "开始你的秘境之旅吧！\n";
+    console() << std::string(60, '=') << "\n\n";
     
     // 自动进入游戏主循环
     look();
 }
 
-void Game::printCombatSummary(const Enemy& enemy, int old_xp, int old_coins, int old_level) {
-    std::cout << "\n" << std::string(40, '=') << "\n";
-    std::cout << "⚔️ 战斗小结\n";
-    std::cout << std::string(40, '=') << "\n";
+void Game::printCombatSummary(int old_level) {
+    console() << "\n" << std::string(40, '=') << "\n";
+    console() << "⚔️ 战斗小结\n";
+    console() << std::string(40, '=') << "\n";
     
     // 当前血量显示
-    std::cout << "❤️ 当前血量: " << state_.player.attr().hp << "/" << state_.player.attr().max_hp << "\n";
+    console() << "❤️ 当前血量: " << state_.player.attr().hp << "/" << state_.player.attr().max_hp << "\n";
     
     // 经验值和升级进度
-    std::cout << "📈 经验值: " << state_.player.xp() << " (还需 " << state_.player.getXPNeededForNextLevel() << " 升级)\n";
+    console() << "📈 经验值: " << state_.player.xp() << " (还需 " << state_.player.getXPNeededForNextLevel() << " 升级)\n";
     
     // 等级变化
     if (state_.player.level() > old_level) {
-        std::cout << "⭐ 等级提升: " << old_level << " → " << state_.player.level() << "\n";
+        console() << "⭐ 等级提升: " << old_level << " → " << state_.player.level() << "\n";
     }
     
     // 任务进度
-    std::cout << "📋 任务进度: ";
+    console() << "📋 任务进度: ";
     bool has_task_progress = false;
     if (state_.task_manager.hasActiveTask("S2_动力碎片")) {
         int qty = state_.player.inventory().quantity("power_fragment");
-        std::cout << "动力碎片 " << qty << "/3";
+        console() << "动力碎片 " << qty << "/3";
         has_task_progress = true;
     }
     if (state_.task_manager.hasActiveTask("S3_实验失败妖")) {
-        if (has_task_progress) std::cout << ", ";
-        std::cout << "实验失败妖 " << state_.failed_experiment_kill_count << "/11";
+        if (has_task_progress) console() << ", ";
+        console() << "实验失败妖 " << state_.failed_experiment_kill_count << "/11";
         has_task_progress = true;
     }
-    if (!has_task_progress) std::cout << "无活跃任务";
-    std::cout << "\n";
+    if (!has_task_progress) console() << "无活跃任务";
+    console() << "\n";
     
     
-    std::cout << std::string(40, '=') << "\n\n";
+    console() << std::string(40, '=') << "\n\n";
 }
 
-void Game::handleCombatVictory(const Enemy& enemy, int old_xp, int old_coins, int old_level) {
+void Game::handleCombatVictory(const Enemy& enemy, int old_level) {
     // 战斗结束后清除所有负面状态
     state_.player.attr().removeStatus(StatusEffect::TENSION);
     state_.player.attr().removeStatus(StatusEffect::SLOW);
-    std::cout << "【状态清除】战斗结束，所有负面状态已清除。\n";
+    console() << "【状态清除】战斗结束，所有负面状态已清除。\n";
     
     // 计算经验值惩罚
     int exp_penalty = calculateExperiencePenalty(enemy);
@@ -693,173 +786,54 @@ void Game::handleCombatVictory(const Enemy& enemy, int old_xp, int old_coins, in
     // 战斗胜利奖励（应用经验值惩罚）
     state_.player.addXP(actual_xp);
     state_.player.addCoins(enemy.coinReward());
-    std::cout<<"获得经验值"<<actual_xp<<"，金币"<<enemy.coinReward()<<"。\n";
+    console()<<"获得经验值"<<actual_xp<<"，金币"<<enemy.coinReward()<<"。\n";
     
-    // 增加回合计数器
-    state_.turn_counter++;
+    // 战斗胜利推进一个世界回合
+    state_.scheduler.advance();
     
     // 显示经验值奖励/惩罚信息
     if (exp_penalty > 100) {
-        std::cout << "【越级奖励】由于挑战高等级怪物，获得经验值增加至 " << exp_penalty << "%\n";
+        console() << "【越级奖励】由于挑战高等级怪物，获得经验值增加至 " << exp_penalty << "%\n";
     } else if (exp_penalty < 100) {
-        std::cout << "【等级惩罚】由于挑战低等级怪物，获得经验值减少至 " << exp_penalty << "%\n";
+        console() << "【等级惩罚】由于挑战低等级怪物，获得经验值减少至 " << exp_penalty << "%\n";
     }
     
     // 怪物被击败，更新刷新状态
     onMonsterDefeated(state_.current_loc, enemy.name());
     
-    // 处理掉落物品
-    processEnemyDrops(enemy);
-    
-    // 打印战斗小结
-    printCombatSummary(enemy, old_xp, old_coins, old_level);
-    
-    // 若有S2任务，实时更新进度
-    if (state_.task_manager.hasActiveTask("S2_动力碎片")) {
-        int qty = state_.player.inventory().quantity("power_fragment");
-        if (auto* tk = state_.task_manager.getTask("S2_动力碎片")) {
-            tk->setObjective(0, std::string("收集动力碎片：") + std::to_string(qty) + "/3");
-            std::cout<<"【任务进度】动力碎片："<<qty<<"/3\n";
-        }
-    }
-
-    // 如果在文心潭并击败三战之一，标记钥匙
-    if (state_.current_loc == "wenxintan") {
-        onWenxinBossDefeated(state_, enemy.name());
-        // 集齐三把钥匙后一次性通关奖励和第四章触发
-        if (!state_.truth_reward_given && state_.key_i_obtained && state_.key_ii_obtained && state_.key_iii_obtained) {
-            state_.player.addXP(300);
-            state_.player.addCoins(200);
-            state_.truth_reward_given = true;
-
-            // 延迟一下，让玩家看到奖励信息
-            std::cout<<"【通关奖励】获得大量经验300与金币200！\n";
-            std::cout<<"【称号】获得称号：荣誉博士！\n";
-            std::cout<<"恭喜通关！！\n\n";
-
-            // 自动触发第四章
-            triggerChapter4Transition();
-        }
-    }
-
-    // S3任务进度：若为实验失败妖，更新任务与进度显示
-    if (enemy.name().find("实验失败妖") != std::string::npos) {
-        // 更新新任务系统的进度
-        if (auto* tk = state_.task_manager.getTask("side_lab_challenge")) {
-            if (tk->getStatus() == TaskStatus::IN_PROGRESS) {
-                // 更新任务目标：击败实验失败妖
-                tk->setObjective(2, "击败实验失败妖 ✓");
-            }
-        }
-        std::cout << "【任务进度】实验失败妖：击败 " << state_.failed_experiment_kill_count << "/11，ATK " << state_.player.attr().getEffectiveATK() << "（需≥30）\n";
-    }
-
-    // 首次击败高数难题精奖励：给予启智笔
-    if (enemy.name().find("高数难题精") != std::string::npos && !state_.math_difficulty_spirit_first_kill) {
-        state_.math_difficulty_spirit_first_kill = true;
-        Item wisdom_pen = Item::createEquipment("wisdom_pen", "启智笔", 
-            "智力试炼的奖励，能提升思维敏捷度。", 
-            EquipmentType::WEAPON, EquipmentSlot::WEAPON, 6, 0, 0, 0, 120);
-        wisdom_pen.quality = EquipmentQuality::MASTER;
-        wisdom_pen.effect_type = "damage_multiplier";
-        wisdom_pen.effect_target = "difficult_problem";
-        wisdom_pen.effect_value = 1.15f;
-        wisdom_pen.effect_description = "对难题类敌人额外造成15%伤害";
-        state_.player.inventory().add(wisdom_pen, 1);
-        std::cout << "【智力试炼完成】首次击败高数难题精！获得启智笔×1！\n";
-        std::cout << "【装备效果】启智笔：ATK+6，对难题类敌人额外造成15%伤害\n";
-    }
-
-    // S3奖励判定：击败实验失败妖>10且ATK≥30且未发放
-    if (!state_.s3_reward_given && state_.failed_experiment_kill_count>10 && state_.player.attr().getEffectiveATK()>=30) {
-        state_.s3_reward_given = true;
-        Item goggles = Item::createEquipment("goggles","护目镜","视野更清晰，行动更敏捷。",EquipmentType::ACCESSORY,EquipmentSlot::ACCESSORY2,0,0,6,0,0);
-        state_.player.inventory().add(goggles,1);
-        state_.player.addNPCFavor("林清漪",20);
-        std::cout<<"【S3完成】长期与实验失败妖交手让你收获良多。获得护目镜×1。林清漪好感+20。\n";
-        
-        // 完成新任务系统的任务
-        if (auto* tk = state_.task_manager.getTask("side_lab_challenge")) {
-            tk->setObjective(3, "获得实验服 ✓");
-            state_.task_manager.completeTask("side_lab_challenge");
-        }
-    }
-
-    // S4奖励判定入口：树下空间Boss击败后，如持启智笔，触发答题
-    if (state_.current_loc == "tree_space" && !state_.s4_reward_given && (enemy.name()=="答辩紧张魔" || enemy.name()=="答辩紧张魔·强化")) {
-        // 更新新任务系统的进度
-        if (auto* tk = state_.task_manager.getTask("side_debate_challenge")) {
-            if (tk->getStatus() == TaskStatus::IN_PROGRESS) {
-                tk->setObjective(1, "击败答辩紧张魔 ✓");
-            }
-        }
-        
-        bool has_wisdom_pen=false; auto inv = state_.player.inventory().asSimpleItems();
-        for (auto &it: inv) if (it.id=="wisdom_pen" && it.count>0) { has_wisdom_pen=true; break; }
-        if (has_wisdom_pen) {
-            int correct=0; std::string a;
-            std::cout<<"【对话挑战】请回答以下问题（3题，答对≥2通过）：\n";
-            std::cout<<"1. 演讲时缓解紧张的有效方式是？\n A) 大声喝止对方\n B) 深呼吸并放慢语速\n C) 避免目光接触\n> ";
-            std::getline(std::cin,a); if(a=="B"||a=="b") correct++;
-            std::cout<<"2. 回答问题时最重要的是？\n A) 语速越快越好\n B) 逻辑清晰、层次分明\n C) 使用大量术语\n> ";
-            std::getline(std::cin,a); if(a=="B"||a=="b") correct++;
-            std::cout<<"3. 面对质疑，正确做法是？\n A) 反驳并否定\n B) 情绪化回应\n C) 接纳问题、给出证据与解释\n> ";
-            std::getline(std::cin,a); if(a=="C"||a=="c") correct++;
-            if (correct>=2) {
-                state_.s4_reward_given = true;
-                Item fan = Item::createEquipment("debate_fan","辩锋羽扇","锋芒毕露，言辞更有力。",EquipmentType::WEAPON,EquipmentSlot::WEAPON,15,0,6,0,350);
-                fan.quality = EquipmentQuality::DOCTOR;
-                fan.effect_type = "damage_multiplier";
-                fan.effect_target = "答辩紧张魔·强化";
-                fan.effect_value = 1.3f;
-                fan.effect_description = "对答辩紧张魔·强化造成1.3倍伤害";
-                state_.player.inventory().add(fan,1);
-                state_.player.addNPCFavor("林清漪",20);
-                std::cout<<"【S4完成】你顺利通过对话挑战，获得辩锋羽扇×1。林清漪好感+20。\n";
-                
-                // 完成新任务系统的任务
-                if (auto* tk = state_.task_manager.getTask("side_debate_challenge")) {
-                    tk->setObjective(2, "回答3个问题 ✓");
-                    tk->setObjective(3, "答对2题以上 ✓");
-                    tk->setObjective(4, "获得辩峰羽扇 ✓");
-                    state_.task_manager.completeTask("side_debate_challenge");
-                }
-            } else {
-                std::cout<<"很遗憾，本次挑战未通过，可稍后再试。\n";
-            }
-        }
-    }
+    // 击败事件：掉落、战斗小结、钥匙、支线进度与奖励等反应由registerEventListeners中订阅的监听器处理
+    state_.events.publish(MonsterDefeatedEvent{enemy, state_.current_loc, old_level});
     
     // 战斗结束后显示当前位置信息（第四章之后不显示）
     if (!state_.chapter4_shown) {
-        std::cout << "\n" << std::string(50, '=') << "\n";
-        std::cout << "📍 当前位置信息\n";
-        std::cout << std::string(50, '=') << "\n";
+        console() << "\n" << std::string(50, '=') << "\n";
+        console() << "📍 当前位置信息\n";
+        console() << std::string(50, '=') << "\n";
         
         // 显示当前位置基本信息
         auto* loc = state_.map.get(state_.current_loc);
         if (loc) {
-            std::cout << "📍 位置: " << loc->name << "\n";
-            std::cout << "📝 描述: " << loc->desc << "\n";
+            console() << "📍 位置: " << loc->name << "\n";
+            console() << "📝 描述: " << loc->desc << "\n";
             
             // 显示可前往的地点
             if (!loc->exits.empty()) {
-                std::cout << "🚪 可前往: ";
+                console() << "🚪 可前往: ";
                 for (size_t i = 0; i < loc->exits.size(); ++i) {
-                    if (i > 0) std::cout << ", ";
-                    std::cout << loc->exits[i].label;
+                    if (i > 0) console() << ", ";
+                    console() << loc->exits[i].label;
                 }
-                std::cout << "\n";
+                console() << "\n";
             }
             
             // 显示NPC
             if (!loc->npcs.empty()) {
-                std::cout << "👥 NPC: ";
+                console() << "👥 NPC: ";
                 for (size_t i = 0; i < loc->npcs.size(); ++i) {
-                    if (i > 0) std::cout << ", ";
-                    std::cout << loc->npcs[i].name();
+                    if (i > 0) console() << ", ";
+                    console() << loc->npcs[i].name();
                 }
-                std::cout << "\n";
+                console() << "\n";
             }
             
             // 显示怪物状态 - 基于monster_spawns系统
@@ -867,7 +841,7 @@ void Game::handleCombatVictory(const Enemy& enemy, int old_xp, int old_coins, in
             for (const auto& spawn : state_.monster_spawns) {
                 if (spawn.location_id == state_.current_loc) {
                     if (!has_monsters) {
-                        std::cout << "👹 怪物状态:\n";
+                        console() << "👹 怪物状态:\n";
                         has_monsters = true;
                     }
                     
@@ -908,121 +882,121 @@ void Game::handleCombatVictory(const Enemy& enemy, int old_xp, int old_coins, in
                         difficulty_hint = " (极危)";
                     }
                     
-                    std::cout << "   • Lv" << monster_level << " " << spawn.monster_name << difficulty_hint;
+                    console() << "   • Lv" << monster_level << " " << spawn.monster_name << difficulty_hint;
                     
-                    if (spawn.turns_until_respawn > 0) {
-                        std::cout << " (刷新中，还需 " << spawn.turns_until_respawn << " 回合)";
+                    if (spawn.respawn_turn != 0) {
+                        console() << " (刷新中，还需 " << state_.turnsUntilRespawn(spawn) << " 回合)";
                     } else if (remaining_challenges > 0) {
-                        std::cout << " (剩余 " << remaining_challenges << " 次挑战)";
+                        console() << " (剩余 " << remaining_challenges << " 次挑战)";
                     } else {
-                        std::cout << " (暂时不可挑战，需等待刷新)";
+                        console() << " (暂时不可挑战，需等待刷新)";
                     }
-                    std::cout << "\n";
+                    console() << "\n";
                 }
             }
             
             if (!has_monsters) {
-                std::cout << "👹 怪物: 无\n";
-            }
-            
-            // 显示商店刷新信息（在顶部位置信息区域）
-            if (state_.shop_system.shouldRefresh(state_.turn_counter)) {
-                std::cout << "\033[34m【商店刷新】钱道然的商店更新了新的货物！\033[0m\n";
+                console() << "👹 怪物: 无\n";
             }
         }
         
-        std::cout << std::string(50, '=') << "\n";
+        console() << std::string(50, '=') << "\n";
     }
 }
 
 void Game::showContextualHelp() {
-    std::cout << "\n" << std::string(60, '=') << "\n";
-    std::cout << "📖 文心秘境指令帮助\n";
-    std::cout << std::string(60, '=') << "\n\n";
+    console() << "\n" << std::string(60, '=') << "\n";
+    console() << "📖 文心秘境指令帮助\n";
+    console() << std::string(60, '=') << "\n\n";
     
     // 基础指令
-    std::cout << "🔹 基础操作：\n";
-    std::cout << "  look - 查看当前位置和可用操作\n";
-    std::cout << "  stats - 查看角色属性和等级\n";
-    std::cout << "  inv - 查看背包中的物品\n";
-    std::cout << "  task - 查看当前任务和目标\n";
-    std::cout << "  map - 查看当前地图\n";
-    std::cout << "  help - 显示此帮助信息\n\n";
+    console() << "🔹 基础操作：\n";
+    console() << "  look - 查看当前位置和可用操作\n";
+    console() << "  stats - 查看角色属性和等级\n";
+    console() << "  inv - 查看背包中的物品\n";
+    console() << "  task - 查看当前任务和目标\n";
+    console() << "  map - 查看当前地图\n";
+    console() << "  help - 显示此帮助信息\n\n";
     
     // 移动指令
-    std::cout << "🔹 移动系统：\n";
-    std::cout << "  w/a/s/d - 快速方向移动（北/西/南/东）\n";
-    std::cout << "  enter - 进入教学区详细地图（仅在教学区有效）\n";
-    std::cout << "  exit - 退出教学区详细地图（仅在九珠坛有效）\n\n";
+    console() << "🔹 移动系统：\n";
+    console() << "  w/a/s/d - 快速方向移动（北/西/南/东）\n";
+    console() << "  enter - 进入教学区详细地图（仅在教学区有效）\n";
+    console() << "  exit - 退出教学区详细地图（仅在九珠坛有效）\n";
+    console() << "  goto/前往 <地点名> - 自动寻路走到目的地\n";
+    console() << "  down/下楼、up/上楼 - 在文心潭进入无尽秘境，在秘境的阶梯间上下\n\n";
     
     // 交互指令
-    std::cout << "🔹 交互系统：\n";
-    std::cout << "  talk/对话 - 打开对话菜单（列出本地NPC，支持数字选择）\n";
-    std::cout << "  fight/战斗 - 打开战斗菜单（列出本地敌人，支持数字选择）\n";
-    std::cout << "  monsters/怪物信息 - 查看怪物刷新信息\n\n";
+    console() << "🔹 交互系统：\n";
+    console() << "  talk/对话 - 打开对话菜单（列出本地NPC，支持数字选择）\n";
+    console() << "  fight/战斗 - 打开战斗菜单（列出本地敌人，支持数字选择）\n";
+    console() << "  monsters/怪物信息 - 查看怪物刷新信息\n\n";
     
     // 装备指令
-    std::cout << "🔹 装备系统：\n";
-    std::cout << "  equip/装备 - 打开装备菜单（列出可装备物品，支持数字选择）\n";
-    std::cout << "  unequip/卸下 - 打开卸装菜单（列出已装备物品，支持数字选择）\n";
-    std::cout << "  use <物品名> - 使用消耗品（如生命药水）\n\n";
+    console() << "🔹 装备系统：\n";
+    console() << "  equip/装备 - 打开装备菜单（列出可装备物品，支持数字选择）\n";
+    console() << "  unequip/卸下 - 打开卸装菜单（列出已装备物品，支持数字选择）\n";
+    console() << "  use <物品名> - 使用消耗品（如生命药水）\n\n";
     
     // 商店指令
-    std::cout << "🔹 商店系统：\n";
-    std::cout << "  sell - 出售装备（10金币/件）\n\n";
+    console() << "🔹 商店系统：\n";
+    console() << "  sell - 出售装备（10金币/件）\n\n";
     
     // 属性分配
     if (state_.player.attr().available_points > 0) {
-        std::cout << "🔹 属性分配：\n";
-        std::cout << "  allocate <属性> [数量] - 分配属性点\n";
-        std::cout << "  可用属性：hp(生命), atk(攻击), def(防御), spd(速度)\n";
-        std::cout << "  示例：allocate atk 3 或 allocate hp 2\n\n";
+        console() << "🔹 属性分配：\n";
+        console() << "  allocate <属性> [数量] - 分配属性点\n";
+        console() << "  可用属性：hp(生命), atk(攻击), def(防御), spd(速度)\n";
+        console() << "  示例：allocate atk 3 或 allocate hp 2\n\n";
     }
     
     // 系统指令
-    std::cout << "🔹 系统指令：\n";
-    std::cout << "  save - 保存游戏进度\n";
-    std::cout << "  load - 加载游戏进度\n";
-    std::cout << "  quit/q - 退出游戏\n\n";
+    console() << "🔹 系统指令：\n";
+    console() << "  save - 保存游戏进度\n";
+    console() << "  load - 加载游戏进度\n";
+    console() << "  quit/q - 退出游戏\n";
+    console() << "  指令1; 指令2; ... - 一行执行多条指令（例：w; w; fight 1）\n";
+    console() << "  quiet 指令1; 指令2 - 同上，只显示最后一条指令的结果\n\n";
     
     // 装备品质说明
-    std::cout << "🔹 装备品质：\n";
-    std::cout << "  \x1b[32m本科\x1b[0m - 基础装备，适合新手(ง •_•)ง\n";
-    std::cout << "  \x1b[34m硕士\x1b[0m - 高级装备，需要一定实力获得(๑•̀ㅂ•́)و✧\n";
-    std::cout << "  \x1b[31m博士\x1b[0m - 顶级装备，只有强者才能驾驭，或者有钱b（￣▽￣）d　\n";
-    std::cout << "  \x1b[33m饰品\x1b[0m - 特殊装备，提供独特效果，显示为黄色文字(★ω★)\n\n";
+    console() << "🔹 装备品质：\n";
+    console() << "  \x1b[32m本科\x1b[0m - 基础装备，适合新手(ง •_•)ง\n";
+    console() << "  \x1b[34m硕士\x1b[0m - 高级装备，需要一定实力获得(๑•̀ㅂ•́)و✧\n";
+    console() << "  \x1b[31m博士\x1b[0m - 顶级装备，只有强者才能驾驭，或者有钱b（￣▽￣）d　\n";
+    console() << "  \x1b[33m饰品\x1b[0m - 特殊装备，提供独特效果，显示为黄色文字(★ω★)\n\n";
     
     // 特殊帮助
-    std::cout << "🔹 特殊帮助：\n";
-    std::cout << "  help combat - 查看战斗系统帮助\n";
-    std::cout << "  help shop - 查看商店系统帮助\n";
-    std::cout << "  help task - 查看任务系统帮助\n\n";
+    console() << "🔹 特殊帮助：\n";
+    console() << "  help combat - 查看战斗系统帮助\n";
+    console() << "  help shop - 查看商店系统帮助\n";
+    console() << "  help task - 查看任务系统帮助\n\n";
     
     // 当前进度提示
-    std::cout << "🔹 当前进度：\n";
+    console() << "🔹 当前进度：\n";
     if (state_.player.level() < 5) {
-        std::cout << "  阶段：新手阶段\n";
-        std::cout << "  目标：与林清漪对话获得新手装备，完成苏小萌和陆天宇的任务\n";
-        std::cout << "  建议：在体育馆击败迷糊书虫和拖延小妖练级\n";
+        console() << "  阶段：新手阶段\n";
+        console() << "  目标：与林清漪对话获得新手装备，完成苏小萌和陆天宇的任务\n";
+        console() << "  建议：在体育馆击败迷糊书虫和拖延小妖练级\n";
     } else if (state_.player.level() < 9) {
-        std::cout << "  阶段：进阶阶段\n";
-        std::cout << "  目标：提升等级至9级，收集硕士品质装备\n";
-        std::cout << "  建议：进入教学区详细地图，完成智力试炼\n";
+        console() << "  阶段：进阶阶段\n";
+        console() << "  目标：提升等级至9级，收集硕士品质装备\n";
+        console() << "  建议：进入教学区详细地图，完成智力试炼\n";
     } else if (!state_.key_i_obtained || !state_.key_ii_obtained || !state_.key_iii_obtained) {
-        std::cout << "  阶段：高级阶段\n";
-        std::cout << "  目标：前往文心潭，集齐三把秘钥\n";
-        std::cout << "  提示：文心潭需要等级≥9且至少两件硕士品质装备\n";
+        console() << "  阶段：高级阶段\n";
+        console() << "  目标：前往文心潭，集齐三把秘钥\n";
+        console() << "  提示：文心潭需要等级≥9且至少两件硕士品质装备\n";
     } else {
-        std::cout << "  阶段：最终阶段\n";
-        std::cout << "  目标：输入 'ending' 查看结局\n";
-        std::cout << "  恭喜：已完成所有试炼，可以查看结局了！\n";
+        console() << "  阶段：最终阶段\n";
+        console() << "  目标：输入 'ending' 查看结局\n";
+        console() << "  恭喜：已完成所有试炼，可以查看结局了！\n";
     }
     
-    std::cout << "\n" << std::string(60, '=') << "\n";
+    console() << "\n" << std::string(60, '=') << "\n";
 }
 
 void Game::processEnemyDrops(const Enemy& enemy) {
-    auto roll = [](){ return (std::rand() % 100) + 1; };
+    HX_TRACE_SPAN("drops");
+    auto roll = [this](){ return static_cast<int>(rng_() % 100) + 1; };
     
     // 教学区子地图专用掉落系统
     if (state_.in_teaching_detail) {
@@ -1038,7 +1012,7 @@ void Game::processEnemyDrops(const Enemy& enemy) {
             // 随机选择武器或护甲
             if (roll() <= 50) {
                 // 选择武器
-                std::string equip_id = undergrad_weapons[std::rand() % undergrad_weapons.size()];
+                std::string equip_id = undergrad_weapons[rng_() % undergrad_weapons.size()];
                 Item equip;
                 if (equip_id == "wu_jing_ball") {
                     equip = ItemDefinitions::createWuJingBall();
@@ -1047,11 +1021,11 @@ void Game::processEnemyDrops(const Enemy& enemy) {
                         EquipmentType::WEAPON, EquipmentSlot::WEAPON, 0, 0, 0, 0, 0);
                     equip.quality = EquipmentQuality::UNDERGRAD;
                 }
-                state_.player.inventory().add(equip, 1);
-                std::cout << "【掉落】获得 " << getColoredItemName(equip) << "！\n";
+                state_.player.gainItem(equip, 1);
+                console() << "【掉落】获得 " << getColoredItemName(equip) << "！\n";
             } else {
                 // 选择护甲
-                std::string equip_id = undergrad_armor[std::rand() % undergrad_armor.size()];
+                std::string equip_id = undergrad_armor[rng_() % undergrad_armor.size()];
                 Item equip;
                 if (equip_id == "bed_quilt") {
                     equip = ItemDefinitions::createBedQuilt();
@@ -1064,8 +1038,8 @@ void Game::processEnemyDrops(const Enemy& enemy) {
                         EquipmentType::ARMOR, EquipmentSlot::ARMOR, 0, 0, 0, 0, 0);
                     equip.quality = EquipmentQuality::UNDERGRAD;
                 }
-                state_.player.inventory().add(equip, 1);
-                std::cout << "【掉落】获得 " << getColoredItemName(equip) << "！\n";
+                state_.player.gainItem(equip, 1);
+                console() << "【掉落】获得 " << getColoredItemName(equip) << "！\n";
             }
         }
         // 第二类：硕士级装备（掉落概率15%，累积40%）
@@ -1077,7 +1051,7 @@ void Game::processEnemyDrops(const Enemy& enemy) {
             
             if (roll() <= 50) {
                 // 选择武器
-                std::string equip_id = master_weapons[std::rand() % master_weapons.size()];
+                std::string equip_id = master_weapons[rng_() % master_weapons.size()];
                 Item equip;
                 if (equip_id == "wisdom_pen") {
                     equip = ItemDefinitions::createWisdomPen();
@@ -1088,11 +1062,11 @@ void Game::processEnemyDrops(const Enemy& enemy) {
                         EquipmentType::WEAPON, EquipmentSlot::WEAPON, 0, 0, 0, 0, 0);
                     equip.quality = EquipmentQuality::MASTER;
                 }
-                state_.player.inventory().add(equip, 1);
-                std::cout << "【掉落】获得 " << getColoredItemName(equip) << "！\n";
+                state_.player.gainItem(equip, 1);
+                console() << "【掉落】获得 " << getColoredItemName(equip) << "！\n";
             } else {
                 // 选择护甲
-                std::string equip_id = master_armor[std::rand() % master_armor.size()];
+                std::string equip_id = master_armor[rng_() % master_armor.size()];
                 Item equip;
                 if (equip_id == "bachelor_robe") {
                     equip = ItemDefinitions::createBachelorRobe();
@@ -1103,8 +1077,8 @@ void Game::processEnemyDrops(const Enemy& enemy) {
                         EquipmentType::ARMOR, EquipmentSlot::ARMOR, 0, 0, 0, 0, 0);
                     equip.quality = EquipmentQuality::MASTER;
                 }
-                state_.player.inventory().add(equip, 1);
-                std::cout << "【掉落】获得 " << getColoredItemName(equip) << "！\n";
+                state_.player.gainItem(equip, 1);
+                console() << "【掉落】获得 " << getColoredItemName(equip) << "！\n";
             }
         }
         // 第三类：博士级装备（掉落概率8%，累积48%）
@@ -1116,7 +1090,7 @@ void Game::processEnemyDrops(const Enemy& enemy) {
             
             if (roll() <= 50) {
                 // 选择武器
-                std::string equip_id = doctor_weapons[std::rand() % doctor_weapons.size()];
+                std::string equip_id = doctor_weapons[rng_() % doctor_weapons.size()];
                 Item equip;
                 if (equip_id == "phd_thesis") {
                     equip = ItemDefinitions::createPhdThesis();
@@ -1125,11 +1099,11 @@ void Game::processEnemyDrops(const Enemy& enemy) {
                         EquipmentType::WEAPON, EquipmentSlot::WEAPON, 0, 0, 0, 0, 0);
                     equip.quality = EquipmentQuality::DOCTOR;
                 }
-                state_.player.inventory().add(equip, 1);
-                std::cout << "【掉落】获得 " << getColoredItemName(equip) << "！\n";
+                state_.player.gainItem(equip, 1);
+                console() << "【掉落】获得 " << getColoredItemName(equip) << "！\n";
             } else {
                 // 选择护甲
-                std::string equip_id = doctor_armor[std::rand() % doctor_armor.size()];
+                std::string equip_id = doctor_armor[rng_() % doctor_armor.size()];
                 Item equip;
                 if (equip_id == "lab_coat") {
                     equip = ItemDefinitions::createLabCoat();
@@ -1142,8 +1116,8 @@ void Game::processEnemyDrops(const Enemy& enemy) {
                         EquipmentType::ARMOR, EquipmentSlot::ARMOR, 0, 0, 0, 0, 0);
                     equip.quality = EquipmentQuality::DOCTOR;
                 }
-                state_.player.inventory().add(equip, 1);
-                std::cout << "【掉落】获得 " << getColoredItemName(equip) << "！\n";
+                state_.player.gainItem(equip, 1);
+                console() << "【掉落】获得 " << getColoredItemName(equip) << "！\n";
             }
         }
         // 第四类：饰品类装备（掉落概率10%，累积58%）
@@ -1157,7 +1131,7 @@ void Game::processEnemyDrops(const Enemy& enemy) {
                 "ecard_amulet",          // 【海大e卡通】：商店购物享受10%折扣
                 "seat_all_lib_amulet"    // 【全图书馆占座物品】：SPD +5，首回合必定先攻
             };
-            std::string acc_id = accessories[std::rand() % accessories.size()];
+            std::string acc_id = accessories[rng_() % accessories.size()];
             
             // 饰品可以装备到任意槽位，让装备系统自动选择
             Item accessory;
@@ -1177,8 +1151,8 @@ void Game::processEnemyDrops(const Enemy& enemy) {
                 accessory = Item::createEquipment(acc_id, "未知饰品", "教学区掉落的饰品", 
                     EquipmentType::ACCESSORY, EquipmentSlot::ACCESSORY1, 0, 0, 0, 0, 0);
             }
-            state_.player.inventory().add(accessory, 1);
-            std::cout << "【掉落】获得 " << getColoredItemName(accessory) << "！\n";
+            state_.player.gainItem(accessory, 1);
+            console() << "【掉落】获得 " << getColoredItemName(accessory) << "！\n";
         }
         // 未触发任何一类时则无装备掉落
     }
@@ -1186,7 +1160,7 @@ void Game::processEnemyDrops(const Enemy& enemy) {
     // 无论是否在教学区详细地图，都处理普通掉落物品
     for (const auto& drop : enemy.getDropItems()) {
         if (roll() <= (int)(drop.drop_rate * 100)) {
-            int quantity = drop.min_quantity + (std::rand() % (drop.max_quantity - drop.min_quantity + 1));
+            int quantity = drop.min_quantity + static_cast<int>(rng_() % static_cast<unsigned>(drop.max_quantity - drop.min_quantity + 1));
             
             // 创建掉落物品
             Item drop_item;
@@ -1205,42 +1179,37 @@ void Game::processEnemyDrops(const Enemy& enemy) {
                 drop_item.type = ItemType::CONSUMABLE;
             }
             
-            state_.player.inventory().add(drop_item, quantity);
-            std::cout << "【掉落】获得 " << drop.item_name << " x" << quantity << "！\n";
+            console() << "【掉落】获得 " << drop.item_name << " x" << quantity << "！\n";
+            state_.player.gainItem(drop_item, quantity);
         }
     }
 }
 
-void Game::move(const std::string& label){ // label is the exit label exactly
+void Game::move(const std::string& label, bool render){ // label is the exit label exactly
     auto* loc = state_.map.get(state_.current_loc);
-    if(!loc){ std::cout<<"当前地点不存在。\n"; return; }
+    if(!loc){ console()<<"当前地点不存在。\n"; return; }
     const Exit* ex = nullptr;
     for(auto &e: loc->exits) if(e.label==label) ex=&e;
-    if(!ex){ std::cout<<"此方向无法直接通行（需要沿已有连接行走）。\n"; return; }
+    if(!ex){ console()<<"此方向无法直接通行（需要沿已有连接行走）。\n"; return; }
+    const std::string from = state_.current_loc;
     
-    // 清屏功能
-    #ifdef _WIN32
-        system("cls");
-    #else
-        system("clear");
-    #endif
+    // 清屏功能（自动寻路途中不清屏）
+    if (render) clearScreen();
     
     if(ex->to == "enter_teaching") {
         // 进入教学区详细地图
         state_.in_teaching_detail = true;
         state_.current_loc = "jiuzhutan"; // 初始位置在九珠坛
-        std::cout << "\n=== 进入教学区详细地图 ===\n";
-        look();
+        console() << "\n=== 进入教学区详细地图 ===\n";
     } else if (ex->to == "exit_teaching") {
         // 退出教学区，回到主地图
         state_.in_teaching_detail = false;
         state_.current_loc = "teaching_area"; // 回到教学区
-        std::cout << "\n=== 返回主地图 ===\n";
-        look();
-    } else if (ex->to == "wenxintan") {
-        // 进入文心潭前的条件判定
-        std::cout << "\n—— 文心潭进入条件判定 ——\n";
-        std::cout << "需要：Lv≥9 且 至少两件装备品质≥硕士\n";
+        console() << "\n=== 返回主地图 ===\n";
+    } else if (ex->to == "wenxintan" && Dungeon::floorOf(from) == 0) {
+        // 进入文心潭前的条件判定（从秘境上楼回来时不再判定，免得被困在秘境里）
+        console() << "\n—— 文心潭进入条件判定 ——\n";
+        console() << "需要：Lv≥9 且 至少两件装备品质≥硕士\n";
         int high_quality_count = 0;
         for (auto slot : state_.player.equipment().getOccupiedSlots()) {
             const Item* it = state_.player.equipment().getEquippedItem(slot);
@@ -1248,74 +1217,107 @@ void Game::move(const std::string& label){ // label is the exit label exactly
         }
         bool cond_level = state_.player.level() >= 9;
         bool cond_equip = high_quality_count >= 2;
-        std::cout << "当前Lv: " << state_.player.level() << (cond_level?" ✓":" ✗") << "\n";
-        std::cout << "高品质装备件数(≥硕士): " << high_quality_count << (cond_equip?" ✓":" ✗") << "\n";
+        console() << "当前Lv: " << state_.player.level() << (cond_level?" ✓":" ✗") << "\n";
+        console() << "高品质装备件数(≥硕士): " << high_quality_count << (cond_equip?" ✓":" ✗") << "\n";
         if (!cond_level || !cond_equip) {
-            std::cout << "未满足进入条件，无法进入文心潭。\n";
+            console() << "未满足进入条件，无法进入文心潭。\n";
             return;
         }
         state_.current_loc = ex->to;
-        std::cout << "\n=== 进入文心潭 ===\n";
-        if (!state_.wenxintan_intro_shown) {
-            state_.wenxintan_intro_shown = true;
-
-            // 章节标题
-            std::cout << "第三章：核心·文心潭试炼（终极考验）\n";
-            std::cout << "━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━\n\n";
-
-            // 场景描述
-            std::cout << "场景：文心潭\n";
-            std::cout << "━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━\n\n";
-
-            // 剧情描述
-            std::cout << "潭水如镜，轻波涟漪，倒映出你走过的每一段路。\n";
-            std::cout << "随着你靠近，水面上逐渐浮现出三道凝实的影子——它们是此处失衡的根源：\n\n";
-
-            // BOSS介绍
-            std::cout << "试炼之敌\n";
-            std::cout << "━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━\n";
-            std::cout << "① 文献综述怪：海量资料化作铠甲，阅读即护身，难以击破。\n";
-            std::cout << "② 实验失败妖·复苏：不断召唤失败的回声，以数量压垮意志。\n";
-            std::cout << "③ 答辩紧张魔·强化：言辞如刃，情绪波动使其愈战愈狂。\n\n";
-
-            // 任务目标
-            std::cout << "试炼目标\n";
-            std::cout << "━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━\n";
-            std::cout << "只有依次击败它们，集齐三把【文心秘钥】，才能让文心潭回归平衡。\n";
-            std::cout << "⚔️ 你握紧了手中的装备，深吸一口气，迈入最后的修行。\n\n";
-
-            // 成就提示
-            std::cout << "击败所有心魔后，将自动开启第四章！\n";
-            std::cout << "━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━\n";
-        }
-        look();
+        console() << "\n=== 进入文心潭 ===\n";
     } else {
+        // 秘境的层按需生成：走进还不在地图里的一层之前先把它放进地图（正在离开的一层不淘汰）
+        if (int floor = Dungeon::floorOf(ex->to)) {
+            state_.dungeon.enter(state_.map, floor, Dungeon::floorOf(from));
+            if (floor != Dungeon::floorOf(from)) {
+                console() << "\n=== 秘境第" << floor << "层 ===\n";
+            }
+        }
         state_.current_loc = ex->to;
-        // 更新怪物刷新状态
-        updateMonsterSpawns();
-        look();
+        // 移动推进一个世界回合（到期的怪物刷新等在此触发）
+        state_.scheduler.advance();
+    }
+    
+    // 进入事件：首次进入文心潭的章节介绍等由registerEventListeners中订阅的监听器处理
+    if (state_.current_loc != from) {
+        state_.events.publish(LocationEnteredEvent{from, state_.current_loc});
+    }
+    if (render) look();
+}
+
+// 自动寻路
+// 功能：目标按地点名（或地点ID）匹配，同名时优先取同一地图层里最近的；
+//       每一步查路由表走一个出口，和手动移动一样推进世界回合、触发到达事件，
+//       只是途中不清屏也不显示地点，最后在停下的地方显示一次。
+//       遇到进不去的地点（文心潭的进入条件）、途中开始了对话等交互时提前停下
+void Game::travelTo(std::string_view target) {
+    const Location* dest = state_.map.get(std::string(target));
+    if (!dest) {
+        if (location_names_revision_ != state_.map.revision()) buildLocationIndex();
+        std::vector<std::string> names;
+        for (const auto& kv : state_.map.locations()) names.push_back(kv.second.name);
+        std::string name = resolveName(location_names_, target, names);
+        // 同名的地点（秘境每层都有“秘境入口”“下行阶梯”）优先取所在地图层的，再取走过去最近的
+        const auto* here = state_.map.get(state_.current_loc);
+        auto rank = [this, here](const Location& loc) {
+            int steps = state_.map.routeLength(state_.current_loc, loc.id);
+            bool other_layer = !here || loc.layer != here->layer;
+            return std::make_pair(steps < 0 ? 2 : other_layer ? 1 : 0, steps);
+        };
+        for (const auto& kv : state_.map.locations()) {
+            if (name.empty() || kv.second.name != name) continue;
+            if (!dest || rank(kv.second) < rank(*dest)) dest = &kv.second;
+        }
+    }
+    if (!dest) {
+        console() << "没有找到地点：" << target << "\n";
+        return;
+    }
+    const std::string dest_id = dest->id;
+    const std::string dest_name = dest->name;
+    if (dest_id == state_.current_loc) {
+        console() << "你已经在" << dest_name << "了。\n";
+        return;
+    }
+    int steps = state_.map.routeLength(state_.current_loc, dest_id);
+    if (steps < 0) {
+        console() << "从这里走不到" << dest_name << "。\n";
+        return;
+    }
+
+    clearScreen();
+    console() << "🧭 自动寻路：前往 " << dest_name << "（" << steps << " 步）\n";
+    while (state_.current_loc != dest_id) {
+        const Exit* hop = state_.map.nextHop(state_.current_loc, dest_id);
+        if (!hop) break;
+        const std::string here = state_.current_loc;
+        move(hop->label, false);
+        if (state_.current_loc == here || flow_.waiting()) break; // 没走过去（原因move已经说明），或者到达事件开始了交互
+    }
+    if (flow_.waiting()) return;
+    if (state_.current_loc != dest_id) {
+        auto* loc = state_.map.get(state_.current_loc);
+        console() << "🧭 自动寻路在 " << (loc ? loc->name : state_.current_loc) << " 停下。\n";
     }
+    look();
 }
 
 void Game::talk(const std::string& npc_name) {
+    MetricTimer timer(Metric::TALK);
     auto* loc = state_.map.get(state_.current_loc);
     if(!loc) {
-        std::cout<<"未知地点。\n"; 
+        console()<<"未知地点。\n"; 
         return;
     }
     
     NPC* npc = const_cast<NPC*>(loc->findNPC(npc_name));
     if(!npc) {
-        std::cout<<"这里没有名为 "<<npc_name<<" 的NPC。\n";
+        console()<<"这里没有名为 "<<npc_name<<" 的NPC。\n";
         return;
     }
     
     // 清屏功能 - 让对话界面更清晰
-    #ifdef _WIN32
-        system("cls");
-    #else
-        system("clear");
-    #endif
+    clearScreen();
     
     std::string current_dialogue_id = npc->defaultDialogue();
     // 基于任务状态的起始分支（让对话逻辑更清晰）
@@ -1326,34 +1328,28 @@ void Game::talk(const std::string& npc_name) {
         // 钱道然也使用主菜单系统
         current_dialogue_id = "main_menu";
     } else if (npc_name == "苏小萌") {
-        if (auto* tk = state_.task_manager.getTask("side_canteen_choice")) {
-            if (tk->getStatus() == TaskStatus::COMPLETED) {
-                current_dialogue_id = "s1_chat"; // 完成后显示支线任务3承接内容
-            } else if (tk->getStatus() == TaskStatus::IN_PROGRESS) {
-                // 检查是否已经选择过食物（通过好感度标记）
-                bool has_chosen_food = state_.player.getNPCFavor("苏小萌") > 0;
-                if (has_chosen_food) {
-                    // 已经选择过食物，直接进入咖啡因灵液需求阶段
-                    current_dialogue_id = "s1_after_pick";
-                } else {
-                    // 还没有选择食物，进入选择界面
-                    current_dialogue_id = "s1_choose";
-                }
+        TaskStatus s1_status = state_.task_manager.getStatus("side_canteen_choice");
+        if (s1_status == TaskStatus::COMPLETED) {
+            current_dialogue_id = "s1_chat"; // 完成后显示支线任务3承接内容
+        } else if (s1_status == TaskStatus::IN_PROGRESS) {
+            // 检查是否已经选择过食物（通过好感度标记）
+            bool has_chosen_food = state_.player.getNPCFavor("苏小萌") > 0;
+            if (has_chosen_food) {
+                // 已经选择过食物，直接进入咖啡因灵液需求阶段
+                current_dialogue_id = "s1_after_pick";
             } else {
-                current_dialogue_id = "welcome"; // 默认首次欢迎
+                // 还没有选择食物，进入选择界面
+                current_dialogue_id = "s1_choose";
             }
         } else {
-            current_dialogue_id = "welcome"; // 未接取任务
+            current_dialogue_id = "welcome"; // 未接取任务，默认首次欢迎
         }
     } else if (npc_name == "陆天宇") {
-        if (auto* tk = state_.task_manager.getTask("side_gym_fragments")) {
-            if (tk->getStatus() == TaskStatus::COMPLETED) {
-                current_dialogue_id = "s2_done"; // 完成后显示支线任务4承接内容
-            } else if (tk->getStatus() == TaskStatus::IN_PROGRESS) {
-                current_dialogue_id = "s2_turnin"; // 进行中→直接进入交付界面
-            } else {
-                current_dialogue_id = "welcome"; // 未接取任务
-            }
+        TaskStatus s2_status = state_.task_manager.getStatus("side_gym_fragments");
+        if (s2_status == TaskStatus::COMPLETED) {
+            current_dialogue_id = "s2_done"; // 完成后显示支线任务4承接内容
+        } else if (s2_status == TaskStatus::IN_PROGRESS) {
+            current_dialogue_id = "s2_turnin"; // 进行中→直接进入交付界面
         } else {
             current_dialogue_id = "welcome"; // 未接取任务
         }
@@ -1366,13 +1362,62 @@ void Game::talk(const std::string& npc_name) {
     // 改进的对话界面布局
     // 为钱道然的主菜单提供简洁显示，跳过完整的对话界面
     if (!(npc_name == "钱道然" && current_dialogue_id == "main_menu")) {
-        std::cout << std::string(60, '=') << "\n";
-        std::cout << "💬 与 " << npc_name << " 对话\n";
-        std::cout << std::string(60, '=') << "\n";
-        std::cout << "💡 输入 'help' 查看对话命令 | 'clear' 清屏 | 'back' 退出\n";
-        std::cout << std::string(60, '-') << "\n";
+        console() << std::string(60, '=') << "\n";
+        console() << "💬 与 " << npc_name << " 对话\n";
+        console() << std::string(60, '=') << "\n";
+        console() << "💡 输入 'help' 查看对话命令 | 'clear' 清屏 | 'back' 退出\n";
+        console() << std::string(60, '-') << "\n";
     }
     
+    talk_ = TalkSession{npc_name, current_dialogue_id, player_favor, {}};
+    showDialogue();
+}
+
+// 当前对话的NPC（对话期间地点不变，每一步重新查找）
+NPC* Game::talkingNPC() {
+    auto* loc = state_.map.get(state_.current_loc);
+    return loc ? const_cast<NPC*>(loc->findNPC(talk_.npc_name)) : nullptr;
+}
+
+// 结束对话并显示当前地点信息
+void Game::endTalk() {
+    console() << "\n🎭 对话结束。\n";
+    console() << std::string(60, '=') << "\n";
+    look();
+}
+
+// 显示对话命令帮助
+static void printDialogueHelp() {
+    console() << "\n" << std::string(60, '=') << "\n";
+    console() << "📖 对话命令帮助\n";
+    console() << std::string(60, '=') << "\n";
+    console() << "数字 - 选择对应选项\n";
+    console() << "task/t - 查看任务\n";
+    console() << "clear - 清屏刷新界面\n";
+    console() << "reset_dialogue - 重置对话记忆（调试用）\n";
+    console() << "back - 退出对话\n";
+    console() << std::string(60, '=') << "\n";
+}
+
+// 清屏并重新显示对话界面头部
+static void redrawDialogueHeader(const std::string& npc_name, int player_favor) {
+    clearScreen();
+    console() << std::string(60, '=') << "\n";
+    console() << "💬 与 " << npc_name << " 对话\n";
+    console() << "❤️  好感度: " << player_favor << "\n";
+    console() << std::string(60, '=') << "\n";
+    console() << "💡 输入 'help' 查看对话命令 | 'clear' 清屏 | 'back' 退出\n";
+    console() << std::string(60, '-') << "\n";
+}
+
+// 显示当前对话节点，并等待玩家选择
+void Game::showDialogue() {
+    NPC* npc = talkingNPC();
+    if(!npc) return;
+    const std::string& npc_name = talk_.npc_name;
+    std::string& current_dialogue_id = talk_.dialogue_id;
+    int player_favor = talk_.player_favor;
+    
     while(true) {
         const DialogueNode* node = npc->getDialogue(current_dialogue_id);
         if(!node) {
@@ -1389,64 +1434,26 @@ void Game::talk(const std::string& npc_name) {
             }
             
             // 如果仍然没有对话，显示错误信息
-            std::cout<<"对话错误：找不到可用的对话内容。\n";
+            console()<<"对话错误：找不到可用的对话内容。\n";
             // 对话错误时仍允许用户输入命令
-            std::cout << "💡 输入 'help' 查看对话命令 | 'clear' 清屏 | 'back' 退出\n";
-            std::cout << ">";
-            std::string input;
-            std::getline(std::cin, input);
-            
-            if(input == "back") {
-                std::cout << "\n🎭 对话结束。\n";
-                std::cout << std::string(60, '=') << "\n";
-                look();
-                break;
-            } else if(input == "help") {
-                std::cout << "\n" << std::string(60, '=') << "\n";
-                std::cout << "📖 对话命令帮助\n";
-                std::cout << std::string(60, '=') << "\n";
-                std::cout << "数字 - 选择对应选项\n";
-                std::cout << "task/t - 查看任务\n";
-                std::cout << "clear - 清屏刷新界面\n";
-                std::cout << "reset_dialogue - 重置对话记忆（调试用）\n";
-                std::cout << "back - 退出对话\n";
-                std::cout << std::string(60, '=') << "\n";
-                continue;
-            } else if(input == "clear") {
-                #ifdef _WIN32
-                    system("cls");
-                #else
-                    system("clear");
-                #endif
-                std::cout << std::string(60, '=') << "\n";
-                std::cout << "💬 与 " << npc_name << " 对话\n";
-                std::cout << "❤️  好感度: " << player_favor << "\n";
-                std::cout << std::string(60, '=') << "\n";
-                std::cout << "💡 输入 'help' 查看对话命令 | 'clear' 清屏 | 'back' 退出\n";
-                std::cout << std::string(60, '-') << "\n";
-                continue;
-            } else if(input == "task" || input == "t") {
-                state_.task_manager.showTaskList();
-                continue;
-            } else {
-                std::cout << "无效命令，请输入 'back' 退出对话。\n";
-                continue;
-            }
+            console() << "💡 输入 'help' 查看对话命令 | 'clear' 清屏 | 'back' 退出\n";
+            flow_.await(">", [this](const std::string& input) { onDialogueErrorInput(input); });
+            return;
         }
         
         // 为钱道然的主菜单提供简洁显示
         if (npc_name == "钱道然" && current_dialogue_id == "main_menu") {
             // 跳过完整的对话界面，直接显示主菜单内容
-            std::cout << "\n" << std::string(60, '-') << "\n";
-            std::cout << "【" << npc->name() << "】\n";
-            std::cout << node->npc_text << "\n";
-            std::cout << std::string(60, '-') << "\n";
+            console() << "\n" << std::string(60, '-') << "\n";
+            console() << "【" << npc->name() << "】\n";
+            console() << node->npc_text << "\n";
+            console() << std::string(60, '-') << "\n";
         } else {
             // 检查好感度要求
             if(player_favor < node->favor_requirement) {
-                std::cout << "\n" << std::string(60, '-') << "\n";
-                std::cout << "【" << npc->name() << "】\"我们还不够熟悉，需要好感度 " << node->favor_requirement << " 才能继续这个话题。\"\n";
-                std::cout << std::string(60, '-') << "\n";
+                console() << "\n" << std::string(60, '-') << "\n";
+                console() << "【" << npc->name() << "】\"我们还不够熟悉，需要好感度 " << node->favor_requirement << " 才能继续这个话题。\"\n";
+                console() << std::string(60, '-') << "\n";
                 current_dialogue_id = "welcome";
                 continue;
             }
@@ -1457,16 +1464,16 @@ void Game::talk(const std::string& npc_name) {
             // 检查记忆系统，避免重复信息
             if (!node->memory_key.empty() && npc->hasMemory(node->memory_key)) {
                 // 如果已经访问过这个记忆，可以显示简化版本或跳过
-                std::cout << "\n" << std::string(60, '-') << "\n";
-                std::cout << "【" << npc->name() << "】\n";
-                std::cout << "（" << npc->name() << "点了点头）\n\n我们之前已经讨论过这个话题了。有什么其他需要帮助的吗？\n";
-                std::cout << std::string(60, '-') << "\n";
+                console() << "\n" << std::string(60, '-') << "\n";
+                console() << "【" << npc->name() << "】\n";
+                console() << "（" << npc->name() << "点了点头）\n\n我们之前已经讨论过这个话题了。有什么其他需要帮助的吗？\n";
+                console() << std::string(60, '-') << "\n";
             } else {
                 // 改进的对话文本显示
-                std::cout << "\n" << std::string(60, '-') << "\n";
-                std::cout << "【" << npc->name() << "】\n";
-                std::cout << node->npc_text << "\n";
-                std::cout << std::string(60, '-') << "\n";
+                console() << "\n" << std::string(60, '-') << "\n";
+                console() << "【" << npc->name() << "】\n";
+                console() << node->npc_text << "\n";
+                console() << std::string(60, '-') << "\n";
                 
                 // 添加记忆
                 if (!node->memory_key.empty()) {
@@ -1476,14 +1483,12 @@ void Game::talk(const std::string& npc_name) {
         }
         
         if(node->options.empty()) {
-            std::cout << "\n🎭 对话结束。\n";
-            std::cout << std::string(60, '=') << "\n";
-            look(); // 显示当前地点信息
-            break;
+            endTalk(); // 显示当前地点信息
+            return;
         }
         
         // 改进的选项显示
-        std::cout << "\n📋 选择回复：\n";
+        console() << "\n📋 选择回复：\n";
         
         // 声明可用选项向量
         std::vector<size_t> available_options;
@@ -1533,11 +1538,11 @@ void Game::talk(const std::string& npc_name) {
         for(size_t i = 0; i < available_options.size(); ++i) {
             size_t option_index = available_options[i];
             const auto& option = node->options[option_index];
-            std::cout << "   " << (i+1) << ". " << option.text;
+            console() << "   " << (i+1) << ". " << option.text;
             if(option.favor_change != 0) {
-                std::cout << " (好感度" << (option.favor_change > 0 ? "+" : "") << option.favor_change << ")";
+                console() << " (好感度" << (option.favor_change > 0 ? "+" : "") << option.favor_change << ")";
             }
-            std::cout << "\n";
+            console() << "\n";
         }
         
         // 显示特殊命令
@@ -1545,327 +1550,451 @@ void Game::talk(const std::string& npc_name) {
 
         }
         
-        std::cout << "\n" << std::string(60, '-') << "\n";
-        std::cout << "请选择 (输入数字或命令): ";
-        std::string input;
-        std::getline(std::cin, input);
-        
-
-        
-        if(input == "help") {
-            std::cout << "\n" << std::string(60, '=') << "\n";
-            std::cout << "📖 对话命令帮助\n";
-            std::cout << std::string(60, '=') << "\n";
-            std::cout << "数字 - 选择对应选项\n";
-            std::cout << "task/t - 查看任务\n";
-            std::cout << "clear - 清屏刷新界面\n";
-            std::cout << "reset_dialogue - 重置对话记忆（调试用）\n";
-            std::cout << "back - 退出对话\n";
-            std::cout << std::string(60, '=') << "\n";
-            continue;
-        }
-        
-        if(input == "task" || input == "t") {
-            state_.task_manager.showTaskList();
-            continue;
-        }
-        
-        if(input == "clear") {
-            // 清屏功能
-            #ifdef _WIN32
-                system("cls");
-            #else
-                system("clear");
-            #endif
-            // 重新显示对话界面头部
-            std::cout << std::string(60, '=') << "\n";
-            std::cout << "💬 与 " << npc_name << " 对话\n";
-            std::cout << "❤️  好感度: " << player_favor << "\n";
-            std::cout << std::string(60, '=') << "\n";
-            std::cout << "💡 输入 'help' 查看对话命令 | 'clear' 清屏 | 'back' 退出\n";
-            std::cout << std::string(60, '-') << "\n";
-            continue;
-        }
-        
-        if(input == "reset_dialogue") {
-            // 重置对话记忆（调试用）
-            state_.dialogue_memory[npc_name].clear();
-            std::cout << "对话记忆已重置。\n";
-            continue;
-        }
-        
-        if(input == "back") {
-            std::cout << "\n🎭 对话结束。\n";
-            std::cout << std::string(60, '=') << "\n";
-            look();
-            break;
-        }
-        
-
-        
-        try {
-            int choice = std::stoi(input);
-            if(choice > 0 && choice <= static_cast<int>(available_options.size())) {
-                size_t option_index = available_options[choice - 1];
-                const auto& option = node->options[option_index];
-                
-                // 记录已选择的选项
-                std::string memory_key = npc_name + "_" + current_dialogue_id + "_" + option.text;
-                state_.dialogue_memory[npc_name].insert(memory_key);
-                
-                // 为林清漪和钱道然记录选项选择（用于动态选项显示）
-                if ((npc_name == "林清漪" || npc_name == "钱道然") && current_dialogue_id == "main_menu" && !option.requirement.empty()) {
-                    const_cast<NPC*>(npc)->markOptionChosen(option.requirement);
-                }
-                
-                // 检查选项条件（为林清漪和钱道然的主菜单跳过requirement检查，因为requirement用作选项标识符）
-                // 如果对话ID为空或者是main_menu，都跳过条件检查
-                bool should_check_conditions = !((npc_name == "林清漪" || npc_name == "钱道然") && 
-                                                (current_dialogue_id == "main_menu" || current_dialogue_id.empty()));
-                
-                if (should_check_conditions) {
-                    auto inventory_items = state_.player.inventory().asSimpleItems();
-                    std::unordered_map<std::string, int> inventory_map;
-                    for (const auto& item : inventory_items) {
-                        inventory_map[item.id] = item.count;
-                    }
-                    bool can_choose = npc->canChooseOption(option, player_favor, inventory_map);
-                    if(!can_choose) {
-                        std::cout<<"条件不满足，无法选择此选项。\n";
-                        continue;
-                    }
-                }
-                
-                // 增加好感度
-                if(option.favor_change != 0) {
-                    state_.player.addNPCFavor(npc_name, option.favor_change);
-                    player_favor = state_.player.getNPCFavor(npc_name); // 更新本地好感度
-                    if(option.favor_change > 0) {
-                        std::cout<<"【好感度 +" << option.favor_change << "】\n";
-                    } else if(option.favor_change < 0) {
-                        std::cout<<"【好感度 " << option.favor_change << "】\n";
-                    }
-                }
-                
-                // 执行特殊行动
-                if(option.action) {
-                    option.action();
-                }
-                
-                // 处理特殊奖励逻辑
-                handleSpecialRewards(npc_name, current_dialogue_id, choice, npc);
-                
-                // 特殊处理商店功能
-                if(option.next_dialogue_id == "shop" && npc_name == "钱道然") {
-                    // 直接调用商店系统
-                    openShop(npc_name);
-                    // 商店返回后，直接退出对话，避免重复显示主菜单
-                    std::cout << "\n🎭 对话结束。\n";
-                    std::cout << std::string(60, '=') << "\n";
-                    look();
-                    return;
-                }
-                
-                
-                
-                // 移动到下一个对话
-                if(option.next_dialogue_id == "exit") {
-                    std::cout<<"\n🎭 对话结束。\n";
-                    std::cout << std::string(60, '=') << "\n";
-                    look(); // 显示当前地点信息
-                    return; // 直接退出对话函数
-                } else {
-                    // 检查苏小萌的咖啡因灵液对话特殊情况
-                    if (npc_name == "苏小萌" && current_dialogue_id == "s1_after_pick" && option.next_dialogue_id == "s1_give") {
-                        // 检查是否没有咖啡因灵液
-                        if (state_.dialogue_memory[npc_name].find("no_caffeine_elixir") != state_.dialogue_memory[npc_name].end()) {
-                            // 清除标志并跳转到没有物品的对话
-                            state_.dialogue_memory[npc_name].erase("no_caffeine_elixir");
-                            current_dialogue_id = "s1_no_elixir_response";
-                        } else {
-                            current_dialogue_id = option.next_dialogue_id;
-                        }
-                    }
-                    // 检查陆天宇的动力碎片对话特殊情况
-                    else if (npc_name == "陆天宇" && current_dialogue_id == "s2_turnin" && option.next_dialogue_id == "s2_check_fragments") {
-                        // 根据记忆标志决定跳转到哪个对话
-                        if (state_.dialogue_memory[npc_name].find("has_enough_fragments") != state_.dialogue_memory[npc_name].end()) {
-                            // 有足够的碎片，直接跳转到完成对话
-                            current_dialogue_id = "s2_done";
-                            // 执行奖励逻辑
-                            state_.player.inventory().remove("power_fragment",3);
-                            Item wrist = ItemDefinitions::createWeightBracelet();
-                            wrist.price = 0; // 奖励物品免费
-                            state_.player.inventory().add(wrist,1);
-                            state_.player.addNPCFavor("林清漪",20);
-                            std::cout<<"【S2完成】你交付了3个动力碎片，获得负重护腕×1。林清漪好感+20。\n";
-                            if (auto* tk = state_.task_manager.getTask("side_gym_fragments")) { tk->complete(); }
-                            // 清除记忆标志
-                            state_.dialogue_memory[npc_name].erase("has_enough_fragments");
-                        } else if (state_.dialogue_memory[npc_name].find("not_enough_fragments") != state_.dialogue_memory[npc_name].end()) {
-                            // 没有足够的碎片，跳转到检查对话
-                            current_dialogue_id = "s2_check_fragments";
-                            // 更新对话内容显示当前数量
-                            int current_fragments = state_.player.inventory().quantity("power_fragment");
-                            std::cout << "（他数了数你手中的动力碎片）\n\n目前你有 " << current_fragments << " 个动力碎片，还需要 " << (3 - current_fragments) << " 个。\n\n";
-                            // 清除记忆标志
-                            state_.dialogue_memory[npc_name].erase("not_enough_fragments");
-                        } else {
-                            current_dialogue_id = option.next_dialogue_id;
-                        }
-                    }
-                // 为林清漪和钱道然实现特殊的对话跳转逻辑
-                else if ((npc_name == "林清漪" || npc_name == "钱道然") && current_dialogue_id == "main_menu" && option.next_dialogue_id != "main_menu") {
-                    // 主菜单的选项选择后，先跳转到对应对话，然后自动回到主菜单
-                    current_dialogue_id = option.next_dialogue_id;
-                } else if (npc_name == "林清漪" && option.next_dialogue_id == "main_menu") {
-                    // 林清漪的子对话返回主菜单
-                    current_dialogue_id = "main_menu";
-                } else if (npc_name == "钱道然" && option.next_dialogue_id == "main_menu") {
-                    // 钱道然的子对话返回主菜单
-                    current_dialogue_id = "main_menu";
-                } else {
-                    current_dialogue_id = option.next_dialogue_id;
-                }
-                }
-            } else {
-                std::cout<<"无效选择，请重新输入。\n";
-            }
-        } catch(...) {
-            std::cout<<"无效输入，请重新输入。\n";
-        }
+        console() << "\n" << std::string(60, '-') << "\n";
+        talk_.available_options = std::move(available_options);
+        flow_.await("请选择 (输入数字或命令): ", [this](const std::string& input) { onDialogueInput(input); });
+        return;
     }
 }
 
-// 免参数对话入口：列出当前位置NPC并支持数字/模糊匹配
-void Game::talkAuto() {
-    auto* loc = state_.map.get(state_.current_loc);
-    if(!loc) { std::cout<<"未知地点。\n"; return; }
-    if (loc->npcs.empty()) { std::cout<<"这里没有可以交谈的NPC。\n"; return; }
-
-    // 若只有一个NPC，直接进入
-    if (loc->npcs.size()==1) { talk(loc->npcs[0].name()); return; }
-
-    std::cout << "\n可交谈的NPC：\n";
-    for(size_t i=0;i<loc->npcs.size();++i){
-        std::cout << "  " << (i+1) << ". " << loc->npcs[i].name() << " - " << loc->npcs[i].description() << "\n";
+// 对话内容缺失时处理玩家输入
+void Game::onDialogueErrorInput(const std::string& input) {
+    if(input == "back") {
+        endTalk();
+        return;
+    } else if(input == "help") {
+        printDialogueHelp();
+    } else if(input == "clear") {
+        redrawDialogueHeader(talk_.npc_name, talk_.player_favor);
+    } else if(input == "task" || input == "t") {
+        state_.task_manager.showTaskList();
+    } else {
+        console() << "无效命令，请输入 'back' 退出对话。\n";
     }
-    std::cout << "输入编号或NPC名字（back返回）：";
-    std::string sel; std::getline(std::cin, sel);
-    if (sel=="back") return;
-    // 数字选择
-    try{
-        int idx = std::stoi(sel);
-        if (idx>0 && idx<=static_cast<int>(loc->npcs.size())) { talk(loc->npcs[idx-1].name()); return; }
-    }catch(...){ }
-    // 模糊匹配
-    for(const auto& n: loc->npcs){ if (n.name().find(sel)!=std::string::npos) { talk(n.name()); return; } }
-    std::cout << "未找到匹配的NPC。\n";
+    showDialogue();
 }
 
-// 无参数战斗选择
-void Game::fightAuto() {
-    auto* loc = state_.map.get(state_.current_loc);
-    if(!loc) { std::cout<<"未知地点。\n"; return; }
+// 处理对话选择
+void Game::onDialogueInput(const std::string& input) {
+    MetricTimer timer(Metric::TALK);
+    NPC* npc = talkingNPC();
+    if(!npc) return;
+    const std::string& npc_name = talk_.npc_name;
+    std::string& current_dialogue_id = talk_.dialogue_id;
+    int& player_favor = talk_.player_favor;
+    const DialogueNode* node = npc->getDialogue(current_dialogue_id);
+    if(!node) { showDialogue(); return; }
+    const std::vector<size_t> available_options = talk_.available_options;
     
-    // 检查当前地点是否有可战斗的怪物
-    std::vector<std::string> available_monsters;
-    for (const auto& spawn : state_.monster_spawns) {
-        if (spawn.location_id == state_.current_loc && canSpawnMonster(state_.current_loc, spawn.monster_name)) {
-            available_monsters.push_back(spawn.monster_name);
-        }
-    }
+
     
-    if (available_monsters.empty()) { 
-        std::cout<<"这里没有可以战斗的敌人。\n"; 
-        return; 
+    if(input == "help") {
+        printDialogueHelp();
+        showDialogue();
+        return;
     }
     
-    // 记录战斗前的状态
-    int old_xp = state_.player.xp();
-    int old_coins = state_.player.coins();
-    int old_level = state_.player.level();
+    if(input == "task" || input == "t") {
+        state_.task_manager.showTaskList();
+        showDialogue();
+        return;
+    }
     
-    if (available_monsters.size()==1) {
-        // 只有一个敌人，直接战斗
-        std::string monster_name = available_monsters[0];
-        Enemy en = createMonsterByName(monster_name);
-        
-        // 清屏功能 - 让战斗界面更清晰
-        #ifdef _WIN32
-            system("cls");
-        #else
-            system("clear");
-        #endif
-        
-        // 显示战斗开始信息
-        std::cout << "\n" << std::string(50, '=') << "\n";
-        std::cout << "⚔️ 战斗开始！\n";
-        std::cout << "挑战目标: " << formatMonsterName(en) << "\n";
-        std::cout << "你的等级: Lv" << state_.player.level() << "\n";
-        std::cout << std::string(50, '=') << "\n";
-        
-        std::string log;
-        if(combat_.fight(state_.player,en,log)){
-            std::cout<<log; 
-            handleCombatVictory(en, old_xp, old_coins, old_level);
-        } else { 
-            std::cout<<log; 
-            handlePlayerDeath(); 
-        }
+    if(input == "clear") {
+        // 清屏并重新显示对话界面头部
+        redrawDialogueHeader(npc_name, player_favor);
+        showDialogue();
         return;
     }
     
-    // 多个敌人，显示选择菜单
-    std::cout << "\n可挑战的敌人：\n";
-    for(size_t i=0;i<available_monsters.size();++i){ 
-        std::string monster_name = available_monsters[i];
-        Enemy temp_en = createMonsterByName(monster_name);
-        std::cout<<"  "<<(i+1)<<". "<<formatMonsterName(temp_en)<<"\n"; 
+    if(input == "reset_dialogue") {
+        // 重置对话记忆（调试用）
+        state_.dialogue_memory[npc_name].clear();
+        console() << "对话记忆已重置。\n";
+        showDialogue();
+        return;
+    }
+    
+    if(input == "back") {
+        endTalk();
+        return;
     }
     
-    std::cout<<"输入编号（back返回）："; 
-    std::string sel; 
-    std::getline(std::cin, sel); 
-    if(sel=="back") return; 
+
     
-    try{ 
-        int idx=std::stoi(sel); 
-        if(idx>0 && idx<=static_cast<int>(available_monsters.size())){
-            std::string monster_name = available_monsters[idx-1];
-            Enemy en = createMonsterByName(monster_name);
+    try {
+        int choice = std::stoi(input);
+        if(choice > 0 && choice <= static_cast<int>(available_options.size())) {
+            size_t option_index = available_options[choice - 1];
+            const auto& option = node->options[option_index];
             
-            // 清屏功能 - 让战斗界面更清晰
-            #ifdef _WIN32
-                system("cls");
-            #else
-                system("clear");
-            #endif
+            // 记录已选择的选项
+            std::string memory_key = npc_name + "_" + current_dialogue_id + "_" + option.text;
+            state_.dialogue_memory[npc_name].insert(memory_key);
             
-            // 显示战斗开始信息
-            std::cout << "\n" << std::string(50, '=') << "\n";
-            std::cout << "⚔️ 战斗开始！\n";
-            std::cout << "挑战目标: " << formatMonsterName(en) << "\n";
-            std::cout << "你的等级: Lv" << state_.player.level() << "\n";
-            std::cout << std::string(50, '=') << "\n";
+            // 为林清漪和钱道然记录选项选择（用于动态选项显示）
+            if ((npc_name == "林清漪" || npc_name == "钱道然") && current_dialogue_id == "main_menu" && !option.requirement.empty()) {
+                const_cast<NPC*>(npc)->markOptionChosen(option.requirement);
+            }
+            
+            // 检查选项条件（为林清漪和钱道然的主菜单跳过requirement检查，因为requirement用作选项标识符）
+            // 如果对话ID为空或者是main_menu，都跳过条件检查
+            bool should_check_conditions = !((npc_name == "林清漪" || npc_name == "钱道然") && 
+                                            (current_dialogue_id == "main_menu" || current_dialogue_id.empty()));
             
-            std::string log; 
-            if(combat_.fight(state_.player,en,log)){
-                std::cout<<log; 
-                handleCombatVictory(en, old_xp, old_coins, old_level);
-            } else { 
-                std::cout<<log; 
-                handlePlayerDeath(); 
+            if (should_check_conditions) {
+                bool can_choose = npc->canChooseOption(option, player_favor, state_.player.inventory());
+                if(!can_choose) {
+                    console()<<"条件不满足，无法选择此选项。\n";
+                    showDialogue();
+                    return;
+                }
+            }
+            
+            // 增加好感度
+            if(option.favor_change != 0) {
+                state_.player.addNPCFavor(npc_name, option.favor_change);
+                player_favor = state_.player.getNPCFavor(npc_name); // 更新本地好感度
+            }
+            
+            // 执行特殊行动
+            if(option.action) {
+                option.action();
             }
+            
+            // 选择事件：特殊奖励由registerEventListeners中订阅的监听器处理
+            state_.events.publish(DialogueChoiceEvent{npc_name, current_dialogue_id, choice, npc});
+            
+            // 特殊处理商店功能
+            if(option.next_dialogue_id == "shop" && npc_name == "钱道然") {
+                // 直接调用商店系统；商店返回后直接退出对话，避免重复显示主菜单
+                openShop(npc_name, [this]() { endTalk(); });
+                return;
+            }
+            
+            
+            
+            // 移动到下一个对话
+            if(option.next_dialogue_id == "exit") {
+                endTalk(); // 显示当前地点信息
+                return; // 直接退出对话
+            } else {
+                // 检查苏小萌的咖啡因灵液对话特殊情况
+                if (npc_name == "苏小萌" && current_dialogue_id == "s1_after_pick" && option.next_dialogue_id == "s1_give") {
+                    // 检查是否没有咖啡因灵液
+                    if (state_.dialogue_memory[npc_name].find("no_caffeine_elixir") != state_.dialogue_memory[npc_name].end()) {
+                        // 清除标志并跳转到没有物品的对话
+                        state_.dialogue_memory[npc_name].erase("no_caffeine_elixir");
+                        current_dialogue_id = "s1_no_elixir_response";
+                    } else {
+                        current_dialogue_id = option.next_dialogue_id;
+                    }
+                }
+                // 检查陆天宇的动力碎片对话特殊情况
+                else if (npc_name == "陆天宇" && current_dialogue_id == "s2_turnin" && option.next_dialogue_id == "s2_check_fragments") {
+                    // 根据记忆标志决定跳转到哪个对话
+                    if (state_.dialogue_memory[npc_name].find("has_enough_fragments") != state_.dialogue_memory[npc_name].end()) {
+                        // 有足够的碎片，直接跳转到完成对话
+                        current_dialogue_id = "s2_done";
+                        // 执行奖励逻辑
+                        state_.player.inventory().remove("power_fragment",3);
+                        Item wrist = ItemDefinitions::createWeightBracelet();
+                        wrist.price = 0; // 奖励物品免费
+                        state_.player.gainItem(wrist,1);
+                        console()<<"【S2完成】你交付了3个动力碎片，获得负重护腕×1。\n";
+                        state_.player.addNPCFavor("林清漪",20);
+                        state_.task_manager.completeTask("side_gym_fragments", false);
+                        // 清除记忆标志
+                        state_.dialogue_memory[npc_name].erase("has_enough_fragments");
+                    } else if (state_.dialogue_memory[npc_name].find("not_enough_fragments") != state_.dialogue_memory[npc_name].end()) {
+                        // 没有足够的碎片，跳转到检查对话
+                        current_dialogue_id = "s2_check_fragments";
+                        // 更新对话内容显示当前数量
+                        int current_fragments = state_.player.inventory().quantity("power_fragment");
+                        console() << "（他数了数你手中的动力碎片）\n\n目前你有 " << current_fragments << " 个动力碎片，还需要 " << (3 - current_fragments) << " 个。\n\n";
+                        // 清除记忆标志
+                        state_.dialogue_memory[npc_name].erase("not_enough_fragments");
+                    } else {
+                        current_dialogue_id = option.next_dialogue_id;
+                    }
+                }
+            // 为林清漪和钱道然实现特殊的对话跳转逻辑
+            else if ((npc_name == "林清漪" || npc_name == "钱道然") && current_dialogue_id == "main_menu" && option.next_dialogue_id != "main_menu") {
+                // 主菜单的选项选择后，先跳转到对应对话，然后自动回到主菜单
+                current_dialogue_id = option.next_dialogue_id;
+            } else if (npc_name == "林清漪" && option.next_dialogue_id == "main_menu") {
+                // 林清漪的子对话返回主菜单
+                current_dialogue_id = "main_menu";
+            } else if (npc_name == "钱道然" && option.next_dialogue_id == "main_menu") {
+                // 钱道然的子对话返回主菜单
+                current_dialogue_id = "main_menu";
+            } else {
+                current_dialogue_id = option.next_dialogue_id;
+            }
+            }
+        } else {
+            console()<<"无效选择，请重新输入。\n";
+        }
+    } catch(...) {
+        console()<<"无效输入，请重新输入。\n";
+    }
+    showDialogue();
+}
+
+// 未知指令时的建议：输入里含有（或近似）某个别名时给出对应提示
+struct CommandHint {
+    std::vector<const char*> aliases;
+    const char* hint;
+};
+static const CommandHint kCommandHints[] = {
+    {{"look", "查看", "看"}, "   尝试输入 'look' 或 '查看' 查看当前位置\n"},
+    {{"stats", "属性", "状态"}, "   尝试输入 'stats' 或 '属性' 查看角色信息\n"},
+    {{"inv", "背包", "物品"}, "   尝试输入 'inv' 或 '背包' 查看物品\n"},
+    {{"task", "任务"}, "   尝试输入 'task' 或 '任务' 查看任务\n"},
+    {{"help", "帮助"}, "   尝试输入 'help' 或 '帮助' 查看帮助\n"},
+    {{"talk", "对话"}, "   尝试输入 talk\n"},
+    {{"fight", "战斗", "挑战"}, "   尝试输入 fight\n"},
+    {{"optimize", "配装"}, "   尝试输入 'optimize [怪物名]' 或 '配装 [怪物名]' 查看配装建议\n"},
+    {{"goto", "前往"}, "   尝试输入 'goto <地点名>' 或 '前往 <地点名>' 自动走到目的地\n"},
+    {{"down", "下楼", "up", "上楼"}, "   在文心潭或秘境的阶梯处输入 'down/下楼' 或 'up/上楼'\n"},
+};
+
+// 建立名称索引
+// 功能：世界里所有NPC名和怪物名、指令别名各建一个模糊匹配索引，后续输入解析都查这里
+void Game::buildNameIndexes() {
+    npc_names_.clear();
+    monster_names_.clear();
+    command_hints_.clear();
+
+    std::unordered_map<std::string, FuzzyIndex::Key> npc_keys, monster_keys;
+    auto add = [](FuzzyIndex& index, std::unordered_map<std::string, FuzzyIndex::Key>& keys, const std::string& name) {
+        if (keys.count(name)) return;
+        FuzzyIndex::Key key = static_cast<FuzzyIndex::Key>(keys.size());
+        keys[name] = key;
+        index.insert(key, name);
+    };
+    for (const auto& loc : state_.map.allLocations()) {
+        for (const auto& npc : loc.npcs) add(npc_names_, npc_keys, npc.name());
+        for (const auto& en : loc.enemies) add(monster_names_, monster_keys, en.name());
+    }
+    for (const auto& spawn : state_.monster_spawns) add(monster_names_, monster_keys, spawn.monster_name);
+
+    // 指令别名的键：高位是提示编号，低8位是别名编号
+    for (size_t i = 0; i < sizeof(kCommandHints) / sizeof(kCommandHints[0]); ++i) {
+        for (size_t j = 0; j < kCommandHints[i].aliases.size(); ++j) {
+            command_hints_.insert(static_cast<FuzzyIndex::Key>(i << 8 | j), kCommandHints[i].aliases[j]);
+        }
+    }
+    buildLocationIndex();
+}
+
+// 建立地点名索引
+// 功能：同名地点（秘境每层的“秘境入口”等）只建一个条目；记下地图的版本，
+//       秘境生成或淘汰楼层后地图版本变了，下次寻路前重建
+void Game::buildLocationIndex() {
+    location_names_.clear();
+    std::unordered_map<std::string, FuzzyIndex::Key> keys;
+    for (const auto& kv : state_.map.locations()) {
+        const std::string& name = kv.second.name;
+        if (keys.count(name)) continue;
+        FuzzyIndex::Key key = static_cast<FuzzyIndex::Key>(keys.size());
+        keys[name] = key;
+        location_names_.insert(key, name);
+    }
+    location_names_revision_ = state_.map.revision();
+}
+
+// 在候选名称（例如当前地点的NPC）中找与输入最相关的，没有时返回空字符串
+std::string Game::resolveName(const FuzzyIndex& index, std::string_view input,
+                              const std::vector<std::string>& candidates) const {
+    if (std::find(candidates.begin(), candidates.end(), input) != candidates.end()) return std::string(input);
+    FuzzyIndex::Key key;
+    bool found = index.best(input, key, [&index, &candidates](FuzzyIndex::Key k) {
+        return std::find(candidates.begin(), candidates.end(), index.name(k)) != candidates.end();
+    });
+    return found ? index.name(key) : std::string();
+}
+
+// 在某个地点的怪物中找与输入最相关的，没有时返回nullptr
+// 与 resolveName 相同的规则，但直接在地点的怪物列表上查，不复制名称
+const Enemy* Game::matchEnemy(const Location& loc, std::string_view input) const {
+    for (const auto& en : loc.enemies) {
+        if (en.name() == input) return &en;
+    }
+    auto here = [&loc](const std::string& name) {
+        for (const auto& en : loc.enemies) {
+            if (en.name() == name) return &en;
+        }
+        return static_cast<const Enemy*>(nullptr);
+    };
+    FuzzyIndex::Key key;
+    const FuzzyIndex& index = monster_names_;
+    if (!index.best(input, key, [&index, &here](FuzzyIndex::Key k) { return here(index.name(k)) != nullptr; })) {
+        return nullptr;
+    }
+    return here(index.name(key));
+}
+
+// 免参数对话入口：列出当前位置NPC并支持数字/模糊匹配
+void Game::talkAuto() {
+    auto* loc = state_.map.get(state_.current_loc);
+    if(!loc) { console()<<"未知地点。\n"; return; }
+    if (loc->npcs.empty()) { console()<<"这里没有可以交谈的NPC。\n"; return; }
+
+    // 若只有一个NPC，直接进入
+    if (loc->npcs.size()==1) { talk(loc->npcs[0].name()); return; }
+
+    console() << "\n可交谈的NPC：\n";
+    for(size_t i=0;i<loc->npcs.size();++i){
+        console() << "  " << (i+1) << ". " << loc->npcs[i].name() << " - " << loc->npcs[i].description() << "\n";
+    }
+    flow_.await("输入编号或NPC名字（back返回）：", [this](const std::string& sel) {
+        auto* loc = state_.map.get(state_.current_loc);
+        if (!loc || sel=="back") return;
+        // 数字选择
+        int idx = 0;
+        if (parseIndex(sel, idx) && idx>0 && idx<=static_cast<int>(loc->npcs.size())) { talk(loc->npcs[idx-1].name()); return; }
+        // 模糊匹配
+        std::vector<std::string> names;
+        for(const auto& n: loc->npcs) names.push_back(n.name());
+        std::string name = resolveName(npc_names_, sel, names);
+        if (!name.empty()) { talk(name); return; }
+        console() << "未找到匹配的NPC。\n";
+    });
+}
+
+// 无参数战斗选择
+void Game::fightAuto() {
+    auto* loc = state_.map.get(state_.current_loc);
+    if(!loc) { console()<<"未知地点。\n"; return; }
+    
+    // 检查当前地点是否有可战斗的怪物
+    std::vector<std::string> available_monsters;
+    for (const auto& spawn : state_.monster_spawns) {
+        if (spawn.location_id == state_.current_loc && canSpawnMonster(state_.current_loc, spawn.monster_name)) {
+            available_monsters.push_back(spawn.monster_name);
+        }
+    }
+    
+    if (available_monsters.empty()) { 
+        console()<<"这里没有可以战斗的敌人。\n"; 
+        return; 
+    }
+    
+    if (available_monsters.size()==1) {
+        // 只有一个敌人，直接战斗
+        fightMonster(available_monsters[0]);
+        return;
+    }
+    
+    // 多个敌人，显示选择菜单（附上按当前状态模拟出的胜率和平均回合数）
+    console() << "\n可挑战的敌人：\n";
+    int tier = combat_.tierFor(state_.player);
+    for(size_t i=0;i<available_monsters.size();++i){ 
+        std::string monster_name = available_monsters[i];
+        Enemy temp_en = createMonsterByName(monster_name);
+        CombatForecast f = forecastCombat(state_.player, temp_en, tier);
+        char odds[64];
+        std::snprintf(odds, sizeof(odds), "  胜率约%.0f%%，平均%.1f回合", f.win_rate * 100.0, f.expected_turns);
+        console()<<"  "<<(i+1)<<". "<<formatMonsterName(temp_en)<<odds<<"\n"; 
+    }
+    
+    flow_.await("输入编号或怪物名（back返回）：", [this, available_monsters](const std::string& sel) {
+        if(sel=="back") return; 
+        int idx = 0;
+        if(parseIndex(sel, idx) && idx>0 && idx<=static_cast<int>(available_monsters.size())){
+            fightMonster(available_monsters[idx-1]);
             return; 
         }
-    }catch(...){ }
-    std::cout<<"无效选择。\n";
+        std::string name = resolveName(monster_names_, sel, available_monsters);
+        if (!name.empty()) { fightMonster(name); return; }
+        console()<<"无效选择。\n";
+    });
+}
+
+// 与指定怪物战斗（战斗菜单选定后）
+void Game::fightMonster(const std::string& monster_name) {
+    beginCombat(createMonsterByName(monster_name), false);
+}
+
+// 开始战斗
+// 功能：显示战斗开场，然后按回合预算推进；没有预算时一次打完
+void Game::beginCombat(const Enemy& en, bool notify_wenxin_fail) {
+    // 记录战斗前的状态
+    int old_xp = state_.player.xp();
+    int old_coins = state_.player.coins();
+    int old_level = state_.player.level();
+    
+    // 清屏功能 - 让战斗界面更清晰
+    clearScreen();
+    
+    // 显示战斗开始信息
+    console() << "\n" << std::string(50, '=') << "\n";
+    console() << "⚔️ 战斗开始！\n";
+    console() << "挑战目标: " << formatMonsterName(en) << "\n";
+    console() << "你的等级: Lv" << state_.player.level() << "\n";
+    console() << std::string(50, '=') << "\n";
+    
+    combat_run_.reset(new ActiveCombat{combat_.begin(state_.player, en), old_xp, old_coins, old_level, notify_wenxin_fail});
+    advanceCombat();
+}
+
+// 继续战斗：推进一段回合，这段日志立即输出
+void Game::advanceCombat() {
+    combat_.advance(combat_run_->encounter, combat_turn_budget_);
+    console() << combat_run_->encounter.takeLog();
+    if (combat_run_->encounter.finished) finishCombat();
+}
+
+// 继续未完成的工作：战斗没打完时推进一段回合，否则执行批处理的下一条指令
+// 静默批处理中，最后一条之前的指令（包括它们引起的战斗）输出都被丢弃
+bool Game::resume() {
+    if (combat_run_) {
+        std::optional<ConsoleScope> mute;
+        if (batch_.muted) mute.emplace(nullConsole());
+        advanceCombat();
+        return true;
+    }
+    std::string_view cmd;
+    if (!nextBatchCommand(cmd)) {
+        batch_.next = batch_.text.size();
+        return true;
+    }
+    bool more = batchHasMore();
+    batch_.muted = batch_.quiet && more;
+    std::optional<ConsoleScope> mute;
+    if (batch_.muted) mute.emplace(nullConsole());
+    // 非静默的批处理中，每条指令前面照常显示提示语和这条指令，合并后的输出读起来和逐行输入一样
+    if (!batch_.quiet && batch_.executed > 0) {
+        console() << (flow_.waiting() ? flow_.prompt() : "\n> ") << cmd << "\n";
+    }
+    ++batch_.executed;
+    if (!execute(cmd)) {
+        batch_.next = batch_.text.size();
+        batch_.muted = false;
+        return false;
+    }
+    if (!more) batch_.next = batch_.text.size();
+    return true;
+}
+
+// 战斗结束结算
+void Game::finishCombat() {
+    std::unique_ptr<ActiveCombat> done = std::move(combat_run_);
+    const Enemy& en = done->encounter.enemy;
+    if (done->encounter.won) {
+        handleCombatVictory(en, done->old_level);
+    } else {
+        // 战斗失败，执行死亡惩罚
+        handlePlayerDeath();
+        if (done->notify_wenxin_fail && state_.current_loc == "wenxintan") {
+            onWenxinFail(state_);
+        }
+    }
 }
 
 // 无参数装备选择
 void Game::equipAuto() {
-    auto items = state_.player.inventory().list();
     std::vector<Item> equippables;
     
     // 获取当前已装备的物品ID列表
@@ -1876,29 +2005,148 @@ void Game::equipAuto() {
     }
     
     // 过滤掉已装备的物品
-    for (const auto& it: items) {
+    for (const auto& it: state_.player.inventory()) {
         if (it.type == ItemType::EQUIPMENT && equipped_ids.find(it.id) == equipped_ids.end()) {
             equippables.push_back(it);
         }
     }
     
-    if (equippables.empty()) { std::cout<<"没有可装备的物品。\n"; return; }
-    std::cout<<"\n可装备的物品：\n"; for(size_t i=0;i<equippables.size();++i){ std::cout<<"  "<<(i+1)<<". "<<getColoredItemName(equippables[i])<<"\n"; }
-    std::cout<<"输入编号（back返回）："; std::string sel; std::getline(std::cin, sel); if(sel=="back") return; 
-    try{ int idx=std::stoi(sel); if(idx>0 && idx<=static_cast<int>(equippables.size())){
-        if(state_.player.equipItem(equippables[idx-1].name)) {
-            // 装备成功，显示装备详细信息
-            std::cout<<"装备了 " << getColoredItemName(equippables[idx-1]) << "！\n";
-            std::cout << "\n" << std::string(40, '-') << "\n";
-            std::cout << "📋 装备详情：\n";
-            std::cout << formatEquipmentDetails(equippables[idx-1]);
-            std::cout << std::string(40, '-') << "\n";
+    if (equippables.empty()) { console()<<"没有可装备的物品。\n"; return; }
+    console()<<"\n可装备的物品：\n"; for(size_t i=0;i<equippables.size();++i){ console()<<"  "<<(i+1)<<". "<<getColoredItemName(equippables[i])<<"\n"; }
+    flow_.await("输入编号或物品名（back返回）：", [this, equippables](const std::string& sel) {
+        if(sel=="back") return; 
+        auto equipChosen = [this](const Item chosen) {
+            equipNamed(chosen.name, [chosen](bool ok) {
+                if(ok) {
+                    // 装备成功，显示装备详细信息
+                    console()<<"装备了 " << getColoredItemName(chosen) << "！\n";
+                    console() << "\n" << std::string(40, '-') << "\n";
+                    console() << "📋 装备详情：\n";
+                    console() << formatEquipmentDetails(chosen);
+                    console() << std::string(40, '-') << "\n";
+                } else {
+                    console()<<"无法装备这个物品。\n";
+                }
+            });
+        };
+        int idx = 0;
+        if(parseIndex(sel, idx) && idx>0 && idx<=static_cast<int>(equippables.size())){
+            equipChosen(equippables[idx-1]);
+            return;
+        }
+        // 按名称匹配（只在列出的装备里找，字面相似的只给提示，不直接装备）
+        const Inventory& inv = state_.player.inventory();
+        auto listed = [&inv, &equippables](FuzzyIndex::Key k) {
+            const Item* item = inv.get(k);
+            return item && std::any_of(equippables.begin(), equippables.end(),
+                                       [item](const Item& e) { return e.id == item->id; });
+        };
+        FuzzyIndex::Key key;
+        if (inv.names().best(sel, key, listed, FuzzyIndex::kNoSimilar)) { equipChosen(*inv.get(key)); return; }
+        console()<<"无效选择。\n";
+        if (inv.names().best(sel, key, listed)) console()<<"你是不是要找「"<<inv.get(key)->name<<"」？\n";
+    });
+}
+
+// 配装建议
+// 功能：在背包和身上的装备里搜索对目标最好的搭配，列出要换的装备，并用胜率预估对比前后
+void Game::recommendLoadout(std::string_view target) {
+    const Player& player = state_.player;
+    std::optional<Enemy> enemy;
+    if (target.empty()) {
+        // 没有指定怪物时，假想一个与自己同等级、没有加点和装备的对手
+        int lv = player.level();
+        Attributes rival;
+        rival.hp = rival.max_hp = 60 + (lv - 1) * 10;
+        rival.atk = rival.def_ = rival.spd = 10 + (lv - 1) * 2;
+        enemy.emplace("同级对手", rival, 0, 0);
+    } else {
+        std::vector<std::string> names;
+        for (const auto& spawn : state_.monster_spawns) names.push_back(spawn.monster_name);
+        std::string name = resolveName(monster_names_, target, names);
+        if (name.empty()) {
+            console() << "没有叫这个名字的怪物。\n";
+            return;
+        }
+        enemy = createMonsterByName(name);
+    }
+
+    int tier = combat_.tierFor(player);
+    LoadoutPlan plan = optimizeLoadout(player, *enemy, tier);
+    auto slotName = [](EquipmentSlot slot) {
+        switch (slot) {
+            case EquipmentSlot::WEAPON: return "武器";
+            case EquipmentSlot::ARMOR: return "护甲";
+            case EquipmentSlot::ACCESSORY1: return "饰品1";
+            default: return "饰品2";
+        }
+    };
+
+    console() << "\n🧮 配装建议（对手：" << (target.empty() ? enemy->name() : formatMonsterName(*enemy)) << "）\n";
+    const EquipmentSlot slots[4] = {EquipmentSlot::WEAPON, EquipmentSlot::ARMOR, EquipmentSlot::ACCESSORY1, EquipmentSlot::ACCESSORY2};
+    std::vector<std::string> to_equip;
+    for (EquipmentSlot slot : slots) {
+        const Item* now = player.equipment().getEquippedItem(slot);
+        auto it = std::find_if(plan.items.begin(), plan.items.end(), [slot](const Item& i) { return i.equip_slot == slot; });
+        console() << "  " << slotName(slot) << "：" << (it != plan.items.end() ? getColoredItemName(*it) : std::string("（空）"));
+        bool same = (now && it != plan.items.end() && now->id == it->id) || (!now && it == plan.items.end());
+        if (!same && now) console() << "  ← 替换 " << getColoredItemName(*now);
+        console() << "\n";
+        if (!same && it != plan.items.end()) to_equip.push_back(it->name);
+    }
+    const StatLine& st = plan.best.stats;
+    console() << "  属性：生命" << st.max_hp << " 攻击" << st.atk << " 防御" << st.def_ << " 速度" << st.spd;
+    if (plan.best.set_bonus > 1.0f) {
+        console() << "（学霸两件套 +" << static_cast<int>(std::lround((plan.best.set_bonus - 1.0f) * 100)) << "%）";
+    }
+    console() << "\n";
+    char line[160];
+    std::snprintf(line, sizeof(line), "  估算：约%.1f回合击败对手，可支撑约%.1f回合（现有配装：%.1f / %.1f）\n",
+                  plan.best.kill_turns, plan.best.survive_turns, plan.current.kill_turns, plan.current.survive_turns);
+    console() << line;
+
+    if (to_equip.empty()) {
+        console() << "  现在的配装已经是最好的。\n";
+    } else {
+        // 用胜率预估验证一下：按推荐配装和现有配装各模拟一次（当前生命值不变）
+        Player trial(player.name());
+        trial.setLevel(player.level());
+        trial.setAttr(player.attr());
+        trial.equipment().setEquippedItems(plan.items);
+        trial.updateAttributesFromEquipment();
+        CombatForecast before = forecastCombat(player, *enemy, tier);
+        CombatForecast after = forecastCombat(trial, *enemy, tier);
+        std::snprintf(line, sizeof(line), "  模拟胜率：%.0f%% → %.0f%%\n", before.win_rate * 100.0, after.win_rate * 100.0);
+        console() << line;
+        console() << "  依次输入：";
+        for (size_t i = 0; i < to_equip.size(); ++i) console() << (i ? "，" : "") << "equip " << to_equip[i];
+        console() << "\n";
+    }
+    if (!plan.exhaustive) {
+        console() << "  （组合太多，在时间预算内只搜索了 " << plan.evaluated << " 种，以上是其中最好的）\n";
+    }
+}
+
+// 按名称装备物品；两个饰品槽同品质时先询问替换哪个槽位，完成后回调结果
+void Game::equipNamed(const std::string& item_name, std::function<void(bool)> on_result) {
+    if (!state_.player.needsAccessorySlotChoice(item_name)) {
+        on_result(state_.player.equipItem(item_name));
+        return;
+    }
+    const Equipment& eq = state_.player.equipment();
+    console() << "两个饰品槽位都被占用，请选择要替换的槽位：\n";
+    console() << "1. 饰品1槽位 (" << getColoredItemName(*eq.getEquippedItem(EquipmentSlot::ACCESSORY1)) << ")\n";
+    console() << "2. 饰品2槽位 (" << getColoredItemName(*eq.getEquippedItem(EquipmentSlot::ACCESSORY2)) << ")\n";
+    flow_.await("请选择 (1/2): ", [this, item_name, on_result](const std::string& choice) {
+        if (choice == "1") {
+            on_result(state_.player.equipItem(item_name, EquipmentSlot::ACCESSORY1));
+        } else if (choice == "2") {
+            on_result(state_.player.equipItem(item_name, EquipmentSlot::ACCESSORY2));
         } else {
-            std::cout<<"无法装备这个物品。\n";
+            console() << "无效选择，取消装备。\n";
+            on_result(false);
         }
-        return; }
-    }catch(...){ }
-    std::cout<<"无效选择。\n";
+    });
 }
 
 // 无参数卸下选择
@@ -1909,642 +2157,722 @@ void Game::unequipAuto() {
     if (eq.getEquippedItem(EquipmentSlot::ARMOR))   slots.push_back({"护甲", EquipmentSlot::ARMOR});
     if (eq.getEquippedItem(EquipmentSlot::ACCESSORY1)) slots.push_back({"饰品1", EquipmentSlot::ACCESSORY1});
     if (eq.getEquippedItem(EquipmentSlot::ACCESSORY2)) slots.push_back({"饰品2", EquipmentSlot::ACCESSORY2});
-    if (slots.empty()) { std::cout<<"当前没有可卸下的装备。\n"; return; }
-    std::cout<<"\n可卸下：\n"; for(size_t i=0;i<slots.size();++i){ std::cout<<"  "<<(i+1)<<". "<<slots[i].first<<"\n"; }
-    std::cout<<"输入编号（back返回）："; std::string sel; std::getline(std::cin, sel); if(sel=="back") return; 
-    try{ int idx=std::stoi(sel); if(idx>0 && idx<=static_cast<int>(slots.size())){
-        if(state_.player.unequipItem(slots[idx-1].second)) std::cout<<"卸下了装备。\n"; else std::cout<<"该槽位没有装备。\n"; return; }
-    }catch(...){ }
-    std::cout<<"无效选择。\n";
+    if (slots.empty()) { console()<<"当前没有可卸下的装备。\n"; return; }
+    console()<<"\n可卸下：\n"; for(size_t i=0;i<slots.size();++i){ console()<<"  "<<(i+1)<<". "<<slots[i].first<<"\n"; }
+    flow_.await("输入编号（back返回）：", [this, slots](const std::string& sel) {
+        if(sel=="back") return; 
+        int idx = 0;
+        if(parseIndex(sel, idx) && idx>0 && idx<=static_cast<int>(slots.size())){
+            if(state_.player.unequipItem(slots[idx-1].second)) console()<<"卸下了装备。\n"; else console()<<"该槽位没有装备。\n";
+            return;
+        }
+        console()<<"无效选择。\n";
+    });
 }
 
-void Game::run(){ 
-    printBanner(); 
-    showOpeningStory();
+void Game::run(TranscriptWriter* recorder){ 
+    start();
     std::string line;
     while(true){ 
-        // 更新玩家状态效果持续时间
-        state_.player.attr().updateStatuses();
-        
-        std::cout<<"\n> "; 
+        // 一行里的多条指令全部执行完再读下一行
+        while (busy()) {
+            if (!resume()) return;
+        }
+        console()<<prompt(); 
         if(!std::getline(std::cin,line)) break; 
-        if(line=="quit" || line=="q"){ 
-            std::cout<<"游戏结束。\n"; 
-            break; 
-        }
-        else if(line=="exit") {
-            // exit命令只在九珠坛有效，用于退出教学区
-            if(state_.current_loc == "jiuzhutan" && state_.in_teaching_detail) {
-                // 退出教学区，回到主地图
-                state_.in_teaching_detail = false;
-                state_.current_loc = "teaching_area";
-                std::cout << "\n=== 退出教学区，回到主地图 ===\n";
-                look();
-            } else {
-                std::cout<<"exit命令只在九珠坛有效，用于退出教学区。\n";
-                std::cout<<"要退出游戏，请使用 quit 或 q 命令。\n";
-            }
+        std::int64_t at_ms = recorder ? recorder->record(line) : -1;
+        if(!handleLine(line, at_ms)) break;
+    }
+}
+
+// 开始游戏：显示标题和开场剧情
+void Game::start() {
+    printBanner(); 
+    showOpeningStory();
+}
+
+// 读取下一行之前的提示语：有流程在等待输入时使用它的提示
+std::string Game::prompt() const {
+    if (busy()) return "";
+    return flow_.waiting() ? flow_.prompt() : "\n> ";
+}
+
+// 中文战斗指令 "挑战XXX" 的前缀
+static constexpr std::string_view kChallenge = "挑战";
+// 批处理的静默前缀："quiet w; w; look" 只显示最后一条指令的结果
+static constexpr std::string_view kQuiet = "quiet ";
+
+// 是否是指令分隔符（半角分号或全角分号"；"），是的话给出它占的字节数
+static size_t separatorAt(std::string_view s, size_t i) {
+    if (s[i] == ';') return 1;
+    if (s.compare(i, 3, "\xEF\xBC\x9B") == 0) return 3;
+    return 0;
+}
+
+// 处理一行输入
+// 功能：含分号的一行作为批处理，拆成多条指令依次执行（见resume）；否则直接执行
+bool Game::handleLine(const std::string& raw, std::int64_t at_ms) {
+    // 上一场战斗或上一行的批处理还没完成时先完成，新输入在之后执行
+    while (busy()) {
+        if (!resume()) return false;
+    }
+    // 离开了一段时间的话，先告诉玩家这期间发生了什么
+    noteInputTime(at_ms >= 0 ? at_ms : wallClockMillis());
+    settleAway();
+    std::string_view line(raw);
+    bool has_separator = false;
+    for (size_t i = 0; i < line.size() && !has_separator; ++i) has_separator = separatorAt(line, i) != 0;
+    if (!has_separator) return execute(line);
+
+    // 批处理：只保存整行和读到的位置，每条指令执行时再取出
+    size_t start = line.find_first_not_of(' ');
+    if (start == std::string_view::npos) start = line.size();
+    batch_.quiet = line.compare(start, kQuiet.size(), kQuiet) == 0;
+    if (batch_.quiet) start += kQuiet.size();
+    batch_.text.assign(line.substr(start));
+    batch_.next = 0;
+    batch_.executed = 0;
+    batch_.muted = false;
+    return resume();
+}
+
+// 取出批处理的下一条指令（跳过空指令）；没有时返回false
+bool Game::nextBatchCommand(std::string_view& out) {
+    std::string_view text(batch_.text);
+    while (batch_.next < text.size()) {
+        size_t begin = batch_.next;
+        size_t end = begin;
+        size_t sep = 0;
+        while (end < text.size() && (sep = separatorAt(text, end)) == 0) ++end;
+        batch_.next = end < text.size() ? end + sep : end;
+        std::string_view cmd = text.substr(begin, end - begin);
+        size_t first = cmd.find_first_not_of(' ');
+        if (first == std::string_view::npos) continue;
+        size_t last = cmd.find_last_not_of(' ');
+        out = cmd.substr(first, last - first + 1);
+        return true;
+    }
+    return false;
+}
+
+// 批处理后面是否还有指令
+bool Game::batchHasMore() const {
+    std::string_view text(batch_.text);
+    for (size_t i = batch_.next; i < text.size(); ++i) {
+        if (text[i] != ' ' && separatorAt(text, i) == 0) return true;
+    }
+    return false;
+}
+
+// 每执行这么多条指令重新统计一次会话内存（一次统计要走遍所有地点和对话表，约几十微秒）
+static constexpr unsigned kMemoryPublishInterval = 64;
+
+// 指令按动词归到哪一类运行指标
+static Metric commandMetric(const CommandLine& cmd) {
+    static const std::unordered_map<std::string_view, Metric> kVerbs = {
+        {"w", Metric::CMD_MOVE}, {"a", Metric::CMD_MOVE}, {"s", Metric::CMD_MOVE}, {"d", Metric::CMD_MOVE},
+        {"goto", Metric::CMD_MOVE}, {"前往", Metric::CMD_MOVE},
+        {"enter", Metric::CMD_MOVE}, {"exit", Metric::CMD_MOVE},
+        {"down", Metric::CMD_MOVE}, {"下楼", Metric::CMD_MOVE}, {"up", Metric::CMD_MOVE}, {"上楼", Metric::CMD_MOVE},
+        {"look", Metric::CMD_LOOK}, {"l", Metric::CMD_LOOK}, {"查看", Metric::CMD_LOOK},
+        {"看", Metric::CMD_LOOK}, {"观察", Metric::CMD_LOOK}, {"刷新信息", Metric::CMD_LOOK},
+        {"map", Metric::CMD_MAP},
+        {"stats", Metric::CMD_STATS}, {"属性", Metric::CMD_STATS}, {"状态", Metric::CMD_STATS},
+        {"inv", Metric::CMD_INVENTORY}, {"i", Metric::CMD_INVENTORY},
+        {"背包", Metric::CMD_INVENTORY}, {"物品", Metric::CMD_INVENTORY},
+        {"task", Metric::CMD_TASK}, {"t", Metric::CMD_TASK}, {"任务", Metric::CMD_TASK}, {"任务列表", Metric::CMD_TASK},
+        {"fight", Metric::CMD_FIGHT}, {"战斗", Metric::CMD_FIGHT}, {kChallenge, Metric::CMD_FIGHT},
+        {"talk", Metric::CMD_TALK}, {"对话", Metric::CMD_TALK},
+        {"buy", Metric::CMD_BUY},
+        {"use", Metric::CMD_ITEM}, {"equip", Metric::CMD_ITEM}, {"unequip", Metric::CMD_ITEM},
+        {"装备", Metric::CMD_ITEM}, {"卸下", Metric::CMD_ITEM},
+        {"allocate", Metric::CMD_ALLOCATE},
+        {"save", Metric::CMD_SAVE}, {"load", Metric::CMD_LOAD},
+        {"help", Metric::CMD_HELP}, {"h", Metric::CMD_HELP}, {"?", Metric::CMD_HELP},
+    };
+    std::string_view verb = cmd.verb();
+    // “挑战X”没有空格，按前缀归类
+    if (verb.rfind(kChallenge, 0) == 0) return Metric::CMD_FIGHT;
+    auto it = kVerbs.find(verb);
+    return it == kVerbs.end() ? Metric::CMD_OTHER : it->second;
+}
+
+// 执行一条指令
+// 功能：先把输入规范化并切分（见CommandLine）；交互流程（商店、对话、菜单）在等待时，
+//       这一行交给它；否则作为指令执行
+bool Game::execute(std::string_view raw) {
+    command_.parse(raw);
+    const CommandLine& cmd = command_;
+    if (++commands_since_memory_ >= kMemoryPublishInterval) publishMemory();
+    MetricTimer timer(flow_.waiting() ? Metric::CMD_MENU : commandMetric(cmd));
+    HX_TRACE_SPAN_TEXT("command", cmd.text());
+    if (flow_.feed(cmd.text())) return true;
+    std::string_view line = cmd.text();
+    if(line=="quit" || line=="q"){ 
+        console()<<"游戏结束。\n"; 
+        return false; 
+    }
+    else if(line=="exit") {
+        // exit命令只在九珠坛有效，用于退出教学区
+        if(state_.current_loc == "jiuzhutan" && state_.in_teaching_detail) {
+            // 退出教学区，回到主地图
+            state_.in_teaching_detail = false;
+            state_.current_loc = "teaching_area";
+            state_.events.publish(LocationEnteredEvent{"jiuzhutan", state_.current_loc});
+            console() << "\n=== 退出教学区，回到主地图 ===\n";
+            look();
+        } else {
+            console()<<"exit命令只在九珠坛有效，用于退出教学区。\n";
+            console()<<"要退出游戏，请使用 quit 或 q 命令。\n";
         }
-        else if(line=="help" || line=="h" || line=="?"){ 
-            showContextualHelp();
-        }
-        else if(line=="help combat"){ 
-            std::cout<<"\n"<<std::string(50,'=')<<"\n";
-            std::cout<<"⚔️ 战斗帮助\n"<<std::string(50,'=')<<"\n";
-            std::cout<<" - 命中与闪避受 SPD 影响；专注=必中；鼓舞=ATK+15%\n";
-            std::cout<<" - 敌人可能施加‘迟缓/紧张’，留意提示\n";
-            std::cout<<" - 装备特效：演讲之词(开场鼓舞)、护目镜(额外闪避)、被子(回合恢复)\n";
-            std::cout<<" - 学霸两件套：武器与护甲同品质 → 本科套装+10%，硕士套装+15%，博士套装+20%\n";
-        }
-        else if(line=="help shop"){ 
-            std::cout<<"\n"<<std::string(50,'=')<<"\n";
-            std::cout<<"🛒 商店帮助\n"<<std::string(50,'=')<<"\n";
-            std::cout<<" - buy <物品名> 购买；sell 出售装备(10金币/件)\n";
-            std::cout<<" - e卡通享受9折；复活符限购2张\n";
-            std::cout<<" - 可输入 ‘详情 <编号>’ 查看描述\n";
-        }
-        else if(line=="help task"){ 
-            std::cout<<"\n"<<std::string(50,'=')<<"\n";
-            std::cout<<"📝 任务帮助\n"<<std::string(50,'=')<<"\n";
-            std::cout<<" - task 查看任务列表；task <任务名> 查看详情\n";
-            std::cout<<" - 某些任务目标会实时更新进度(如S3击败次数)\n";
-        }
-        else if(line=="ending"){
-            std::cout<<"\n" << std::string(60, '=') << "\n";
-            std::cout<<"🌟 结局判定·命运的十字路口 🌟\n";
-            std::cout << std::string(60, '=') << "\n";
-            bool cleared = state_.truth_reward_given && state_.key_i_obtained && state_.key_ii_obtained && state_.key_iii_obtained;
-            int favor = state_.player.getNPCFavor("林清漪");
-            bool has_two_items = 0;
-            {
-                // 检查是否持有【启智笔】【护目镜】【辩锋羽扇】任意两件（包括背包和装备）
-                int count=0; 
-                
-                // 检查背包中的物品
-                auto inv = state_.player.inventory().asSimpleItems();
-                for (auto &it: inv){
-                    if (it.id=="wisdom_pen"||it.id=="goggles"||it.id=="debate_fan") count += (it.count>0);
-                }
-                
-                // 检查已装备的物品
-                auto equipped_items = state_.player.equipment().getEquippedItems();
-                for (const auto& item: equipped_items){
-                    if (item.id=="wisdom_pen"||item.id=="goggles"||item.id=="debate_fan") count += 1;
-                }
-                
-                has_two_items = count>=2;
-            }
-            if(!cleared){
-                std::cout<<"❌ 尚未完成文心潭主线，无法结局判定。\n";
-                std::cout<<"💡 提示：需要集齐三把文心秘钥才能开启结局判定。\n";
-            } else if (state_.wenxintan_fail_streak>=3) {
-                std::cout<<"\n" << std::string(50, '=') << "\n";
-                std::cout<<"💔 结局E：迷失的旅人\n";
-                std::cout << std::string(50, '=') << "\n";
-                std::cout<<"在屡次战斗失败后，你的精神过于疲惫，最终被秘境排斥而出。\n\n";
-                std::cout<<"水镜中的倒影开始模糊，那些曾经清晰的目标变得遥不可及。\n";
-                std::cout<<"你感到一阵眩晕，再次睁开眼时，发现自己正坐在图书馆的桌前。\n";
-                std::cout<<"桌上空空如也，没有《文心潭秘录》，也没有任何痕迹证明刚才的经历。\n\n";
-                std::cout<<"回归现实后，你发现自己对学习的信心受到了打击，成绩反而有所下滑。\n";
-                std::cout<<"那些在秘境中获得的勇气和智慧，仿佛从未存在过。\n";
-                std::cout<<"你开始怀疑，是否真的有过那样一段奇妙的旅程。\n\n";
-                std::cout<<"也许，有些机会只有一次。有些成长，需要更多的坚持。\n";
-                std::cout<<"但请记住，失败不是终点，而是重新开始的起点。\n";
-                std::cout<<"\n🎮 恭喜通关！！\n";
-            } else if(cleared && favor>=50 && has_two_items && state_.player.level()>=10){
-                std::cout<<"\n" << std::string(50, '=') << "\n";
-                std::cout<<"⚖️ 结局C：平衡行者（隐藏结局）\n";
-                std::cout << std::string(50, '=') << "\n";
-                std::cout<<"你看着手中的《文心潭秘录》，心中有了一个大胆的想法。\n";
-                std::cout<<"'也许...我可以找到一种平衡。'你喃喃自语。\n\n";
-                std::cout<<"你深吸一口气，将秘录的力量一分为二：\n";
-                std::cout<<"一半留在秘境，维持这个特殊空间的运转；\n";
-                std::cout<<"一半融入自己的身体，带回现实世界。\n\n";
-                std::cout<<"瞬间，你感受到两股力量在体内交织，既强大又和谐。\n";
-                std::cout<<"你明白，真正的智慧不是选择其中一方，而是找到平衡点。\n\n";
-                std::cout<<"回到现实后，你白天学习、夜晚修炼，创立了'学业互助社'。\n";
-                std::cout<<"你用自己的经历和智慧，帮助那些还在为学业焦虑的同学们。\n";
-                std::cout<<"你告诉他们，学习不是负担，而是成长的过程。\n\n";
-                std::cout<<"渐渐地，你成为了海大校园的传奇人物。\n";
-                std::cout<<"同学们都说，和你聊天后，学习变得不再那么困难。\n";
-                std::cout<<"你明白，这是秘境给你的最好礼物——帮助他人的能力。\n\n";
-                std::cout<<"多年后，当你站在毕业典礼的讲台上时，\n";
-                std::cout<<"你看着台下那些充满希望的年轻面孔，心中涌起无限感慨。\n";
-                std::cout<<"你知道，你的故事将会激励更多的人，去面对自己的心魔，\n";
-                std::cout<<"去追求真正的成长。\n";
-                std::cout<<"\n🎮 恭喜通关！！\n";
-                std::cout<<"\n📋 结局判定条件：等级≥10级 + 林清漪好感度≥50 + 拥有特殊装备≥2件 + 完成文心潭主线\n";
-                std::cout<<"   💡 特殊装备：启智笔、护目镜、辩锋羽扇（包括已装备的）\n";
-            } else if(state_.player.level()>=12 && cleared && favor>=60){
-                std::cout<<"\n" << std::string(50, '=') << "\n";
-                std::cout<<"🌟 结局B：秘境守护者\n";
-                std::cout << std::string(50, '=') << "\n";
-                std::cout<<"你凝视着水镜中林清漪的身影，心中涌起一股暖流。\n";
-                std::cout<<"'我想留下来。'你轻声说道，'我想帮助更多的人。'\n\n";
-                std::cout<<"林清漪的眼中闪过一丝欣慰，她缓缓点头：\n";
-                std::cout<<"'很好，你终于明白了秘境的真正意义。这里需要的不是强大的力量，\n";
-                std::cout<<"而是一颗愿意帮助他人的心。'\n\n";
-                std::cout<<"你接过林清漪手中的《文心潭秘录》，感受到其中蕴含的无穷智慧。\n";
-                std::cout<<"从此刻起，你成为了新的秘境守护者。\n\n";
-                std::cout<<"日复一日，你在水镜前诉说过来人的经验，看见他们重拾自信。\n";
-                std::cout<<"你见证了无数个学子的成长：从迷茫到坚定，从恐惧到勇敢。\n";
-                std::cout<<"每一个成功走出秘境的人，都带着新的希望回到现实。\n\n";
-                std::cout<<"偶尔你也望见现实里的同学们毕业、远行——你知道，这同样是有意义的选择。\n";
-                std::cout<<"你明白，真正的成长不是逃避现实，而是在现实中找到自己的价值。\n\n";
-                std::cout<<"岁月如流水，你在这个特殊的空间里，成为了无数人生命中的指路明灯。\n";
-                std::cout<<"虽然你无法回到现实，但你知道，你的存在让这个世界变得更加美好。\n";
-                std::cout<<"\n🎮 恭喜通关！！\n";
-                std::cout<<"\n📋 结局判定条件：等级≥12级 + 林清漪好感度≥60 + 完成文心潭主线\n";
-            } else if(state_.player.level()>=12 && cleared && favor<60){
-                std::cout<<"\n" << std::string(50, '=') << "\n";
-                std::cout<<"🎓 结局A：学业有成（回归现实）\n";
-                std::cout << std::string(50, '=') << "\n";
-                std::cout<<"你深吸一口气，将三把秘钥合而为一。\n";
-                std::cout<<"瞬间，文心潭的水面爆发出耀眼的光芒，一道通往现实的光门缓缓开启。\n\n";
-                std::cout<<"你踏入光门，回到现实的图书馆。秘录化作流光融入身体，\n";
-                std::cout<<"你感受到一股暖流在体内流淌，那是知识的力量，是成长的印记。\n\n";
-                std::cout<<"此后学习渐入佳境，难点迎刃而解。期末佳绩，名列前茅。\n";
-                std::cout<<"同学们都惊讶于你的变化，但你明白，这不是'开挂'，\n";
-                std::cout<<"而是你在秘境磨砺后的水到渠成。\n\n";
-                std::cout<<"每当夜深人静时，你偶尔会想起那段奇妙的经历，\n";
-                std::cout<<"想起那些与你并肩作战的伙伴，想起那些被击败的心魔。\n";
-                std::cout<<"你知道，那些经历已经成为了你人生中最宝贵的财富。\n\n";
-                std::cout<<"毕业那天，你站在海大的校园里，看着那些还在为学业焦虑的学弟学妹们，\n";
-                std::cout<<"心中涌起一股暖流。你决定，要将这份力量传递下去。\n";
-                std::cout<<"\n🎮 恭喜通关！！\n";
-                std::cout<<"\n📋 结局判定条件：等级≥12级 + 林清漪好感度<60 + 完成文心潭主线\n";
-            } else if (cleared){
-                std::cout<<"\n" << std::string(50, '=') << "\n";
-                std::cout<<"🌅 结局D：普通回归\n";
-                std::cout << std::string(50, '=') << "\n";
-                std::cout<<"你完成了文心潭的试炼，但心中仍有些许遗憾。\n";
-                std::cout<<"你明白，自己还没有完全准备好面对更大的挑战。\n\n";
-                std::cout<<"你返回现实，保留了部分收获。学习有所提升，但并非腾飞。\n";
-                std::cout<<"你偶尔会想起那段奇妙经历，但记忆如梦，渐行渐远。\n\n";
-                std::cout<<"不过，你并没有完全忘记。\n";
-                std::cout<<"每当遇到困难时，你总会想起在秘境中学到的那些道理：\n";
-                std::cout<<"面对恐惧，理解问题，拆解困难，最终克服。\n\n";
-                std::cout<<"虽然你的成长没有那么显著，但你明白，\n";
-                std::cout<<"真正的成长往往是在潜移默化中发生的。\n";
-                std::cout<<"也许，下一次机会来临时，你会做得更好。\n\n";
-                std::cout<<"毕竟，人生不是一场游戏，而是一段漫长的旅程。\n";
-                std::cout<<"每一个选择，每一次尝试，都是成长的一部分。\n";
-                std::cout<<"\n🎮 恭喜通关！！\n";
-                std::cout<<"\n📋 结局判定条件：完成文心潭主线 + 其他情况（未满足上述特殊条件）\n";
-            }
-            
-            std::cout << "\n" << std::string(60, '=') << "\n";
-            std::cout << "感谢您体验《文心潭秘录》的冒险之旅！\n";
-            std::cout << "愿您在现实的学习生活中，也能像在秘境中一样勇敢前行。\n";
-            std::cout << std::string(60, '=') << "\n";
-        }
-        else if(line=="look" || line=="l" || line=="查看" || line=="看" || line=="观察") look();
-        else if(line=="w" || line=="a" || line=="s" || line=="d") {
-            // WASD移动系统 - 严格检查方向连接
-            std::string direction;
-            if(line=="w") direction = "北";
-            else if(line=="a") direction = "西";
-            else if(line=="s") direction = "南";
-            else if(line=="d") direction = "东";
+    }
+    else if(line=="help" || line=="h" || line=="?"){ 
+        showContextualHelp();
+    }
+    else if(line=="help combat"){ 
+        console()<<"\n"<<std::string(50,'=')<<"\n";
+        console()<<"⚔️ 战斗帮助\n"<<std::string(50,'=')<<"\n";
+        console()<<" - 命中与闪避受 SPD 影响；专注=必中；鼓舞=ATK+15%\n";
+        console()<<" - 敌人可能施加‘迟缓/紧张’，留意提示\n";
+        console()<<" - 装备特效：演讲之词(开场鼓舞)、护目镜(额外闪避)、被子(回合恢复)\n";
+        console()<<" - 学霸两件套：武器与护甲同品质 → 本科套装+10%，硕士套装+15%，博士套装+20%\n";
+    }
+    else if(line=="help shop"){ 
+        console()<<"\n"<<std::string(50,'=')<<"\n";
+        console()<<"🛒 商店帮助\n"<<std::string(50,'=')<<"\n";
+        console()<<" - buy <物品名> 购买；sell 出售装备(10金币/件)\n";
+        console()<<" - e卡通享受9折；复活符限购2张\n";
+        console()<<" - 可输入 ‘详情 <编号>’ 查看描述\n";
+    }
+    else if(line=="help task"){ 
+        console()<<"\n"<<std::string(50,'=')<<"\n";
+        console()<<"📝 任务帮助\n"<<std::string(50,'=')<<"\n";
+        console()<<" - task 查看任务列表；task <任务名> 查看详情\n";
+        console()<<" - 某些任务目标会实时更新进度(如S3击败次数)\n";
+    }
+    else if(line=="ending"){
+        console()<<"\n" << std::string(60, '=') << "\n";
+        console()<<"🌟 结局判定·命运的十字路口 🌟\n";
+        console() << std::string(60, '=') << "\n";
+        bool cleared = state_.truth_reward_given && state_.key_i_obtained && state_.key_ii_obtained && state_.key_iii_obtained;
+        int favor = state_.player.getNPCFavor("林清漪");
+        bool has_two_items = 0;
+        {
+            // 检查是否持有【启智笔】【护目镜】【辩锋羽扇】任意两件（包括背包和装备）
+            int count=0; 
             
-            // 检查当前地点是否有该方向的出口
-            auto* loc = state_.map.get(state_.current_loc);
-            if(!loc) {
-                std::cout<<"当前地点不存在。\n";
-                continue;
+            // 检查背包中的物品
+            const Inventory& inv = state_.player.inventory();
+            for (const char* id : {"wisdom_pen", "goggles", "debate_fan"}) {
+                count += (inv.quantity(id) > 0);
             }
             
-            bool has_exit = false;
-            for(const auto& exit : loc->exits) {
-                if(exit.label == direction) {
-                    has_exit = true;
-                    break;
-                }
+            // 检查已装备的物品
+            auto equipped_items = state_.player.equipment().getEquippedItems();
+            for (const auto& item: equipped_items){
+                if (item.id=="wisdom_pen"||item.id=="goggles"||item.id=="debate_fan") count += 1;
             }
             
-            if(has_exit) {
-                move(direction);
-            } else {
-                std::cout<<"无法移动。\n";
-            }
+            has_two_items = count>=2;
+        }
+        if(!cleared){
+            console()<<"❌ 尚未完成文心潭主线，无法结局判定。\n";
+            console()<<"💡 提示：需要集齐三把文心秘钥才能开启结局判定。\n";
+        } else if (state_.wenxintan_fail_streak>=3) {
+            console()<<"\n" << std::string(50, '=') << "\n";
+            console()<<"💔 结局E：迷失的旅人\n";
+            console() << std::string(50, '=') << "\n";
+            console()<<"在屡次战斗失败后，你的精神过于疲惫，最终被秘境排斥而出。\n\n";
+            console()<<"水镜中的倒影开始模糊，那些曾经清晰的目标变得遥不可及。\n";
+            console()<<"你感到一阵眩晕，再次睁开眼时，发现自己正坐在图书馆的桌前。\n";
+            console()<<"桌上空空如也，没有《文心潭秘录》，也没有任何痕迹证明刚才的经历。\n\n";
+            console()<<"回归现实后，你发现自己对学习的信心受到了打击，成绩反而有所下滑。\n";
+            console()<<"那些在秘境中获得的勇气和智慧，仿佛从未存在过。\n";
+            console()<<"你开始怀疑，是否真的有过那样一段奇妙的旅程。\n\n";
+            console()<<"也许，有些机会只有一次。有些成长，需要更多的坚持。\n";
+            console()<<"但请记住，失败不是终点，而是重新开始的起点。\n";
+            console()<<"\n🎮 恭喜通关！！\n";
+        } else if(cleared && favor>=50 && has_two_items && state_.player.level()>=10){
+            console()<<"\n" << std::string(50, '=') << "\n";
+            console()<<"⚖️ 结局C：平衡行者（隐藏结局）\n";
+            console() << std::string(50, '=') << "\n";
+            console()<<"你看着手中的《文心潭秘录》，心中有了一个大胆的想法。\n";
+            console()<<"'也许...我可以找到一种平衡。'你喃喃自语。\n\n";
+            console()<<"你深吸一口气，将秘录的力量一分为二：\n";
+            console()<<"一半留在秘境，维持这个特殊空间的运转；\n";
+            console()<<"一半融入自己的身体，带回现实世界。\n\n";
+            console()<<"瞬间，你感受到两股力量在体内交织，既强大又和谐。\n";
+            console()<<"你明白，真正的智慧不是选择其中一方，而是找到平衡点。\n\n";
+            console()<<"回到现实后，你白天学习、夜晚修炼，创立了'学业互助社'。\n";
+            console()<<"你用自己的经历和智慧，帮助那些还在为学业焦虑的同学们。\n";
+            console()<<"你告诉他们，学习不是负担，而是成长的过程。\n\n";
+            console()<<"渐渐地，你成为了海大校园的传奇人物。\n";
+            console()<<"同学们都说，和你聊天后，学习变得不再那么困难。\n";
+            console()<<"你明白，这是秘境给你的最好礼物——帮助他人的能力。\n\n";
+            console()<<"多年后，当你站在毕业典礼的讲台上时，\n";
+            console()<<"你看着台下那些充满希望的年轻面孔，心中涌起无限感慨。\n";
+            console()<<"你知道，你的故事将会激励更多的人，去面对自己的心魔，\n";
+            console()<<"去追求真正的成长。\n";
+            console()<<"\n🎮 恭喜通关！！\n";
+            console()<<"\n📋 结局判定条件：等级≥10级 + 林清漪好感度≥50 + 拥有特殊装备≥2件 + 完成文心潭主线\n";
+            console()<<"   💡 特殊装备：启智笔、护目镜、辩锋羽扇（包括已装备的）\n";
+        } else if(state_.player.level()>=12 && cleared && favor>=60){
+            console()<<"\n" << std::string(50, '=') << "\n";
+            console()<<"🌟 结局B：秘境守护者\n";
+            console() << std::string(50, '=') << "\n";
+            console()<<"你凝视着水镜中林清漪的身影，心中涌起一股暖流。\n";
+            console()<<"'我想留下来。'你轻声说道，'我想帮助更多的人。'\n\n";
+            console()<<"林清漪的眼中闪过一丝欣慰，她缓缓点头：\n";
+            console()<<"'很好，你终于明白了秘境的真正意义。这里需要的不是强大的力量，\n";
+            console()<<"而是一颗愿意帮助他人的心。'\n\n";
+            console()<<"你接过林清漪手中的《文心潭秘录》，感受到其中蕴含的无穷智慧。\n";
+            console()<<"从此刻起，你成为了新的秘境守护者。\n\n";
+            console()<<"日复一日，你在水镜前诉说过来人的经验，看见他们重拾自信。\n";
+            console()<<"你见证了无数个学子的成长：从迷茫到坚定，从恐惧到勇敢。\n";
+            console()<<"每一个成功走出秘境的人，都带着新的希望回到现实。\n\n";
+            console()<<"偶尔你也望见现实里的同学们毕业、远行——你知道，这同样是有意义的选择。\n";
+            console()<<"你明白，真正的成长不是逃避现实，而是在现实中找到自己的价值。\n\n";
+            console()<<"岁月如流水，你在这个特殊的空间里，成为了无数人生命中的指路明灯。\n";
+            console()<<"虽然你无法回到现实，但你知道，你的存在让这个世界变得更加美好。\n";
+            console()<<"\n🎮 恭喜通关！！\n";
+            console()<<"\n📋 结局判定条件：等级≥12级 + 林清漪好感度≥60 + 完成文心潭主线\n";
+        } else if(state_.player.level()>=12 && cleared && favor<60){
+            console()<<"\n" << std::string(50, '=') << "\n";
+            console()<<"🎓 结局A：学业有成（回归现实）\n";
+            console() << std::string(50, '=') << "\n";
+            console()<<"你深吸一口气，将三把秘钥合而为一。\n";
+            console()<<"瞬间，文心潭的水面爆发出耀眼的光芒，一道通往现实的光门缓缓开启。\n\n";
+            console()<<"你踏入光门，回到现实的图书馆。秘录化作流光融入身体，\n";
+            console()<<"你感受到一股暖流在体内流淌，那是知识的力量，是成长的印记。\n\n";
+            console()<<"此后学习渐入佳境，难点迎刃而解。期末佳绩，名列前茅。\n";
+            console()<<"同学们都惊讶于你的变化，但你明白，这不是'开挂'，\n";
+            console()<<"而是你在秘境磨砺后的水到渠成。\n\n";
+            console()<<"每当夜深人静时，你偶尔会想起那段奇妙的经历，\n";
+            console()<<"想起那些与你并肩作战的伙伴，想起那些被击败的心魔。\n";
+            console()<<"你知道，那些经历已经成为了你人生中最宝贵的财富。\n\n";
+            console()<<"毕业那天，你站在海大的校园里，看着那些还在为学业焦虑的学弟学妹们，\n";
+            console()<<"心中涌起一股暖流。你决定，要将这份力量传递下去。\n";
+            console()<<"\n🎮 恭喜通关！！\n";
+            console()<<"\n📋 结局判定条件：等级≥12级 + 林清漪好感度<60 + 完成文心潭主线\n";
+        } else if (cleared){
+            console()<<"\n" << std::string(50, '=') << "\n";
+            console()<<"🌅 结局D：普通回归\n";
+            console() << std::string(50, '=') << "\n";
+            console()<<"你完成了文心潭的试炼，但心中仍有些许遗憾。\n";
+            console()<<"你明白，自己还没有完全准备好面对更大的挑战。\n\n";
+            console()<<"你返回现实，保留了部分收获。学习有所提升，但并非腾飞。\n";
+            console()<<"你偶尔会想起那段奇妙经历，但记忆如梦，渐行渐远。\n\n";
+            console()<<"不过，你并没有完全忘记。\n";
+            console()<<"每当遇到困难时，你总会想起在秘境中学到的那些道理：\n";
+            console()<<"面对恐惧，理解问题，拆解困难，最终克服。\n\n";
+            console()<<"虽然你的成长没有那么显著，但你明白，\n";
+            console()<<"真正的成长往往是在潜移默化中发生的。\n";
+            console()<<"也许，下一次机会来临时，你会做得更好。\n\n";
+            console()<<"毕竟，人生不是一场游戏，而是一段漫长的旅程。\n";
+            console()<<"每一个选择，每一次尝试，都是成长的一部分。\n";
+            console()<<"\n🎮 恭喜通关！！\n";
+            console()<<"\n📋 结局判定条件：完成文心潭主线 + 其他情况（未满足上述特殊条件）\n";
         }
-        else if(line=="talk" || line=="对话") {
-            talkAuto();
+        
+        console() << "\n" << std::string(60, '=') << "\n";
+        console() << "感谢您体验《文心潭秘录》的冒险之旅！\n";
+        console() << "愿您在现实的学习生活中，也能像在秘境中一样勇敢前行。\n";
+        console() << std::string(60, '=') << "\n";
+    }
+    else if(line=="look" || line=="l" || line=="查看" || line=="看" || line=="观察") look();
+    else if(line=="w" || line=="a" || line=="s" || line=="d") {
+        // WASD移动系统 - 严格检查方向连接
+        std::string direction;
+        if(line=="w") direction = "北";
+        else if(line=="a") direction = "西";
+        else if(line=="s") direction = "南";
+        else if(line=="d") direction = "东";
+        
+        // 检查当前地点是否有该方向的出口
+        auto* loc = state_.map.get(state_.current_loc);
+        if(!loc) {
+            console()<<"当前地点不存在。\n";
+            return true;
         }
         
-        else if(line=="fight" || line=="战斗" || line=="挑战") {
-            fightAuto();
+        bool has_exit = false;
+        for(const auto& exit : loc->exits) {
+            if(exit.label == direction) {
+                has_exit = true;
+                break;
+            }
         }
-        else if(line=="monsters" || line=="怪物信息" || line=="刷新信息") {
-            showMonsterSpawnInfo();
+        
+        if(has_exit) {
+            move(direction);
+        } else {
+            console()<<"无法移动。\n";
         }
-        else if(line.rfind("fight ",0)==0){ 
-            std::string target = line.substr(6); 
-            auto* loc = state_.map.get(state_.current_loc); 
-            if(!loc){ 
-                std::cout<<"未知地点\n"; 
-                continue;
-            } 
-            bool found=false; 
-            for(auto en : loc->enemies){ 
-                if(en.name()==target){ 
-                    found=true; 
-                    
-                    // 记录战斗前状态
-                    int old_xp = state_.player.xp();
-                    int old_coins = state_.player.coins();
-                    int old_level = state_.player.level();
-                    
-                    std::string log; 
-                    // 检查是否可以战斗（怪物数量限制）
-                    if (!canSpawnMonster(state_.current_loc, en.name())) {
-                        std::cout << "【提示】" << formatMonsterName(en) << " 暂时不在这个区域，需要等待刷新。\n";
-                        std::cout << "输入 'monsters' 查看怪物刷新信息。\n";
-                        break;
-                    }
-                    
-                    // 清屏功能 - 让战斗界面更清晰
-                    #ifdef _WIN32
-                        system("cls");
-                    #else
-                        system("clear");
-                    #endif
-                    
-                    // 显示战斗开始信息
-                    std::cout << "\n" << std::string(50, '=') << "\n";
-                    std::cout << "⚔️ 战斗开始！\n";
-                    std::cout << "挑战目标: " << formatMonsterName(en) << "\n";
-                    std::cout << "你的等级: Lv" << state_.player.level() << "\n";
-                    std::cout << std::string(50, '=') << "\n";
-                    
-                    if(combat_.fight(state_.player,en,log)) {
-                        std::cout<<log;
-                        handleCombatVictory(en, old_xp, old_coins, old_level);
-                    } else {
-                        std::cout<<log;
-                        // 战斗失败，执行死亡惩罚
-                        handlePlayerDeath();
-                        if (state_.current_loc == "wenxintan") {
-                            onWenxinFail(state_);
-                        }
-                    }
-                    break; 
-                } 
-            } 
-            if(!found) std::cout<<"这里没有这个敌人。\n"; 
-        }
-        else if(line.rfind("挑战",0)==0) {
-            // 处理中文战斗指令 "挑战XXX"
-            std::string target = line.substr(2); // 跳过"挑战"
-            auto* loc = state_.map.get(state_.current_loc); 
-            if(!loc){ 
-                std::cout<<"未知地点\n"; 
-                continue;
-            } 
-            bool found=false; 
-            for(auto en : loc->enemies){ 
-                if(en.name()==target){ 
-                    found=true; 
-                    
-                    // 记录战斗前状态
-                    int old_xp = state_.player.xp();
-                    int old_coins = state_.player.coins();
-                    int old_level = state_.player.level();
-                    
-                    std::string log; 
-                    // 检查是否可以战斗（怪物数量限制）
-                    if (!canSpawnMonster(state_.current_loc, en.name())) {
-                        std::cout << "【提示】" << formatMonsterName(en) << " 暂时不在这个区域，需要等待刷新。\n";
-                        std::cout << "输入 'monsters' 查看怪物刷新信息。\n";
-                        break;
-                    }
-                    
-                    // 清屏功能 - 让战斗界面更清晰
-                    #ifdef _WIN32
-                        system("cls");
-                    #else
-                        system("clear");
-                    #endif
-                    
-                    // 显示战斗开始信息
-                    std::cout << "\n" << std::string(50, '=') << "\n";
-                    std::cout << "⚔️ 战斗开始！\n";
-                    std::cout << "挑战目标: " << formatMonsterName(en) << "\n";
-                    std::cout << "你的等级: Lv" << state_.player.level() << "\n";
-                    std::cout << std::string(50, '=') << "\n";
-                    
-                    if(combat_.fight(state_.player,en,log)) {
-                        std::cout<<log;
-                        handleCombatVictory(en, old_xp, old_coins, old_level);
-                    } else {
-                        std::cout<<log;
-                        // 战斗失败，执行死亡惩罚
-                        handlePlayerDeath();
-                        if (state_.current_loc == "wenxintan") {
-                            onWenxinFail(state_);
-                        }
-                    }
-                    break; 
-                } 
-            } 
-            if(!found) std::cout<<"这里没有这个敌人。\n"; 
-        }
-        else if(line.rfind("buy ",0)==0) {
-            std::string item_name = line.substr(4);
-            auto* loc = state_.map.get(state_.current_loc);
-            if(!loc) {
-                std::cout<<"未知地点\n";
-                continue;
-            }
-            bool found = false;
-            for(const auto& item : loc->shop) {
-                if(item.name == item_name) {
-                    found = true;
-                    if(state_.player.spendCoins(item.price)) {
-                        state_.player.inventory().add(item, 1);
-                        std::cout<<"购买了 " << item.name << "。\n";
-                    } else {
-                        std::cout<<"金币不足。\n";
-                    }
-                    break;
-                }
-            }
-            if(!found) std::cout<<"商店中没有这个物品。\n";
+    }
+    else if(line=="down" || line=="下楼" || line=="up" || line=="上楼") {
+        // 秘境的阶梯：文心潭和每层的下行阶梯可以下楼，每层的入口可以上楼
+        const char* label = (line=="down" || line=="下楼") ? Dungeon::kDownLabel : Dungeon::kUpLabel;
+        auto* loc = state_.map.get(state_.current_loc);
+        if(loc && loc->findExitByLabel(label)) {
+            move(label);
+        } else {
+            console()<<"这里没有可以"<<label<<"的阶梯。\n";
         }
-        else if(line.rfind("use ",0)==0) {
-            std::string item_name = line.substr(4);
-            if(!state_.player.useItem(item_name)) {
-                std::cout<<"无法使用这个物品。\n";
-            }
+    }
+    else if(line=="talk" || line=="对话") {
+        talkAuto();
+    }
+    
+    else if(line=="fight" || line=="战斗" || line=="挑战") {
+        fightAuto();
+    }
+    else if(line=="monsters" || line=="怪物信息" || line=="刷新信息") {
+        showMonsterSpawnInfo();
+    }
+    else if((cmd.verb()=="fight" && cmd.size()>1) || line.rfind(kChallenge,0)==0) {
+        // "fight <名字>" 或中文的 "挑战<名字>"（名字前可以有空格）
+        std::string_view input = cmd.verb()=="fight" ? cmd.rest() : line.substr(kChallenge.size());
+        if (!input.empty() && input.front()==' ') input.remove_prefix(1);
+        auto* loc = state_.map.get(state_.current_loc); 
+        if(!loc){ 
+            console()<<"未知地点\n"; 
+            return true;
+        } 
+        // 名字可以只输入一部分或有错字
+        const Enemy* en = matchEnemy(*loc, input);
+        if(!en) {
+            console()<<"这里没有这个敌人。\n"; 
+        }
+        // 检查是否可以战斗（怪物数量限制）
+        else if (!canSpawnMonster(state_.current_loc, en->name())) {
+            console() << "【提示】" << formatMonsterName(*en) << " 暂时不在这个区域，需要等待刷新。\n";
+            console() << "输入 'monsters' 查看怪物刷新信息。\n";
+        } else {
+            beginCombat(*en, true);
         }
-        else if(line=="equip" || line=="装备") {
-            equipAuto();
-        }
-        else if(line.rfind("equip ",0)==0) {
-            std::string item_name = line.substr(6);
-            // 查找物品以获取颜色信息
-            auto items = state_.player.inventory().list();
-            Item* found_item = nullptr;
-            for (const auto& item : items) {
-                if (item.name.find(item_name) != std::string::npos || 
-                    item_name.find(item.name) != std::string::npos ||
-                    item.id == item_name) {
-                    found_item = const_cast<Item*>(&item);
-                    break;
+    }
+    else if(cmd.verb()=="buy" && cmd.size()>1) {
+        std::string_view item_name = cmd.rest();
+        auto* loc = state_.map.get(state_.current_loc);
+        if(!loc) {
+            console()<<"未知地点\n";
+            return true;
+        }
+        bool found = false;
+        for(const auto& item : loc->shop) {
+            if(item.name == item_name) {
+                found = true;
+                if(state_.player.spendCoins(item.price)) {
+                    state_.player.gainItem(item, 1);
+                    console()<<"购买了 " << item.name << "。\n";
+                } else {
+                    console()<<"金币不足。\n";
                 }
+                break;
             }
-            
-            if(state_.player.equipItem(item_name)) {
+        }
+        if(!found) console()<<"商店中没有这个物品。\n";
+    }
+    else if(cmd.verb()=="use" && cmd.size()>1) {
+        if(!state_.player.useItem(cmd.rest())) {
+            console()<<"无法使用这个物品。\n";
+        }
+    }
+    else if(line=="equip" || line=="装备") {
+        equipAuto();
+    }
+    else if(cmd.verb()=="equip" && cmd.size()>1) {
+        std::string item_name(cmd.rest());
+        // 查找物品以获取颜色信息
+        std::optional<Item> found_item;
+        if (const Item* item = state_.player.inventory().get(state_.player.inventory().match(item_name))) {
+            found_item = *item;
+        }
+        
+        equipNamed(item_name, [item_name, found_item](bool ok) {
+            if(ok) {
                 if (found_item) {
-                    std::cout<<"装备了 " << getColoredItemName(*found_item) << "。\n";
+                    console()<<"装备了 " << getColoredItemName(*found_item) << "。\n";
                     // 显示装备详细信息
-                    std::cout << "\n" << std::string(40, '-') << "\n";
-                    std::cout << "📋 装备详情：\n";
-                    std::cout << formatEquipmentDetails(*found_item);
-                    std::cout << std::string(40, '-') << "\n";
+                    console() << "\n" << std::string(40, '-') << "\n";
+                    console() << "📋 装备详情：\n";
+                    console() << formatEquipmentDetails(*found_item);
+                    console() << std::string(40, '-') << "\n";
                 } else {
-                    std::cout<<"装备了 " << item_name << "。\n";
+                    console()<<"装备了 " << item_name << "。\n";
                 }
             } else {
-                std::cout<<"无法装备这个物品。\n";
+                console()<<"无法装备这个物品。\n";
             }
+        });
+    }
+    else if(line=="unequip" || line=="卸下") {
+        unequipAuto();
+    }
+    else if(cmd.verb()=="unequip" && cmd.size()>1) {
+        std::string_view slot_name = cmd.rest();
+        EquipmentSlot slot;
+        if(slot_name == "weapon" || slot_name == "武器") slot = EquipmentSlot::WEAPON;
+        else if(slot_name == "armor" || slot_name == "护甲" || slot_name == "防具") slot = EquipmentSlot::ARMOR;
+        else if(slot_name == "accessory1" || slot_name == "饰品1" || slot_name == "饰品一") slot = EquipmentSlot::ACCESSORY1;
+        else if(slot_name == "accessory2" || slot_name == "饰品2" || slot_name == "饰品二") slot = EquipmentSlot::ACCESSORY2;
+        else {
+            console()<<"无效的装备槽位。请使用: 武器/护甲/饰品1/饰品2 或 weapon/armor/accessory1/accessory2\n";
+            return true;
+        }
+        if(state_.player.unequipItem(slot)) {
+            console()<<"卸下了装备。\n";
+        } else {
+            console()<<"该槽位没有装备。\n";
         }
-        else if(line=="unequip" || line=="卸下") {
-            unequipAuto();
-        }
-        else if(line.rfind("unequip ",0)==0) {
-            std::string slot_name = line.substr(8);
-            EquipmentSlot slot;
-            if(slot_name == "weapon" || slot_name == "武器") slot = EquipmentSlot::WEAPON;
-            else if(slot_name == "armor" || slot_name == "护甲" || slot_name == "防具") slot = EquipmentSlot::ARMOR;
-            else if(slot_name == "accessory1" || slot_name == "饰品1" || slot_name == "饰品一") slot = EquipmentSlot::ACCESSORY1;
-            else if(slot_name == "accessory2" || slot_name == "饰品2" || slot_name == "饰品二") slot = EquipmentSlot::ACCESSORY2;
-            else {
-                std::cout<<"无效的装备槽位。请使用: 武器/护甲/饰品1/饰品2 或 weapon/armor/accessory1/accessory2\n";
-                continue;
-            }
-            if(state_.player.unequipItem(slot)) {
-                std::cout<<"卸下了装备。\n";
-            } else {
-                std::cout<<"该槽位没有装备。\n";
-            }
+    }
+    else if(cmd.verb()=="optimize" || cmd.verb()=="配装") {
+        recommendLoadout(cmd.size()>1 ? cmd.rest() : std::string_view());
+    }
+    else if((cmd.verb()=="goto" || cmd.verb()=="前往") && cmd.size()>1) {
+        travelTo(cmd.rest());
+    }
+    else if(line=="memory" || line=="内存统计") {
+        // 管理用：这一局各部分占用的内存，以及所有会话的平均值
+        publishMemory();
+        console()<<formatMemoryReport(memory_published_, liveSessionMemory(), liveSessions());
+    }
+    else if(line=="metrics" || line=="性能统计") {
+        // 管理用：各类指令和子系统的耗时、内存分配（所有线程合并）
+        console()<<formatMetricsTable();
+    }
+    else if(cmd.verb()=="trace") {
+        // 管理用：时间线跟踪 trace on/off/dump [文件]，导出的JSON用 chrome://tracing 或 ui.perfetto.dev 打开
+        std::string_view sub = cmd.word(1);
+        if (!tracingCompiled()) {
+            console()<<"这个版本编译时没有打开跟踪点（CMake 选项 ENABLE_TRACING=OFF）。\n";
+        } else if (sub=="on") {
+            setTracing(true);
+            console()<<"跟踪已打开。\n";
+        } else if (sub=="off") {
+            setTracing(false);
+            console()<<"跟踪已关闭，已记录 "<<traceEventCount()<<" 个跟踪点。\n";
+        } else if (sub=="dump") {
+            std::string path = cmd.size()>2 ? std::string(cmd.rest(2)) : "trace.json";
+            if (writeChromeTraceFile(path)) console()<<"已导出 "<<traceEventCount()<<" 个跟踪点到 "<<path<<"\n";
+            else console()<<"无法写入 "<<path<<"\n";
+        } else {
+            console()<<"跟踪"<<(tracingEnabled() ? "已打开" : "未打开")<<"，已记录 "<<traceEventCount()<<" 个跟踪点。\n";
+            console()<<"用法: trace on | trace off | trace dump [文件]\n";
         }
-        else if(line=="save"){ 
-            // 检查是否已通关
-            if (state_.truth_reward_given) {
-                std::cout<<"通关后无法存档\n";
-            } else if(SaveLoad::save(state_)) {
-                std::cout<<"存档成功。\n"; 
-            } else {
-                std::cout<<"存档失败。\n"; 
-            }
+    }
+    else if(line=="hash" || line=="状态哈希") {
+        // 调试用：显示当前状态的哈希，回放或重构前后对比
+        StateDigest d = stateHash();
+        console()<<"状态哈希: "<<hashToHex(d.total)<<"\n";
+        console()<<"  玩家 "<<hashToHex(d.player)<<"  背包 "<<hashToHex(d.inventory)<<"  装备 "<<hashToHex(d.equipment)<<"\n";
+        console()<<"  好感 "<<hashToHex(d.favors)<<"  任务 "<<hashToHex(d.tasks)<<"  对话 "<<hashToHex(d.dialogue)<<"\n";
+        console()<<"  刷新 "<<hashToHex(d.spawns)<<"  标记 "<<hashToHex(d.flags)<<"  货架 "<<hashToHex(d.world)<<"\n";
+    }
+    else if(line=="save"){ 
+        // 检查是否已通关
+        if (state_.truth_reward_given) {
+            console()<<"通关后无法存档\n";
+        } else if(saveGame()) {
+            console()<<"存档成功。\n"; 
+        } else {
+            console()<<"存档失败。\n"; 
         }
-        else if(line=="load"){ 
-            if(SaveLoad::load(state_)) { 
-                std::cout<<"读档成功。\n"; 
-                // 确保怪物刷新系统被正确初始化
-                if (state_.monster_spawns.empty()) {
-                    initializeMonsterSpawns();
-                }
-                // 重新初始化NPC对话内容，确保对话系统正常工作
-                // 这不会覆盖已保存的对话状态（如visited_dialogues_, memories_等）
-                initializeNPCDialogues();
-                look(); 
-            } else std::cout<<"读档失败。\n"; 
-        }
-        else if(line=="stats" || line=="s" || line=="属性" || line=="状态"){ 
-            auto &p = state_.player; 
-            std::cout << "\n" << std::string(50, '=') << "\n";
-            std::cout << "📊 角色属性\n";
-            std::cout << std::string(50, '=') << "\n";
-            std::cout << "等级: " << p.level() << " | XP: " << p.xp() << " | 金币: " << p.coins() << "\n";
-            std::cout << "生命: " << p.attr().hp << "/" << p.attr().max_hp << "\n";
-            std::cout << "攻击: " << p.attr().atk << " | 防御: " << p.attr().def_ << " | 速度: " << p.attr().spd << "\n";
-            if(p.attr().available_points > 0) {
-                std::cout << "未分配属性点: " << p.attr().available_points << "\n";
-                std::cout << "可用属性：hp(生命), atk(攻击), def(防御), spd(速度)\n";
-                std::cout << "示例：allocate hp 1 或 allocate atk 2\n";
-            }
-            std::cout << "\n装备信息：\n" << p.equipment().getEquipmentInfo() << "\n";
-            std::cout << std::string(50, '=') << "\n";
+    }
+    else if(line=="load"){ 
+        if(loadGame()) { 
+            console()<<"读档成功。\n"; 
+            // 确保怪物刷新系统被正确初始化
+            if (state_.monster_spawns.empty()) {
+                initializeMonsterSpawns();
+            }
+            // 按读档后的回合重建定时任务
+            scheduleWorldTimers();
+            // 重新初始化NPC对话内容，确保对话系统正常工作
+            // 这不会覆盖已保存的对话状态（如visited_dialogues_, memories_等）
+            initializeNPCDialogues();
+            // 从存档记下的最后输入时刻算离线进度（读档前这一局攒下的回合不算）
+            away_turns_ = 0;
+            noteInputTime(input_ms_);
+            settleAway();
+            look(); 
+        } else console()<<"读档失败。\n"; 
+    }
+    else if(line=="stats" || line=="s" || line=="属性" || line=="状态"){ 
+        auto &p = state_.player; 
+        console() << "\n" << std::string(50, '=') << "\n";
+        console() << "📊 角色属性\n";
+        console() << std::string(50, '=') << "\n";
+        console() << "等级: " << p.level() << " | XP: " << p.xp() << " | 金币: " << p.coins() << "\n";
+        console() << "生命: " << p.attr().hp << "/" << p.attr().max_hp << "\n";
+        console() << "攻击: " << p.attr().atk << " | 防御: " << p.attr().def_ << " | 速度: " << p.attr().spd << "\n";
+        if(p.attr().available_points > 0) {
+            console() << "未分配属性点: " << p.attr().available_points << "\n";
+            console() << "可用属性：hp(生命), atk(攻击), def(防御), spd(速度)\n";
+            console() << "示例：allocate hp 1 或 allocate atk 2\n";
+        }
+        console() << "\n装备信息：\n" << p.equipment().getEquipmentInfo() << "\n";
+        console() << std::string(50, '=') << "\n";
+    }
+    else if(line=="inv" || line=="i" || line=="背包" || line=="物品"){ 
+        // 获取当前已装备的物品ID列表
+        std::set<std::string> equipped_ids;
+        auto equipped_items = state_.player.equipment().getEquippedItems();
+        for (const auto& item : equipped_items) {
+            equipped_ids.insert(item.id);
         }
-        else if(line=="inv" || line=="i" || line=="背包" || line=="物品"){ 
-            auto items = state_.player.inventory().list(); 
-            
-            // 获取当前已装备的物品ID列表
-            std::set<std::string> equipped_ids;
-            auto equipped_items = state_.player.equipment().getEquippedItems();
-            for (const auto& item : equipped_items) {
-                equipped_ids.insert(item.id);
-            }
-            
-            // 过滤掉已装备的物品
-            std::vector<Item> unequipped_items;
-            for (const auto& it : items) {
-                if (it.type != ItemType::EQUIPMENT || equipped_ids.find(it.id) == equipped_ids.end()) {
-                    unequipped_items.push_back(it);
-                }
+        
+        // 过滤掉已装备的物品
+        std::vector<const Item*> unequipped_items;
+        for (const auto& it : state_.player.inventory()) {
+            if (it.type != ItemType::EQUIPMENT || equipped_ids.find(it.id) == equipped_ids.end()) {
+                unequipped_items.push_back(&it);
             }
-            
-            if(unequipped_items.empty()) {
-                std::cout << "\n" << std::string(50, '=') << "\n";
-                std::cout << "🎒 背包\n";
-                std::cout << std::string(50, '=') << "\n";
-                std::cout << "背包是空的。\n";
-                std::cout << std::string(50, '=') << "\n";
-            } else { 
-                std::cout << "\n" << std::string(50, '=') << "\n";
-                std::cout << "🎒 背包\n";
-                std::cout << std::string(50, '=') << "\n";
-                for(auto &it:unequipped_items) {
-                    std::string name = it.type==ItemType::EQUIPMENT ? getColoredItemName(it) : it.name;
-                    std::string type_icon = it.type==ItemType::EQUIPMENT ? "⚔️ " : 
-                                          it.type==ItemType::CONSUMABLE ? "🧪 " : "📋 ";
-                    std::cout << "   " << type_icon << name << " x" << it.count;
-                    
-                    // 如果是装备，显示简要属性
-                    if (it.type == ItemType::EQUIPMENT) {
-                        std::cout << " (";
-                        bool first = true;
-                        if (it.atk_delta > 0) {
-                            if (!first) std::cout << ", ";
-                            std::cout << "ATK+" << it.atk_delta;
-                            first = false;
-                        }
-                        if (it.def_delta > 0) {
-                            if (!first) std::cout << ", ";
-                            std::cout << "DEF+" << it.def_delta;
-                            first = false;
-                        }
-                        if (it.spd_delta > 0) {
-                            if (!first) std::cout << ", ";
-                            std::cout << "SPD+" << it.spd_delta;
-                            first = false;
-                        }
-                        if (it.hp_delta > 0) {
-                            if (!first) std::cout << ", ";
-                            std::cout << "HP+" << it.hp_delta;
-                            first = false;
-                        }
-                        std::cout << ")";
+        }
+        
+        if(unequipped_items.empty()) {
+            console() << "\n" << std::string(50, '=') << "\n";
+            console() << "🎒 背包\n";
+            console() << std::string(50, '=') << "\n";
+            console() << "背包是空的。\n";
+            console() << std::string(50, '=') << "\n";
+        } else { 
+            console() << "\n" << std::string(50, '=') << "\n";
+            console() << "🎒 背包\n";
+            console() << std::string(50, '=') << "\n";
+            for(const Item* item:unequipped_items) {
+                const Item& it = *item;
+                std::string name = it.type==ItemType::EQUIPMENT ? getColoredItemName(it) : it.name;
+                std::string type_icon = it.type==ItemType::EQUIPMENT ? "⚔️ " : 
+                                      it.type==ItemType::CONSUMABLE ? "🧪 " : "📋 ";
+                console() << "   " << type_icon << name << " x" << it.count;
+                
+                // 如果是装备，显示简要属性
+                if (it.type == ItemType::EQUIPMENT) {
+                    console() << " (";
+                    bool first = true;
+                    if (it.atk_delta > 0) {
+                        if (!first) console() << ", ";
+                        console() << "ATK+" << it.atk_delta;
+                        first = false;
+                    }
+                    if (it.def_delta > 0) {
+                        if (!first) console() << ", ";
+                        console() << "DEF+" << it.def_delta;
+                        first = false;
                     }
-                    std::cout << "\n";
+                    if (it.spd_delta > 0) {
+                        if (!first) console() << ", ";
+                        console() << "SPD+" << it.spd_delta;
+                        first = false;
+                    }
+                    if (it.hp_delta > 0) {
+                        if (!first) console() << ", ";
+                        console() << "HP+" << it.hp_delta;
+                        first = false;
+                    }
+                    console() << ")";
                 }
-                std::cout << std::string(50, '=') << "\n";
-            } 
-        }
+                console() << "\n";
+            }
+            console() << std::string(50, '=') << "\n";
+        } 
+    }
 
-        else if(line=="task" || line=="t" || line=="任务" || line=="任务列表") {
-            state_.task_manager.showTaskList(state_.player);
+    else if(line=="task" || line=="t" || line=="任务" || line=="任务列表") {
+        state_.task_manager.showTaskList(state_.player);
+    }
+    else if(cmd.verb()=="task" && cmd.size()>1) {
+        std::string task_name(cmd.rest());
+        state_.task_manager.showTaskDetails(task_name);
+    }
+    else if(line=="map") {
+        renderMap();
+    }
+    else if(cmd.verb()=="allocate" && cmd.size()>1) {
+        Stat stat;
+        int amount = 1; // 默认分配1点
+        
+        if (cmd.size() > 2 && !parseIndex(cmd.word(2), amount)) {
+            amount = 0;  // 数量不是数字
         }
-        else if(line.rfind("task ",0)==0) {
-            std::string task_name = line.substr(5);
-            state_.task_manager.showTaskDetails(task_name);
+        
+        if (amount <= 0) {
+            console()<<"分配数量必须大于0！\n";
+            return true;
         }
-        else if(line=="map") {
-            if(state_.in_teaching_detail) {
-                renderTeachingDetailMap();
-            } else {
-                renderMainMap();
-            }
+        
+        if (amount > state_.player.attr().available_points) {
+            console()<<"可用属性点不足！需要 " << amount << " 点，但只有 " << state_.player.attr().available_points << " 点。\n";
+            return true;
         }
-        else if(line.rfind("allocate ",0)==0) {
-            std::string params = line.substr(9);
-            std::istringstream iss(params);
-            std::string stat;
-            int amount = 1; // 默认分配1点
-            
-            iss >> stat;
-            if (iss >> amount) {
-                // 如果提供了数量参数
-            }
-            
-            if (amount <= 0) {
-                std::cout<<"分配数量必须大于0！\n";
-                continue;
-            }
-            
-            if (amount > state_.player.attr().available_points) {
-                std::cout<<"可用属性点不足！需要 " << amount << " 点，但只有 " << state_.player.attr().available_points << " 点。\n";
-                continue;
-            }
-            
-            bool success = true;
-            for (int i = 0; i < amount; ++i) {
-                if (!state_.player.attr().allocatePoint(stat)) {
-                    success = false;
-                    break;
-                }
-            }
-            
-            if (success) {
-                std::cout<<"✅ 成功分配 " << amount << " 点属性到 " << stat << "！\n";
-                std::cout<<"📊 当前属性：" << state_.player.attr().toString() << "\n";
-                if (state_.player.attr().available_points > 0) {
-                    std::cout<<"💡 还有 " << state_.player.attr().available_points << " 点属性可分配，继续使用 allocate 指令\n";
-                } else {
-                    std::cout<<"🎉 所有属性点已分配完毕！\n";
-                }
-            } else {
-                std::cout<<"❌ 分配失败！请检查属性名称是否正确 (hp/atk/def/spd)\n";
+        
+        bool success = parseStat(cmd.word(1), stat);
+        for (int i = 0; success && i < amount; ++i) {
+            if (!state_.player.attr().allocatePoint(stat)) {
+                success = false;
+                break;
             }
         }
-        else if(line=="enter") {
-            // 进入教学区详细地图
-            auto* loc = state_.map.get(state_.current_loc);
-            if(!loc) {
-                std::cout<<"当前地点不存在。\n";
-                continue;
-            }
-            
-            // 检查是否在教学区
-            if(state_.current_loc == "teaching_area") {
-                state_.in_teaching_detail = true;
-                state_.current_loc = "jiuzhutan"; // 初始位置在九珠坛
-                std::cout << "\n=== 进入教学区详细地图 ===\n";
-                look();
+        
+        if (success) {
+            console()<<"✅ 成功分配 " << amount << " 点属性到 " << cmd.word(1) << "！\n";
+            console()<<"📊 当前属性：" << state_.player.attr().toString() << "\n";
+            if (state_.player.attr().available_points > 0) {
+                console()<<"💡 还有 " << state_.player.attr().available_points << " 点属性可分配，继续使用 allocate 指令\n";
             } else {
-                std::cout<<"这里无法进入教学区。\n";
+                console()<<"🎉 所有属性点已分配完毕！\n";
             }
+        } else {
+            console()<<"❌ 分配失败！请检查属性名称是否正确 (hp/atk/def/spd)\n";
         }
-        else if(line=="exit") {
-            // 退出教学区详细地图
-            if(state_.in_teaching_detail) {
-                state_.in_teaching_detail = false;
-                state_.current_loc = "teaching_area"; // 回到教学区
-                std::cout << "\n=== 返回主地图 ===\n";
-                look();
-            } else {
-                std::cout<<"你不在教学区详细地图中。\n";
-            }
+    }
+    else if(line=="enter") {
+        // 进入教学区详细地图
+        auto* loc = state_.map.get(state_.current_loc);
+        if(!loc) {
+            console()<<"当前地点不存在。\n";
+            return true;
         }
-        else { 
-            // 智能提示系统
-            std::cout << "❌ 未知指令: " << line << "\n";
-            std::cout << "💡 建议：\n";
-            
-            // 检查是否是常见的拼写错误或相似命令
-            if (line.find("look") != std::string::npos || line.find("查看") != std::string::npos || line.find("看") != std::string::npos) {
-                std::cout << "   尝试输入 'look' 或 '查看' 查看当前位置\n";
-            } else if (line.find("stats") != std::string::npos || line.find("属性") != std::string::npos || line.find("状态") != std::string::npos) {
-                std::cout << "   尝试输入 'stats' 或 '属性' 查看角色信息\n";
-            } else if (line.find("inv") != std::string::npos || line.find("背包") != std::string::npos || line.find("物品") != std::string::npos) {
-                std::cout << "   尝试输入 'inv' 或 '背包' 查看物品\n";
-            } else if (line.find("task") != std::string::npos || line.find("任务") != std::string::npos) {
-                std::cout << "   尝试输入 'task' 或 '任务' 查看任务\n";
-            } else if (line.find("help") != std::string::npos || line.find("帮助") != std::string::npos) {
-                std::cout << "   尝试输入 'help' 或 '帮助' 查看帮助\n";
-            } else if (line.find("talk") != std::string::npos || line.find("对话") != std::string::npos) {
-                std::cout << "   尝试输入 talk\n";
-            } else if (line.find("fight") != std::string::npos || line.find("战斗") != std::string::npos || line.find("挑战") != std::string::npos) {
-                std::cout << "   尝试输入 fight\n";
-            } else {
-                std::cout << "   输入 'help' 查看所有可用指令\n";
-                std::cout << "   输入 'look' 查看当前位置和可用操作\n";
-                std::cout << "   常用指令: 查看(look), 属性(stats), 背包(inv), 任务(task)\n";
-            }
+        
+        // 检查是否在教学区
+        if(state_.current_loc == "teaching_area") {
+            state_.in_teaching_detail = true;
+            state_.current_loc = "jiuzhutan"; // 初始位置在九珠坛
+            state_.events.publish(LocationEnteredEvent{"teaching_area", state_.current_loc});
+            console() << "\n=== 进入教学区详细地图 ===\n";
+            look();
+        } else {
+            console()<<"这里无法进入教学区。\n";
         }
     }
+    else if(line=="exit") {
+        // 退出教学区详细地图
+        if(state_.in_teaching_detail) {
+            state_.in_teaching_detail = false;
+            state_.current_loc = "teaching_area"; // 回到教学区
+            console() << "\n=== 返回主地图 ===\n";
+            look();
+        } else {
+            console()<<"你不在教学区详细地图中。\n";
+        }
+    }
+    else { 
+        // 智能提示系统
+        console() << "❌ 未知指令: " << line << "\n";
+        console() << "💡 建议：\n";
+        
+        // 检查是否是常见的拼写错误或相似命令
+        FuzzyIndex::Key hint;
+        if (command_hints_.best(line, hint)) {
+            console() << kCommandHints[hint >> 8].hint;
+        } else {
+            console() << "   输入 'help' 查看所有可用指令\n";
+            console() << "   输入 'look' 查看当前位置和可用操作\n";
+            console() << "   常用指令: 查看(look), 属性(stats), 背包(inv), 任务(task)\n";
+        }
+    }
+    return true;
 }
 
 // 怪物管理系统实现
@@ -2575,101 +2903,127 @@ void Game::initializeMonsterSpawns() {
     state_.monster_spawns.push_back({"wenxintan", "答辩紧张魔·强化", 1, 1, 5, 0, 12, 0, 3});
 }
 
-void Game::updateMonsterSpawns() {
-    for (auto& spawn : state_.monster_spawns) {
-        if (spawn.turns_until_respawn > 0) {
-            spawn.turns_until_respawn--;
-            if (spawn.turns_until_respawn == 0) {
-                // 统一处理：所有怪物都刷新到最大数量并重新添加怪物
-                if (spawn.current_count < spawn.max_count) {
-                    // 重新添加怪物到地图
-                    auto* loc = state_.map.get(spawn.location_id);
-                    if (loc) {
-                        // 检查怪物是否已经存在
-                        bool monster_exists = false;
-                        for (const auto& enemy : loc->enemies) {
-                            if (enemy.name() == spawn.monster_name) {
-                                monster_exists = true;
-                                break;
-                            }
-                        }
+// 安排世界定时任务
+// 功能：新游戏和读档后调用，重建状态效果、商店刷新和怪物刷新的定时任务
+void Game::scheduleWorldTimers() {
+    TickScheduler& scheduler = state_.scheduler;
+    scheduler.reset(scheduler.now());
+
+    // 状态效果：每个世界回合结算一次持续时间
+    scheduler.scheduleEvery(1, [this]() { state_.player.attr().updateStatuses(); });
+
+    // 商店：每隔固定回合进一次货，下次打开商店时刷新
+    const std::uint64_t interval = ShopSystem::kRefreshInterval;
+    scheduler.scheduleEvery(interval, [this]() {
+        state_.shop_system.markRefreshDue();
+        console() << "\033[34m【商店刷新】钱道然的商店更新了新的货物！\033[0m\n";
+    }, interval - scheduler.now() % interval);
+
+    // 怪物：恢复读档前尚未到期的刷新
+    for (size_t i = 0; i < state_.monster_spawns.size(); ++i) {
+        if (state_.monster_spawns[i].respawn_turn != 0) scheduleRespawn(i);
+    }
+}
 
-                        if (!monster_exists) {
-                            // 根据位置和怪物名称重新创建怪物
-                            if (spawn.location_id == "teach_5") {
-                                Enemy math_difficulty_spirit(spawn.monster_name, Attributes{90, 90, 18, 12}, 50, 80);
-                                math_difficulty_spirit.setSpecialSkill("专注弱点", "若攻击者处于专注状态，受到伤害+25%");
-                                loc->enemies.push_back(math_difficulty_spirit);
-                            } else if (spawn.location_id == "teach_7") {
-                                Enemy failed_experiment_group(spawn.monster_name, Attributes{135, 135, 45, 30}, 80, 120);
-                                failed_experiment_group.setSpecialSkill("自爆机制", "每回合随机1只自爆，对玩家造成ATK×0.8真实伤害");
-                                failed_experiment_group.setHasExplosionMechanic(true);
-                                failed_experiment_group.setIsGroupEnemy(true, 3);
-                                loc->enemies.push_back(failed_experiment_group);
-                            } else if (spawn.location_id == "tree_space") {
-                                Enemy defense_anxiety_demon(spawn.monster_name, Attributes{80, 80, 22, 14}, 60, 100);
-                                defense_anxiety_demon.setSpecialSkill("紧张施压", "每回合40%概率对玩家施加紧张(DEF-15%, 3回合)");
-                                defense_anxiety_demon.setHasTensionSkill(true);
-                                loc->enemies.push_back(defense_anxiety_demon);
-                            } else {
-                                // 其他区域的怪物，根据名称创建
-                                if (spawn.monster_name == "迷糊书虫") {
-                                    Enemy confused_bookworm(spawn.monster_name, Attributes{25, 25, 8, 5}, 15, 25);
-                                    confused_bookworm.addDropItem("health_potion", "生命药水", 1, 1, 0.05f);
-                                    confused_bookworm.addDropItem("power_fragment", "动力碎片", 1, 1, 0.50f);
-                                    loc->enemies.push_back(confused_bookworm);
-                                } else if (spawn.monster_name == "拖延小妖") {
-                                    Enemy procrastination_goblin(spawn.monster_name, Attributes{30, 30, 10, 6}, 20, 30);
-                                    procrastination_goblin.addDropItem("health_potion", "生命药水", 1, 1, 0.08f);
-                                    procrastination_goblin.addDropItem("power_fragment", "动力碎片", 1, 1, 0.50f);
-                                    loc->enemies.push_back(procrastination_goblin);
-                                } else if (spawn.monster_name == "水波幻影") {
-                                    Enemy water_wave_phantom(spawn.monster_name, Attributes{40, 40, 12, 8}, 25, 40);
-                                    loc->enemies.push_back(water_wave_phantom);
-                                } else if (spawn.monster_name == "学业焦虑影") {
-                                    Enemy academic_anxiety_shadow(spawn.monster_name, Attributes{50, 50, 14, 10}, 30, 50);
-                                    loc->enemies.push_back(academic_anxiety_shadow);
-                                } else if (spawn.monster_name == "夜行怠惰魔") {
-                                    Enemy night_laziness_demon(spawn.monster_name, Attributes{70, 70, 16, 12}, 40, 70);
-                                    night_laziness_demon.setSpecialSkill("迟缓攻击", "攻击后50%概率对玩家施加迟缓(SPD-20%, 2回合)");
-                                    night_laziness_demon.setHasSlowSkill(true);
-                                    night_laziness_demon.addDropItem("health_potion", "生命药水", 1, 1, 0.10f);
-                                    night_laziness_demon.addDropItem("caffeine_elixir", "咖啡因灵液", 1, 1, 0.50f);
-                                    loc->enemies.push_back(night_laziness_demon);
-                                } else if (spawn.monster_name == "压力黑雾") {
-                                    Enemy stress_black_mist(spawn.monster_name, Attributes{80, 80, 18, 14}, 50, 80);
-                                    stress_black_mist.setSpecialSkill("减速领域", "减速(全场SPD-15%, 2回合, 每3回合发动一次)，对玩家实施紧张效果");
-                                    stress_black_mist.setHasTensionSkill(true);
-                                    stress_black_mist.addDropItem("caffeine_elixir", "咖啡因灵液", 1, 1, 0.50f);
-                                    loc->enemies.push_back(stress_black_mist);
-                                } else if (spawn.monster_name == "文献综述怪") {
-                                    Enemy literature_review_monster(spawn.monster_name, Attributes{280, 280, 50, 25}, 100, 150);
-                                    literature_review_monster.setSpecialSkill("阅读", "每3回合进入阅读状态，DEF+50%，持续2回合");
-                                    literature_review_monster.addDropItem("wenxin_key_i", "文心秘钥·I", 1, 1, 1.0f);
-                                    loc->enemies.push_back(literature_review_monster);
-                                } else if (spawn.monster_name == "实验失败妖·复苏") {
-                                    Enemy failed_experiment_revive(spawn.monster_name, Attributes{260, 260, 55, 30}, 100, 150);
-                                    failed_experiment_revive.setSpecialSkill("召唤", "每3回合召唤1只实验失败妖，最多3只");
-                                    failed_experiment_revive.setHasSlowSkill(true);
-                                    failed_experiment_revive.addDropItem("wenxin_key_ii", "文心秘钥·II", 1, 1, 1.0f);
-                                    loc->enemies.push_back(failed_experiment_revive);
-                                } else if (spawn.monster_name == "答辩紧张魔·强化") {
-                                    Enemy defense_anxiety_demon_enhanced(spawn.monster_name, Attributes{300, 300, 60, 35}, 120, 180);
-                                    defense_anxiety_demon_enhanced.setSpecialSkill("紧张施压", "每回合50%概率对玩家施加紧张(DEF-20%, 4回合)");
-                                    defense_anxiety_demon_enhanced.setHasTensionSkill(true);
-                                    defense_anxiety_demon_enhanced.addDropItem("wenxin_key_iii", "文心秘钥·III", 1, 1, 1.0f);
-                                    loc->enemies.push_back(defense_anxiety_demon_enhanced);
-                                }
-                            }
-                        }
-                    }
+// 按刷新点记录的到期回合安排一次重生
+void Game::scheduleRespawn(size_t index) {
+    auto& spawn = state_.monster_spawns[index];
+    std::uint64_t now = state_.scheduler.now();
+    if (spawn.respawn_turn <= now) spawn.respawn_turn = now + 1;
+    state_.scheduler.schedule(spawn.respawn_turn - now, [this, index]() { respawnMonster(index); });
+}
 
-                    spawn.current_count = spawn.max_count; // 重置为最大数量
-                    spawn.challenge_count = 0; // 重置挑战次数计数器
-                    std::cout << "\033[31m【怪物刷新】" << spawn.monster_name << " 在 " << spawn.location_id << " 重新出现了！\033[0m\n";
+// 怪物重生：到期时由调度器调用
+void Game::respawnMonster(size_t index) {
+    auto& spawn = state_.monster_spawns[index];
+    spawn.respawn_turn = 0;
+    // 统一处理：所有怪物都刷新到最大数量并重新添加怪物
+    if (spawn.current_count < spawn.max_count) {
+        // 重新添加怪物到地图
+        auto* loc = state_.map.get(spawn.location_id);
+        if (loc) {
+            // 检查怪物是否已经存在
+            bool monster_exists = false;
+            for (const auto& enemy : loc->enemies) {
+                if (enemy.name() == spawn.monster_name) {
+                    monster_exists = true;
+                    break;
+                }
+            }
+
+            if (!monster_exists) {
+                // 根据位置和怪物名称重新创建怪物
+                if (spawn.location_id == "teach_5") {
+                    Enemy math_difficulty_spirit(spawn.monster_name, Attributes{90, 90, 18, 12}, 50, 80);
+                    math_difficulty_spirit.setSpecialSkill("专注弱点", "若攻击者处于专注状态，受到伤害+25%");
+                    loc->enemies.push_back(math_difficulty_spirit);
+                } else if (spawn.location_id == "teach_7") {
+                    Enemy failed_experiment_group(spawn.monster_name, Attributes{135, 135, 45, 30}, 80, 120);
+                    failed_experiment_group.setSpecialSkill("自爆机制", "每回合随机1只自爆，对玩家造成ATK×0.8真实伤害");
+                    failed_experiment_group.setHasExplosionMechanic(true);
+                    failed_experiment_group.setIsGroupEnemy(true, 3);
+                    loc->enemies.push_back(failed_experiment_group);
+                } else if (spawn.location_id == "tree_space") {
+                    Enemy defense_anxiety_demon(spawn.monster_name, Attributes{80, 80, 22, 14}, 60, 100);
+                    defense_anxiety_demon.setSpecialSkill("紧张施压", "每回合40%概率对玩家施加紧张(DEF-15%, 3回合)");
+                    defense_anxiety_demon.setHasTensionSkill(true);
+                    loc->enemies.push_back(defense_anxiety_demon);
+                } else {
+                    // 其他区域的怪物，根据名称创建
+                    if (spawn.monster_name == "迷糊书虫") {
+                        Enemy confused_bookworm(spawn.monster_name, Attributes{25, 25, 8, 5}, 15, 25);
+                        confused_bookworm.addDropItem("health_potion", "生命药水", 1, 1, 0.05f);
+                        confused_bookworm.addDropItem("power_fragment", "动力碎片", 1, 1, 0.50f);
+                        loc->enemies.push_back(confused_bookworm);
+                    } else if (spawn.monster_name == "拖延小妖") {
+                        Enemy procrastination_goblin(spawn.monster_name, Attributes{30, 30, 10, 6}, 20, 30);
+                        procrastination_goblin.addDropItem("health_potion", "生命药水", 1, 1, 0.08f);
+                        procrastination_goblin.addDropItem("power_fragment", "动力碎片", 1, 1, 0.50f);
+                        loc->enemies.push_back(procrastination_goblin);
+                    } else if (spawn.monster_name == "水波幻影") {
+                        Enemy water_wave_phantom(spawn.monster_name, Attributes{40, 40, 12, 8}, 25, 40);
+                        loc->enemies.push_back(water_wave_phantom);
+                    } else if (spawn.monster_name == "学业焦虑影") {
+                        Enemy academic_anxiety_shadow(spawn.monster_name, Attributes{50, 50, 14, 10}, 30, 50);
+                        loc->enemies.push_back(academic_anxiety_shadow);
+                    } else if (spawn.monster_name == "夜行怠惰魔") {
+                        Enemy night_laziness_demon(spawn.monster_name, Attributes{70, 70, 16, 12}, 40, 70);
+                        night_laziness_demon.setSpecialSkill("迟缓攻击", "攻击后50%概率对玩家施加迟缓(SPD-20%, 2回合)");
+                        night_laziness_demon.setHasSlowSkill(true);
+                        night_laziness_demon.addDropItem("health_potion", "生命药水", 1, 1, 0.10f);
+                        night_laziness_demon.addDropItem("caffeine_elixir", "咖啡因灵液", 1, 1, 0.50f);
+                        loc->enemies.push_back(night_laziness_demon);
+                    } else if (spawn.monster_name == "压力黑雾") {
+                        Enemy stress_black_mist(spawn.monster_name, Attributes{80, 80, 18, 14}, 50, 80);
+                        stress_black_mist.setSpecialSkill("减速领域", "减速(全场SPD-15%, 2回合, 每3回合发动一次)，对玩家实施紧张效果");
+                        stress_black_mist.setHasTensionSkill(true);
+                        stress_black_mist.addDropItem("caffeine_elixir", "咖啡因灵液", 1, 1, 0.50f);
+                        loc->enemies.push_back(stress_black_mist);
+                    } else if (spawn.monster_name == "文献综述怪") {
+                        Enemy literature_review_monster(spawn.monster_name, Attributes{280, 280, 50, 25}, 100, 150);
+                        literature_review_monster.setSpecialSkill("阅读", "每3回合进入阅读状态，DEF+50%，持续2回合");
+                        literature_review_monster.addDropItem("wenxin_key_i", "文心秘钥·I", 1, 1, 1.0f);
+                        loc->enemies.push_back(literature_review_monster);
+                    } else if (spawn.monster_name == "实验失败妖·复苏") {
+                        Enemy failed_experiment_revive(spawn.monster_name, Attributes{260, 260, 55, 30}, 100, 150);
+                        failed_experiment_revive.setSpecialSkill("召唤", "每3回合召唤1只实验失败妖，最多3只");
+                        failed_experiment_revive.setHasSlowSkill(true);
+                        failed_experiment_revive.addDropItem("wenxin_key_ii", "文心秘钥·II", 1, 1, 1.0f);
+                        loc->enemies.push_back(failed_experiment_revive);
+                    } else if (spawn.monster_name == "答辩紧张魔·强化") {
+                        Enemy defense_anxiety_demon_enhanced(spawn.monster_name, Attributes{300, 300, 60, 35}, 120, 180);
+                        defense_anxiety_demon_enhanced.setSpecialSkill("紧张施压", "每回合50%概率对玩家施加紧张(DEF-20%, 4回合)");
+                        defense_anxiety_demon_enhanced.setHasTensionSkill(true);
+                        defense_anxiety_demon_enhanced.addDropItem("wenxin_key_iii", "文心秘钥·III", 1, 1, 1.0f);
+                        loc->enemies.push_back(defense_anxiety_demon_enhanced);
+                    }
                 }
             }
         }
+
+        spawn.current_count = spawn.max_count; // 重置为最大数量
+        spawn.challenge_count = 0; // 重置挑战次数计数器
+        console() << "\033[31m【怪物刷新】" << spawn.monster_name << " 在 " << spawn.location_id << " 重新出现了！\033[0m\n";
     }
 }
 
@@ -2677,7 +3031,7 @@ bool Game::canSpawnMonster(const std::string& location_id, const std::string& mo
     for (const auto& spawn : state_.monster_spawns) {
         if (spawn.location_id == location_id && spawn.monster_name == monster_name) {
             // 检查怪物是否可用：当前数量大于0，挑战次数未达上限，且不在刷新倒计时中
-            return spawn.current_count > 0 && spawn.challenge_count < spawn.max_challenges && spawn.turns_until_respawn == 0;
+            return spawn.current_count > 0 && spawn.challenge_count < spawn.max_challenges && spawn.respawn_turn == 0;
         }
     }
     return true; // 如果没找到配置，默认允许
@@ -2693,6 +3047,11 @@ int Game::getAvailableMonsterCount(const std::string& location_id, const std::st
 }
 
 void Game::onMonsterDefeated(const std::string& location_id, const std::string& monster_name) {
+    // 秘境的怪物不刷新：击败后房间清空，记入这一层的改动记录
+    if (state_.dungeon.onMonsterDefeated(state_.map, location_id)) {
+        console() << "【秘境】" << monster_name << " 消散了，这个房间已经清理干净。\n";
+        return;
+    }
     for (auto& spawn : state_.monster_spawns) {
         if (spawn.location_id == location_id && spawn.monster_name == monster_name) {
             spawn.challenge_count++; // 增加挑战次数计数器
@@ -2715,16 +3074,17 @@ void Game::onMonsterDefeated(const std::string& location_id, const std::string&
                 }
 
                 // 设置重生倒计时
-                spawn.turns_until_respawn = spawn.respawn_turns;
+                spawn.respawn_turn = state_.scheduler.now() + static_cast<std::uint64_t>(std::max(0, spawn.respawn_turns));
+                scheduleRespawn(static_cast<size_t>(&spawn - state_.monster_spawns.data()));
                 
                 // 显示怪物消失和刷新信息
-                std::cout << "【怪物消失】" << monster_name << " 已暂时离开这个区域。\n";
-                std::cout << "【挑战限制】本次刷新周期内已挑战 " << spawn.challenge_count << " 次，需等待 " << spawn.respawn_turns << " 回合后刷新。\n";
+                console() << "【怪物消失】" << monster_name << " 已暂时离开这个区域。\n";
+                console() << "【挑战限制】本次刷新周期内已挑战 " << spawn.challenge_count << " 次，需等待 " << spawn.respawn_turns << " 回合后刷新。\n";
             } else {
                 // 还有挑战次数剩余，不减少current_count，怪物继续可用
                 // 显示剩余挑战次数信息
                 int remaining_challenges = spawn.max_challenges - spawn.challenge_count;
-                std::cout << "【挑战剩余】" << monster_name << " 还有 " << remaining_challenges << " 次挑战机会。\n";
+                console() << "【挑战剩余】" << monster_name << " 还有 " << remaining_challenges << " 次挑战机会。\n";
             }
             break;
         }
@@ -2768,22 +3128,22 @@ int Game::calculateExperiencePenalty(const Enemy& enemy) {
 }
 
 void Game::showMonsterSpawnInfo() const {
-    std::cout << "\n" << std::string(50, '=') << "\n";
-    std::cout << "🐉 怪物刷新信息\n";
-    std::cout << std::string(50, '=') << "\n";
+    console() << "\n" << std::string(50, '=') << "\n";
+    console() << "🐉 怪物刷新信息\n";
+    console() << std::string(50, '=') << "\n";
 
     for (const auto& spawn : state_.monster_spawns) {
-        std::cout << "📍 " << spawn.location_id << " - " << spawn.monster_name << "\n";
-        std::cout << "   当前数量: " << spawn.current_count << "/" << spawn.max_count << "\n";
-        std::cout << "   推荐等级: " << spawn.recommended_level << "\n";
-        std::cout << "   已挑战次数: " << spawn.challenge_count << "/" << spawn.max_challenges << "\n";
+        console() << "📍 " << spawn.location_id << " - " << spawn.monster_name << "\n";
+        console() << "   当前数量: " << spawn.current_count << "/" << spawn.max_count << "\n";
+        console() << "   推荐等级: " << spawn.recommended_level << "\n";
+        console() << "   已挑战次数: " << spawn.challenge_count << "/" << spawn.max_challenges << "\n";
 
-        if (spawn.turns_until_respawn > 0) {
-            std::cout << "   重生倒计时: " << spawn.turns_until_respawn << " 回合\n";
+        if (spawn.respawn_turn != 0) {
+            console() << "   重生倒计时: " << state_.turnsUntilRespawn(spawn) << " 回合\n";
         }
-        std::cout << "\n";
+        console() << "\n";
     }
-    std::cout << std::string(50, '=') << "\n";
+    console() << std::string(50, '=') << "\n";
 }
 
 // 根据怪物名称创建怪物实例
@@ -0,0 +1,208 @@
+// 这是游戏事件监听的实现文件
+// 作者：大一学生
+// 功能：集中订阅游戏事件，处理击败怪物、获得物品、对话选择、升级等之后的剧情、任务反应与提示
+
+#include "Game.hpp"        // 游戏类头文件
+#include "Item.hpp"        // 物品类头文件
+#include "Output.hpp"      // 游戏输出
+#include <cctype>          // std::toupper
+#include <iostream>        // 输入输出流
+
+namespace hx {
+
+// 订阅游戏事件
+// 功能：在世界初始化后调用一次，监听器按注册顺序执行
+void Game::registerEventListeners() {
+    EventBus& events = state_.events;
+
+    // 升级提示：一次获得大量经验连升几级时只提示一次
+    events.subscribe<LevelUpEvent>([this](const LevelUpEvent& e) {
+        console() << "【升级】等级提升至 " << e.new_level << "！HP已回复到上限。\n";
+        console() << "【属性点】获得 " << state_.player.attr().available_points << " 点属性点可分配！\n";
+        console() << "💡 使用 'allocate <属性> [数量]' 分配属性点\n";
+        console() << "   可用属性：hp(生命), atk(攻击), def(防御), spd(速度)\n";
+        console() << "   示例：allocate hp 1 或 allocate atk 2\n";
+    });
+
+    // 好感度变化提示（按夹到0-100之后的实际变化显示）
+    events.subscribe<FavorChangedEvent>([](const FavorChangedEvent& e) {
+        int delta = e.new_favor - e.old_favor;
+        console() << "【" << e.npc_name << "好感度 " << (delta > 0 ? "+" : "") << delta << "】\n";
+    });
+
+    // 对话选择后的特殊奖励（装备、首次问候好感等）
+    events.subscribe<DialogueChoiceEvent>([this](const DialogueChoiceEvent& e) {
+        handleSpecialRewards(e.npc_name, e.dialogue_id, e.choice, e.npc);
+    });
+
+    // 首次进入文心潭：第三章介绍
+    events.subscribe<LocationEnteredEvent>([this](const LocationEnteredEvent& e) {
+        if (e.to != "wenxintan" || state_.wenxintan_intro_shown) return;
+        state_.wenxintan_intro_shown = true;
+
+        // 章节标题
+        console() << "第三章：核心·文心潭试炼（终极考验）\n";
+        console() << "━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━\n\n";
+
+        // 场景描述
+        console() << "场景：文心潭\n";
+        console() << "━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━\n\n";
+
+        // 剧情描述
+        console() << "潭水如镜，轻波涟漪，倒映出你走过的每一段路。\n";
+        console() << "随着你靠近，水面上逐渐浮现出三道凝实的影子——它们是此处失衡的根源：\n\n";
+
+        // BOSS介绍
+        console() << "试炼之敌\n";
+        console() << "━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━\n";
+        console() << "① 文献综述怪：海量资料化作铠甲，阅读即护身，难以击破。\n";
+        console() << "② 实验失败妖·复苏：不断召唤失败的回声，以数量压垮意志。\n";
+        console() << "③ 答辩紧张魔·强化：言辞如刃，情绪波动使其愈战愈狂。\n\n";
+
+        // 任务目标
+        console() << "试炼目标\n";
+        console() << "━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━\n";
+        console() << "只有依次击败它们，集齐三把【文心秘钥】，才能让文心潭回归平衡。\n";
+        console() << "⚔️ 你握紧了手中的装备，深吸一口气，迈入最后的修行。\n\n";
+
+        // 成就提示
+        console() << "击败所有心魔后，将自动开启第四章！\n";
+        console() << "━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━\n";
+    });
+
+    // S2任务进度：获得动力碎片时实时更新
+    events.subscribe<ItemGainedEvent>([this](const ItemGainedEvent& e) {
+        if (e.item.id != "power_fragment" || !state_.task_manager.hasActiveTask("side_gym_fragments")) return;
+        int qty = state_.player.inventory().quantity("power_fragment");
+        state_.task_manager.setObjective("side_gym_fragments", 2, std::string("收集动力碎片：") + std::to_string(qty) + "/3");
+        console()<<"【任务进度】动力碎片："<<qty<<"/3\n";
+    });
+
+    // 掉落与战斗小结：先于其他击败反应，小结里的任务进度已包含本次掉落
+    events.subscribe<MonsterDefeatedEvent>([this](const MonsterDefeatedEvent& e) {
+        processEnemyDrops(e.enemy);
+        printCombatSummary(e.old_level);
+    });
+
+    // 文心潭三战：击败后标记钥匙，集齐三把钥匙后一次性通关奖励和第四章触发
+    events.subscribe<MonsterDefeatedEvent>([this](const MonsterDefeatedEvent& e) {
+        if (e.location != "wenxintan") return;
+        const std::string& boss_name = e.enemy.name();
+        if (boss_name == "文献综述怪") state_.key_i_obtained = true;
+        if (boss_name == "实验失败妖·复苏") state_.key_ii_obtained = true;
+        if (boss_name == "答辩紧张魔·强化") state_.key_iii_obtained = true;
+        state_.wenxintan_fail_streak = 0;
+
+        if (!state_.truth_reward_given && state_.key_i_obtained && state_.key_ii_obtained && state_.key_iii_obtained) {
+            state_.player.addXP(300);
+            state_.player.addCoins(200);
+            state_.truth_reward_given = true;
+
+            // 延迟一下，让玩家看到奖励信息
+            console()<<"【通关奖励】获得大量经验300与金币200！\n";
+            console()<<"【称号】获得称号：荣誉博士！\n";
+            console()<<"恭喜通关！！\n\n";
+
+            // 自动触发第四章
+            triggerChapter4Transition();
+        }
+    });
+
+    // S3任务进度：若为实验失败妖，更新任务与进度显示
+    events.subscribe<MonsterDefeatedEvent>([this](const MonsterDefeatedEvent& e) {
+        if (e.enemy.name().find("实验失败妖") == std::string::npos) return;
+        if (state_.task_manager.hasActiveTask("side_lab_challenge")) {
+            // 更新任务目标：击败实验失败妖
+            state_.task_manager.setObjective("side_lab_challenge", 2, "击败实验失败妖 ✓");
+        }
+        console() << "【任务进度】实验失败妖：击败 " << state_.failed_experiment_kill_count << "/11，ATK " << state_.player.attr().getEffectiveATK() << "（需≥30）\n";
+    });
+
+    // 首次击败高数难题精奖励：给予启智笔
+    events.subscribe<MonsterDefeatedEvent>([this](const MonsterDefeatedEvent& e) {
+        if (state_.math_difficulty_spirit_first_kill || e.enemy.name().find("高数难题精") == std::string::npos) return;
+        state_.math_difficulty_spirit_first_kill = true;
+        Item wisdom_pen = Item::createEquipment("wisdom_pen", "启智笔",
+            "智力试炼的奖励，能提升思维敏捷度。",
+            EquipmentType::WEAPON, EquipmentSlot::WEAPON, 6, 0, 0, 0, 120);
+        wisdom_pen.quality = EquipmentQuality::MASTER;
+        wisdom_pen.effect_type = "damage_multiplier";
+        wisdom_pen.effect_target = "difficult_problem";
+        wisdom_pen.effect_value = 1.15f;
+        wisdom_pen.effect_description = "对难题类敌人额外造成15%伤害";
+        state_.player.gainItem(wisdom_pen, 1);
+        console() << "【智力试炼完成】首次击败高数难题精！获得启智笔×1！\n";
+        console() << "【装备效果】启智笔：ATK+6，对难题类敌人额外造成15%伤害\n";
+    });
+
+    // S3奖励判定：击败实验失败妖>10且ATK≥30且未发放
+    events.subscribe<MonsterDefeatedEvent>([this](const MonsterDefeatedEvent&) {
+        if (state_.s3_reward_given || state_.failed_experiment_kill_count <= 10 || state_.player.attr().getEffectiveATK() < 30) return;
+        state_.s3_reward_given = true;
+        Item goggles = Item::createEquipment("goggles","护目镜","视野更清晰，行动更敏捷。",EquipmentType::ACCESSORY,EquipmentSlot::ACCESSORY2,0,0,6,0,0);
+        state_.player.gainItem(goggles,1);
+        console()<<"【S3完成】长期与实验失败妖交手让你收获良多。获得护目镜×1。\n";
+        state_.player.addNPCFavor("林清漪",20);
+
+        // 完成任务
+        state_.task_manager.setObjective("side_lab_challenge", 3, "获得实验服 ✓");
+        state_.task_manager.completeTask("side_lab_challenge");
+    });
+
+    // S4奖励判定入口：树下空间Boss击败后，如持启智笔，触发答题
+    events.subscribe<MonsterDefeatedEvent>([this](const MonsterDefeatedEvent& e) {
+        if (e.location != "tree_space" || state_.s4_reward_given) return;
+        if (e.enemy.name() != "答辩紧张魔" && e.enemy.name() != "答辩紧张魔·强化") return;
+        if (state_.task_manager.hasActiveTask("side_debate_challenge")) {
+            state_.task_manager.setObjective("side_debate_challenge", 1, "击败答辩紧张魔 ✓");
+        }
+
+        if (state_.player.inventory().quantity("wisdom_pen") <= 0) return;
+        // 答题等玩家输入，战斗结算输出完毕后再提问
+        askDebateQuestion(0, 0);
+    });
+}
+
+// S4对话挑战：依次提问3题，答对≥2通过
+void Game::askDebateQuestion(size_t index, int correct) {
+    struct Question { const char* text; char answer; };
+    static const Question questions[] = {
+        {"1. 演讲时缓解紧张的有效方式是？\n A) 大声喝止对方\n B) 深呼吸并放慢语速\n C) 避免目光接触\n> ", 'B'},
+        {"2. 回答问题时最重要的是？\n A) 语速越快越好\n B) 逻辑清晰、层次分明\n C) 使用大量术语\n> ", 'B'},
+        {"3. 面对质疑，正确做法是？\n A) 反驳并否定\n B) 情绪化回应\n C) 接纳问题、给出证据与解释\n> ", 'C'},
+    };
+    const size_t count = sizeof(questions) / sizeof(questions[0]);
+
+    if (index < count) {
+        std::string prompt = questions[index].text;
+        if (index == 0) prompt = "【对话挑战】请回答以下问题（3题，答对≥2通过）：\n" + prompt;
+        flow_.await(prompt, [this, index, correct](const std::string& a) {
+            bool right = a.size() == 1 && std::toupper(static_cast<unsigned char>(a[0])) == questions[index].answer;
+            askDebateQuestion(index + 1, correct + (right ? 1 : 0));
+        });
+        return;
+    }
+
+    if (correct>=2) {
+        state_.s4_reward_given = true;
+        Item fan = Item::createEquipment("debate_fan","辩锋羽扇","锋芒毕露，言辞更有力。",EquipmentType::WEAPON,EquipmentSlot::WEAPON,15,0,6,0,350);
+        fan.quality = EquipmentQuality::DOCTOR;
+        fan.effect_type = "damage_multiplier";
+        fan.effect_target = "答辩紧张魔·强化";
+        fan.effect_value = 1.3f;
+        fan.effect_description = "对答辩紧张魔·强化造成1.3倍伤害";
+        state_.player.gainItem(fan,1);
+        console()<<"【S4完成】你顺利通过对话挑战，获得辩锋羽扇×1。\n";
+        state_.player.addNPCFavor("林清漪",20);
+
+        // 完成任务
+        state_.task_manager.setObjective("side_debate_challenge", 2, "回答3个问题 ✓");
+        state_.task_manager.setObjective("side_debate_challenge", 3, "答对2题以上 ✓");
+        state_.task_manager.setObjective("side_debate_challenge", 4, "获得辩峰羽扇 ✓");
+        state_.task_manager.completeTask("side_debate_challenge");
+    } else {
+        console()<<"很遗憾，本次挑战未通过，可稍后再试。\n";
+    }
+}
+
+} // namespace hx
@@ -9,6 +9,8 @@
 #include "ItemDefinitions.hpp" // 物品定义头文件
 #include "Enemy.hpp"           // 敌人类头文件
 #include "Attributes.hpp"      // 属性类头文件
+#include "Output.hpp"          // 游戏输出
+#include "Trace.hpp"           // 时间线跟踪
 #include <iostream>            // 输入输出流
 
 namespace hx {
@@ -17,23 +19,38 @@ namespace hx {
 // 功能：初始化整个游戏世界，创建所有游戏元素
 void Game::setupWorld() {
     // 创建地点 - 设置游戏中的所有地点
+    HX_TRACE_PHASE(phase, "setup.locations");
     createLocations();
     
     // 创建NPC - 设置游戏中的所有NPC
+    HX_TRACE_NEXT(phase, "setup.npcs");
     createNPCs();
     
     // 初始化NPC对话 - 为NPC添加对话内容
+    HX_TRACE_NEXT(phase, "setup.dialogues");
     initializeNPCDialogues();
     
     // 创建物品 - 设置游戏中的所有物品
+    HX_TRACE_NEXT(phase, "setup.items");
     createItems();
     
     // 创建任务 - 设置游戏中的所有任务
+    HX_TRACE_NEXT(phase, "setup.tasks");
     createTasks();
     
     // 初始化怪物刷新系统 - 设置怪物的刷新机制
+    HX_TRACE_NEXT(phase, "setup.spawns");
     initializeMonsterSpawns();
     
+    // 秘境 - 从地图上的怪物收集原型，文心潭加上下楼的出口
+    HX_TRACE_NEXT(phase, "setup.dungeon");
+    state_.dungeon.setCatalog(state_.map);
+    state_.dungeon.attach(state_.map);
+    
+    // 建立名称索引 - 玩家输入的NPC名、怪物名、指令可以模糊匹配
+    HX_TRACE_NEXT(phase, "setup.indexes");
+    buildNameIndexes();
+    
     // 设置初始位置 - 海大图书馆古籍区
     state_.current_loc = "library";
 }
@@ -44,7 +61,7 @@ void Game::createLocations() {
     library.id = "library";
     library.name = "秘境图书馆";
     library.desc = "高耸的书架直抵穹顶，空气中弥漫着墨香。林清漪立于中央，微笑注视着你。这里是安全区，也是你的重生点。";
-    library.coord = {3, 2};
+    library.coord = {5, 1};
     library.exits = {
         {"东", "wenxintan"},
         {"西", "info_building"},
@@ -56,7 +73,7 @@ void Game::createLocations() {
     wenxintan.id = "wenxintan";
     wenxintan.name = "文心潭";
     wenxintan.desc = "潭水如镜，却映照出你内心的焦虑与恐惧。波纹中升起的，是你最深的心魔。这里是最终的试炼之地。";
-    wenxintan.coord = {2, 2};
+    wenxintan.coord = {6, 1};
     wenxintan.exits = {
         {"西", "library"}
     };
@@ -96,7 +113,7 @@ void Game::createLocations() {
     info_building.id = "info_building";
     info_building.name = "信息楼";
     info_building.desc = "信息技术相关教学楼，实验设备齐全。";
-    info_building.coord = {4, 2};
+    info_building.coord = {4, 1};
     info_building.exits = {
         {"东", "library"},
         {"西", "teaching_area"}
@@ -148,7 +165,7 @@ void Game::createLocations() {
     activity_center.id = "activity_center";
     activity_center.name = "大学生活动中心";
     activity_center.desc = "学生活动的中心场所，各种社团活动在此举行。";
-    activity_center.coord = {1, 0};
+    activity_center.coord = {0, 1};
     activity_center.exits = {
         {"东", "gymnasium"},
         {"北", "north_playground"}
@@ -159,7 +176,7 @@ void Game::createLocations() {
     canteen.id = "canteen";
     canteen.name = "食堂";
     canteen.desc = "香气与嘈杂交织，你看到苏小萌在烦恼选择。这里是选择支线任务的地点。";
-    canteen.coord = {2, 0};
+    canteen.coord = {1, 0};
     canteen.exits = {
         {"西", "north_playground"}
     };
@@ -170,7 +187,7 @@ void Game::createLocations() {
     north_playground.id = "north_playground";
     north_playground.name = "荒废北操场";
     north_playground.desc = "废弃的操场，杂草丛生，偶尔有野猫出没。";
-    north_playground.coord = {2, -1};
+    north_playground.coord = {0, 0};
     north_playground.exits = {
         {"东", "canteen"},
         {"南", "activity_center"}
@@ -195,7 +212,8 @@ void Game::createLocations() {
     jiuzhutan.id = "jiuzhutan";
     jiuzhutan.name = "九珠坛";
     jiuzhutan.desc = "教学区的中心广场，九根石柱环绕，象征着九大学科。";
-    jiuzhutan.coord = {0, 0};
+    jiuzhutan.coord = {2, 0};
+    jiuzhutan.layer = kTeachingLayer;
     jiuzhutan.exits = {
         {"东", "teach_4"},
         {"西", "teach_3"},
@@ -207,7 +225,8 @@ void Game::createLocations() {
     teach_2.id = "teach_2";
     teach_2.name = "教学楼二区";
     teach_2.desc = "基础课程教学楼，新生们在这里学习基础知识。";
-    teach_2.coord = {-2, 0};
+    teach_2.coord = {0, 0};
+    teach_2.layer = kTeachingLayer;
     teach_2.exits = {
         {"东", "teach_3"}
     };
@@ -217,7 +236,8 @@ void Game::createLocations() {
     teach_3.id = "teach_3";
     teach_3.name = "教学楼三区";
     teach_3.desc = "专业课程教学楼，学生们在这里深入学习专业知识。";
-    teach_3.coord = {-1, 0};
+    teach_3.coord = {1, 0};
+    teach_3.layer = kTeachingLayer;
     teach_3.exits = {
         {"东", "jiuzhutan"},
         {"西", "teach_2"},
@@ -229,7 +249,8 @@ void Game::createLocations() {
     teach_4.id = "teach_4";
     teach_4.name = "教学楼四区";
     teach_4.desc = "实验课程教学楼，各种实验设备齐全。";
-    teach_4.coord = {1, 0};
+    teach_4.coord = {3, 0};
+    teach_4.layer = kTeachingLayer;
     teach_4.exits = {
         {"西", "jiuzhutan"}
     };
@@ -239,7 +260,8 @@ void Game::createLocations() {
     teach_5.id = "teach_5";
     teach_5.name = "教学楼五区";
     teach_5.desc = "走廊里漂浮着试卷幻影，每一道题都化作幻影敌人扑来。这里是智力试炼之地。";
-    teach_5.coord = {0, 1};
+    teach_5.coord = {1, 1};
+    teach_5.layer = kTeachingLayer;
     teach_5.exits = {
         {"东", "teach_6"},
         {"北", "teach_3"}
@@ -255,7 +277,8 @@ void Game::createLocations() {
     teach_6.id = "teach_6";
     teach_6.name = "教学楼六区";
     teach_6.desc = "高级课程教学楼，研究生们在这里进行深入研究。";
-    teach_6.coord = {1, 1};
+    teach_6.coord = {2, 1};
+    teach_6.layer = kTeachingLayer;
     teach_6.exits = {
         {"西", "teach_5"},
         {"东", "teach_7"},
@@ -267,7 +290,8 @@ void Game::createLocations() {
     teach_7.id = "teach_7";
     teach_7.name = "教学楼七区";
     teach_7.desc = "实验楼：烧瓶与仪器碎片漂浮在空气中，失败的实验化作怪物冲来。这里是抗挫试炼之地。";
-    teach_7.coord = {2, 1};
+    teach_7.coord = {3, 1};
+    teach_7.layer = kTeachingLayer;
     teach_7.exits = {
         {"西", "teach_6"},
     };
@@ -284,7 +308,8 @@ void Game::createLocations() {
     tree_space.id = "tree_space";
     tree_space.name = "树下空间";
     tree_space.desc = "大厅中空无一人，却有无数声音在你耳边争论，让你心神不宁。这里是表达试炼之地。";
-    tree_space.coord = {2, 0};
+    tree_space.coord = {2, 2};
+    tree_space.layer = kTeachingLayer;
     tree_space.exits = {
         {"北", "teach_6"}
     };
@@ -341,18 +366,18 @@ void Game::createNPCs() {
             // 给予装备
             Item uniform = ItemDefinitions::createStudentUniform();
             uniform.price = 0; // 奖励物品免费
-            state_.player.inventory().add(uniform, 1);
+            state_.player.gainItem(uniform, 1);
             
             Item notes = ItemDefinitions::createBambooNotes();
             notes.price = 0; // 奖励物品免费
-            state_.player.inventory().add(notes, 1);
+            state_.player.gainItem(notes, 1);
             
-            std::cout << "【获得装备】普通学子服×1、竹简笔记×1\n";
+            console() << "【获得装备】普通学子服×1、竹简笔记×1\n";
             
             // 自动接取进入秘境任务
             if (!state_.task_manager.hasActiveTask("m1_enter_secret") && !state_.task_manager.hasCompletedTask("m1_enter_secret")) {
                 state_.task_manager.startTask("m1_enter_secret");
-                std::cout<<"【任务接取】进入秘境。使用 task 查看详情。\n";
+                console()<<"【任务接取】进入秘境。使用 task 查看详情。\n";
             }
         }, 0, ""},
         DialogueOption{"我怎样才能获得更好的装备？", "equipment_guide", nullptr, 0, ""}
@@ -385,7 +410,7 @@ void Game::createNPCs() {
             // 自动接取支线任务5：答辩对话挑战
             if (!state_.task_manager.hasActiveTask("side_debate_challenge") && !state_.task_manager.hasCompletedTask("side_debate_challenge")) {
                 state_.task_manager.startTask("side_debate_challenge");
-                std::cout<<"【任务接取】答辩对话挑战。使用 task 查看详情。\n";
+                console()<<"【任务接取】答辩对话挑战。使用 task 查看详情。\n";
             }
         }, 0, ""}
     };
@@ -397,33 +422,28 @@ void Game::createNPCs() {
     equipment_guide.options = {
         DialogueOption{"我明白了，谢谢您的指导。", "main_menu", [this](){
             // 检查是否已经给过装备（通过检查背包中是否已有这些装备）
-            bool hasUniform = false;
-            bool hasNotes = false;
-            
-            for (const auto& item : state_.player.inventory().list()) {
-                if (item.id == "student_uniform") hasUniform = true;
-                if (item.id == "bamboo_notes") hasNotes = true;
-            }
+            bool hasUniform = state_.player.inventory().find("student_uniform") != Inventory::kNone;
+            bool hasNotes = state_.player.inventory().find("bamboo_notes") != Inventory::kNone;
             
             if (!hasUniform || !hasNotes) {
                 // 给予装备
                 Item uniform = ItemDefinitions::createStudentUniform();
                 uniform.price = 0; // 奖励物品免费
-                state_.player.inventory().add(uniform, 1);
+                state_.player.gainItem(uniform, 1);
                 
                 Item notes = ItemDefinitions::createBambooNotes();
                 notes.price = 0; // 奖励物品免费
-                state_.player.inventory().add(notes, 1);
+                state_.player.gainItem(notes, 1);
                 
-                std::cout << "【获得装备】普通学子服×1、竹简笔记×1\n";
+                console() << "【获得装备】普通学子服×1、竹简笔记×1\n";
                 
                 // 自动接取进入秘境任务
                 if (!state_.task_manager.hasActiveTask("m1_enter_secret") && !state_.task_manager.hasCompletedTask("m1_enter_secret")) {
                     state_.task_manager.startTask("m1_enter_secret");
-                    std::cout<<"【任务接取】进入秘境。使用 task 查看详情。\n";
+                    console()<<"【任务接取】进入秘境。使用 task 查看详情。\n";
                 }
             } else {
-                std::cout<<"【林清漪】\"这些装备我已经给过你了，要好好珍惜哦。\"\n";
+                console()<<"【林清漪】\"这些装备我已经给过你了，要好好珍惜哦。\"\n";
             }
         }, 0, ""}
     };
@@ -437,7 +457,7 @@ void Game::createNPCs() {
             // 自动接取试炼任务
             if (!state_.task_manager.hasActiveTask("m2_trials") && !state_.task_manager.hasCompletedTask("m2_trials")) {
                 state_.task_manager.startTask("m2_trials");
-                std::cout<<"【任务接取】完成试炼。使用 task 查看详情。\n";
+                console()<<"【任务接取】完成试炼。使用 task 查看详情。\n";
             }
         }, 0, ""}
     };
@@ -461,7 +481,7 @@ void Game::createNPCs() {
         DialogueOption{"当然可以！我来帮你选择。", "s1_choose", [this](){
             if (!state_.task_manager.hasActiveTask("side_canteen_choice") && !state_.task_manager.hasCompletedTask("side_canteen_choice")) {
                 state_.task_manager.startTask("side_canteen_choice");
-                std::cout<<"【任务接取】食堂选择。使用 task 查看详情。\n";
+                console()<<"【任务接取】食堂选择。使用 task 查看详情。\n";
             }
         }, 0, ""},
         DialogueOption{"选择困难确实很麻烦，让我想想...", "s1_advice", nullptr, 0, ""},
@@ -479,13 +499,13 @@ void Game::createNPCs() {
         DialogueOption{"当然可以！让我帮你分析一下。", "s1_choose", [this](){
             if (!state_.task_manager.hasActiveTask("side_canteen_choice") && !state_.task_manager.hasCompletedTask("side_canteen_choice")) {
                 state_.task_manager.startTask("side_canteen_choice");
-                std::cout<<"【任务接取】食堂选择。使用 task 查看。\n";
+                console()<<"【任务接取】食堂选择。使用 task 查看。\n";
             }
         }, 0, ""},
         DialogueOption{"我觉得你可以试试...", "s1_choose", [this](){
             if (!state_.task_manager.hasActiveTask("side_canteen_choice") && !state_.task_manager.hasCompletedTask("side_canteen_choice")) {
                 state_.task_manager.startTask("side_canteen_choice");
-                std::cout<<"【任务接取】食堂选择。使用 task 查看。\n";
+                console()<<"【任务接取】食堂选择。使用 task 查看。\n";
             }
         }, 0, ""},
         DialogueOption{"抱歉，我可能帮不上忙。", "exit", nullptr, 0, ""}
@@ -496,27 +516,27 @@ void Game::createNPCs() {
     s1_choose.options = {
         DialogueOption{"选麻辣烫吧！香辣可口，能让人热血沸腾。", "s1_after_pick", [this](){ 
             state_.player.attr().atk += 2; 
-            std::cout<<"你感到热血上涌，ATK+2。\n"; 
-            if(auto* tk=state_.task_manager.getTask("side_canteen_choice")) {
-                tk->setObjective(0, "完成选择 ✓");
+            console()<<"你感到热血上涌，ATK+2。\n"; 
+            if(state_.task_manager.getTask("side_canteen_choice")) {
+                state_.task_manager.setObjective("side_canteen_choice", 0, "完成选择 ✓");
                 // 标记已经选择过食物，防止重复选择
                 state_.player.setNPCFavor("苏小萌", 1); // 使用好感度标记已选择
             }
         }, 0, ""},
         DialogueOption{"选牛肉面吧！清淡营养，能让人内心平静。", "s1_after_pick", [this](){ 
             state_.player.attr().def_ += 3; 
-            std::cout<<"一碗下肚，底气更足，DEF+3。\n"; 
-            if(auto* tk=state_.task_manager.getTask("side_canteen_choice")) {
-                tk->setObjective(0, "完成选择 ✓");
+            console()<<"一碗下肚，底气更足，DEF+3。\n"; 
+            if(state_.task_manager.getTask("side_canteen_choice")) {
+                state_.task_manager.setObjective("side_canteen_choice", 0, "完成选择 ✓");
                 // 标记已经选择过食物，防止重复选择
                 state_.player.setNPCFavor("苏小萌", 1); // 使用好感度标记已选择
             }
         }, 0, ""},
         DialogueOption{"选大盘鸡吧！分量十足，能让人充满活力。", "s1_after_pick", [this](){ 
             state_.player.attr().spd += 3; 
-            std::cout<<"辣香刺激，脚步更轻，SPD+3。\n"; 
-            if(auto* tk=state_.task_manager.getTask("side_canteen_choice")) {
-                tk->setObjective(0, "完成选择 ✓");
+            console()<<"辣香刺激，脚步更轻，SPD+3。\n"; 
+            if(state_.task_manager.getTask("side_canteen_choice")) {
+                state_.task_manager.setObjective("side_canteen_choice", 0, "完成选择 ✓");
                 // 标记已经选择过食物，防止重复选择
                 state_.player.setNPCFavor("苏小萌", 1); // 使用好感度标记已选择
             }
@@ -530,16 +550,16 @@ void Game::createNPCs() {
             if (state_.player.inventory().remove("caffeine_elixir",1)) {
                 // 奖励：生命药水×1 与 钢勺护符
                 Item hp = Item::createConsumable("health_potion","生命药水","恢复生命值的药水。",30,30);
-                state_.player.inventory().add(hp,1);
+                state_.player.gainItem(hp,1);
                 Item spoon = ItemDefinitions::createSteelSpoon();
                 spoon.price = 0; // 奖励物品免费
                 spoon.effect_type = "damage_multiplier"; spoon.effect_target = "失败实验体"; spoon.effect_value = 1.3f;
-                state_.player.inventory().add(spoon,1);
+                state_.player.gainItem(spoon,1);
+                console()<<"【S1完成】你交付了咖啡因灵液，获得生命药水×1、钢勺护符×1。\n";
                 state_.player.addNPCFavor("林清漪",20);
-                std::cout<<"【S1完成】你交付了咖啡因灵液，获得生命药水×1、钢勺护符×1。林清漪好感+20。\n";
-                if(auto* tk=state_.task_manager.getTask("side_canteen_choice")) { tk->setObjective(1, "赠送咖啡因灵液 ✓"); tk->complete(); }
+                state_.task_manager.setObjective("side_canteen_choice", 1, "赠送咖啡因灵液 ✓"); state_.task_manager.completeTask("side_canteen_choice", false);
             } else {
-                std::cout<<"你没有咖啡因灵液。\n";
+                console()<<"你没有咖啡因灵液。\n";
                 // 设置标志，表示没有物品，需要跳转到不同的对话
                 state_.dialogue_memory["苏小萌"].insert("no_caffeine_elixir");
             }
@@ -575,7 +595,7 @@ void Game::createNPCs() {
             // 自动接取支线任务3：智力试炼
             if (!state_.task_manager.hasActiveTask("side_teach_wisdom") && !state_.task_manager.hasCompletedTask("side_teach_wisdom")) {
                 state_.task_manager.startTask("side_teach_wisdom");
-                std::cout<<"【任务接取】智力试炼。使用 task 查看详情。\n";
+                console()<<"【任务接取】智力试炼。使用 task 查看详情。\n";
             }
         }, 0, ""},
         DialogueOption{"你现在还会选择困难吗？", "s1_choice_advice", nullptr, 0, ""},
@@ -652,7 +672,7 @@ void Game::createNPCs() {
         DialogueOption{"当然可以！我来帮你收集。", "s2_turnin", [this](){
             if (!state_.task_manager.hasActiveTask("side_gym_fragments") && !state_.task_manager.hasCompletedTask("side_gym_fragments")) {
                 state_.task_manager.startTask("side_gym_fragments");
-                std::cout<<"【任务接取】动力碎片。使用 task 查看详情。\n";
+                console()<<"【任务接取】动力碎片。使用 task 查看详情。\n";
             }
         }, 0, ""},
         DialogueOption{"动力碎片是什么？怎么获得？", "s2_hint", nullptr, 0, ""},
@@ -671,7 +691,7 @@ void Game::createNPCs() {
         DialogueOption{"我明白了，我来帮你收集动力碎片。", "s2_turnin", [this](){
             if (!state_.task_manager.hasActiveTask("side_gym_fragments") && !state_.task_manager.hasCompletedTask("side_gym_fragments")) {
                 state_.task_manager.startTask("side_gym_fragments");
-                std::cout<<"【任务接取】动力碎片。使用 task 查看详情。\n";
+                console()<<"【任务接取】动力碎片。使用 task 查看详情。\n";
             }
         }, 0, ""},
         DialogueOption{"拖延小妖在哪里？", "s2_hint", nullptr, 0, ""},
@@ -686,7 +706,7 @@ void Game::createNPCs() {
         DialogueOption{"我明白了，开始收集！", "s2_turnin", [this](){
             if (!state_.task_manager.hasActiveTask("side_gym_fragments") && !state_.task_manager.hasCompletedTask("side_gym_fragments")) {
                 state_.task_manager.startTask("side_gym_fragments");
-                std::cout<<"【任务接取】动力碎片。使用 task 查看详情。\n";
+                console()<<"【任务接取】动力碎片。使用 task 查看详情。\n";
             }
         }, 0, ""},
         DialogueOption{"拖延小妖长什么样？", "s2_monster_info", nullptr, 0, ""},
@@ -701,7 +721,7 @@ void Game::createNPCs() {
         DialogueOption{"我明白了，开始收集！", "s2_turnin", [this](){
             if (!state_.task_manager.hasActiveTask("side_gym_fragments") && !state_.task_manager.hasCompletedTask("side_gym_fragments")) {
                 state_.task_manager.startTask("side_gym_fragments");
-                std::cout<<"【任务接取】动力碎片。使用 task 查看详情。\n";
+                console()<<"【任务接取】动力碎片。使用 task 查看详情。\n";
             }
         }, 0, ""},
         DialogueOption{"谢谢你的解释。", "welcome", nullptr, 0, ""}
@@ -741,7 +761,7 @@ void Game::createNPCs() {
             // 自动接取支线任务4：实验失败妖挑战
             if (!state_.task_manager.hasActiveTask("side_lab_challenge") && !state_.task_manager.hasCompletedTask("side_lab_challenge")) {
                 state_.task_manager.startTask("side_lab_challenge");
-                std::cout<<"【任务接取】挑战实验失败妖。使用 task 查看详情。\n";
+                console()<<"【任务接取】挑战实验失败妖。使用 task 查看详情。\n";
             }
         }, 0, ""},
         DialogueOption{"这个训练装置现在能做什么？", "s2_machine_working", nullptr, 0, ""},
@@ -1132,7 +1152,7 @@ void Game::initializeLuTianyuDialogues(NPC& npc) {
         DialogueOption{"当然可以！我来帮你收集。", "s2_turnin", [this](){
             if (!state_.task_manager.hasActiveTask("side_gym_fragments") && !state_.task_manager.hasCompletedTask("side_gym_fragments")) {
                 state_.task_manager.startTask("side_gym_fragments");
-                std::cout<<"【任务接取】动力碎片。使用 task 查看详情。\n";
+                console()<<"【任务接取】动力碎片。使用 task 查看详情。\n";
             }
         }, 0, ""},
         DialogueOption{"动力碎片是什么？怎么获得？", "s2_hint", nullptr, 0, ""},
@@ -1149,7 +1169,7 @@ void Game::initializeLuTianyuDialogues(NPC& npc) {
         DialogueOption{"我明白了，我来帮你收集动力碎片。", "s2_turnin", [this](){
             if (!state_.task_manager.hasActiveTask("side_gym_fragments") && !state_.task_manager.hasCompletedTask("side_gym_fragments")) {
                 state_.task_manager.startTask("side_gym_fragments");
-                std::cout<<"【任务接取】动力碎片。使用 task 查看详情。\n";
+                console()<<"【任务接取】动力碎片。使用 task 查看详情。\n";
             }
         }, 0, ""},
         DialogueOption{"拖延小妖在哪里？", "s2_hint", nullptr, 0, ""},
@@ -1164,7 +1184,7 @@ void Game::initializeLuTianyuDialogues(NPC& npc) {
         DialogueOption{"我明白了，开始收集！", "s2_turnin", [this](){
             if (!state_.task_manager.hasActiveTask("side_gym_fragments") && !state_.task_manager.hasCompletedTask("side_gym_fragments")) {
                 state_.task_manager.startTask("side_gym_fragments");
-                std::cout<<"【任务接取】动力碎片。使用 task 查看详情。\n";
+                console()<<"【任务接取】动力碎片。使用 task 查看详情。\n";
             }
         }, 0, ""},
         DialogueOption{"拖延小妖长什么样？", "s2_monster_info", nullptr, 0, ""},
@@ -1179,7 +1199,7 @@ void Game::initializeLuTianyuDialogues(NPC& npc) {
         DialogueOption{"我明白了，开始收集！", "s2_turnin", [this](){
             if (!state_.task_manager.hasActiveTask("side_gym_fragments") && !state_.task_manager.hasCompletedTask("side_gym_fragments")) {
                 state_.task_manager.startTask("side_gym_fragments");
-                std::cout<<"【任务接取】动力碎片。使用 task 查看详情。\n";
+                console()<<"【任务接取】动力碎片。使用 task 查看详情。\n";
             }
         }, 0, ""},
         DialogueOption{"谢谢你的解释。", "welcome", nullptr, 0, ""}
@@ -1220,7 +1240,7 @@ void Game::initializeLuTianyuDialogues(NPC& npc) {
             // 自动接取支线任务4：实验失败妖挑战
             if (!state_.task_manager.hasActiveTask("side_lab_challenge") && !state_.task_manager.hasCompletedTask("side_lab_challenge")) {
                 state_.task_manager.startTask("side_lab_challenge");
-                std::cout<<"【任务接取】挑战实验失败妖。使用 task 查看详情。\n";
+                console()<<"【任务接取】挑战实验失败妖。使用 task 查看详情。\n";
             }
         }, 0, ""},
         DialogueOption{"这个训练装置现在能做什么？", "s2_machine_working", nullptr, 0, ""},
@@ -1291,7 +1311,7 @@ void Game::initializeSuXiaomengDialogues(NPC& npc) {
         DialogueOption{"当然可以！我来帮你选择。", "s1_choose", [this](){
             if (!state_.task_manager.hasActiveTask("side_canteen_choice") && !state_.task_manager.hasCompletedTask("side_canteen_choice")) {
                 state_.task_manager.startTask("side_canteen_choice");
-                std::cout<<"【任务接取】食堂选择。使用 task 查看详情。\n";
+                console()<<"【任务接取】食堂选择。使用 task 查看详情。\n";
             }
         }, 0, ""},
         DialogueOption{"选择困难确实很麻烦，让我想想...", "s1_advice", nullptr, 0, ""},
@@ -1308,13 +1328,13 @@ void Game::initializeSuXiaomengDialogues(NPC& npc) {
         DialogueOption{"当然可以！让我帮你分析一下。", "s1_choose", [this](){
             if (!state_.task_manager.hasActiveTask("side_canteen_choice") && !state_.task_manager.hasCompletedTask("side_canteen_choice")) {
                 state_.task_manager.startTask("side_canteen_choice");
-                std::cout<<"【任务接取】食堂选择。使用 task 查看。\n";
+                console()<<"【任务接取】食堂选择。使用 task 查看。\n";
             }
         }, 0, ""},
         DialogueOption{"我觉得你可以试试...", "s1_choose", [this](){
             if (!state_.task_manager.hasActiveTask("side_canteen_choice") && !state_.task_manager.hasCompletedTask("side_canteen_choice")) {
                 state_.task_manager.startTask("side_canteen_choice");
-                std::cout<<"【任务接取】食堂选择。使用 task 查看。\n";
+                console()<<"【任务接取】食堂选择。使用 task 查看。\n";
             }
         }, 0, ""},
         DialogueOption{"抱歉，我可能帮不上忙。", "exit", nullptr, 0, ""}
@@ -1327,27 +1347,27 @@ void Game::initializeSuXiaomengDialogues(NPC& npc) {
     s1_choose.options = {
         DialogueOption{"选麻辣烫吧！香辣可口，能让人热血沸腾。", "s1_after_pick", [this](){ 
             state_.player.attr().atk += 2; 
-            std::cout<<"你感到热血上涌，ATK+2。\n"; 
-            if(auto* tk=state_.task_manager.getTask("side_canteen_choice")) {
-                tk->setObjective(0, "完成选择 ✓");
+            console()<<"你感到热血上涌，ATK+2。\n"; 
+            if(state_.task_manager.getTask("side_canteen_choice")) {
+                state_.task_manager.setObjective("side_canteen_choice", 0, "完成选择 ✓");
                 // 标记已经选择过食物，防止重复选择
                 state_.player.setNPCFavor("苏小萌", 1); // 使用好感度标记已选择
             }
         }, 0, ""},
         DialogueOption{"选牛肉面吧！清淡营养，能让人内心平静。", "s1_after_pick", [this](){ 
             state_.player.attr().def_ += 3; 
-            std::cout<<"一碗下肚，底气更足，DEF+3。\n"; 
-            if(auto* tk=state_.task_manager.getTask("side_canteen_choice")) {
-                tk->setObjective(0, "完成选择 ✓");
+            console()<<"一碗下肚，底气更足，DEF+3。\n"; 
+            if(state_.task_manager.getTask("side_canteen_choice")) {
+                state_.task_manager.setObjective("side_canteen_choice", 0, "完成选择 ✓");
                 // 标记已经选择过食物，防止重复选择
                 state_.player.setNPCFavor("苏小萌", 1); // 使用好感度标记已选择
             }
         }, 0, ""},
         DialogueOption{"选大盘鸡吧！分量十足，能让人充满活力。", "s1_after_pick", [this](){ 
             state_.player.attr().spd += 3; 
-            std::cout<<"辣香刺激，脚步更轻，SPD+3。\n"; 
-            if(auto* tk=state_.task_manager.getTask("side_canteen_choice")) {
-                tk->setObjective(0, "完成选择 ✓");
+            console()<<"辣香刺激，脚步更轻，SPD+3。\n"; 
+            if(state_.task_manager.getTask("side_canteen_choice")) {
+                state_.task_manager.setObjective("side_canteen_choice", 0, "完成选择 ✓");
                 // 标记已经选择过食物，防止重复选择
                 state_.player.setNPCFavor("苏小萌", 1); // 使用好感度标记已选择
             }
@@ -1363,16 +1383,16 @@ void Game::initializeSuXiaomengDialogues(NPC& npc) {
             if (state_.player.inventory().remove("caffeine_elixir",1)) {
                 // 奖励：生命药水×1 与 钢勺护符
                 Item hp = Item::createConsumable("health_potion","生命药水","恢复生命值的药水。",30,30);
-                state_.player.inventory().add(hp,1);
+                state_.player.gainItem(hp,1);
                 Item spoon = ItemDefinitions::createSteelSpoon();
                 spoon.price = 0; // 奖励物品免费
                 spoon.effect_type = "damage_multiplier"; spoon.effect_target = "失败实验体"; spoon.effect_value = 1.3f;
-                state_.player.inventory().add(spoon,1);
+                state_.player.gainItem(spoon,1);
+                console()<<"【S1完成】你交付了咖啡因灵液，获得生命药水×1、钢勺护符×1。\n";
                 state_.player.addNPCFavor("林清漪",20);
-                std::cout<<"【S1完成】你交付了咖啡因灵液，获得生命药水×1、钢勺护符×1。林清漪好感+20。\n";
-                if(auto* tk=state_.task_manager.getTask("side_canteen_choice")) { tk->setObjective(1, "赠送咖啡因灵液 ✓"); tk->complete(); }
+                state_.task_manager.setObjective("side_canteen_choice", 1, "赠送咖啡因灵液 ✓"); state_.task_manager.completeTask("side_canteen_choice", false);
             } else {
-                std::cout<<"你没有咖啡因灵液。\n";
+                console()<<"你没有咖啡因灵液。\n";
                 // 设置标志，表示没有物品，需要跳转到不同的对话
                 state_.dialogue_memory["苏小萌"].insert("no_caffeine_elixir");
             }
@@ -1409,7 +1429,7 @@ void Game::initializeSuXiaomengDialogues(NPC& npc) {
             // 自动接取支线任务3：智力试炼
             if (!state_.task_manager.hasActiveTask("side_teach_wisdom") && !state_.task_manager.hasCompletedTask("side_teach_wisdom")) {
                 state_.task_manager.startTask("side_teach_wisdom");
-                std::cout<<"【任务接取】智力试炼。使用 task 查看详情。\n";
+                console()<<"【任务接取】智力试炼。使用 task 查看详情。\n";
             }
         }, 0, ""},
         DialogueOption{"你现在还会选择困难吗？", "s1_choice_advice", nullptr, 0, ""},
@@ -0,0 +1,64 @@
+// 这是会话休眠的实现文件
+// 作者：大一学生
+// 功能：Game::hibernate / Game::restore。休眠数据 = 各随机数引擎的新种子 + 商店进货标记 + 存档内容，
+//       存档部分和save指令写出的文件完全相同（包括最后输入的时刻），恢复时按读档指令的步骤重建定时任务和对话；
+//       离线补算不在这里做，和没休眠的会话一样由回来后的第一行输入触发（见OfflineProgress.hpp）
+
+#include "Game.hpp"      // 游戏类头文件
+#include "Output.hpp"    // 游戏输出
+#include "SaveLoad.hpp"  // 存档读档
+#include "Trace.hpp"     // 时间线跟踪
+#include <sstream>       // 字符串流
+
+namespace hx {
+
+namespace {
+// 休眠数据开头的固定部分
+struct HibernationHeader {
+    std::uint32_t game_seed;    // 掉落等游戏逻辑
+    std::uint32_t combat_seed;  // 战斗
+    std::uint32_t shop_seed;    // 商店进货
+    bool shop_refresh_due;      // 商店是否等着下次打开时刷新（存档里没有）
+};
+}
+
+// 休眠
+// 功能：随机数引擎的完整状态每个有两千多字节，这里不保存，而是从每个引擎里各抽一个数，
+//       恢复后用它重新设置种子：恢复后的随机结果仍由种子和输入决定，只是和不休眠时的那一串不同
+std::string Game::hibernate() {
+    HX_TRACE_SPAN("hibernate");
+    HibernationHeader header{};
+    header.game_seed = static_cast<std::uint32_t>(rng_());
+    header.combat_seed = static_cast<std::uint32_t>(combat_.engine()());
+    header.shop_seed = static_cast<std::uint32_t>(state_.shop_system.engine()());
+    header.shop_refresh_due = state_.shop_system.refreshDue();
+
+    std::ostringstream out(std::ios::binary);
+    out.write((const char*)&header, sizeof(header));
+    if (!SaveLoad::save(state_, out)) return std::string();
+    return out.str();
+}
+
+// 恢复
+// 功能：本对象应是用同一个种子刚建好的Game；读档后的步骤和读档指令相同
+bool Game::restore(const std::string& blob) {
+    HX_TRACE_SPAN("restore");
+    ConsoleScope mute(nullConsole());
+    std::istringstream in(blob, std::ios::binary);
+    HibernationHeader header{};
+    if (!in.read((char*)&header, sizeof(header))) return false;
+    if (!SaveLoad::load(state_, in)) return false;
+
+    if (state_.monster_spawns.empty()) initializeMonsterSpawns();
+    scheduleWorldTimers();
+    initializeNPCDialogues();
+
+    rng_.seed(header.game_seed);
+    combat_.seed(header.combat_seed);
+    state_.shop_system.seed(header.shop_seed);
+    if (header.shop_refresh_due) state_.shop_system.markRefreshDue();
+    publishMemory();
+    return true;
+}
+
+} // namespace hx
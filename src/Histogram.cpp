@@ -0,0 +1,81 @@
+// 这是延迟直方图的实现文件
+// 作者：大一学生
+// 功能：数值到格子编号的换算、合并与百分位数查询
+
+#include "Histogram.hpp"  // 延迟直方图头文件
+#include <algorithm>      // min/max
+
+namespace hx {
+
+namespace {
+constexpr unsigned kSubBits = 6;                        // 每段64格
+constexpr std::uint64_t kLinear = 2ull << kSubBits;     // 0..127 每个值一格
+constexpr size_t kBuckets = static_cast<size_t>(kLinear) + (63 - kSubBits) * (1u << kSubBits);
+
+// 最高位的位置（value>0）
+unsigned highestBit(std::uint64_t value) {
+    unsigned bit = 0;
+    for (unsigned step = 32; step > 0; step /= 2) {
+        if (value >> (bit + step)) bit += step;
+    }
+    return bit;
+}
+} // namespace
+
+Histogram::Histogram() : counts_(kBuckets, 0) {}
+
+// 128以下直接对应；更大的值：最高位决定段，紧跟的6位决定段内的格
+size_t Histogram::indexOf(std::uint64_t value) {
+    if (value < kLinear) return static_cast<size_t>(value);
+    unsigned shift = highestBit(value) - kSubBits;  // 至少为1
+    std::uint64_t sub = (value >> shift) - (1ull << kSubBits);
+    return static_cast<size_t>(kLinear + (shift - 1) * (1ull << kSubBits) + sub);
+}
+
+std::uint64_t Histogram::highestInBucket(size_t index) {
+    if (index < kLinear) return index;
+    size_t offset = index - static_cast<size_t>(kLinear);
+    unsigned shift = static_cast<unsigned>(offset >> kSubBits) + 1;
+    std::uint64_t sub = (offset & ((1u << kSubBits) - 1)) + (1ull << kSubBits);
+    return ((sub + 1) << shift) - 1;
+}
+
+void Histogram::record(std::uint64_t value) {
+    ++counts_[indexOf(value)];
+    ++count_;
+    sum_ += value;
+    min_ = std::min(min_, value);
+    max_ = std::max(max_, value);
+}
+
+void Histogram::merge(const Histogram& other) {
+    for (size_t i = 0; i < counts_.size(); ++i) counts_[i] += other.counts_[i];
+    count_ += other.count_;
+    sum_ += other.sum_;
+    min_ = std::min(min_, other.min_);
+    max_ = std::max(max_, other.max_);
+}
+
+void Histogram::clear() {
+    std::fill(counts_.begin(), counts_.end(), 0);
+    count_ = 0;
+    sum_ = 0;
+    min_ = ~std::uint64_t(0);
+    max_ = 0;
+}
+
+std::uint64_t Histogram::percentile(double p) const {
+    if (count_ == 0) return 0;
+    p = std::min(100.0, std::max(0.0, p));
+    // 至少要覆盖到第 rank 个值
+    std::uint64_t rank = static_cast<std::uint64_t>(p / 100.0 * static_cast<double>(count_) + 0.5);
+    rank = std::max<std::uint64_t>(1, std::min(rank, count_));
+    std::uint64_t seen = 0;
+    for (size_t i = 0; i < counts_.size(); ++i) {
+        seen += counts_[i];
+        if (seen >= rank) return std::min(highestInBucket(i), max_);
+    }
+    return max_;
+}
+
+} // namespace hx
@@ -2,52 +2,138 @@
 // 玩家的背包系统，管理物品的存储和数量
 
 #include "Inventory.hpp"  // 背包类头文件
+#include "MemoryUsage.hpp" // 内存统计工具
+#include <functional>     // std::hash
 
 namespace hx {
+
+namespace {
+std::size_t idHash(std::string_view id) { return std::hash<std::string_view>{}(id); }
+} // namespace
+
 // 添加物品到背包
 // 输入要添加的物品和数量
-void Inventory::add(const Item& item,int qty){ 
-    auto &entry = data_[item.id];           // 获取或创建物品条目
-    if(entry.second==0) entry.first=item;   // 如果是新物品，设置物品信息
-    entry.second+=qty;                      // 增加数量
-    entry.first.count=entry.second;         // 更新物品的计数
+void Inventory::add(const Item& item,int qty){
+    Handle h = find(item.id);
+    if (h != kNone) {
+        slots_[h].item.count += qty;        // 已有物品，增加数量
+        return;
+    }
+    // 新物品：优先使用空出来的槽位
+    if (!free_.empty()) {
+        h = free_.back();
+        free_.pop_back();
+    } else {
+        h = static_cast<Handle>(slots_.size());
+        slots_.emplace_back();
+    }
+    slots_[h].item = item;
+    slots_[h].item.count = qty;
+    slots_[h].used = true;
+    id_index_.emplace(idHash(item.id), h);
+    names_.insert(h, item.name);
 }
 
 // 从背包中移除物品
 // 输入物品ID和要移除的数量
 // 如果移除成功返回true，物品不足返回false
-bool Inventory::remove(const std::string& id,int qty){ 
-    auto it=data_.find(id);                 // 查找物品
-    if(it==data_.end()) return false;       // 物品不存在，返回失败
-    if(it->second.second<qty) return false; // 数量不足，返回失败
-    it->second.second-=qty;                 // 减少数量
-    it->second.first.count=it->second.second; // 更新物品计数
-    if(it->second.second==0) data_.erase(it); // 如果数量为0，删除物品
+bool Inventory::remove(const std::string& id,int qty){
+    Handle h = find(id);                    // 查找物品
+    if(h==kNone) return false;              // 物品不存在，返回失败
+    Item& item = slots_[h].item;
+    if(item.count<qty) return false;        // 数量不足，返回失败
+    item.count-=qty;                        // 减少数量
+    if(item.count==0) {                     // 如果数量为0，空出槽位
+        auto range = id_index_.equal_range(idHash(item.id));
+        for (auto it = range.first; it != range.second; ++it) {
+            if (it->second == h) { id_index_.erase(it); break; }
+        }
+        names_.erase(h);
+        slots_[h].used = false;
+        slots_[h].item = Item{};
+        free_.push_back(h);
+    }
     return true;                            // 返回成功
 }
 
 // 查询物品数量
-int Inventory::quantity(const std::string& id) const{ 
-    auto it=data_.find(id);                 // 查找物品
-    return it==data_.end()?0:it->second.second; // 返回数量或0
+int Inventory::quantity(std::string_view id) const{
+    Handle h = find(id);                    // 查找物品
+    return h==kNone?0:slots_[h].item.count; // 返回数量或0
+}
+
+// 按ID查找槽位
+Inventory::Handle Inventory::find(std::string_view id) const {
+    auto range = id_index_.equal_range(idHash(id));
+    for (auto it = range.first; it != range.second; ++it) {
+        if (slots_[it->second].item.id == id) return it->second;
+    }
+    return kNone;
+}
+
+// 按玩家输入查找物品
+// 功能：ID完全相同时直接返回，否则交给名称索引按相关度选择（不要字面相似的）
+Inventory::Handle Inventory::match(std::string_view text) const {
+    if (text.empty()) {
+        // 空输入被任何名称包含，返回第一个物品
+        const_iterator first = begin();
+        return first == end() ? kNone : first.handle();
+    }
+    Handle h = find(text);
+    if (h != kNone) return h;
+    FuzzyIndex::Key key;
+    return names_.best(text, key, nullptr, FuzzyIndex::kNoSimilar) ? key : kNone;
+}
+
+// 给找不到的输入找个建议
+Inventory::Handle Inventory::suggest(std::string_view text) const {
+    FuzzyIndex::Key key;
+    return names_.best(text, key) ? key : kNone;
+}
+
+// 取槽位里的物品
+const Item* Inventory::get(Handle h) const {
+    if (h >= slots_.size() || !slots_[h].used) return nullptr;
+    return &slots_[h].item;
 }
 
 // 获取所有物品列表
-std::vector<Item> Inventory::list() const{ 
+std::vector<Item> Inventory::list() const{
     std::vector<Item> out;                  // 创建输出向量
-    for(auto &kv:data_) out.push_back(kv.second.first); // 遍历所有物品并添加到向量
+    out.reserve(size());
+    for(const Item& item : *this) out.push_back(item); // 遍历所有物品并添加到向量
     return out;                             // 返回物品列表
 }
 
 // 获取简单物品列表（与list()功能相同）
 // 兼容性方法
-std::vector<Item> Inventory::asSimpleItems() const{ 
-    return list(); 
+std::vector<Item> Inventory::asSimpleItems() const{
+    return list();
 }
 
 // 设置背包内容
-void Inventory::setFromSimple(const std::vector<Item>& items){ 
-    data_.clear();                          // 清空背包
-    for(auto &it:items) data_[it.id] = {it, it.count}; // 添加所有物品
+void Inventory::setFromSimple(const std::vector<Item>& items){
+    // 清空背包
+    slots_.clear();
+    free_.clear();
+    id_index_.clear();
+    names_.clear();
+    // 添加所有物品（ID重复时以后面的为准）
+    for(auto &it:items) {
+        Handle h = find(it.id);
+        if (h == kNone) {
+            h = static_cast<Handle>(slots_.size());
+            slots_.push_back(Slot{it, true});
+            id_index_.emplace(idHash(it.id), h);
+        } else {
+            slots_[h].item = it;
+        }
+        names_.insert(h, it.name);
+    }
+}
+
+size_t Inventory::heapBytes() const {
+    return memory::bytes(slots_, [](const Slot& s) { return s.item.heapBytes(); })
+         + memory::bytes(free_) + memory::tableBytes(id_index_) + names_.heapBytes();
 }
 } // namespace hx
@@ -2,6 +2,7 @@
 // 游戏中的物品系统，包括消耗品、装备、任务物品等
 
 #include "Item.hpp"    // 物品类头文件
+#include "MemoryUsage.hpp" // 内存统计工具
 #include <sstream>     // 字符串流
 #include <algorithm>   // 算法库
 
@@ -350,4 +351,14 @@ void Equipment::setEquippedItems(const std::vector<Item>& items) {
     }
 }
 
+size_t Item::heapBytes() const {
+    return memory::bytes(id) + memory::bytes(name) + memory::bytes(description) + memory::bytes(set_name)
+         + memory::bytes(effect_description) + memory::bytes(effect_type) + memory::bytes(effect_target)
+         + memory::bytes(use_message);
+}
+
+size_t Equipment::heapBytes() const {
+    return memory::tableBytes(equipped_items_, [](const auto& kv) { return kv.second.heapBytes(); });
+}
+
 } // namespace hx
@@ -0,0 +1,358 @@
+// 这是配装优化的实现文件
+// 作者：大一学生
+// 功能：收集候选装备、预先合计饰品组合、分支限界搜索武器×护甲×饰品组合
+
+#include "LoadoutOptimizer.hpp"  // 配装优化头文件
+#include "Combat.hpp"            // 战斗系统（装备对敌人的伤害倍率）
+#include "Enemy.hpp"             // 敌人类
+#include "Trace.hpp"             // 时间线跟踪
+#include "WorkerPool.hpp"        // 共用的辅助线程池
+#include <algorithm>             // sort/max/min
+#include <atomic>                // 线程间共享的最好得分
+#include <cmath>                 // round
+#include <mutex>                 // 保护最好的配装
+#include <string>                // 字符串
+#include <unordered_map>         // 按ID去重
+
+namespace hx {
+
+namespace {
+
+constexpr double kMaxTurns = 1000.0;        // 受到的伤害全被回复抵消时，按这么多回合算
+constexpr double kInspireShare = 0.5;       // 鼓舞大约覆盖战斗的一半回合
+constexpr double kShieldShare = 1.0 / 3.0;  // 周期护盾每3回合有1回合
+constexpr size_t kParallelLeaves = 200000;  // 组合数超过这个才分给多个线程
+constexpr size_t kDeadlineStride = 256;     // 每评估这么多组合看一次时间
+
+// 一件或几件装备合计的加成
+// 闪避、回复这类效果在战斗里是把同类效果的数值相乘（Equipment::getEffectValue），合计时也相乘；
+// 伤害倍率战斗里只取第一件，这里也只保留一个
+struct Terms {
+    int atk{0};
+    int def_{0};
+    int spd{0};
+    int hp{0};
+    bool evasion{false};
+    double evasion_value{1.0};
+    bool heal{false};
+    double heal_value{1.0};
+    bool shield{false};
+    bool inspire{false};
+    double damage_mul{1.0};
+};
+
+Terms termsOf(const Item& item, const Enemy& enemy) {
+    Terms t;
+    t.atk = item.atk_delta;
+    t.def_ = item.def_delta;
+    t.spd = item.spd_delta;
+    t.hp = item.hp_delta;
+    if (item.effect_type == "extra_evasion") { t.evasion = true; t.evasion_value = item.effect_value; }
+    if (item.effect_type == "per_turn_heal_percent") { t.heal = true; t.heal_value = item.effect_value; }
+    t.shield = item.effect_type == "periodic_shield";
+    t.inspire = item.effect_type == "auto_inspiration" || item.effect_type == "on_attack_inspiration";
+    t.damage_mul = CombatSystem::equipmentDamageMultiplier(item, enemy);
+    return t;
+}
+
+// 实际穿上 a 和 b 两组装备的合计
+Terms combine(const Terms& a, const Terms& b) {
+    Terms t;
+    t.atk = a.atk + b.atk;
+    t.def_ = a.def_ + b.def_;
+    t.spd = a.spd + b.spd;
+    t.hp = a.hp + b.hp;
+    t.evasion = a.evasion || b.evasion;
+    t.evasion_value = a.evasion_value * b.evasion_value;
+    t.heal = a.heal || b.heal;
+    t.heal_value = a.heal_value * b.heal_value;
+    t.shield = a.shield || b.shield;
+    t.inspire = a.inspire || b.inspire;
+    t.damage_mul = a.damage_mul != 1.0 ? a.damage_mul : b.damage_mul;
+    return t;
+}
+
+// 一组可选项的乐观合计：每一项都取所有选项里最好的（不一定来自同一个选项）
+Terms optimisticOf(const std::vector<Terms>& options) {
+    Terms best;
+    bool first = true;
+    for (const Terms& t : options) {
+        best.atk = first ? t.atk : std::max(best.atk, t.atk);
+        best.def_ = first ? t.def_ : std::max(best.def_, t.def_);
+        best.spd = first ? t.spd : std::max(best.spd, t.spd);
+        best.hp = first ? t.hp : std::max(best.hp, t.hp);
+        if (t.evasion && (!best.evasion || t.evasion_value > best.evasion_value)) { best.evasion = true; best.evasion_value = t.evasion_value; }
+        if (t.heal && (!best.heal || t.heal_value > best.heal_value)) { best.heal = true; best.heal_value = t.heal_value; }
+        best.shield = best.shield || t.shield;
+        best.inspire = best.inspire || t.inspire;
+        best.damage_mul = std::max(best.damage_mul, t.damage_mul);
+        first = false;
+    }
+    return best;
+}
+
+// 已定部分 fixed 加上剩余部分的乐观合计 rest，得到得分的上界：
+// 同类效果相乘只会变小，所以已经有了就按已有的算，还没有才取剩余里最好的
+Terms bound(const Terms& fixed, const Terms& rest) {
+    Terms t = combine(fixed, rest);
+    t.evasion_value = fixed.evasion ? fixed.evasion_value : rest.evasion_value;
+    t.heal_value = fixed.heal ? fixed.heal_value : rest.heal_value;
+    t.damage_mul = std::max(fixed.damage_mul, rest.damage_mul);
+    return t;
+}
+
+// 两层剩余部分的乐观合计合在一起：属性相加，效果取两层里最好的
+Terms boundRest(const Terms& a, const Terms& b) {
+    Terms t = combine(a, b);
+    t.evasion_value = !a.evasion ? b.evasion_value : (!b.evasion ? a.evasion_value : std::max(a.evasion_value, b.evasion_value));
+    t.heal_value = !a.heal ? b.heal_value : (!b.heal ? a.heal_value : std::max(a.heal_value, b.heal_value));
+    t.damage_mul = std::max(a.damage_mul, b.damage_mul);
+    return t;
+}
+
+// 与 CombatSystem::rollHit 相同的命中率
+double hitChance(double attacker_spd, double defender_spd) {
+    return std::max(15.0, std::min(95.0, 100.0 - (defender_spd - attacker_spd) * 2.0)) / 100.0;
+}
+
+// 评分用到的固定部分：玩家基础属性和敌人
+struct Context {
+    StatLine base;
+    double enemy_hp;
+    double enemy_atk;
+    double enemy_def;
+    double enemy_spd;
+};
+
+int applyBonus(int value, float bonus) {
+    return bonus > 1.0f ? static_cast<int>(static_cast<float>(value) * bonus) : value;
+}
+
+// 期望值估算（与 CombatSystem::playTurn 的伤害公式一致；鼓舞和护盾按覆盖的回合比例折算）
+// 每一项加成都只会让得分变大或不变，所以用乐观合计算出的就是上界
+LoadoutScore evaluate(const Context& ctx, const Terms& t, float bonus) {
+    LoadoutScore s;
+    s.set_bonus = bonus;
+    s.stats.atk = applyBonus(ctx.base.atk + t.atk, bonus);
+    s.stats.def_ = applyBonus(ctx.base.def_ + t.def_, bonus);
+    s.stats.spd = applyBonus(ctx.base.spd + t.spd, bonus);
+    s.stats.max_hp = applyBonus(ctx.base.max_hp + t.hp, bonus);
+
+    double atk = s.stats.atk * (t.inspire ? 1.0 + 0.15 * kInspireShare : 1.0);
+    double spd = s.stats.spd * (t.inspire ? 1.0 + 0.10 * kInspireShare : 1.0);
+    double def = s.stats.def_ * (t.shield ? 1.0 + 0.3 * kShieldShare : 1.0);
+
+    double dealt = std::max(1.0, atk * t.damage_mul * (1.0 - ctx.enemy_def / (ctx.enemy_def + 120.0)))
+                 * hitChance(spd, ctx.enemy_spd);
+    double taken = std::max(1.0, ctx.enemy_atk * (1.0 - def / (def + 120.0)))
+                 * hitChance(ctx.enemy_spd, spd) * (t.evasion ? 1.0 - t.evasion_value : 1.0);
+    double heal = t.heal ? std::max(1.0, s.stats.max_hp * t.heal_value) : 0.0;
+
+    s.kill_turns = ctx.enemy_hp / dealt;
+    s.survive_turns = taken > heal ? std::min(kMaxTurns, s.stats.max_hp / (taken - heal)) : kMaxTurns;
+    s.score = s.survive_turns / s.kill_turns;
+    return s;
+}
+
+// 一种可选的装备（按ID去重；units 为最多能同时穿几件）
+struct Option {
+    const Item* item;
+    Terms terms;
+    int units;
+};
+
+// 两个饰品槽的一种组合（预先合计好）
+struct AccessoryPair {
+    const Item* first;
+    const Item* second;
+    Terms terms;
+};
+
+// 收集候选装备：背包里的和身上穿着的，同ID只留一份
+void collect(const Player& player, const Enemy& enemy, std::vector<Option>& weapons,
+             std::vector<Option>& armors, std::vector<Option>& accessories) {
+    std::unordered_map<std::string, size_t> seen;
+    std::vector<Option> all;
+    auto add = [&](const Item& item, int count) {
+        if (item.type != ItemType::EQUIPMENT || item.equip_type == EquipmentType::NONE) return;
+        if (item.level_requirement > player.level() || count <= 0) return;
+        auto it = seen.find(item.id);
+        if (it != seen.end()) { all[it->second].units += count; return; }
+        seen[item.id] = all.size();
+        all.push_back(Option{&item, termsOf(item, enemy), count});
+    };
+    for (const Item& item : player.inventory()) add(item, item.count);
+    for (EquipmentSlot slot : {EquipmentSlot::WEAPON, EquipmentSlot::ARMOR, EquipmentSlot::ACCESSORY1, EquipmentSlot::ACCESSORY2}) {
+        if (const Item* item = player.equipment().getEquippedItem(slot)) add(*item, 1);
+    }
+    for (const Option& o : all) {
+        if (o.item->equip_type == EquipmentType::WEAPON) weapons.push_back(o);
+        else if (o.item->equip_type == EquipmentType::ARMOR) armors.push_back(o);
+        else accessories.push_back(o);
+    }
+}
+
+// 搜索过程中共享的状态
+struct Search {
+    const Context* ctx;
+    const std::vector<Option>* weapons;    // item 为空指针的一项表示空着
+    const std::vector<Option>* armors;
+    const std::vector<AccessoryPair>* pairs;
+    Terms below_weapon;                    // 护甲层和饰品层合起来的乐观合计
+    Terms pair_rest;                       // 饰品层的乐观合计
+    std::chrono::steady_clock::time_point deadline;
+
+    std::atomic<size_t> next_weapon{0};
+    std::atomic<size_t> evaluated{0};
+    std::atomic<bool> stopped{false};
+    std::atomic<double> best_score{0.0};
+    std::mutex mutex;
+    LoadoutScore best;
+    const Item* best_items[4]{};
+
+    void offer(const LoadoutScore& s, const Item* w, const Item* a, const AccessoryPair& p) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (s.score <= best.score) return;
+        best = s;
+        best_items[0] = w; best_items[1] = a; best_items[2] = p.first; best_items[3] = p.second;
+        best_score.store(s.score, std::memory_order_relaxed);
+    }
+
+    // 线程轮流领取下一把武器，搜索它下面的全部护甲和饰品组合
+    void work() {
+        size_t local = 0;
+        for (size_t wi = next_weapon.fetch_add(1); wi < weapons->size() && !stopped.load(std::memory_order_relaxed);
+             wi = next_weapon.fetch_add(1)) {
+            const Option& w = (*weapons)[wi];
+            // 武器层的上界：护甲和饰品都取最好，两件套倍率取能凑出的最高
+            float best_bonus = 1.0f;
+            for (const Option& a : *armors) best_bonus = std::max(best_bonus, Player::twoPieceBonus(w.item, a.item));
+            if (evaluate(*ctx, bound(w.terms, below_weapon), best_bonus).score
+                <= best_score.load(std::memory_order_relaxed)) continue;
+
+            for (const Option& a : *armors) {
+                Terms wa = combine(w.terms, a.terms);
+                float bonus = Player::twoPieceBonus(w.item, a.item);
+                if (evaluate(*ctx, bound(wa, pair_rest), bonus).score <= best_score.load(std::memory_order_relaxed)) continue;
+                for (const AccessoryPair& p : *pairs) {
+                    LoadoutScore s = evaluate(*ctx, combine(wa, p.terms), bonus);
+                    if (s.score > best_score.load(std::memory_order_relaxed)) offer(s, w.item, a.item, p);
+                    if (++local % kDeadlineStride == 0 && std::chrono::steady_clock::now() > deadline) {
+                        stopped.store(true, std::memory_order_relaxed);
+                    }
+                }
+                if (stopped.load(std::memory_order_relaxed)) break;
+            }
+        }
+        evaluated.fetch_add(local, std::memory_order_relaxed);
+    }
+};
+
+Context makeContext(const Player& player, const Enemy& enemy, int tier) {
+    Context ctx;
+    ctx.base = player.baseStats();
+    const Attributes& ea = enemy.attr();
+    double atk_mul = tier == 0 ? 0.9 : (tier == 2 ? 1.1 : 1.0);
+    ctx.enemy_hp = std::max(1, ea.hp);
+    ctx.enemy_atk = std::round(ea.atk * atk_mul);
+    ctx.enemy_def = ea.def_;
+    ctx.enemy_spd = ea.spd;
+    return ctx;
+}
+
+Terms equippedTerms(const Player& player, const Enemy& enemy) {
+    Terms t;
+    for (EquipmentSlot slot : {EquipmentSlot::WEAPON, EquipmentSlot::ARMOR, EquipmentSlot::ACCESSORY1, EquipmentSlot::ACCESSORY2}) {
+        if (const Item* item = player.equipment().getEquippedItem(slot)) t = combine(t, termsOf(*item, enemy));
+    }
+    return t;
+}
+
+} // namespace
+
+LoadoutScore scoreLoadout(const Player& player, const Enemy& enemy, int tier) {
+    const Equipment& eq = player.equipment();
+    return evaluate(makeContext(player, enemy, tier), equippedTerms(player, enemy),
+                    Player::twoPieceBonus(eq.getEquippedItem(EquipmentSlot::WEAPON), eq.getEquippedItem(EquipmentSlot::ARMOR)));
+}
+
+LoadoutPlan optimizeLoadout(const Player& player, const Enemy& enemy, int tier, std::chrono::milliseconds budget) {
+    HX_TRACE_SPAN("optimize_loadout");
+    Context ctx = makeContext(player, enemy, tier);
+    std::vector<Option> weapons, armors, accessories;
+    collect(player, enemy, weapons, armors, accessories);
+
+    LoadoutPlan plan;
+    plan.candidates = weapons.size() + armors.size() + accessories.size();
+
+    // 饰品组合：两件不同的、同一件穿两份（背包里至少有两件时）、只穿一件、都不穿
+    std::vector<AccessoryPair> pairs;
+    pairs.push_back(AccessoryPair{nullptr, nullptr, Terms{}});
+    for (size_t i = 0; i < accessories.size(); ++i) {
+        const Option& a = accessories[i];
+        pairs.push_back(AccessoryPair{a.item, nullptr, a.terms});
+        if (a.units >= 2) pairs.push_back(AccessoryPair{a.item, a.item, combine(a.terms, a.terms)});
+        for (size_t j = i + 1; j < accessories.size(); ++j) {
+            pairs.push_back(AccessoryPair{a.item, accessories[j].item, combine(a.terms, accessories[j].terms)});
+        }
+    }
+    // 武器、护甲各加一个“空着”的选项
+    weapons.push_back(Option{nullptr, Terms{}, 1});
+    armors.push_back(Option{nullptr, Terms{}, 1});
+
+    std::vector<Terms> rest;
+    for (const Option& a : armors) rest.push_back(a.terms);
+    Terms armor_rest = optimisticOf(rest);
+    rest.clear();
+    for (const AccessoryPair& p : pairs) rest.push_back(p.terms);
+    Terms pair_rest = optimisticOf(rest);
+
+    // 先搜上界高的武器和护甲，尽早找到好的配装，后面才剪得多
+    auto order = [&](std::vector<Option>& options, const Terms& others) {
+        std::vector<std::pair<double, Option>> keyed;
+        for (const Option& o : options) keyed.emplace_back(evaluate(ctx, bound(o.terms, others), 1.2f).score, o);
+        std::stable_sort(keyed.begin(), keyed.end(), [](const auto& x, const auto& y) { return x.first > y.first; });
+        for (size_t i = 0; i < keyed.size(); ++i) options[i] = keyed[i].second;
+    };
+    Terms below_weapon = boundRest(armor_rest, pair_rest);
+    order(weapons, below_weapon);
+    order(armors, pair_rest);
+
+    Search search;
+    search.ctx = &ctx;
+    search.weapons = &weapons;
+    search.armors = &armors;
+    search.pairs = &pairs;
+    search.below_weapon = below_weapon;
+    search.pair_rest = pair_rest;
+    search.deadline = std::chrono::steady_clock::now() + budget;
+    // 现有配装作为初始的最好结果：搜不完时也不会推荐比现在更差的
+    plan.current = scoreLoadout(player, enemy, tier);
+    search.best = plan.current;
+    const Equipment& eq = player.equipment();
+    search.best_items[0] = eq.getEquippedItem(EquipmentSlot::WEAPON);
+    search.best_items[1] = eq.getEquippedItem(EquipmentSlot::ARMOR);
+    search.best_items[2] = eq.getEquippedItem(EquipmentSlot::ACCESSORY1);
+    search.best_items[3] = eq.getEquippedItem(EquipmentSlot::ACCESSORY2);
+    search.best_score.store(plan.current.score);
+
+    size_t leaves = weapons.size() * armors.size() * pairs.size();
+    unsigned helpers = leaves > kParallelLeaves ? sharedPoolThreads() : 0u;
+    helpers = std::min<unsigned>(helpers, static_cast<unsigned>(weapons.size()) - 1);
+    auto work = [&search]() { search.work(); };
+    runShared(helpers, work);
+
+    plan.best = search.best;
+    plan.evaluated = search.evaluated.load();
+    plan.exhaustive = !search.stopped.load();
+    const EquipmentSlot slots[4] = {EquipmentSlot::WEAPON, EquipmentSlot::ARMOR, EquipmentSlot::ACCESSORY1, EquipmentSlot::ACCESSORY2};
+    for (int i = 0; i < 4; ++i) {
+        if (!search.best_items[i]) continue;
+        Item item = *search.best_items[i];
+        item.equip_slot = slots[i];
+        plan.items.push_back(std::move(item));
+    }
+    return plan;
+}
+
+} // namespace hx
@@ -7,6 +7,9 @@
 #include <algorithm>       // 算法库
 #include <sstream>         // 字符串流
 #include <map>             // 映射容器
+#include <queue>           // 寻路的BFS队列
+#include "TextWidth.hpp"   // 地名的显示宽度
+#include "MemoryUsage.hpp" // 内存统计工具
 #include <windows.h>       // Windows控制台颜色支持
 
 namespace hx {
@@ -19,111 +22,215 @@ void setConsoleColor(int color) {
     SetConsoleTextAttribute(hConsole, color);           // 设置文字属性
 }
 
-void Map::addLocation(const Location& loc){ data_[loc.id]=loc; }
+void Map::addLocation(const Location& loc){ data_[loc.id]=loc; invalidateIndexes(); }
+void Map::removeLocation(const std::string& id){ if(data_.erase(id)) invalidateIndexes(); }
 const Location* Map::get(const std::string& id) const{ auto it=data_.find(id); return it==data_.end()?nullptr:&it->second; }
 Location* Map::get(const std::string& id){ auto it=data_.find(id); return it==data_.end()?nullptr:&it->second; }
 std::vector<Location> Map::allLocations() const{ std::vector<Location> out; for(auto &kv:data_) out.push_back(kv.second); return out; }
 
+void Map::setLayerTitle(int layer, std::string title) {
+    if (title.empty()) layer_titles_.erase(layer);
+    else layer_titles_[layer] = std::move(title);
+}
+
 // 检查是否为教学区地点
 bool Map::isTeachingAreaLocation(const std::string& locationId) const {
-    return std::find(teachingAreaLocations_.begin(), teachingAreaLocations_.end(), locationId) != teachingAreaLocations_.end();
+    const Location* loc = get(locationId);
+    return loc && loc->layer == kTeachingLayer;
 }
 
-// 主地图渲染 - 单条走廊+分支结构
-std::string Map::renderMainMap(const std::string& currentId) const {
-    std::stringstream ss;
-    ss << "=== 主地图 ===\n";
-    
-    // 地图模板 - 使用占位符表示地名
-    std::string mapTemplate = 
-        "{north_playground} —— {canteen}\n"
-        "      |\n"
-        "{activity_center} —— {gymnasium} —— {plaza_36} —— {teaching_area} —— {info_building} —— {library} —— {wenxintan}\n";
-    
-    // 地名映射
-    std::map<std::string, std::string> locationNames = {
-        {"north_playground", "荒废北操场"},
-        {"canteen", "食堂"},
-        {"activity_center", "大学生活动中心"},
-        {"gymnasium", "体育馆"},
-        {"plaza_36", "三六广场"},
-        {"teaching_area", "教学区"},
-        {"info_building", "信息楼"},
-        {"library", "秘境图书馆"},
-        {"wenxintan", "文心潭"}
-    };
-    
-    // 渲染地图，替换占位符
-    std::string result = mapTemplate;
-    for (const auto& [id, name] : locationNames) {
-        std::string placeholder = "{" + id + "}";
-        std::string displayName;
-        
-        if (id == currentId) {
-            // 当前位置用黄色高亮
-            displayName = "\033[33m" + name + "\033[0m";
-        } else {
-            displayName = name;
+// 出口实际通往的地点
+const std::string& Map::exitDestination(const Exit& exit) {
+    static const std::string jiuzhutan = "jiuzhutan", teaching_area = "teaching_area";
+    if (exit.to == "enter_teaching") return jiuzhutan;     // 进入教学区后站在九珠坛
+    if (exit.to == "exit_teaching") return teaching_area;  // 退出教学区回到主地图的教学区
+    return exit.to;
+}
+
+// 建立路由表
+// 功能：从每个地点出发各做一次BFS；第一步走的出口沿BFS树往下传，
+//       得到“从 i 去 j 先走哪个出口”。表是 n×n 的：固定地点几十个，加上最多
+//       Dungeon::kMaxResidentFloors 层秘境（每层至多十几个房间）也就一百多个，
+//       BFS 和内存都还撑得住。
+//       出口不变时不重建，秘境生成或淘汰一层后下次寻路时重建
+void Map::buildRoutes() const {
+    route_index_.clear();
+    std::vector<const Location*> nodes;
+    for (const auto& kv : data_) {
+        route_index_[kv.first] = static_cast<int>(nodes.size());
+        nodes.push_back(&kv.second);
+    }
+    const size_t n = nodes.size();
+    next_hop_.assign(n * n, -1);
+    hops_.assign(n * n, -1);
+
+    std::queue<int> frontier;
+    for (size_t src = 0; src < n; ++src) {
+        int* next = &next_hop_[src * n];
+        int* dist = &hops_[src * n];
+        dist[src] = 0;
+        frontier.push(static_cast<int>(src));
+        while (!frontier.empty()) {
+            int at = frontier.front();
+            frontier.pop();
+            const auto& exits = nodes[static_cast<size_t>(at)]->exits;
+            for (size_t e = 0; e < exits.size(); ++e) {
+                auto it = route_index_.find(exitDestination(exits[e]));
+                if (it == route_index_.end() || dist[it->second] >= 0) continue;
+                dist[it->second] = dist[at] + 1;
+                // 从起点直接走出去的那一步记出口编号，更远的地点沿用父节点的第一步
+                next[it->second] = static_cast<size_t>(at) == src ? static_cast<int>(e) : next[at];
+                frontier.push(it->second);
+            }
         }
-        
-        // 替换占位符
-        size_t pos = result.find(placeholder);
-        if (pos != std::string::npos) {
-            result.replace(pos, placeholder.length(), displayName);
+    }
+    routes_valid_ = true;
+}
+
+const Exit* Map::nextHop(const std::string& from, const std::string& to) const {
+    if (!routes_valid_) buildRoutes();
+    auto a = route_index_.find(from), b = route_index_.find(to);
+    if (a == route_index_.end() || b == route_index_.end()) return nullptr;
+    int e = next_hop_[static_cast<size_t>(a->second) * route_index_.size() + static_cast<size_t>(b->second)];
+    return e < 0 ? nullptr : &data_.at(from).exits[static_cast<size_t>(e)];
+}
+
+int Map::routeLength(const std::string& from, const std::string& to) const {
+    if (!routes_valid_) buildRoutes();
+    auto a = route_index_.find(from), b = route_index_.find(to);
+    if (a == route_index_.end() || b == route_index_.end()) return -1;
+    return hops_[static_cast<size_t>(a->second) * route_index_.size() + static_cast<size_t>(b->second)];
+}
+
+// 建立地图视图的缓存
+// 功能：每个地点算好地名占的列数，按所在层和坐标放进空间索引，顺便记下每层的坐标范围
+void Map::buildView() const {
+    tiles_.clear();
+    tile_index_.clear();
+    layer_bounds_.clear();
+    grid_.clear();
+    for (const auto& kv : data_) {
+        const Location& loc = kv.second;
+        size_t index = tiles_.size();
+        tiles_.push_back({&loc, displayWidth(loc.name)});
+        tile_index_[loc.id] = index;
+        grid_.insert(loc.layer, loc.coord, index);
+        auto it = layer_bounds_.find(loc.layer);
+        if (it == layer_bounds_.end()) {
+            layer_bounds_[loc.layer] = {loc.coord.x, loc.coord.y, loc.coord.x, loc.coord.y};
+        } else {
+            LayerBounds& b = it->second;
+            b.min_x = std::min(b.min_x, loc.coord.x); b.max_x = std::max(b.max_x, loc.coord.x);
+            b.min_y = std::min(b.min_y, loc.coord.y); b.max_y = std::max(b.max_y, loc.coord.y);
         }
     }
-    
-    ss << result;
-    return ss.str();
+    view_valid_ = true;
 }
 
-// 教学区子地图渲染 - 树形分支结构
-std::string Map::renderTeachingDetailMap(const std::string& currentId) const {
-    std::stringstream ss;
-    ss << "=== 教学区地图 ===\n";
-    
-    // 地图模板 - 使用占位符表示地名
-    std::string mapTemplate = 
-        "{teach_2} —— {teach_3} —— {jiuzhutan} —— {teach_4}\n"
-        "                    |\n"
-        "                  {teach_5} —— {teach_6} —— {teach_7}\n"
-        "                                        |\n"
-        "                                      {tree_space}\n";
-    
-    // 地名映射
-    std::map<std::string, std::string> locationNames = {
-        {"teach_2", "教学楼二区"},
-        {"teach_3", "教学楼三区"},
-        {"teach_4", "教学楼四区"},
-        {"teach_5", "教学楼五区"},
-        {"jiuzhutan", "九珠坛"},
-        {"teach_6", "教学楼六区"},
-        {"teach_7", "教学楼七区"},
-        {"tree_space", "树下空间"}
+bool Map::linked(const Location& a, const Location& b) const {
+    for (const auto& e : a.exits) if (exitDestination(e) == b.id) return true;
+    for (const auto& e : b.exits) if (exitDestination(e) == a.id) return true;
+    return false;
+}
+
+// 视口地图渲染
+// 功能：从空间索引取出视口里的地点，收缩到它们实际占的行列；每列的宽度取这一列最长的地名，
+//       东西相邻且相连的画“——”，南北相邻且相连的在上面地名的中间画“|”。当前位置用黄色高亮
+std::string Map::renderViewport(const std::string& currentId) const {
+    if (!view_valid_) buildView();
+    auto cur = tile_index_.find(currentId);
+    if (cur == tile_index_.end()) return "";
+    const Location& here = *tiles_[cur->second].loc;
+    const int layer = here.layer;
+
+    // 视口里的地点放进按视口大小开的格子数组，再收缩到它们实际占的行列
+    constexpr int kCols = 2 * kViewRadiusX + 1, kRows = 2 * kViewRadiusY + 1;
+    const int left = here.coord.x - kViewRadiusX, top = here.coord.y - kViewRadiusY;
+    std::vector<const Tile*> cells(static_cast<size_t>(kCols * kRows), nullptr);
+    int x0 = kViewRadiusX, y0 = kViewRadiusY, x1 = x0, y1 = y0;  // 实际占的范围（视口内的列号、行号）
+    grid_.forEachIn(layer, left, top, left + kCols - 1, top + kRows - 1, [&](Coord pos, size_t item) {
+        int c = pos.x - left, r = pos.y - top;
+        const Tile*& slot = cells[static_cast<size_t>(r * kCols + c)];
+        if (slot) return;  // 同一坐标有多个地点时只画先找到的
+        slot = &tiles_[item];
+        x0 = std::min(x0, c); x1 = std::max(x1, c);
+        y0 = std::min(y0, r); y1 = std::max(y1, r);
+    });
+    auto cell = [&](int c, int r) { return cells[static_cast<size_t>(r * kCols + c)]; };
+    int widths[kCols];
+    for (int c = x0; c <= x1; ++c) {
+        widths[c] = 2;  // 空列也留两列宽
+        for (int r = y0; r <= y1; ++r) {
+            if (cell(c, r)) widths[c] = std::max(widths[c], cell(c, r)->width);
+        }
+    }
+
+    constexpr int kGap = 4;  // 两列之间的间隔（" —— "）
+    auto title = layer_titles_.find(layer);
+    std::string out = title != layer_titles_.end() ? "=== " + title->second + " ===\n"
+                    : layer == kTeachingLayer ? "=== 教学区地图 ===\n" : "=== 主地图 ===\n";
+    out.reserve(static_cast<size_t>((y1 - y0 + 1) * 2 * (x1 - x0 + 1) * 24));
+    auto endLine = [&out](size_t start) {
+        while (out.size() > start && out.back() == ' ') out.pop_back();
+        out += '\n';
     };
-    
-    // 渲染地图，替换占位符
-    std::string result = mapTemplate;
-    for (const auto& [id, name] : locationNames) {
-        std::string placeholder = "{" + id + "}";
-        std::string displayName;
-        
-        if (id == currentId) {
-            // 当前位置用黄色高亮
-            displayName = "\033[33m" + name + "\033[0m";
-        } else {
-            displayName = name;
+    for (int r = y0; r <= y1; ++r) {
+        // 地名行
+        size_t start = out.size();
+        for (int c = x0; c <= x1; ++c) {
+            const Tile* t = cell(c, r);
+            int pad = widths[c];
+            if (t) {
+                bool current = t->loc->id == currentId;
+                if (current) out += "\033[33m";
+                out += t->loc->name;
+                if (current) out += "\033[0m";
+                pad -= t->width;
+            }
+            const Tile* e = c < x1 ? cell(c + 1, r) : nullptr;
+            if (t && e && linked(*t->loc, *e->loc)) {
+                // 连线拉长到下一列的起点，地名后面不留空白
+                out += ' ';
+                for (int i = 0; i < pad + kGap - 2; ++i) out += "—";
+                out += ' ';
+            } else if (c < x1) {
+                out.append(static_cast<size_t>(pad + kGap), ' ');
+            }
         }
-        
-        // 替换占位符
-        size_t pos = result.find(placeholder);
-        if (pos != std::string::npos) {
-            result.replace(pos, placeholder.length(), displayName);
+        endLine(start);
+
+        // 连线行（和下一行之间，没有连线时不输出）
+        if (r == y1) break;
+        start = out.size();
+        int offset = 0;
+        for (int c = x0; c <= x1; ++c) {
+            const Tile* t = cell(c, r);
+            const Tile* s = cell(c, r + 1);
+            if (t && s && linked(*t->loc, *s->loc)) {
+                size_t at = start + static_cast<size_t>(offset + std::min(t->width, s->width) / 2);
+                if (out.size() < at) out.append(at - out.size(), ' ');
+                out += '|';
+            }
+            offset += widths[c] + kGap;
         }
+        if (out.size() > start) endLine(start);
     }
-    
-    ss << result;
-    return ss.str();
+
+    // 这一层还有视口外的地点时提示一下
+    const LayerBounds& b = layer_bounds_.at(layer);
+    if (b.min_x < here.coord.x - kViewRadiusX || b.max_x > here.coord.x + kViewRadiusX ||
+        b.min_y < here.coord.y - kViewRadiusY || b.max_y > here.coord.y + kViewRadiusY) {
+        out += "（只显示附近的区域）\n";
+    }
+    return out;
+}
+
+size_t Map::indexHeapBytes() const {
+    auto keyBytes = [](const auto& kv) { return memory::bytes(kv.first); };
+    return memory::tableBytes(route_index_, keyBytes) + memory::bytes(next_hop_) + memory::bytes(hops_)
+         + memory::bytes(tiles_) + memory::tableBytes(tile_index_, keyBytes) + memory::tableBytes(layer_bounds_)
+         + grid_.heapBytes()
+         + memory::tableBytes(layer_titles_, [](const auto& kv) { return memory::bytes(kv.second); });
 }
 
 // 增强版主地图渲染 - 使用树状结构和更好的排版
@@ -0,0 +1,181 @@
+// 这是会话内存统计的实现文件
+// 作者：大一学生
+// 功能：沿着GameState的各个数据结构累加占用的字节数，并维护所有会话的合计
+
+#include "MemoryUsage.hpp"  // 会话内存统计头文件
+#include "GameState.hpp"    // 游戏状态
+#include <atomic>           // 合计用的原子计数
+#include <cstdio>           // snprintf
+#include <sstream>          // 字符串流
+
+namespace hx {
+
+namespace {
+
+const char* const kPartNames[kMemoryPartCount] = {
+    "state", "map", "npc_dialogue", "inventory", "equipment", "tasks", "dialogue_memory", "shop", "session"
+};
+
+std::atomic<std::int64_t> g_live_bytes[kMemoryPartCount];
+std::atomic<long long> g_live_sessions{0};
+std::atomic<long long> g_hibernated_sessions{0};
+std::atomic<std::int64_t> g_hibernated_bytes{0};
+
+size_t stringBytes(const std::string& s) { return memory::bytes(s); }
+
+size_t stringSetBytes(const std::unordered_set<std::string>& set) {
+    return memory::tableBytes(set, stringBytes);
+}
+
+size_t statusBytes(const Attributes& attr) {
+    return memory::tableBytes(attr.active_statuses, [](const auto& kv) {
+        return memory::bytes(kv.second.name) + memory::bytes(kv.second.description);
+    });
+}
+
+size_t enemyBytes(const Enemy& e) {
+    return memory::bytes(e.name()) + statusBytes(e.attr())
+         + memory::bytes(e.getSpecialSkill()) + memory::bytes(e.getSpecialSkillDescription())
+         + memory::bytes(e.getDropItems(), [](const Enemy::DropItem& d) {
+               return memory::bytes(d.item_id) + memory::bytes(d.item_name);
+           });
+}
+
+size_t dialogueBytes(const NPC& npc) {
+    return memory::tableBytes(npc.getDialogues(), [](const auto& kv) {
+        const DialogueNode& node = kv.second;
+        return memory::bytes(kv.first) + memory::bytes(node.id) + memory::bytes(node.npc_text)
+             + memory::bytes(node.memory_key)
+             + memory::bytes(node.options, [](const DialogueOption& o) {
+                   return memory::bytes(o.text) + memory::bytes(o.next_dialogue_id) + memory::bytes(o.requirement);
+               });
+    });
+}
+
+} // namespace
+
+const char* memoryPartName(MemoryPart part) {
+    size_t index = static_cast<size_t>(part);
+    return index < kMemoryPartCount ? kPartNames[index] : "unknown";
+}
+
+std::uint64_t MemoryReport::total() const {
+    std::uint64_t sum = 0;
+    for (std::uint64_t b : bytes) sum += b;
+    return sum;
+}
+
+MemoryReport measureMemory(const GameState& state) {
+    MemoryReport r;
+
+    // GameState对象本身（玩家、地图、任务管理器等对象的内嵌部分都在里面）和零散的数据
+    const Player& player = state.player;
+    r[MemoryPart::STATE] = sizeof(GameState) + memory::bytes(state.current_loc)
+        + memory::bytes(player.name()) + statusBytes(player.attr())
+        + memory::tableBytes(player.getAllFavors(), [](const auto& kv) { return memory::bytes(kv.first); })
+        + memory::bytes(state.monster_spawns, [](const GameState::MonsterSpawnInfo& s) {
+              return memory::bytes(s.location_id) + memory::bytes(s.monster_name);
+          })
+        + state.scheduler.heapBytes() + state.events.heapBytes();
+
+    // 地图：地点表（含常驻的秘境层）、地点上的出口和敌人，寻路表和地图视图的缓存，以及秘境的原型表和改动记录；NPC对象按地图计，它的对话、记忆、商品分别计入各自的部分
+    r[MemoryPart::MAP] = memory::tableBytes(state.map.locations(), [&r](const auto& kv) {
+        const Location& loc = kv.second;
+        size_t n = memory::bytes(kv.first) + memory::bytes(loc.id) + memory::bytes(loc.name) + memory::bytes(loc.desc)
+                 + memory::bytes(loc.exits, [](const Exit& e) { return memory::bytes(e.label) + memory::bytes(e.to); })
+                 + memory::bytes(loc.enemies, enemyBytes)
+                 + memory::bytes(loc.npcs);
+        for (const NPC& npc : loc.npcs) {
+            n += memory::bytes(npc.name()) + memory::bytes(npc.description()) + memory::bytes(npc.getQuestId())
+               + memory::bytes(npc.getDefaultDialogueId()) + memory::bytes(npc.getDialogueFlow(), stringBytes);
+            r[MemoryPart::NPC_DIALOGUE] += dialogueBytes(npc);
+            r[MemoryPart::DIALOGUE_MEMORY] += stringSetBytes(npc.getVisitedDialogues())
+                + stringSetBytes(npc.getMemories()) + stringSetBytes(npc.getChosenOptions());
+            r[MemoryPart::SHOP] += memory::bytes(npc.shopItems(), [](const ShopItem& s) {
+                return memory::bytes(s.id) + memory::bytes(s.name) + memory::bytes(s.description);
+            });
+        }
+        r[MemoryPart::SHOP] += memory::bytes(loc.shop, [](const Item& i) { return i.heapBytes(); });
+        return n;
+    });
+    r[MemoryPart::MAP] += state.map.indexHeapBytes() + state.dungeon.heapBytes();
+
+    r[MemoryPart::INVENTORY] = sizeof(Inventory) + player.inventory().heapBytes();
+    r[MemoryPart::EQUIPMENT] = player.equipment().heapBytes();
+    r[MemoryPart::TASKS] = state.task_manager.heapBytes();
+    r[MemoryPart::DIALOGUE_MEMORY] += memory::tableBytes(state.dialogue_memory, [](const auto& kv) {
+        return memory::bytes(kv.first) + stringSetBytes(kv.second);
+    });
+    r[MemoryPart::SHOP] += state.shop_system.heapBytes();
+    return r;
+}
+
+void publishSessionMemory(const MemoryReport& previous, const MemoryReport& current) {
+    for (size_t i = 0; i < kMemoryPartCount; ++i) {
+        std::int64_t delta = static_cast<std::int64_t>(current.bytes[i]) - static_cast<std::int64_t>(previous.bytes[i]);
+        if (delta != 0) g_live_bytes[i].fetch_add(delta, std::memory_order_relaxed);
+    }
+}
+
+void addLiveSession(int delta) {
+    g_live_sessions.fetch_add(delta, std::memory_order_relaxed);
+}
+
+MemoryReport liveSessionMemory() {
+    MemoryReport r;
+    for (size_t i = 0; i < kMemoryPartCount; ++i) {
+        std::int64_t v = g_live_bytes[i].load(std::memory_order_relaxed);
+        r.bytes[i] = v > 0 ? static_cast<std::uint64_t>(v) : 0;
+    }
+    return r;
+}
+
+long long liveSessions() {
+    return g_live_sessions.load(std::memory_order_relaxed);
+}
+
+void addHibernatedSession(int delta, std::int64_t bytes) {
+    g_hibernated_sessions.fetch_add(delta, std::memory_order_relaxed);
+    g_hibernated_bytes.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+long long hibernatedSessions() {
+    return g_hibernated_sessions.load(std::memory_order_relaxed);
+}
+
+std::uint64_t hibernatedBytes() {
+    std::int64_t v = g_hibernated_bytes.load(std::memory_order_relaxed);
+    return v > 0 ? static_cast<std::uint64_t>(v) : 0;
+}
+
+std::string formatMemoryReport(const MemoryReport& mine, const MemoryReport& all, long long sessions) {
+    std::ostringstream out;
+    char row[160];
+    bool average = sessions > 1;
+    std::snprintf(row, sizeof(row), "  %-16s %12s %7s", "part", "bytes", "share");
+    out << row;
+    if (average) {
+        std::snprintf(row, sizeof(row), " %14s", "avg/session");
+        out << row;
+    }
+    out << "\n";
+    double total = static_cast<double>(mine.total());
+    for (size_t i = 0; i <= kMemoryPartCount; ++i) {
+        bool sum = i == kMemoryPartCount;
+        std::uint64_t bytes = sum ? mine.total() : mine.bytes[i];
+        std::snprintf(row, sizeof(row), "  %-16s %12llu %6.1f%%", sum ? "total" : kPartNames[i],
+                      static_cast<unsigned long long>(bytes),
+                      total > 0 ? static_cast<double>(bytes) * 100.0 / total : 0.0);
+        out << row;
+        if (average) {
+            std::uint64_t all_bytes = sum ? all.total() : all.bytes[i];
+            std::snprintf(row, sizeof(row), " %14.0f", static_cast<double>(all_bytes) / static_cast<double>(sessions));
+            out << row;
+        }
+        out << "\n";
+    }
+    out << "按容器容量估计，不含malloc的簿记开销；当前共有 " << sessions << " 个会话\n";
+    return out.str();
+}
+
+} // namespace hx
@@ -0,0 +1,375 @@
+// 这是运行指标的实现文件
+// 作者：大一学生
+// 功能：每线程一份的计数分片、读取时合并、内存分配计数（替换全局 operator new）、
+//       表格输出与 Prometheus 文本格式导出
+
+#include "Metrics.hpp"        // 运行指标头文件
+#include "MemoryUsage.hpp"    // 会话内存统计
+#include <algorithm>          // min
+#include <atomic>             // 原子计数
+#include <condition_variable> // 导出线程的等待
+#include <cstdio>             // rename/remove/snprintf
+#include <cstdlib>            // malloc/free
+#include <fstream>            // 文件输出
+#include <mutex>              // 互斥锁
+#include <new>                // operator new / bad_alloc
+#include <sstream>            // 字符串流
+#include <thread>             // 导出线程
+
+namespace hx {
+
+namespace {
+
+// 当前线程的分配计数；只有平凡类型，operator new 在线程启动和退出时调用也是安全的
+thread_local std::uint64_t t_alloc_count = 0;
+thread_local std::uint64_t t_alloc_bytes = 0;
+
+// 一项统计的一个分片：只有所属线程写，读的一方用 relaxed 读取，所以不需要加锁
+struct ShardSeries {
+    std::atomic<std::uint64_t> count{0};
+    std::atomic<std::uint64_t> total_ns{0};
+    std::atomic<std::uint64_t> allocations{0};
+    std::atomic<std::uint64_t> allocated_bytes{0};
+    std::atomic<std::uint64_t> buckets[kMetricBuckets + 1]{};
+    std::atomic<std::uint64_t> min_ns{UINT64_MAX};
+    std::atomic<std::uint64_t> max_ns{0};
+};
+
+struct Shard {
+    ShardSeries series[kMetricCount];
+};
+
+// 单写者的累加：读-加-写比 fetch_add 便宜，也不会和别的线程抢缓存行
+inline void bump(std::atomic<std::uint64_t>& cell, std::uint64_t delta) {
+    cell.store(cell.load(std::memory_order_relaxed) + delta, std::memory_order_relaxed);
+}
+
+// 所有线程的分片。线程退出后分片仍然保留，已经记下的数不会丢
+struct Registry {
+    std::mutex mutex;
+    std::vector<std::unique_ptr<Shard>> shards;
+};
+
+Registry& registry() {
+    static Registry* instance = new Registry(); // 故意不释放：线程可能在静态对象析构之后才退出
+    return *instance;
+}
+
+Shard& localShard() {
+    thread_local Shard* shard = nullptr;
+    if (!shard) {
+        auto created = std::make_unique<Shard>();
+        shard = created.get();
+        Registry& reg = registry();
+        std::lock_guard<std::mutex> lock(reg.mutex);
+        reg.shards.push_back(std::move(created));
+    }
+    return *shard;
+}
+
+const char* const kMetricNames[kMetricCount] = {
+    "move", "look", "map", "stats", "inventory", "task", "fight", "talk",
+    "buy", "item", "allocate", "save", "load", "help", "menu", "other",
+    "combat", "save", "load", "map_render", "world_tick", "talk"
+};
+
+// Prometheus 的 le 标签（秒）
+const char* const kBucketLabels[kMetricBuckets] = {
+    "1e-06", "2.5e-06", "5e-06", "1e-05", "2.5e-05", "5e-05",
+    "0.0001", "0.00025", "0.0005", "0.001", "0.0025", "0.005",
+    "0.01", "0.025", "0.05", "0.1", "0.25", "0.5", "1", "2.5"
+};
+
+size_t bucketOf(std::uint64_t nanos) {
+    for (size_t i = 0; i < kMetricBuckets; ++i) {
+        if (nanos <= kMetricBucketBounds[i]) return i;
+    }
+    return kMetricBuckets;
+}
+
+} // namespace
+
+const std::uint64_t kMetricBucketBounds[kMetricBuckets] = {
+    1000, 2500, 5000, 10000, 25000, 50000,
+    100000, 250000, 500000, 1000000, 2500000, 5000000,
+    10000000, 25000000, 50000000, 100000000, 250000000, 500000000,
+    1000000000, 2500000000
+};
+
+bool isCommandMetric(Metric metric) {
+    return metric < Metric::COMBAT;
+}
+
+const char* metricName(Metric metric) {
+    size_t index = static_cast<size_t>(metric);
+    return index < kMetricCount ? kMetricNames[index] : "unknown";
+}
+
+double MetricSeries::meanMicros() const {
+    return count ? static_cast<double>(total_ns) / static_cast<double>(count) / 1000.0 : 0.0;
+}
+
+double MetricSeries::percentileMicros(double p) const {
+    if (count == 0) return 0.0;
+    p = std::min(100.0, std::max(0.0, p));
+    double rank = p / 100.0 * static_cast<double>(count);
+    const double lowest = static_cast<double>(min_ns);
+    const double highest = static_cast<double>(max_ns);
+    std::uint64_t seen = 0;
+    for (size_t i = 0; i <= kMetricBuckets; ++i) {
+        if (buckets[i] == 0) continue;
+        if (static_cast<double>(seen + buckets[i]) >= rank) {
+            // 落在最后的 +Inf 桶里时没有上界，报告最长的一次
+            if (i == kMetricBuckets) return highest / 1000.0;
+            // 桶的上下界收窄到实际记录到的范围以内（只有一个样本时就是它本身）
+            double lower = std::max(i == 0 ? 0.0 : static_cast<double>(kMetricBucketBounds[i - 1]), lowest);
+            double upper = std::min(static_cast<double>(kMetricBucketBounds[i]), highest);
+            if (upper < lower) upper = lower;
+            double within = (rank - static_cast<double>(seen)) / static_cast<double>(buckets[i]);
+            return (lower + (upper - lower) * within) / 1000.0;
+        }
+        seen += buckets[i];
+    }
+    return highest / 1000.0;
+}
+
+std::vector<MetricSeries> snapshotMetrics() {
+    std::vector<MetricSeries> merged(kMetricCount);
+    Registry& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    for (const auto& shard : reg.shards) {
+        for (size_t m = 0; m < kMetricCount; ++m) {
+            const ShardSeries& from = shard->series[m];
+            MetricSeries& to = merged[m];
+            std::uint64_t n = from.count.load(std::memory_order_relaxed);
+            if (n > 0) {
+                std::uint64_t lo = from.min_ns.load(std::memory_order_relaxed);
+                std::uint64_t hi = from.max_ns.load(std::memory_order_relaxed);
+                to.min_ns = to.count ? std::min(to.min_ns, lo) : lo;
+                to.max_ns = to.count ? std::max(to.max_ns, hi) : hi;
+            }
+            to.count += n;
+            to.total_ns += from.total_ns.load(std::memory_order_relaxed);
+            to.allocations += from.allocations.load(std::memory_order_relaxed);
+            to.allocated_bytes += from.allocated_bytes.load(std::memory_order_relaxed);
+            for (size_t b = 0; b <= kMetricBuckets; ++b) {
+                to.buckets[b] += from.buckets[b].load(std::memory_order_relaxed);
+            }
+        }
+    }
+    return merged;
+}
+
+void resetMetrics() {
+    Registry& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    for (const auto& shard : reg.shards) {
+        for (ShardSeries& series : shard->series) {
+            series.count.store(0, std::memory_order_relaxed);
+            series.total_ns.store(0, std::memory_order_relaxed);
+            series.allocations.store(0, std::memory_order_relaxed);
+            series.allocated_bytes.store(0, std::memory_order_relaxed);
+            for (auto& bucket : series.buckets) bucket.store(0, std::memory_order_relaxed);
+            series.min_ns.store(UINT64_MAX, std::memory_order_relaxed);
+            series.max_ns.store(0, std::memory_order_relaxed);
+        }
+    }
+}
+
+void recordMetric(Metric metric, std::uint64_t nanos, std::uint64_t allocations, std::uint64_t bytes) {
+    size_t index = static_cast<size_t>(metric);
+    if (index >= kMetricCount) return;
+    ShardSeries& series = localShard().series[index];
+    bump(series.count, 1);
+    bump(series.total_ns, nanos);
+    bump(series.allocations, allocations);
+    bump(series.allocated_bytes, bytes);
+    bump(series.buckets[bucketOf(nanos)], 1);
+    if (nanos < series.min_ns.load(std::memory_order_relaxed)) series.min_ns.store(nanos, std::memory_order_relaxed);
+    if (nanos > series.max_ns.load(std::memory_order_relaxed)) series.max_ns.store(nanos, std::memory_order_relaxed);
+}
+
+AllocationCounter threadAllocations() {
+    return AllocationCounter{t_alloc_count, t_alloc_bytes};
+}
+
+MetricTimer::MetricTimer(Metric metric)
+    : metric_(metric), start_(std::chrono::steady_clock::now()), allocs_(threadAllocations()) {}
+
+MetricTimer::~MetricTimer() {
+    auto elapsed = std::chrono::steady_clock::now() - start_;
+    auto nanos = std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+    AllocationCounter now = threadAllocations();
+    recordMetric(metric_, static_cast<std::uint64_t>(nanos < 0 ? 0 : nanos),
+                 now.count - allocs_.count, now.bytes - allocs_.bytes);
+}
+
+// ---------------- 输出 ----------------
+
+std::string formatMetricsTable() {
+    std::vector<MetricSeries> all = snapshotMetrics();
+    std::ostringstream out;
+    char row[160];
+    bool any = false;
+    for (int pass = 0; pass < 2; ++pass) {
+        bool commands = pass == 0;
+        out << (commands ? "【指令】" : "【子系统】") << "\n";
+        std::snprintf(row, sizeof(row), "  %-12s %9s %10s %10s %10s %9s %10s\n",
+                      "name", "count", "mean(us)", "p50(us)", "p99(us)", "allocs", "bytes");
+        out << row;
+        for (size_t m = 0; m < kMetricCount; ++m) {
+            Metric metric = static_cast<Metric>(m);
+            const MetricSeries& s = all[m];
+            if (isCommandMetric(metric) != commands || s.count == 0) continue;
+            any = true;
+            double per_call = static_cast<double>(s.count);
+            std::snprintf(row, sizeof(row), "  %-12s %9llu %10.1f %10.1f %10.1f %9.1f %10.0f\n",
+                          metricName(metric), static_cast<unsigned long long>(s.count),
+                          s.meanMicros(), s.percentileMicros(50), s.percentileMicros(99),
+                          static_cast<double>(s.allocations) / per_call,
+                          static_cast<double>(s.allocated_bytes) / per_call);
+            out << row;
+        }
+    }
+    if (!any) out << "  （还没有记录）\n";
+    out << "allocs/bytes 为每次调用平均的内存分配次数和字节数；百分位数按分桶插值估计\n";
+    return out.str();
+}
+
+// 会话内存（所有活着的会话的合计，见MemoryUsage.hpp）
+static void writeMemoryGauges(std::ostream& out) {
+    MemoryReport all = liveSessionMemory();
+    out << "# HELP haida_sessions Live game sessions.\n";
+    out << "# TYPE haida_sessions gauge\n";
+    out << "haida_sessions " << liveSessions() << "\n";
+    out << "# HELP haida_hibernated_sessions Idle sessions kept only as a serialized blob.\n";
+    out << "# TYPE haida_hibernated_sessions gauge\n";
+    out << "haida_hibernated_sessions " << hibernatedSessions() << "\n";
+    out << "# HELP haida_hibernated_bytes Bytes held by the blobs of hibernated sessions.\n";
+    out << "# TYPE haida_hibernated_bytes gauge\n";
+    out << "haida_hibernated_bytes " << hibernatedBytes() << "\n";
+    out << "# HELP haida_session_memory_bytes Bytes held by all live sessions, by part of the game state.\n";
+    out << "# TYPE haida_session_memory_bytes gauge\n";
+    for (size_t i = 0; i < kMemoryPartCount; ++i) {
+        out << "haida_session_memory_bytes{part=\"" << memoryPartName(static_cast<MemoryPart>(i)) << "\"} "
+            << all.bytes[i] << "\n";
+    }
+}
+
+void writePrometheus(std::ostream& out) {
+    std::vector<MetricSeries> all = snapshotMetrics();
+    char number[32];
+    for (int pass = 0; pass < 2; ++pass) {
+        bool commands = pass == 0;
+        const char* family = commands ? "haida_command" : "haida_subsystem";
+        const char* label = commands ? "command" : "subsystem";
+
+        out << "# HELP " << family << "_duration_seconds "
+            << (commands ? "Time spent handling one player command." : "Time spent in one subsystem call.") << "\n";
+        out << "# TYPE " << family << "_duration_seconds histogram\n";
+        for (size_t m = 0; m < kMetricCount; ++m) {
+            Metric metric = static_cast<Metric>(m);
+            if (isCommandMetric(metric) != commands) continue;
+            const MetricSeries& s = all[m];
+            std::uint64_t cumulative = 0;
+            for (size_t b = 0; b <= kMetricBuckets; ++b) {
+                cumulative += s.buckets[b];
+                out << family << "_duration_seconds_bucket{" << label << "=\"" << metricName(metric)
+                    << "\",le=\"" << (b < kMetricBuckets ? kBucketLabels[b] : "+Inf") << "\"} "
+                    << cumulative << "\n";
+            }
+            std::snprintf(number, sizeof(number), "%.9f", static_cast<double>(s.total_ns) / 1e9);
+            out << family << "_duration_seconds_sum{" << label << "=\"" << metricName(metric) << "\"} " << number << "\n";
+            out << family << "_duration_seconds_count{" << label << "=\"" << metricName(metric) << "\"} " << s.count << "\n";
+        }
+
+        out << "# HELP " << family << "_allocations_total Heap allocations made while handling.\n";
+        out << "# TYPE " << family << "_allocations_total counter\n";
+        for (size_t m = 0; m < kMetricCount; ++m) {
+            Metric metric = static_cast<Metric>(m);
+            if (isCommandMetric(metric) != commands) continue;
+            out << family << "_allocations_total{" << label << "=\"" << metricName(metric) << "\"} "
+                << all[m].allocations << "\n";
+        }
+        out << "# HELP " << family << "_allocated_bytes_total Heap bytes requested while handling.\n";
+        out << "# TYPE " << family << "_allocated_bytes_total counter\n";
+        for (size_t m = 0; m < kMetricCount; ++m) {
+            Metric metric = static_cast<Metric>(m);
+            if (isCommandMetric(metric) != commands) continue;
+            out << family << "_allocated_bytes_total{" << label << "=\"" << metricName(metric) << "\"} "
+                << all[m].allocated_bytes << "\n";
+        }
+    }
+    writeMemoryGauges(out);
+}
+
+bool writePrometheusFile(const std::string& path) {
+    std::string temp = path + ".tmp";
+    {
+        std::ofstream out(temp, std::ios::trunc);
+        if (!out) return false;
+        writePrometheus(out);
+        if (!out) return false;
+    }
+    std::remove(path.c_str()); // Windows 上目标存在时 rename 会失败
+    return std::rename(temp.c_str(), path.c_str()) == 0;
+}
+
+// ---------------- 定期导出 ----------------
+
+struct MetricsExporter::State {
+    std::string path;
+    std::chrono::milliseconds interval;
+    std::mutex mutex;
+    std::condition_variable wake;
+    bool stopping{false};
+    std::thread worker;
+};
+
+MetricsExporter::MetricsExporter(std::string path, double interval_seconds)
+    : state_(std::make_unique<State>()) {
+    state_->path = std::move(path);
+    state_->interval = std::chrono::milliseconds(
+        static_cast<long long>(std::max(0.1, interval_seconds) * 1000.0));
+    State* state = state_.get();
+    state_->worker = std::thread([state] {
+        std::unique_lock<std::mutex> lock(state->mutex);
+        while (!state->stopping) {
+            if (state->wake.wait_for(lock, state->interval, [state] { return state->stopping; })) break;
+            lock.unlock();
+            writePrometheusFile(state->path);
+            lock.lock();
+        }
+    });
+}
+
+MetricsExporter::~MetricsExporter() {
+    {
+        std::lock_guard<std::mutex> lock(state_->mutex);
+        state_->stopping = true;
+    }
+    state_->wake.notify_all();
+    state_->worker.join();
+    writePrometheusFile(state_->path);
+}
+
+} // namespace hx
+
+// ---------------- 分配计数 ----------------
+// 替换全局的 operator new/delete，每次分配只多两次线程局部变量的加法。
+// new[] 和不抛异常的版本在标准库里都转发到这两个函数，不必另外替换
+
+void* operator new(std::size_t size) {
+    ++hx::t_alloc_count;
+    hx::t_alloc_bytes += size;
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+    std::free(p);
+}
@@ -56,7 +56,7 @@ bool NPC::canAccessDialogue(const std::string& dialogue_id, int player_favor) co
 }
 
 bool NPC::canChooseOption(const DialogueOption& option, int player_favor, 
-                         const std::unordered_map<std::string, int>& player_inventory) const {
+                         const Inventory& player_inventory) const {
     // 检查好感度要求
     if (option.favor_change < 0 && player_favor + option.favor_change < 0) {
         return false;
@@ -65,8 +65,7 @@ bool NPC::canChooseOption(const DialogueOption& option, int player_favor,
     // 检查物品要求
     if (!option.requirement.empty()) {
         // 简单的物品检查（可以根据需要扩展）
-        auto it = player_inventory.find(option.requirement);
-        if (it == player_inventory.end() || it->second <= 0) {
+        if (player_inventory.quantity(option.requirement) <= 0) {
             return false;
         }
     }
@@ -0,0 +1,187 @@
+// 这是离线进度补算的实现文件
+// 作者：大一学生
+// 功能：Game::catchUp 及挂机刷怪的结算、结果显示
+
+#include "Game.hpp"            // 游戏类头文件
+#include "CombatForecast.hpp"  // 战前胜率预估（挂机战斗的胜率）
+#include "Output.hpp"          // 游戏输出
+#include "Trace.hpp"           // 时间线跟踪
+#include <algorithm>           // min/find_if
+#include <chrono>              // 真实时刻
+#include <climits>             // INT_MAX
+#include <random>              // bernoulli_distribution
+#include <unordered_map>       // 背包快照
+
+namespace hx {
+
+std::int64_t wallClockMillis() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+// 记下输入时刻
+// 功能：距上一行输入（或存档里记的时刻）kMinAwayTurns 个回合以上才算离开过；
+//       时钟被往回调时不补算。没有记录时（新开的一局、存档的时刻已经用过）只记下时刻
+void Game::noteInputTime(std::int64_t now_ms) {
+    input_ms_ = now_ms;
+    const std::int64_t last = state_.last_active_ms;
+    state_.last_active_ms = now_ms;
+    if (last == 0 || now_ms <= last) return;
+    std::uint64_t turns = static_cast<std::uint64_t>(now_ms - last) / (kSecondsPerOfflineTurn * 1000);
+    if (turns < kMinAwayTurns) return;
+    away_turns_ = std::min(away_turns_ + turns, kMaxOfflineTurns);
+}
+
+// 补算离开的回合
+// 功能：商店、对话等菜单正在等输入时先不动世界，留到菜单结束后的下一行输入
+void Game::settleAway() {
+    if (away_turns_ == 0 || flow_.waiting()) return;
+    OfflineReport report = catchUp(away_turns_);
+    away_turns_ = 0;
+    printOfflineReport(report);
+}
+
+// 离线补算
+// 功能：按“可以挑战的时刻”而不是按回合推进；调度器只在最后设到新的回合并重建定时任务
+OfflineReport Game::catchUp(std::uint64_t turns) {
+    HX_TRACE_SPAN("catch_up");
+    OfflineReport report;
+    report.turns = turns;
+    if (turns == 0) return report;
+
+    Player& player = state_.player;
+    TickScheduler& scheduler = state_.scheduler;
+    const std::uint64_t from = scheduler.now();
+    const std::uint64_t to = from + turns;
+    const int old_level = player.level();
+    const int old_xp = player.xp();
+    const int old_coins = player.coins();
+
+    // 挂机期间的升级、掉落、重生提示都不显示，最后统一汇总
+    ConsoleScope mute(nullConsole());
+
+    // 背包快照：补算结束后对比出掉落获得的物品
+    std::unordered_map<std::string, int> before;
+    for (const Item& item : player.inventory()) before[item.id] = player.inventory().quantity(item.id);
+
+    // 状态效果：N个回合的结算等于持续时间一次减去N
+    player.attr().updateStatuses(static_cast<int>(std::min<std::uint64_t>(turns, INT_MAX)));
+
+    // 商店：期间只要跨过一个进货时刻，下次打开商店时就刷新一次（多次进货与一次效果相同）
+    const std::uint64_t interval = ShopSystem::kRefreshInterval;
+    report.shop_restocks = to / interval - from / interval;
+    if (report.shop_restocks > 0) state_.shop_system.markRefreshDue();
+
+    // 刷新点：所在地点的普通怪物挂机刷怪，其余的只看期间是否到了重生时刻
+    for (size_t i = 0; i < state_.monster_spawns.size(); ++i) {
+        const auto& spawn = state_.monster_spawns[i];
+        if (spawn.location_id == state_.current_loc && spawn.location_id != "wenxintan") {
+            farmSpawn(i, from, to, report);
+        } else if (spawn.respawn_turn != 0 && spawn.respawn_turn <= to) {
+            respawnMonster(i);
+            ++report.respawns;
+        }
+    }
+
+    // 世界回合推进到终点，按新的回合重建状态效果、商店和尚未到期的重生任务
+    scheduler.reset(to);
+    scheduleWorldTimers();
+
+    // 离开了足够久，回来时已经休整好
+    report.rested = turns >= kRestTurns;
+    if (report.rested) player.attr().hp = player.attr().max_hp;
+
+    report.levels = player.level() - old_level;
+    report.coins = player.coins() - old_coins;
+    if (report.levels == 0) report.xp = player.xp() - old_xp;
+    for (const Item& item : player.inventory()) {
+        auto it = before.find(item.id);
+        int gained = player.inventory().quantity(item.id) - (it == before.end() ? 0 : it->second);
+        if (gained > 0) report.items.emplace_back(item.name, gained);
+    }
+    return report;
+}
+
+// 挂机刷怪
+// 功能：刷新点从“可以挑战”的时刻开始，每个周期连续挑战到用完挑战次数或输掉一场为止：
+//       用完次数就和正常战斗一样进入重生倒计时，到期重生后开始下一个周期；
+//       输了就撤下来休整一个重生周期再来（离线时输掉不计死亡惩罚）。
+//       胜负按战前胜率预估抽取，等级变化后重新预估；结算期间把调度器的当前回合设为这一周期的时刻，
+//       这样怪物消失、重生倒计时都直接复用正常战斗的处理
+void Game::farmSpawn(size_t index, std::uint64_t from, std::uint64_t to, OfflineReport& report) {
+    auto& spawn = state_.monster_spawns[index];
+    Player& player = state_.player;
+    const std::uint64_t period = static_cast<std::uint64_t>(std::max(1, spawn.respawn_turns));
+    double win_rate = 0.0;
+    int forecast_level = -1;  // 胜率是按哪个等级预估的
+
+    std::uint64_t t = spawn.respawn_turn != 0 ? spawn.respawn_turn : from;
+    while (t <= to) {
+        state_.scheduler.reset(t);
+        if (spawn.respawn_turn != 0) {
+            respawnMonster(index);
+            ++report.respawns;
+        }
+        if (spawn.current_count <= 0 || spawn.challenge_count >= spawn.max_challenges) break;
+
+        auto* loc = state_.map.get(spawn.location_id);
+        if (!loc) break;
+        auto found = std::find_if(loc->enemies.begin(), loc->enemies.end(),
+                                  [&spawn](const Enemy& e) { return e.name() == spawn.monster_name; });
+        if (found == loc->enemies.end()) break;
+        const Enemy enemy = *found;  // 挑战次数用完时地图上的怪物会被移除，这里留一份
+
+        // 两个周期之间已经休整好，按满血预估
+        player.attr().hp = player.attr().max_hp;
+        if (player.level() != forecast_level) {
+            win_rate = forecastCombat(player, enemy, combat_.tierFor(player)).win_rate;
+            forecast_level = player.level();
+        }
+
+        std::bernoulli_distribution won(win_rate);
+        while (spawn.challenge_count < spawn.max_challenges) {
+            ++report.fights;
+            if (!won(rng_)) break;  // 输了：这个周期不再挑战
+            ++report.wins;
+            // 与handleCombatVictory相同的奖励；击败事件不发布，离线刷怪不推进任务和剧情
+            player.addXP(enemy.xpReward() * calculateExperiencePenalty(enemy) / 100);
+            player.addCoins(enemy.coinReward());
+            processEnemyDrops(enemy);
+            onMonsterDefeated(spawn.location_id, spawn.monster_name);
+        }
+        t = spawn.respawn_turn != 0 ? spawn.respawn_turn : t + period;
+    }
+}
+
+// 显示离线补算的结果
+void Game::printOfflineReport(const OfflineReport& report) const {
+    console() << "\n" << std::string(50, '=') << "\n";
+    console() << "🌙 离线期间（" << report.turns << " 回合）\n";
+    console() << std::string(50, '=') << "\n";
+    if (report.fights > 0) {
+        console() << "⚔️ 挂机战斗 " << report.fights << " 场，胜 " << report.wins << " 场\n";
+        console() << "✨ 获得金币 " << report.coins;
+        if (report.levels > 0) console() << "，等级提升 " << report.levels << " 级（当前 Lv" << state_.player.level() << "）";
+        else console() << "，经验 " << report.xp;
+        console() << "\n";
+        if (report.levels > 0) {
+            console() << "💡 有 " << state_.player.attr().available_points << " 点属性点可分配（allocate <属性> [数量]）\n";
+        }
+    } else {
+        console() << "⚔️ 所在地点没有可以挂机的怪物。\n";
+    }
+    if (!report.items.empty()) {
+        console() << "🎁 掉落：";
+        for (size_t i = 0; i < report.items.size(); ++i) {
+            if (i > 0) console() << "，";
+            console() << report.items[i].first << " x" << report.items[i].second;
+        }
+        console() << "\n";
+    }
+    if (report.respawns > 0) console() << "🐉 怪物重生 " << report.respawns << " 次\n";
+    if (report.shop_restocks > 0) console() << "\033[34m【商店刷新】钱道然的商店更新了新的货物！\033[0m\n";
+    if (report.rested) console() << "❤️ 休整完毕，生命值已回满。\n";
+    console() << std::string(50, '=') << "\n";
+}
+
+} // namespace hx
@@ -0,0 +1,47 @@
+// 这是游戏输出的实现文件
+// 作者：大一学生
+// 功能：用线程局部指针记录当前线程的输出流
+
+#include "Output.hpp"  // 游戏输出头文件
+#include <cstdlib>     // system
+#include <iostream>    // std::cout
+
+namespace hx {
+
+namespace {
+thread_local std::ostream* current_console = nullptr;  // 为空时使用std::cout
+}
+
+std::ostream& console() {
+    return current_console ? *current_console : std::cout;
+}
+
+void clearScreen() {
+    if (current_console) {
+        // 会话输出：写入终端清屏序列，由客户端终端执行
+        *current_console << "\033[H\033[2J\033[3J";
+        return;
+    }
+    std::cout.flush();
+    #ifdef _WIN32
+        system("cls");
+    #else
+        system("clear");
+    #endif
+}
+
+std::ostream& nullConsole() {
+    // 没有缓冲区的流处于出错状态，写入时什么也不做
+    thread_local std::ostream null_stream(nullptr);
+    return null_stream;
+}
+
+ConsoleScope::ConsoleScope(std::ostream& os) : previous_(current_console) {
+    current_console = &os;
+}
+
+ConsoleScope::~ConsoleScope() {
+    current_console = previous_;
+}
+
+} // namespace hx
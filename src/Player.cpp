@@ -3,12 +3,23 @@
 
 #include "Player.hpp"    // 玩家类头文件
 #include "Inventory.hpp" // 背包系统
+#include "Output.hpp"    // 游戏输出
 #include <sstream>       // 字符串流
 #include <algorithm>     // 算法库
 #include <iostream>      // 输入输出流
 
 namespace hx {
 
+namespace {
+// 背包里找不到输入的物品：打错字时提示最相近的那个，但不替玩家选
+void reportMissing(const Inventory& inventory, std::string_view item_name) {
+    console() << "未找到物品: " << item_name << "\n";
+    if (const Item* near = inventory.get(inventory.suggest(item_name))) {
+        console() << "你是不是要找「" << near->name << "」？\n";
+    }
+}
+} // namespace
+
 // 静态常量
 const std::string Player::REVIVAL_SCROLL_ID = "revival_scroll";
 const std::string Player::LIBRARY_LOCATION_ID = "library";
@@ -24,6 +35,14 @@ void Player::addXP(int amount) {
     checkLevelUp();
 }
 
+// 获得物品
+void Player::gainItem(const Item& item, int count) {
+    inventory_->add(item, count);
+    if (events_) {
+        events_->publish(ItemGainedEvent{item, count});
+    }
+}
+
 // 增加金币
 void Player::addCoins(int amount) {
     coins_ += amount;
@@ -38,47 +57,44 @@ bool Player::spendCoins(int amount) {
     return false;
 }
 
+// 判断装备饰品时是否需要玩家选择替换的槽位
+// 两个饰品槽都被占用，且新饰品的品质不高于其中任何一个时需要选择
+bool Player::needsAccessorySlotChoice(std::string_view item_name) const {
+    const Item* item = inventory_->get(inventory_->match(item_name));
+    if (!item) return false;
+    if (item->type != ItemType::EQUIPMENT || item->equip_type != EquipmentType::ACCESSORY) return false;
+    const Item* item1 = equipment_.getEquippedItem(EquipmentSlot::ACCESSORY1);
+    const Item* item2 = equipment_.getEquippedItem(EquipmentSlot::ACCESSORY2);
+    return item1 && item2 && !(item->quality > item1->quality) && !(item->quality > item2->quality);
+}
+
 // 装备物品
-// 输入物品名称（可以只输入一部分）
+// 输入物品名称（可以只输入一部分）；accessory_slot 是两个饰品槽品质相同时要替换的槽位
 // 如果装备成功返回true，失败返回false
-bool Player::equipItem(const std::string& item_name) {
-    // 从背包里拿出所有物品
-    std::vector<Item> items = inventory_->list();
-    Item* found_item = nullptr;  // 找到的物品
-    std::string found_id;        // 找到的物品ID
-    
-    // 在背包里找匹配的物品
-    for (const auto& item : items) {
-        // 看看物品名称是不是匹配
-        if (item.name.find(item_name) != std::string::npos || 
-            item_name.find(item.name) != std::string::npos ||
-            item.id == item_name) {
-            // 找到了就保存起来
-            found_item = const_cast<Item*>(&item);
-            found_id = item.id;
-            break;  // 找到了就退出
-        }
-    }
+bool Player::equipItem(std::string_view item_name, EquipmentSlot accessory_slot) {
+    // 在背包里找匹配的物品（名称可以只输入一部分）
+    const Item* found_item = inventory_->get(inventory_->match(item_name));
     
     if (!found_item) {
-        std::cout << "未找到物品: " << item_name << "\n";
+        reportMissing(*inventory_, item_name);
         return false;
     }
     
     // 检查物品是否存在
-    if (inventory_->quantity(found_id) < 1) {
-        std::cout << "物品数量不足: " << found_item->name << "\n";
+    if (found_item->count < 1) {
+        console() << "物品数量不足: " << found_item->name << "\n";
         return false;
     }
     
     // 检查是否为装备
     if (found_item->type != ItemType::EQUIPMENT) {
-        std::cout << "该物品不是装备，无法装备: " << found_item->name << "\n";
+        console() << "该物品不是装备，无法装备: " << found_item->name << "\n";
         return false;
     }
     
-    // 使用找到的物品信息
+    // 使用找到的物品信息（下面放回旧装备会改动背包，先复制一份）
     Item item = *found_item;
+    std::string found_id = item.id;  // 找到的物品ID
     
     // 对于饰品，需要特殊处理槽位选择
     if (item.equip_type == EquipmentType::ACCESSORY) {
@@ -98,22 +114,8 @@ bool Player::equipItem(const std::string& item_name) {
                     } else if (item.quality > item2->quality) {
                         replace_item1 = false;
                     } else {
-                        // 品质相同，询问用户选择
-                        std::cout << "两个饰品槽位都被占用，请选择要替换的槽位：\n";
-                        std::cout << "1. 饰品1槽位 (" << getColoredItemName(*item1) << ")\n";
-                        std::cout << "2. 饰品2槽位 (" << getColoredItemName(*item2) << ")\n";
-                        std::cout << "请选择 (1/2): ";
-                        std::string choice;
-                        std::getline(std::cin, choice);
-                        
-                        if (choice == "1") {
-                            replace_item1 = true;
-                        } else if (choice == "2") {
-                            replace_item1 = false;
-                        } else {
-                            std::cout << "无效选择，取消装备。\n";
-                            return false;
-                        }
+                        // 品质相同，使用调用者询问玩家后给出的槽位
+                        replace_item1 = (accessory_slot != EquipmentSlot::ACCESSORY2);
                     }
                 }
                 
@@ -130,7 +132,7 @@ bool Player::equipItem(const std::string& item_name) {
             if (old_item) {
                 // 将旧装备放回背包
                 inventory_->add(*old_item, 1);
-                std::cout << "卸下了 " << getColoredItemName(*old_item) << " 并放回背包。\n";
+                console() << "卸下了 " << getColoredItemName(*old_item) << " 并放回背包。\n";
             }
             equipment_.unequipItem(target_slot);
         }
@@ -140,9 +142,9 @@ bool Player::equipItem(const std::string& item_name) {
         
         // 提示用户槽位选择
         if (target_slot == EquipmentSlot::ACCESSORY1) {
-            std::cout << "将装备到饰品1槽位。\n";
+            console() << "将装备到饰品1槽位。\n";
         } else {
-            std::cout << "将装备到饰品2槽位。\n";
+            console() << "将装备到饰品2槽位。\n";
         }
     } else {
         // 对于非饰品装备，检查槽位是否被占用
@@ -151,7 +153,7 @@ bool Player::equipItem(const std::string& item_name) {
             if (old_item) {
                 // 将旧装备放回背包
                 inventory_->add(*old_item, 1);
-                std::cout << "卸下了 " << getColoredItemName(*old_item) << " 并放回背包。\n";
+                console() << "卸下了 " << getColoredItemName(*old_item) << " 并放回背包。\n";
             }
             equipment_.unequipItem(item.equip_slot);
         }
@@ -170,7 +172,7 @@ bool Player::equipItem(const std::string& item_name) {
             Item qdemo; qdemo.type = ItemType::EQUIPMENT; qdemo.quality = eq_weapon->quality;
             qdemo.name = (eq_weapon->quality==EquipmentQuality::UNDERGRAD?"本科":(eq_weapon->quality==EquipmentQuality::MASTER?"硕士":"博士"));
             int bonus_percent = (eq_weapon->quality==EquipmentQuality::UNDERGRAD?10:(eq_weapon->quality==EquipmentQuality::MASTER?15:20));
-            std::cout << "【套装】学霸两件套已触发（" << getColoredItemName(qdemo) << "）全属性+" << bonus_percent << "%\n";
+            console() << "【套装】学霸两件套已触发（" << getColoredItemName(qdemo) << "）全属性+" << bonus_percent << "%\n";
         }
         return true;
     }
@@ -196,34 +198,17 @@ bool Player::unequipItem(EquipmentSlot slot) {
 }
 
 void Player::updateAttributesFromEquipment() {
-    // 重置基础属性（不包括装备加成）
-    // 这里需要保存基础属性，暂时简化处理
-    // 基础值：ATK=10, DEF=10, SPD=10, HPmax=60；随等级与加点线性成长
-    attr().atk = 10 + (level_ - 1) * 2 + attr().total_atk_points * 2;
-    attr().def_ = 10 + (level_ - 1) * 2 + attr().total_def_points * 2;
-    attr().spd = 10 + (level_ - 1) * 2 + attr().total_spd_points * 2;
-    attr().max_hp = 60 + (level_ - 1) * 10 + attr().total_hp_points * 5;
-    
-    // 添加装备属性
-    attr().atk += equipment_.getTotalATK();
-    attr().def_ += equipment_.getTotalDEF();
-    attr().spd += equipment_.getTotalSPD();
-    attr().max_hp += equipment_.getTotalHP();
+    // 基础属性加上装备属性
+    StatLine base = baseStats();
+    attr().atk = base.atk + equipment_.getTotalATK();
+    attr().def_ = base.def_ + equipment_.getTotalDEF();
+    attr().spd = base.spd + equipment_.getTotalSPD();
+    attr().max_hp = base.max_hp + equipment_.getTotalHP();
 
     // 学霸两件套：当武器与护甲为同一品质时，根据品质给予不同加成
-    // 本科套装+10%，硕士套装+15%，博士套装+20%
-    const Item* eq_weapon = equipment_.getEquippedItem(EquipmentSlot::WEAPON);
-    const Item* eq_armor  = equipment_.getEquippedItem(EquipmentSlot::ARMOR);
-    if (eq_weapon && eq_armor && eq_weapon->quality == eq_armor->quality) {
-        float bonus_multiplier = 1.0f;
-        if (eq_weapon->quality == EquipmentQuality::UNDERGRAD) {
-            bonus_multiplier = 1.1f; // 本科套装+10%
-        } else if (eq_weapon->quality == EquipmentQuality::MASTER) {
-            bonus_multiplier = 1.15f; // 硕士套装+15%
-        } else if (eq_weapon->quality == EquipmentQuality::DOCTOR) {
-            bonus_multiplier = 1.2f; // 博士套装+20%
-        }
-        
+    float bonus_multiplier = twoPieceBonus(equipment_.getEquippedItem(EquipmentSlot::WEAPON),
+                                           equipment_.getEquippedItem(EquipmentSlot::ARMOR));
+    if (bonus_multiplier > 1.0f) {
         attr().atk = static_cast<int>(attr().atk * bonus_multiplier);
         attr().def_ = static_cast<int>(attr().def_ * bonus_multiplier);
         attr().spd = static_cast<int>(attr().spd * bonus_multiplier);
@@ -234,38 +219,45 @@ void Player::updateAttributesFromEquipment() {
     attr().hp = std::min(attr().hp, attr().max_hp);
 }
 
+// 基础属性
+// 基础值：ATK=10, DEF=10, SPD=10, HPmax=60；随等级与加点线性成长
+StatLine Player::baseStats() const {
+    StatLine s;
+    s.atk = 10 + (level_ - 1) * 2 + attr().total_atk_points * 2;
+    s.def_ = 10 + (level_ - 1) * 2 + attr().total_def_points * 2;
+    s.spd = 10 + (level_ - 1) * 2 + attr().total_spd_points * 2;
+    s.max_hp = 60 + (level_ - 1) * 10 + attr().total_hp_points * 5;
+    return s;
+}
+
+// 学霸两件套倍率：本科套装+10%，硕士套装+15%，博士套装+20%
+float Player::twoPieceBonus(const Item* weapon, const Item* armor) {
+    if (!weapon || !armor || weapon->quality != armor->quality) return 1.0f;
+    if (weapon->quality == EquipmentQuality::UNDERGRAD) return 1.1f;
+    if (weapon->quality == EquipmentQuality::MASTER) return 1.15f;
+    return 1.2f;
+}
+
 // 物品使用
-bool Player::useItem(const std::string& item_name) {
-    // 从背包中查找匹配的物品
-    std::vector<Item> items = inventory_->list();
-    const Item* found_item = nullptr;
-    std::string found_id;
-    
-    // 查找匹配的物品（支持部分匹配）
-    for (const auto& item : items) {
-        if (item.name.find(item_name) != std::string::npos || 
-            item_name.find(item.name) != std::string::npos ||
-            item.id == item_name) {
-            found_item = &item;
-            found_id = item.id;
-            break;
-        }
-    }
+bool Player::useItem(std::string_view item_name) {
+    // 从背包中查找匹配的物品（支持部分匹配）
+    const Item* found_item = inventory_->get(inventory_->match(item_name));
     
     if (!found_item) {
-        std::cout << "未找到物品: " << item_name << "\n";
+        reportMissing(*inventory_, item_name);
         return false;
     }
     
     // 检查物品是否存在
-    if (inventory_->quantity(found_id) < 1) {
-        std::cout << "物品数量不足: " << found_item->name << "\n";
+    if (found_item->count < 1) {
+        console() << "物品数量不足: " << found_item->name << "\n";
         return false;
     }
+    const std::string found_id = found_item->id;
     
     // 检查是否为消耗品
     if (found_item->type != ItemType::CONSUMABLE) {
-        std::cout << "该物品不是消耗品，无法使用: " << found_item->name << "\n";
+        console() << "该物品不是消耗品，无法使用: " << found_item->name << "\n";
         return false;
     }
     
@@ -273,25 +265,26 @@ bool Player::useItem(const std::string& item_name) {
     if (found_item->heal_amount > 0) {
         // 检查是否满血
         if (attr().hp >= attr().max_hp) {
-            std::cout << "你的生命值已满，无法使用 " << found_item->name << "。\n";
+            console() << "你的生命值已满，无法使用 " << found_item->name << "。\n";
             return false;
         }
         
         int old_hp = attr().hp;
         attr().heal(found_item->heal_amount);
         int actual_heal = attr().hp - old_hp;
-        inventory_->remove(found_id, 1);
         
         if (!found_item->use_message.empty()) {
-            std::cout << found_item->use_message << "\n";
+            console() << found_item->use_message << "\n";
         } else {
-            std::cout << "使用了 " << found_item->name << "，恢复了 " << actual_heal << " 点生命值。\n";
+            console() << "使用了 " << found_item->name << "，恢复了 " << actual_heal << " 点生命值。\n";
         }
         // 显示当前生命值
-        std::cout << "当前生命值: " << attr().hp << "/" << attr().max_hp << "\n";
+        console() << "当前生命值: " << attr().hp << "/" << attr().max_hp << "\n";
         if (!found_item->description.empty()) {
-            std::cout << "说明：" << found_item->description << "\n";
+            console() << "说明：" << found_item->description << "\n";
         }
+        // 最后一个用掉后槽位会被清空，所以放在显示之后
+        inventory_->remove(found_id, 1);
         return true;
     }
     
@@ -299,11 +292,11 @@ bool Player::useItem(const std::string& item_name) {
     if (found_id == "caffeine_elixir") {
         // 获得专注：下一次攻击必中（持续1回合，使用后即生效并在下一次攻击后移除）
         attr().addStatus(StatusEffect::FOCUS, 1);
-        inventory_->remove(found_id, 1);
-        std::cout << "你饮下了咖啡因灵液，精神前所未有地集中。下一次攻击将必中。\n";
+        console() << "你饮下了咖啡因灵液，精神前所未有地集中。下一次攻击将必中。\n";
         if (!found_item->description.empty()) {
-            std::cout << "说明：" << found_item->description << "\n";
+            console() << "说明：" << found_item->description << "\n";
         }
+        inventory_->remove(found_id, 1);
         return true;
     }
     
@@ -367,72 +360,25 @@ int Player::getNPCFavor(const std::string& npc_name) const {
 }
 
 void Player::addNPCFavor(const std::string& npc_name, int amount) {
-    npc_favors_[npc_name] += amount;
+    int& favor = npc_favors_[npc_name];
+    int old_favor = favor;
     // 限制好感度范围 0-100
-    npc_favors_[npc_name] = std::max(0, std::min(100, npc_favors_[npc_name]));
+    favor = std::max(0, std::min(100, favor + amount));
+    if (events_ && favor != old_favor) {
+        events_->publish(FavorChangedEvent{npc_name, old_favor, favor});
+    }
 }
 
 void Player::setNPCFavor(const std::string& npc_name, int favor) {
     npc_favors_[npc_name] = std::max(0, std::min(100, favor));
 }
 
-// 任务系统
-void Player::startQuest(const std::string& quest_id, const std::string& quest_name, 
-                       const std::string& description, const std::vector<std::string>& objectives) {
-    QuestInfo quest;
-    quest.id = quest_id;
-    quest.name = quest_name;
-    quest.description = description;
-    quest.status = QuestStatus::IN_PROGRESS;
-    quest.objectives = objectives;
-    
-    quests_[quest_id] = quest;
-}
-
-void Player::completeQuest(const std::string& quest_id) {
-    auto it = quests_.find(quest_id);
-    if (it != quests_.end()) {
-        it->second.status = QuestStatus::COMPLETED;
-        std::cout << "\033[31m【任务完成】" << it->second.name << " 已完成！\033[0m\n";
-    }
-}
-
-void Player::failQuest(const std::string& quest_id) {
-    auto it = quests_.find(quest_id);
-    if (it != quests_.end()) {
-        it->second.status = QuestStatus::FAILED;
-    }
-}
-
-QuestStatus Player::getQuestStatus(const std::string& quest_id) const {
-    auto it = quests_.find(quest_id);
-    return it != quests_.end() ? it->second.status : QuestStatus::NOT_STARTED;
-}
-
-std::vector<QuestInfo> Player::getActiveQuests() const {
-    std::vector<QuestInfo> active;
-    for (const auto& [id, quest] : quests_) {
-        if (quest.status == QuestStatus::IN_PROGRESS) {
-            active.push_back(quest);
-        }
-    }
-    return active;
-}
-
-std::vector<QuestInfo> Player::getAllQuests() const {
-    std::vector<QuestInfo> all;
-    for (const auto& [id, quest] : quests_) {
-        all.push_back(quest);
-    }
-    return all;
-}
-
 // 结局系统函数已在EndingSystem.cpp中实现
 
 std::vector<SimpleItem> Player::simpleInventory() const {
     std::vector<SimpleItem> result;
-    auto items = inventory_->asSimpleItems();
-    for (const auto& item : items) {
+    result.reserve(inventory_->size());
+    for (const auto& item : *inventory_) {
         result.push_back({item.id, item.name, item.count});
     }
     return result;
@@ -658,6 +604,7 @@ void Player::setInventory(const std::vector<SimpleItem>& items) {
 
 // 等级提升检查
 void Player::checkLevelUp() {
+    int old_level = level_;
     int required_xp = level_ * 100; // 每级需要 level * 100 经验
     while (xp_ >= required_xp) {
         xp_ -= required_xp;
@@ -670,14 +617,13 @@ void Player::checkLevelUp() {
         // 升级时HP回复到上限
         attr_.hp = attr_.max_hp;
         
-        std::cout << "【升级】等级提升至 " << level_ << "！HP已回复到上限。\n";
-        std::cout << "【属性点】获得 " << attr_.available_points << " 点属性点可分配！\n";
-        std::cout << "💡 使用 'allocate <属性> [数量]' 分配属性点\n";
-        std::cout << "   可用属性：hp(生命), atk(攻击), def(防御), spd(速度)\n";
-        std::cout << "   示例：allocate hp 1 或 allocate atk 2\n";
-        
         required_xp = level_ * 100;
     }
+    
+    // 升级提示由订阅了升级事件的监听器显示
+    if (events_ && level_ > old_level) {
+        events_->publish(LevelUpEvent{old_level, level_});
+    }
 }
 
 // 获取下一级所需经验
@@ -0,0 +1,114 @@
+// 这是录制与回放的实现文件
+// 作者：大一学生
+// 功能：记录文件的读写，以及无界面、不等待地回放一局游戏
+
+#include "Replay.hpp"  // 录制与回放头文件
+#include "Game.hpp"    // 游戏类
+#include "Output.hpp"  // 游戏输出
+#include <sstream>     // 字符串流
+
+namespace hx {
+
+namespace {
+const char* const kHeader = "# haida-mud transcript";
+// 回放用的时钟：第一行输入在这个时刻之后 at_ms 毫秒（0表示没有记录，所以不从0开始）
+constexpr std::int64_t kReplayClockStart = 1;
+}
+
+// 读取记录文件
+bool Transcript::load(const std::string& path) {
+    std::ifstream in(path);
+    if (!in) return false;
+    std::string row;
+    if (!std::getline(in, row) || row != kHeader) return false;
+    if (!std::getline(in, row) || row.rfind("seed ", 0) != 0) return false;
+    try {
+        seed = static_cast<std::uint32_t>(std::stoul(row.substr(5)));
+    } catch (...) {
+        return false;
+    }
+    lines.clear();
+    while (std::getline(in, row)) {
+        size_t tab = row.find('\t');
+        if (tab == std::string::npos) return false;
+        Line line;
+        try {
+            line.at_ms = std::stoull(row.substr(0, tab));
+        } catch (...) {
+            return false;
+        }
+        line.text = row.substr(tab + 1);
+        lines.push_back(std::move(line));
+    }
+    return true;
+}
+
+bool Transcript::save(const std::string& path) const {
+    std::ofstream out(path);
+    if (!out) return false;
+    out << kHeader << "\n" << "seed " << seed << "\n";
+    for (const Line& line : lines) out << line.at_ms << '\t' << line.text << "\n";
+    return static_cast<bool>(out);
+}
+
+TranscriptWriter::TranscriptWriter(const std::string& path, std::uint32_t seed)
+    : out_(path), start_(std::chrono::steady_clock::now()), start_wall_ms_(wallClockMillis()) {
+    if (out_) out_ << kHeader << "\n" << "seed " << seed << std::endl;
+}
+
+// 记录一行输入（立即写入文件）
+std::int64_t TranscriptWriter::record(const std::string& line) {
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start_);
+    if (out_) out_ << elapsed.count() << '\t' << line << std::endl;
+    return start_wall_ms_ + elapsed.count();
+}
+
+// 回放：和 Game::run 一样的流程，只是输入来自记录
+ReplayResult replay(const Transcript& transcript, std::ostream* output) {
+    ReplayResult result;
+    auto begin = std::chrono::steady_clock::now();
+    {
+        ConsoleScope scope(output ? *output : nullConsole());
+        Game game(transcript.seed);
+        // 记录里的save/load只读写这次回放自己的存档位，不碰当前目录的save.dat，结果只由记录决定
+        std::string save_slot;
+        game.setSaveSlot(&save_slot);
+        game.start();
+        for (const Transcript::Line& line : transcript.lines) {
+            bool alive = true;
+            while (alive && game.busy()) alive = game.resume();
+            if (!alive) {
+                result.quit = true;
+                break;
+            }
+            console() << game.prompt();
+            ++result.lines;
+            if (!game.handleLine(line.text, kReplayClockStart + static_cast<std::int64_t>(line.at_ms))) {
+                result.quit = true;
+                break;
+            }
+        }
+        while (!result.quit && game.busy()) result.quit = !game.resume();
+        result.state_hash = game.stateHash().total;
+    }
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    return result;
+}
+
+// 逐行比较两段输出
+size_t firstDifference(const std::string& expected, const std::string& actual) {
+    std::istringstream a(expected);
+    std::istringstream b(actual);
+    std::string line_a;
+    std::string line_b;
+    size_t number = 0;
+    while (true) {
+        ++number;
+        bool more_a = static_cast<bool>(std::getline(a, line_a));
+        bool more_b = static_cast<bool>(std::getline(b, line_b));
+        if (!more_a && !more_b) return 0;
+        if (more_a != more_b || line_a != line_b) return number;
+    }
+}
+
+} // namespace hx
@@ -3,29 +3,38 @@
 // 功能：实现游戏的存档和读档功能，保存和恢复游戏状态
 
 #include "SaveLoad.hpp"  // 存档读档头文件
+#include "Output.hpp"    // 游戏输出
+#include "Metrics.hpp"   // 运行指标
+#include "Trace.hpp"     // 时间线跟踪
+#include <algorithm>      // remove_if
 #include <fstream>        // 文件流
 #include <iostream>       // 输入输出流
+#include <map>            // 秘境的改动记录
 
 namespace hx {
 
 // ---------------- 工具函数 ----------------
 // 用于文件读写的辅助函数
-static void writeString(std::ofstream& out, const std::string& s){ 
+static void writeString(std::ostream& out, const std::string& s){ 
     size_t n = s.size(); 
     out.write((char*)&n, sizeof(n)); 
     out.write(s.data(), n); 
 }
 
-static bool readString(std::ifstream& in, std::string& s){ 
+// 读出来的长度超过上限说明存档已经损坏，直接按失败处理，不要按它去分配内存
+static constexpr size_t kMaxStringLength = 1 << 20;
+
+static bool readString(std::istream& in, std::string& s){ 
     size_t n = 0; 
     if(!in.read((char*)&n, sizeof(n))) return false; 
+    if(n > kMaxStringLength) return false; 
     s.resize(n); 
     if(!in.read(&s[0], n)) return false; 
     return true; 
 }
 
 // ---------------- Attributes 序列化 ----------------
-static void writeAttributes(std::ofstream& out, const Attributes& a) {
+static void writeAttributes(std::ostream& out, const Attributes& a) {
     out.write((char*)&a.hp, sizeof(a.hp));
     out.write((char*)&a.max_hp, sizeof(a.max_hp));
     out.write((char*)&a.atk, sizeof(a.atk));
@@ -49,7 +58,7 @@ static void writeAttributes(std::ofstream& out, const Attributes& a) {
     }
 }
 
-static bool readAttributes(std::ifstream& in, Attributes& a) {
+static bool readAttributes(std::istream& in, Attributes& a) {
     if (!in.read((char*)&a.hp, sizeof(a.hp))) return false;
     if (!in.read((char*)&a.max_hp, sizeof(a.max_hp))) return false;
     if (!in.read((char*)&a.atk, sizeof(a.atk))) return false;
@@ -81,7 +90,7 @@ static bool readAttributes(std::ifstream& in, Attributes& a) {
 }
 
 // ---------------- Item 序列化 ----------------
-static void writeItem(std::ofstream& out, const Item& item) {
+static void writeItem(std::ostream& out, const Item& item) {
     writeString(out, item.id);
     writeString(out, item.name);
     writeString(out, item.description);
@@ -109,7 +118,7 @@ static void writeItem(std::ofstream& out, const Item& item) {
     out.write((char*)&item.favor_requirement, sizeof(item.favor_requirement));
 }
 
-static bool readItem(std::ifstream& in, Item& item) {
+static bool readItem(std::istream& in, Item& item) {
     if(!readString(in, item.id)) return false;
     if(!readString(in, item.name)) return false;
     if(!readString(in, item.description)) return false;
@@ -138,97 +147,43 @@ static bool readItem(std::ifstream& in, Item& item) {
     return true;
 }
 
-// ---------------- TaskReward 序列化 ----------------
-static void writeTaskReward(std::ofstream& out, const TaskReward& reward) {
-    writeString(out, reward.item_id);
-    writeString(out, reward.item_name);
-    out.write((char*)&reward.quantity, sizeof(reward.quantity));
-    out.write((char*)&reward.exp_reward, sizeof(reward.exp_reward));
-    out.write((char*)&reward.coin_reward, sizeof(reward.coin_reward));
-    writeString(out, reward.description);
-}
-
-static bool readTaskReward(std::ifstream& in, TaskReward& reward) {
-    if(!readString(in, reward.item_id)) return false;
-    if(!readString(in, reward.item_name)) return false;
-    if(!in.read((char*)&reward.quantity, sizeof(reward.quantity))) return false;
-    if(!in.read((char*)&reward.exp_reward, sizeof(reward.exp_reward))) return false;
-    if(!in.read((char*)&reward.coin_reward, sizeof(reward.coin_reward))) return false;
-    if(!readString(in, reward.description)) return false;
-    return true;
-}
-
 // ---------------- Task 序列化 ----------------
-static void writeTask(std::ofstream& out, const Task& task) {
-    writeString(out, task.getId());
-    writeString(out, task.getName());
-    writeString(out, task.getDescription());
-    TaskType type = task.getType();
-    TaskStatus status = task.getStatus();
-    out.write((char*)&type, sizeof(type));
-    out.write((char*)&status, sizeof(status));
-    
-    // 保存奖励
-    auto rewards = task.getRewards();
-    size_t rewardN = rewards.size();
-    out.write((char*)&rewardN, sizeof(rewardN));
-    for (const auto& reward : rewards) {
-        writeTaskReward(out, reward);
-    }
-    
-    // 保存目标
-    auto objectives = task.getObjectives();
-    size_t objN = objectives.size();
+// 只保存任务状态表中的一行；任务定义由createTasks重建
+static void writeTaskProgress(std::ostream& out, const std::string& id, const TaskProgress& progress) {
+    writeString(out, id);
+    out.write((char*)&progress.status, sizeof(progress.status));
+    size_t objN = progress.objective_overrides.size();
     out.write((char*)&objN, sizeof(objN));
-    for (const auto& obj : objectives) {
-        writeString(out, obj);
+    for (const auto& [index, text] : progress.objective_overrides) {
+        out.write((char*)&index, sizeof(index));
+        writeString(out, text);
     }
 }
 
-static bool readTask(std::ifstream& in, Task& task) {
-    std::string id, name, description;
-    TaskType type;
-    TaskStatus status;
-    
-    if(!readString(in, id) || !readString(in, name) || !readString(in, description) ||
-       !in.read((char*)&type, sizeof(type)) || !in.read((char*)&status, sizeof(status))) {
-        return false;
-    }
-    
-    // 创建任务
-    std::vector<TaskReward> rewards;
-    size_t rewardN;
-    if(!in.read((char*)&rewardN, sizeof(rewardN))) return false;
-    for (size_t i = 0; i < rewardN; ++i) {
-        TaskReward reward;
-        if (!readTaskReward(in, reward)) return false;
-        rewards.push_back(reward);
-    }
-    
-    task = Task(id, name, description, type, rewards);
-    task.setStatus(status);
-    
-    // 加载目标
+static bool readTaskProgress(std::istream& in, std::string& id, TaskProgress& progress) {
+    if(!readString(in, id)) return false;
+    if(!in.read((char*)&progress.status, sizeof(progress.status))) return false;
     size_t objN;
     if(!in.read((char*)&objN, sizeof(objN))) return false;
+    if(objN > 256) return false; // 目标编号是uint8，最多256条
     for (size_t i = 0; i < objN; ++i) {
-        std::string obj;
-        if (!readString(in, obj)) return false;
-        task.addObjective(obj);
+        std::uint8_t index;
+        std::string text;
+        if(!in.read((char*)&index, sizeof(index)) || !readString(in, text)) return false;
+        progress.objective_overrides.emplace_back(index, text);
     }
-    
     return true;
 }
 
 // ---------------- DialogueOption 序列化 ---------------- 
-static void writeDialogueOption(std::ofstream& out, const DialogueOption& option) {
+static void writeDialogueOption(std::ostream& out, const DialogueOption& option) {
     writeString(out, option.text);
     writeString(out, option.next_dialogue_id);
     out.write((char*)&option.favor_change, sizeof(option.favor_change));
     writeString(out, option.requirement);
 }
 
-static bool readDialogueOption(std::ifstream& in, DialogueOption& option) {
+static bool readDialogueOption(std::istream& in, DialogueOption& option) {
     if(!readString(in, option.text)) return false;
     if(!readString(in, option.next_dialogue_id)) return false;
     if(!in.read((char*)&option.favor_change, sizeof(option.favor_change))) return false;
@@ -237,7 +192,7 @@ static bool readDialogueOption(std::ifstream& in, DialogueOption& option) {
 }
 
 // ---------------- DialogueNode 序列化 ---------------- 
-static void writeDialogueNode(std::ofstream& out, const DialogueNode& node) {
+static void writeDialogueNode(std::ostream& out, const DialogueNode& node) {
     writeString(out, node.id);
     writeString(out, node.npc_text);
     out.write((char*)&node.is_shop, sizeof(node.is_shop));
@@ -253,7 +208,7 @@ static void writeDialogueNode(std::ofstream& out, const DialogueNode& node) {
     }
 }
 
-static bool readDialogueNode(std::ifstream& in, DialogueNode& node) {
+static bool readDialogueNode(std::istream& in, DialogueNode& node) {
     if(!readString(in, node.id)) return false;
     if(!readString(in, node.npc_text)) return false;
     if(!in.read((char*)&node.is_shop, sizeof(node.is_shop))) return false;
@@ -277,6 +232,21 @@ static bool readDialogueNode(std::ifstream& in, DialogueNode& node) {
 bool SaveLoad::save(const GameState& state, const std::string& filename){ 
     std::ofstream out(filename, std::ios::binary); 
     if(!out) return false; 
+    return save(state, out);
+}
+
+// 存档开头：格式标记和版本号，布局改变时版本号加一；紧接着是最后输入的时刻（读档后会被清零）
+static const char kSaveMagic[4] = {'H', 'X', 'S', 'V'};
+static constexpr size_t kLastActiveOffset = sizeof(kSaveMagic) + sizeof(std::uint32_t);
+
+bool SaveLoad::save(const GameState& state, std::ostream& out){ 
+    MetricTimer timer(Metric::SAVE);
+    HX_TRACE_PHASE(phase, "save.player");
+
+    out.write(kSaveMagic, sizeof(kSaveMagic));
+    std::uint32_t version = SaveLoad::kFormatVersion;
+    out.write((char*)&version, sizeof(version));
+    out.write((char*)&state.last_active_ms, sizeof(state.last_active_ms));
 
     writeString(out, state.player.getName()); 
 
@@ -295,16 +265,18 @@ bool SaveLoad::save(const GameState& state, const std::string& filename){
     writeString(out, state.current_loc); 
 
     // Inventory
-    auto items = state.player.simpleInventory(); 
-    size_t invN = items.size(); 
+    HX_TRACE_NEXT(phase, "save.inventory");
+    const Inventory& inventory = state.player.inventory(); 
+    size_t invN = inventory.size(); 
     out.write((char*)&invN, sizeof(invN)); 
-    for(auto &it : items){ 
+    for(const Item& it : inventory){ 
         writeString(out, it.id); 
         writeString(out, it.name); 
         out.write((char*)&it.count, sizeof(it.count)); 
     } 
     
     // 保存装备信息
+    HX_TRACE_NEXT(phase, "save.equipment");
     auto equipped_items = state.player.equipment().getEquippedItems();
     size_t equipN = equipped_items.size();
     out.write((char*)&equipN, sizeof(equipN));
@@ -313,6 +285,7 @@ bool SaveLoad::save(const GameState& state, const std::string& filename){
     }
     
     // 保存NPC好感度
+    HX_TRACE_NEXT(phase, "save.favors");
     auto npc_favors = state.player.getAllFavors();
     size_t favorN = npc_favors.size();
     out.write((char*)&favorN, sizeof(favorN));
@@ -321,40 +294,18 @@ bool SaveLoad::save(const GameState& state, const std::string& filename){
         out.write((char*)&favor, sizeof(favor));
     }
     
-    // 保存任务状态
-    auto quests = state.player.getQuests();
-    size_t questN = quests.size();
-    out.write((char*)&questN, sizeof(questN));
-    for (const auto& [quest_id, quest] : quests) {
-        writeString(out, quest.id);
-        writeString(out, quest.name);
-        writeString(out, quest.description);
-        out.write((char*)&quest.status, sizeof(quest.status));
-        
-        // 保存任务目标
-        size_t objN = quest.objectives.size();
-        out.write((char*)&objN, sizeof(objN));
-        for (const auto& obj : quest.objectives) {
-            writeString(out, obj);
-        }
-        
-        // 保存任务奖励
-        size_t rewardN = quest.rewards.size();
-        out.write((char*)&rewardN, sizeof(rewardN));
-        for (const auto& reward : quest.rewards) {
-            writeString(out, reward);
-        }
-    }
-    
-    // 保存TaskManager状态
-    auto tasks = state.task_manager.getAllTasksData();
+    // 保存任务状态表
+    HX_TRACE_NEXT(phase, "save.tasks");
+    const auto& tasks = state.task_manager.tasks();
+    const auto& progress = state.task_manager.progressTable();
     size_t taskN = tasks.size();
     out.write((char*)&taskN, sizeof(taskN));
-    for (const auto& task : tasks) {
-        writeTask(out, task);
+    for (size_t i = 0; i < taskN; ++i) {
+        writeTaskProgress(out, tasks[i].getId(), progress[i]);
     }
     
     // 保存游戏状态数据
+    HX_TRACE_NEXT(phase, "save.flags");
     out.write((char*)&state.in_teaching_detail, sizeof(state.in_teaching_detail));
     out.write((char*)&state.wenxintan_intro_shown, sizeof(state.wenxintan_intro_shown));
     out.write((char*)&state.chapter4_shown, sizeof(state.chapter4_shown));
@@ -374,6 +325,7 @@ bool SaveLoad::save(const GameState& state, const std::string& filename){
     out.write((char*)&state.math_difficulty_spirit_first_kill, sizeof(state.math_difficulty_spirit_first_kill));
     
     // 保存对话记忆系统
+    HX_TRACE_NEXT(phase, "save.dialogue_memory");
     size_t dialogue_memory_size = state.dialogue_memory.size();
     out.write((char*)&dialogue_memory_size, sizeof(dialogue_memory_size));
     for (const auto& [npc_name, choices] : state.dialogue_memory) {
@@ -385,14 +337,17 @@ bool SaveLoad::save(const GameState& state, const std::string& filename){
         }
     }
     
-    // 保存回合计数器和商店系统
-    out.write((char*)&state.turn_counter, sizeof(state.turn_counter));
+    // 保存世界回合和商店系统
+    HX_TRACE_NEXT(phase, "save.world");
+    int turn_counter = static_cast<int>(state.scheduler.now());
+    out.write((char*)&turn_counter, sizeof(turn_counter));
     
     // 保存商店系统状态
     int revival_scroll_purchases = state.shop_system.getRevivalScrollPurchases();
     out.write((char*)&revival_scroll_purchases, sizeof(revival_scroll_purchases));
     
     // 保存怪物刷新系统
+    HX_TRACE_NEXT(phase, "save.spawns");
     size_t monster_spawns_size = state.monster_spawns.size();
     out.write((char*)&monster_spawns_size, sizeof(monster_spawns_size));
     for (const auto& spawn : state.monster_spawns) {
@@ -401,14 +356,20 @@ bool SaveLoad::save(const GameState& state, const std::string& filename){
         out.write((char*)&spawn.max_count, sizeof(spawn.max_count));
         out.write((char*)&spawn.current_count, sizeof(spawn.current_count));
         out.write((char*)&spawn.respawn_turns, sizeof(spawn.respawn_turns));
-        out.write((char*)&spawn.turns_until_respawn, sizeof(spawn.turns_until_respawn));
+        int turns_until_respawn = state.turnsUntilRespawn(spawn); // 存剩余回合，存档格式不变
+        out.write((char*)&turns_until_respawn, sizeof(turns_until_respawn));
         out.write((char*)&spawn.recommended_level, sizeof(spawn.recommended_level));
         out.write((char*)&spawn.challenge_count, sizeof(spawn.challenge_count));
         out.write((char*)&spawn.max_challenges, sizeof(spawn.max_challenges));
     }
     
     // 保存地图状态（NPC状态等）
+    HX_TRACE_NEXT(phase, "save.map");
     auto locations = state.map.allLocations();
+    // 秘境的房间不存：读档时由种子和下面的改动记录重新生成
+    locations.erase(std::remove_if(locations.begin(), locations.end(),
+                                   [](const Location& loc) { return Dungeon::floorOf(loc.id) > 0; }),
+                    locations.end());
     size_t locations_size = locations.size();
     out.write((char*)&locations_size, sizeof(locations_size));
     for (const auto& location : locations) {
@@ -487,43 +448,96 @@ bool SaveLoad::save(const GameState& state, const std::string& filename){
         }
     }
     
-    return true; 
+    // 保存秘境：种子、到过的最深层数和各层的改动记录
+    HX_TRACE_NEXT(phase, "save.dungeon");
+    std::uint32_t dungeon_seed = state.dungeon.seed();
+    out.write((char*)&dungeon_seed, sizeof(dungeon_seed));
+    int deepest = state.dungeon.deepest();
+    out.write((char*)&deepest, sizeof(deepest));
+    size_t floors_size = state.dungeon.cleared().size();
+    out.write((char*)&floors_size, sizeof(floors_size));
+    for (const auto& [floor, rooms] : state.dungeon.cleared()) {
+        out.write((char*)&floor, sizeof(floor));
+        size_t rooms_size = rooms.size();
+        out.write((char*)&rooms_size, sizeof(rooms_size));
+        for (int room : rooms) out.write((char*)&room, sizeof(room));
+    }
+    
+    // 背包的完整物品记录：前面的背包段只有ID、名称和数量，读档时按ID重建，
+    // 不认识的物品会丢掉属性；这一段放在最后，旧版本读档时读不到它也没有影响
+    HX_TRACE_NEXT(phase, "save.inventory_items");
+    out.write((char*)&invN, sizeof(invN));
+    for (const Item& it : inventory) writeItem(out, it);
+    
+    return static_cast<bool>(out); 
 }
 
 bool SaveLoad::load(GameState& state, const std::string& filename){ 
     std::ifstream in(filename, std::ios::binary); 
     if(!in) {
-        std::cout << "无法打开存档文件: " << filename << std::endl;
+        console() << "无法打开存档文件: " << filename << std::endl;
         return false;
     } 
+    return load(state, in);
+}
+
+bool SaveLoad::clearLastActive(const std::string& filename){
+    std::fstream file(filename, std::ios::binary | std::ios::in | std::ios::out);
+    if(!file) return false;
+    const std::int64_t none = 0;
+    file.seekp(static_cast<std::streamoff>(kLastActiveOffset));
+    file.write((const char*)&none, sizeof(none));
+    return static_cast<bool>(file);
+}
+
+void SaveLoad::clearLastActive(std::string& blob){
+    if(blob.size() < kLastActiveOffset + sizeof(std::int64_t)) return;
+    std::fill_n(blob.begin() + static_cast<std::ptrdiff_t>(kLastActiveOffset), sizeof(std::int64_t), '\0');
+}
+
+bool SaveLoad::load(GameState& state, std::istream& in){ 
+    MetricTimer timer(Metric::LOAD);
+
+    // 格式标记或版本不对（旧版本的存档、别的文件）时什么都不改，直接失败
+    char magic[sizeof(kSaveMagic)];
+    std::uint32_t version = 0;
+    if(!in.read(magic, sizeof(magic)) || !std::equal(magic, magic + sizeof(magic), kSaveMagic) ||
+       !in.read((char*)&version, sizeof(version)) || version != SaveLoad::kFormatVersion) {
+        console() << "存档格式不兼容（不是当前版本的存档）" << std::endl;
+        return false;
+    }
+    if(!in.read((char*)&state.last_active_ms, sizeof(state.last_active_ms))) {
+        console() << "读取存档时间失败" << std::endl;
+        return false;
+    }
 
     std::string name; 
     if(!readString(in, name)) {
-        std::cout << "读取玩家名称失败" << std::endl;
+        console() << "读取玩家名称失败" << std::endl;
         return false;
     } 
     state.player.setName(name); 
 
     Attributes a; 
     if(!readAttributes(in, a)) {
-        std::cout << "读取玩家属性失败" << std::endl;
+        console() << "读取玩家属性失败" << std::endl;
         return false;
     } 
     state.player.setAttr(a); 
 
     int lv; 
     if(!in.read((char*)&lv, sizeof(lv))) {
-        std::cout << "读取玩家等级失败" << std::endl;
+        console() << "读取玩家等级失败" << std::endl;
         return false;
     }
     int xp; 
     if(!in.read((char*)&xp, sizeof(xp))) {
-        std::cout << "读取玩家经验失败" << std::endl;
+        console() << "读取玩家经验失败" << std::endl;
         return false;
     }
     int coins; 
     if(!in.read((char*)&coins, sizeof(coins))) {
-        std::cout << "读取玩家金币失败" << std::endl;
+        console() << "读取玩家金币失败" << std::endl;
         return false;
     }
     state.player.setLevel(lv); 
@@ -532,14 +546,14 @@ bool SaveLoad::load(GameState& state, const std::string& filename){
 
     std::string loc; 
     if(!readString(in, loc)) {
-        std::cout << "读取当前位置失败" << std::endl;
+        console() << "读取当前位置失败" << std::endl;
         return false;
     } 
     state.current_loc = loc; 
 
     size_t invN; 
     if(!in.read((char*)&invN, sizeof(invN))) {
-        std::cout << "读取背包数量失败" << std::endl;
+        console() << "读取背包数量失败" << std::endl;
         return false;
     }
     std::vector<SimpleItem> items; 
@@ -556,14 +570,14 @@ bool SaveLoad::load(GameState& state, const std::string& filename){
     // 加载装备信息
     size_t equipN;
     if(!in.read((char*)&equipN, sizeof(equipN))) {
-        std::cout << "读取装备数量失败，使用默认值0" << std::endl;
+        console() << "读取装备数量失败，使用默认值0" << std::endl;
         equipN = 0; // 默认值
     }
     std::vector<Item> equipped_items;
     for (size_t i = 0; i < equipN; ++i) {
         Item item;
         if (!readItem(in, item)) {
-            std::cout << "读取装备信息失败，停止加载装备" << std::endl;
+            console() << "读取装备信息失败，停止加载装备" << std::endl;
             break; // 读取失败，停止
         }
         equipped_items.push_back(item);
@@ -571,14 +585,14 @@ bool SaveLoad::load(GameState& state, const std::string& filename){
     try {
         state.player.equipment().setEquippedItems(equipped_items);
     } catch (const std::exception& e) {
-        std::cout << "设置装备信息时出错: " << e.what() << std::endl;
+        console() << "设置装备信息时出错: " << e.what() << std::endl;
     }
     
     // 更新玩家属性（从装备计算）
     try {
         state.player.updateAttributesFromEquipment();
     } catch (const std::exception& e) {
-        std::cout << "更新玩家属性时出错: " << e.what() << std::endl;
+        console() << "更新玩家属性时出错: " << e.what() << std::endl;
     }
     
     // 加载NPC好感度
@@ -597,55 +611,19 @@ bool SaveLoad::load(GameState& state, const std::string& filename){
     }
     state.player.setNPCFavors(npc_favors);
     
-    // 加载任务状态
-    size_t questN;
-    if(!in.read((char*)&questN, sizeof(questN))) {
-        questN = 0; // 默认值
-    }
-    std::unordered_map<std::string, QuestInfo> quests;
-    for (size_t i = 0; i < questN; ++i) {
-        QuestInfo quest;
-        if (!readString(in, quest.id) || !readString(in, quest.name) || 
-            !readString(in, quest.description) || !in.read((char*)&quest.status, sizeof(quest.status))) {
-            break;
-        }
-        
-        // 加载任务目标
-        size_t objN;
-        if (!in.read((char*)&objN, sizeof(objN))) break;
-        for (size_t j = 0; j < objN; ++j) {
-            std::string obj;
-            if (!readString(in, obj)) break;
-            quest.objectives.push_back(obj);
-        }
-        
-        // 加载任务奖励
-        size_t rewardN;
-        if (!in.read((char*)&rewardN, sizeof(rewardN))) break;
-        for (size_t j = 0; j < rewardN; ++j) {
-            std::string reward;
-            if (!readString(in, reward)) break;
-            quest.rewards.push_back(reward);
-        }
-        
-        quests[quest.id] = quest;
-    }
-    state.player.setQuests(quests);
-    
-    // 加载TaskManager状态
+    // 加载任务状态表
     size_t taskN;
     if(!in.read((char*)&taskN, sizeof(taskN))) {
         taskN = 0; // 默认值
     }
-    std::vector<Task> tasks;
     for (size_t i = 0; i < taskN; ++i) {
-        Task task("", "", "", TaskType::MAIN, {});
-        if (!readTask(in, task)) {
+        std::string task_id;
+        TaskProgress progress;
+        if (!readTaskProgress(in, task_id, progress)) {
             break;
         }
-        tasks.push_back(task);
+        state.task_manager.restoreProgress(task_id, progress);
     }
-    state.task_manager.setAllTasksData(tasks);
     
     // 加载游戏状态数据
     if(!in.read((char*)&state.in_teaching_detail, sizeof(state.in_teaching_detail))) {
@@ -712,10 +690,12 @@ bool SaveLoad::load(GameState& state, const std::string& filename){
         state.dialogue_memory[npc_name] = choices;
     }
     
-    // 加载回合计数器和商店系统
-    if(!in.read((char*)&state.turn_counter, sizeof(state.turn_counter))) {
-        state.turn_counter = 0; // 默认值
+    // 加载世界回合和商店系统（定时任务由Game在读档后重建）
+    int turn_counter;
+    if(!in.read((char*)&turn_counter, sizeof(turn_counter)) || turn_counter < 0) {
+        turn_counter = 0; // 默认值
     }
+    state.scheduler.reset(static_cast<std::uint64_t>(turn_counter));
     
     // 加载商店系统状态
     int revival_scroll_purchases;
@@ -740,7 +720,10 @@ bool SaveLoad::load(GameState& state, const std::string& filename){
         if (!in.read((char*)&spawn.max_count, sizeof(spawn.max_count))) break;
         if (!in.read((char*)&spawn.current_count, sizeof(spawn.current_count))) break;
         if (!in.read((char*)&spawn.respawn_turns, sizeof(spawn.respawn_turns))) break;
-        if (!in.read((char*)&spawn.turns_until_respawn, sizeof(spawn.turns_until_respawn))) break;
+        int turns_until_respawn;
+        if (!in.read((char*)&turns_until_respawn, sizeof(turns_until_respawn))) break;
+        spawn.respawn_turn = turns_until_respawn > 0
+            ? state.scheduler.now() + static_cast<std::uint64_t>(turns_until_respawn) : 0;
         if (!in.read((char*)&spawn.recommended_level, sizeof(spawn.recommended_level))) break;
         
         // 尝试读取新增的字段，如果失败则使用默认值（向后兼容）
@@ -757,7 +740,7 @@ bool SaveLoad::load(GameState& state, const std::string& filename){
     // 只有在怪物刷新系统完全为空且无法从存档加载时才重新初始化
     // 这通常只会在新游戏或损坏的存档中发生
     if (state.monster_spawns.empty()) {
-        std::cout << "警告：怪物刷新系统为空，使用默认配置重新初始化" << std::endl;
+        console() << "警告：怪物刷新系统为空，使用默认配置重新初始化" << std::endl;
         
         // 体育馆 - 低等级区域 (Lv1-3) - 所有怪物5回合刷新
         state.monster_spawns.push_back({"gymnasium", "迷糊书虫", 2, 2, 5, 0, 1, 0, 3});
@@ -781,7 +764,7 @@ bool SaveLoad::load(GameState& state, const std::string& filename){
         state.monster_spawns.push_back({"wenxintan", "实验失败妖·复苏", 1, 1, 5, 0, 12, 0, 3});
         state.monster_spawns.push_back({"wenxintan", "答辩紧张魔·强化", 1, 1, 5, 0, 12, 0, 3});
     } else {
-        std::cout << "成功加载怪物刷新系统，共 " << state.monster_spawns.size() << " 个怪物配置" << std::endl;
+        console() << "成功加载怪物刷新系统，共 " << state.monster_spawns.size() << " 个怪物配置" << std::endl;
     }
     
     // 修复怪物刷新状态：如果还有挑战次数但current_count为0，则重置为1
@@ -791,9 +774,9 @@ bool SaveLoad::load(GameState& state, const std::string& filename){
         }
     }
     
-    // 确保所有怪物都有正确的current_count（如果turns_until_respawn为0且challenge_count < max_challenges）
+    // 确保所有怪物都有正确的current_count（如果不在刷新中且challenge_count < max_challenges）
     for (auto& spawn : state.monster_spawns) {
-        if (spawn.turns_until_respawn == 0 && spawn.challenge_count < spawn.max_challenges && spawn.current_count == 0) {
+        if (spawn.respawn_turn == 0 && spawn.challenge_count < spawn.max_challenges && spawn.current_count == 0) {
             spawn.current_count = spawn.max_count; // 重置为最大数量
         }
     }
@@ -814,7 +797,7 @@ bool SaveLoad::load(GameState& state, const std::string& filename){
                 }
                 
                 if (!monster_exists) {
-                    std::cout << "重新生成怪物: " << spawn.monster_name << " 在 " << spawn.location_id << std::endl;
+                    console() << "重新生成怪物: " << spawn.monster_name << " 在 " << spawn.location_id << std::endl;
                     // 根据怪物名称和位置创建怪物
                     if (spawn.location_id == "gymnasium") {
                         if (spawn.monster_name == "迷糊书虫") {
@@ -916,6 +899,7 @@ bool SaveLoad::load(GameState& state, const std::string& filename){
         
         // 获取现有位置或创建新位置
         Location* location = state.map.get(location_id);
+        const bool created = !location;
         if (!location) {
             // 如果位置不存在，创建新位置
             Location new_location;
@@ -928,11 +912,14 @@ bool SaveLoad::load(GameState& state, const std::string& filename){
         location->name = location_name;
         location->desc = location_desc;
         
-        // 加载坐标
-        if (!in.read((char*)&location->coord.x, sizeof(location->coord.x)) || 
-            !in.read((char*)&location->coord.y, sizeof(location->coord.y))) {
+        // 加载坐标：坐标是世界数据，已有的地点以建立世界时的为准（旧存档里的坐标已经过时），
+        // 只有存档里多出来的地点用存档的坐标
+        Coord saved_coord{0, 0};
+        if (!in.read((char*)&saved_coord.x, sizeof(saved_coord.x)) || 
+            !in.read((char*)&saved_coord.y, sizeof(saved_coord.y))) {
             break;
         }
+        if (created) location->coord = saved_coord;
         
         // 加载出口
         size_t exits_size;
@@ -943,6 +930,7 @@ bool SaveLoad::load(GameState& state, const std::string& filename){
             if (!readString(in, label) || !readString(in, to)) break;
             location->exits.push_back({label, to});
         }
+        state.map.invalidateIndexes(); // 出口和名称被改写，寻路表和地图视图下次用到时重建
         
         // 加载NPC状态
         size_t npcs_size;
@@ -1040,6 +1028,44 @@ bool SaveLoad::load(GameState& state, const std::string& filename){
         // 怪物数据应该被保留，因为我们在更新位置时没有清空enemies
     }
     
+    // 加载秘境：先把现在常驻的层全部移出地图，再恢复改动记录（旧存档没有这一段，按没进过秘境处理）
+    state.dungeon.reset(state.map);
+    std::uint32_t dungeon_seed;
+    int deepest;
+    size_t floors_size;
+    if (in.read((char*)&dungeon_seed, sizeof(dungeon_seed)) && in.read((char*)&deepest, sizeof(deepest)) &&
+        in.read((char*)&floors_size, sizeof(floors_size))) {
+        std::map<int, std::vector<int>> cleared;
+        for (size_t i = 0; i < floors_size; ++i) {
+            int floor;
+            size_t rooms_size;
+            if (!in.read((char*)&floor, sizeof(floor)) || !in.read((char*)&rooms_size, sizeof(rooms_size))) break;
+            std::vector<int>& rooms = cleared[floor];
+            for (size_t j = 0; j < rooms_size; ++j) {
+                int room;
+                if (!in.read((char*)&room, sizeof(room))) break;
+                rooms.push_back(room);
+            }
+        }
+        state.dungeon.setSeed(dungeon_seed); // 各层按存档时的种子生成，读档后和存档前一样
+        state.dungeon.restore(deepest, std::move(cleared));
+    }
+    state.dungeon.attach(state.map);
+    if (int floor = Dungeon::floorOf(state.current_loc)) state.dungeon.enter(state.map, floor);
+    
+    // 背包的完整物品记录（旧存档没有这一段，保留按ID重建的背包）
+    size_t items_size;
+    if (in.read((char*)&items_size, sizeof(items_size))) {
+        Inventory restored;
+        size_t read = 0;
+        for (; read < items_size; ++read) {
+            Item item;
+            if (!readItem(in, item)) break;
+            restored.add(item, item.count);
+        }
+        if (read == items_size) state.player.inventory() = std::move(restored);
+    }
+    
     return true; 
 }
 
@@ -0,0 +1,325 @@
+// 这是会话调度器的实现文件
+// 作者：大一学生
+// 功能：实现工作线程池、就绪队列的取用与窃取，以及每个会话的串行执行
+
+#include "SessionScheduler.hpp"  // 会话调度器头文件
+#include "MemoryUsage.hpp"       // 休眠会话的统计
+#include "Output.hpp"            // 游戏输出
+#include "Trace.hpp"             // 时间线跟踪
+#include <algorithm>             // max
+#include <mutex>                 // 互斥锁
+#include <random>                // 随机种子
+
+namespace hx {
+
+namespace {
+// 当前线程所属的调度器与工作线程编号（外部线程为空）
+thread_local const void* current_scheduler = nullptr;
+thread_local size_t current_worker = 0;
+
+std::int64_t nowTicks() {
+    return std::chrono::steady_clock::now().time_since_epoch().count();
+}
+}
+
+Session::~Session() {
+    if (hibernated()) addHibernatedSession(-1, -static_cast<std::int64_t>(blob_.size()));
+}
+
+SessionScheduler::SessionScheduler(size_t workers, size_t commands_per_slice)
+    : commands_per_slice_(commands_per_slice == 0 ? 1 : commands_per_slice) {
+    if (workers == 0) workers = 1;
+    for (size_t i = 0; i < workers; ++i) {
+        workers_.push_back(std::make_unique<Worker>());
+    }
+    // 所有就绪队列创建完毕后再启动线程，窃取时不会访问到未创建的队列
+    for (size_t i = 0; i < workers; ++i) {
+        workers_[i]->thread = std::thread([this, i]() { workerLoop(i); });
+    }
+}
+
+SessionScheduler::~SessionScheduler() {
+    stop();
+}
+
+void SessionScheduler::stop() {
+    if (stopping_.exchange(true)) return;
+    {
+        std::lock_guard<std::mutex> lock(idle_mutex_);
+    }
+    idle_cv_.notify_all();
+    {
+        std::lock_guard<std::mutex> lock(hibernate_mutex_);
+    }
+    hibernate_cv_.notify_all();
+    if (hibernator_.joinable()) hibernator_.join();
+    for (auto& worker : workers_) {
+        if (worker->thread.joinable()) worker->thread.join();
+    }
+}
+
+Session::Id SessionScheduler::open() {
+    return open(std::random_device{}());
+}
+
+Session::Id SessionScheduler::open(std::uint32_t seed) {
+    Session::Id id;
+    {
+        std::unique_lock<std::shared_mutex> lock(sessions_mutex_);
+        id = next_id_++;
+    }
+    // 建世界比较慢，放在锁外面
+    auto session = std::make_shared<Session>(id, seed);
+    session->game_->setCombatTurnBudget(combat_turns_per_slice_);
+    session->game_->setSaveSlot(&session->save_slot_);
+    session->last_active_.store(nowTicks(), std::memory_order_relaxed);
+    {
+        std::unique_lock<std::shared_mutex> lock(sessions_mutex_);
+        sessions_[id] = session;
+    }
+    // 开场剧情也在工作线程上执行，输出经回调送出
+    session->scheduled_.store(true, std::memory_order_release);
+    enqueue(session);
+    return id;
+}
+
+std::shared_ptr<Session> SessionScheduler::find(Session::Id id) const {
+    std::shared_lock<std::shared_mutex> lock(sessions_mutex_);
+    auto it = sessions_.find(id);
+    return it == sessions_.end() ? nullptr : it->second;
+}
+
+bool SessionScheduler::post(Session::Id id, std::string line) {
+    std::shared_ptr<Session> session = find(id);
+    if (!session || session->closed()) return false;
+    session->inbox_.push(std::move(line));
+    // 会话空闲时由投递者负责排队；已在排队或执行中则由执行者在结束时检查输入队列
+    if (!session->scheduled_.exchange(true, std::memory_order_acq_rel)) {
+        enqueue(std::move(session));
+    }
+    return true;
+}
+
+void SessionScheduler::close(Session::Id id) {
+    std::shared_ptr<Session> session;
+    {
+        std::unique_lock<std::shared_mutex> lock(sessions_mutex_);
+        auto it = sessions_.find(id);
+        if (it == sessions_.end()) return;
+        session = it->second;
+        sessions_.erase(it);
+    }
+    // 正在执行的会话由就绪队列中的shared_ptr保持存活，执行完这一段后自然释放
+    session->closed_.store(true, std::memory_order_release);
+}
+
+size_t SessionScheduler::sessionCount() const {
+    std::shared_lock<std::shared_mutex> lock(sessions_mutex_);
+    return sessions_.size();
+}
+
+void SessionScheduler::setHibernateAfter(std::chrono::milliseconds idle) {
+    hibernate_after_.store(idle.count(), std::memory_order_relaxed);
+    std::lock_guard<std::mutex> lock(hibernate_mutex_);
+    if (idle.count() > 0 && !hibernator_.joinable() && !stopping_.load(std::memory_order_acquire)) {
+        hibernator_ = std::thread([this]() { hibernateLoop(); });
+    }
+    hibernate_cv_.notify_all();
+}
+
+// 后台检查：每过四分之一个休眠时间扫一遍（至少10毫秒），会话最晚在空闲1.25倍休眠时间后休眠
+void SessionScheduler::hibernateLoop() {
+    std::unique_lock<std::mutex> lock(hibernate_mutex_);
+    while (!stopping_.load(std::memory_order_acquire)) {
+        std::int64_t after = hibernate_after_.load(std::memory_order_relaxed);
+        auto period = std::chrono::milliseconds(std::max<std::int64_t>(after / 4, 10));
+        hibernate_cv_.wait_for(lock, period);
+        if (stopping_.load(std::memory_order_acquire)) break;
+        after = hibernate_after_.load(std::memory_order_relaxed);
+        if (after <= 0) continue;
+        lock.unlock();
+        hibernateIdle(std::chrono::milliseconds(after));
+        lock.lock();
+    }
+}
+
+size_t SessionScheduler::hibernateIdle(std::chrono::milliseconds idle) {
+    std::vector<std::shared_ptr<Session>> candidates;
+    const std::int64_t cutoff = nowTicks() -
+        std::chrono::duration_cast<std::chrono::steady_clock::duration>(idle).count();
+    {
+        std::shared_lock<std::shared_mutex> lock(sessions_mutex_);
+        for (const auto& [id, session] : sessions_) {
+            if (!session->hibernated() && session->last_active_.load(std::memory_order_relaxed) <= cutoff) {
+                candidates.push_back(session);
+            }
+        }
+    }
+    size_t count = 0;
+    for (const auto& session : candidates) {
+        Session& s = *session;
+        // 和工作线程一样先取得执行权；会话正在排队或执行就说明它不空闲
+        if (s.scheduled_.exchange(true, std::memory_order_acq_rel)) continue;
+        if (!s.closed() && s.game_ && s.started_ && s.inbox_.empty() && s.game_->canHibernate()) {
+            std::string blob = s.game_->hibernate();
+            if (!blob.empty()) {
+                s.game_.reset();
+                s.blob_ = std::move(blob);
+                s.blob_.shrink_to_fit();
+                s.hibernated_.store(true, std::memory_order_release);
+                addHibernatedSession(1, static_cast<std::int64_t>(s.blob_.size()));
+                hibernations_.fetch_add(1, std::memory_order_relaxed);
+                ++count;
+            }
+        }
+        release(session, false);
+    }
+    return count;
+}
+
+// 恢复：用同一个种子新建Game，再读入休眠数据
+bool SessionScheduler::rehydrate(Session& s) {
+    HX_TRACE_SPAN("rehydrate");
+    auto game = std::make_unique<Game>(s.seed_);
+    game->setCombatTurnBudget(combat_turns_per_slice_);
+    game->setSaveSlot(&s.save_slot_);
+    if (!game->restore(s.blob_)) return false;
+    addHibernatedSession(-1, -static_cast<std::int64_t>(s.blob_.size()));
+    s.game_ = std::move(game);
+    s.blob_ = std::string();
+    s.hibernated_.store(false, std::memory_order_release);
+    rehydrations_.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+void SessionScheduler::enqueue(std::shared_ptr<Session> session) {
+    // 工作线程上产生的就绪会话放回自己的队列，外部投递的轮流分给各工作线程
+    size_t index = (current_scheduler == this)
+        ? current_worker
+        : next_worker_.fetch_add(1, std::memory_order_relaxed) % workers_.size();
+    {
+        std::lock_guard<std::mutex> lock(workers_[index]->mutex);
+        workers_[index]->ready.push_back(std::move(session));
+    }
+    pending_.fetch_add(1, std::memory_order_seq_cst);
+    if (sleepers_.load(std::memory_order_seq_cst) > 0) {
+        // 先拿一下锁，保证等待中的线程要么还没检查条件，要么已经在wait里
+        { std::lock_guard<std::mutex> lock(idle_mutex_); }
+        idle_cv_.notify_one();
+    }
+}
+
+std::shared_ptr<Session> SessionScheduler::takeLocal(size_t index) {
+    Worker& worker = *workers_[index];
+    std::lock_guard<std::mutex> lock(worker.mutex);
+    if (worker.ready.empty()) return nullptr;
+    std::shared_ptr<Session> session = std::move(worker.ready.front());
+    worker.ready.pop_front();
+    pending_.fetch_sub(1, std::memory_order_relaxed);
+    return session;
+}
+
+std::shared_ptr<Session> SessionScheduler::steal(size_t index) {
+    for (size_t offset = 1; offset < workers_.size(); ++offset) {
+        Worker& victim = *workers_[(index + offset) % workers_.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (victim.ready.empty()) continue;
+        std::shared_ptr<Session> session = std::move(victim.ready.back());
+        victim.ready.pop_back();
+        pending_.fetch_sub(1, std::memory_order_relaxed);
+        steals_.fetch_add(1, std::memory_order_relaxed);
+        return session;
+    }
+    return nullptr;
+}
+
+void SessionScheduler::workerLoop(size_t index) {
+    current_scheduler = this;
+    current_worker = index;
+    while (!stopping_.load(std::memory_order_acquire)) {
+        std::shared_ptr<Session> session = takeLocal(index);
+        if (!session) session = steal(index);
+        if (session) {
+            runSlice(session);
+            continue;
+        }
+
+        // 没有就绪会话：登记为等待者后再检查一次，避免错过刚刚到达的会话
+        std::unique_lock<std::mutex> lock(idle_mutex_);
+        sleepers_.fetch_add(1, std::memory_order_seq_cst);
+        idle_cv_.wait(lock, [this]() {
+            return stopping_.load(std::memory_order_acquire) || pending_.load(std::memory_order_seq_cst) > 0;
+        });
+        sleepers_.fetch_sub(1, std::memory_order_relaxed);
+    }
+    current_scheduler = nullptr;
+}
+
+void SessionScheduler::runSlice(const std::shared_ptr<Session>& session) {
+    Session& s = *session;
+    if (!s.closed() && !s.game_ && !rehydrate(s)) {
+        s.output_ << "会话恢复失败，请重新连接。\n";
+        s.closed_.store(true, std::memory_order_release);
+        if (output_handler_) output_handler_(s.id_, s.output_.str(), true);
+        s.output_.str(std::string());
+    }
+    if (!s.closed()) {
+        ConsoleScope scope(s.output_);
+        // 每段输出以下一次输入的提示语结尾，和终端版本看到的一致
+        if (!s.started_) {
+            s.game_->start();
+            s.started_ = true;
+            s.output_ << s.game_->prompt();
+        }
+        // 每行输入（批处理中的每条指令）算一个单位，单位数或时间预算用完就让出线程；
+        // 战斗每段只推进 combat_turns_per_slice_ 回合，打完一段就送出日志并让出线程，下一段重新排队
+        auto deadline = std::chrono::steady_clock::now() + slice_budget_;
+        size_t executed = 0;
+        size_t units = 0;
+        std::string line;
+        while (units < commands_per_slice_ && std::chrono::steady_clock::now() < deadline) {
+            ++units;
+            if (s.game_->busy()) {
+                if (!s.game_->resume()) {
+                    s.closed_.store(true, std::memory_order_release);
+                    break;
+                }
+            } else if (s.inbox_.pop(line)) {
+                ++executed;
+                if (!s.game_->handleLine(line)) {
+                    s.closed_.store(true, std::memory_order_release);
+                    break;
+                }
+            } else {
+                break;
+            }
+            if (s.game_->inCombat()) break;
+            s.output_ << s.game_->prompt();
+        }
+        commands_executed_.fetch_add(executed, std::memory_order_relaxed);
+
+        // 批处理的输出攒到全部执行完再一起送出
+        std::string text = s.game_->batching() ? std::string() : s.output_.str();
+        if (!text.empty()) {
+            s.output_.str(std::string());
+            if (output_handler_) output_handler_(s.id_, text, !s.game_->busy());
+        }
+    }
+
+    // 交还之后会话可能已被别的线程执行，所以战斗状态要在交还之前读取
+    bool unfinished = !s.closed() && s.game_->busy();
+    s.last_active_.store(nowTicks(), std::memory_order_relaxed);
+    release(session, unfinished);
+}
+
+// 交还执行权；战斗没打完或期间又有输入到达时由本线程重新排队
+void SessionScheduler::release(const std::shared_ptr<Session>& session, bool unfinished) {
+    Session& s = *session;
+    s.scheduled_.exchange(false, std::memory_order_acq_rel);
+    if (!s.closed() && (unfinished || !s.inbox_.empty()) &&
+        !s.scheduled_.exchange(true, std::memory_order_acq_rel)) {
+        enqueue(session);
+    }
+}
+
+} // namespace hx
@@ -4,6 +4,7 @@
 
 #include "ShopSystem.hpp"    // 商店系统头文件
 #include "ItemDefinitions.hpp"  // 物品定义头文件
+#include "MemoryUsage.hpp"      // 内存统计工具
 #include <iostream>            // 输入输出流
 #include <algorithm>           // 算法库
 #include <set>                 // 集合容器
@@ -55,11 +56,8 @@ void ShopSystem::initializeConsumablePool() {
     consumable_pool_.push_back({"caffeine_elixir", "咖啡因灵液", "获得专注：下一次攻击必中", 150, EquipmentQuality::UNDERGRAD, false, 0, 0});
 }
 
-bool ShopSystem::shouldRefresh(int turn_counter) const {
-    return turn_counter % 5 == 0;
-}
-
-void ShopSystem::refreshShop(std::vector<Item>& shop_items, int turn_counter) {
+void ShopSystem::refreshShop(std::vector<Item>& shop_items) {
+    refresh_due_ = false;
     shop_items.clear();
     
     // 1. 生命药水（固定，30金币）
@@ -157,4 +155,11 @@ Item ShopSystem::createItemFromId(const std::string& item_id) const {
     return ItemDefinitions::createItemById(item_id);
 }
 
+size_t ShopSystem::heapBytes() const {
+    auto entry = [](const ShopItemPool& p) {
+        return memory::bytes(p.id) + memory::bytes(p.name) + memory::bytes(p.description);
+    };
+    return memory::bytes(equipment_pool_, entry) + memory::bytes(consumable_pool_, entry);
+}
+
 } // namespace hx
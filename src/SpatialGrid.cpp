@@ -0,0 +1,28 @@
+// 这是空间索引的实现文件
+// 作者：大一学生
+// 功能：插入条目和按坐标精确查找
+
+#include "SpatialGrid.hpp"  // 空间索引头文件
+#include "MemoryUsage.hpp"  // 内存统计工具
+
+namespace hx {
+
+void SpatialGrid::insert(int layer, Coord pos, size_t item) {
+    buckets_[bucketKey(layer, cellOf(pos.x), cellOf(pos.y))].push_back({pos, item});
+    ++count_;
+}
+
+size_t SpatialGrid::at(int layer, Coord pos) const {
+    auto it = buckets_.find(bucketKey(layer, cellOf(pos.x), cellOf(pos.y)));
+    if (it == buckets_.end()) return npos;
+    for (const Entry& e : it->second) {
+        if (e.pos.x == pos.x && e.pos.y == pos.y) return e.item;
+    }
+    return npos;
+}
+
+size_t SpatialGrid::heapBytes() const {
+    return memory::tableBytes(buckets_, [](const auto& kv) { return memory::bytes(kv.second); });
+}
+
+} // namespace hx
@@ -0,0 +1,300 @@
+// 这是游戏状态哈希的实现文件
+// 作者：大一学生
+// 功能：4通道的64位哈希器，以及按块遍历GameState的各个部分
+//       无序容器（背包、好感、对话记忆、地点）里每个元素单独算哈希再相加，结果与遍历顺序无关
+
+#include "StateHash.hpp"  // 状态哈希头文件
+#include "GameState.hpp"  // 游戏状态
+#include <cstdio>         // snprintf
+#include <cstring>        // memcpy
+
+namespace hx {
+
+namespace {
+constexpr std::uint64_t kMul1 = 0x9E3779B97F4A7C15ull;
+constexpr std::uint64_t kMul2 = 0xC2B2AE3D27D4EB4Full;
+constexpr std::uint64_t kMul3 = 0x165667B19E3779F9ull;
+
+std::uint64_t rotl(std::uint64_t x, int r) { return (x << r) | (x >> (64 - r)); }
+
+// 最后的雪崩混合（MurmurHash3 的 fmix64）
+std::uint64_t fmix(std::uint64_t h) {
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDull;
+    h ^= h >> 33;
+    h *= 0xC4CEB9FE1A85EC53ull;
+    h ^= h >> 33;
+    return h;
+}
+
+// 按小端序读8个字节（各平台结果一致）
+std::uint64_t load64(const unsigned char* p) {
+    std::uint64_t w = 0;
+    for (int i = 7; i >= 0; --i) w = (w << 8) | p[i];
+    return w;
+}
+
+// 把一组元素哈希加起来（与顺序无关），最后连同个数写入哈希器
+struct UnorderedSum {
+    std::uint64_t sum{0};
+    std::uint64_t count{0};
+    void add(std::uint64_t element) {
+        sum += fmix(element);
+        ++count;
+    }
+    void writeTo(StateHasher& h) const {
+        h.add(sum);
+        h.add(count);
+    }
+};
+
+void hashAttributes(StateHasher& h, const Attributes& a) {
+    for (int v : {a.hp, a.max_hp, a.atk, a.def_, a.spd, a.available_points,
+                  a.total_hp_points, a.total_atk_points, a.total_def_points, a.total_spd_points}) {
+        h.add(v);
+    }
+    UnorderedSum statuses;
+    for (const auto& kv : a.active_statuses) {
+        StateHasher e;
+        e.add(static_cast<int>(kv.first));
+        e.add(kv.second.duration);
+        statuses.add(e.digest());
+    }
+    statuses.writeTo(h);
+}
+
+// 物品中会随游戏变化或影响结算的字段（描述文字由定义决定，不计入）
+void hashItem(StateHasher& h, const Item& item) {
+    h.add(item.id);
+    h.add(item.name);
+    h.add(item.count);
+    h.add(static_cast<int>(item.type));
+    h.add(static_cast<int>(item.equip_type));
+    h.add(static_cast<int>(item.equip_slot));
+    h.add(static_cast<int>(item.quality));
+    h.add(item.set_name);
+    for (int v : {item.hp_delta, item.atk_delta, item.def_delta, item.spd_delta, item.price,
+                  item.heal_amount, item.mp_restore, item.level_requirement, item.favor_requirement}) {
+        h.add(v);
+    }
+    h.add(item.effect_type);
+    h.add(item.effect_target);
+    h.add(static_cast<double>(item.effect_value));
+    h.add(item.is_quest_item);
+    h.add(item.is_tradeable);
+}
+} // namespace
+
+StateHasher::StateHasher(std::uint64_t seed)
+    : lanes_{seed ^ kMul1, seed ^ kMul2, seed ^ kMul3, seed + kMul1 + kMul2} {}
+
+void StateHasher::word(std::uint64_t w) {
+    std::uint64_t& lane = lanes_[next_lane_];
+    lane ^= w * kMul2;
+    lane = rotl(lane, 31) * kMul1;
+    next_lane_ = (next_lane_ + 1) & 3;
+}
+
+void StateHasher::add(std::uint64_t value) {
+    unsigned char bytes[8];
+    for (int i = 0; i < 8; ++i) bytes[i] = static_cast<unsigned char>(value >> (8 * i));
+    addBytes(bytes, 8);
+}
+
+void StateHasher::add(double value) {
+    if (value == 0.0) value = 0.0;  // -0.0 与 0.0 视为相同
+    std::uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    add(bits);
+}
+
+void StateHasher::add(std::string_view text) {
+    add(static_cast<std::uint64_t>(text.size()));
+    addBytes(text.data(), text.size());
+}
+
+void StateHasher::addBytes(const void* data, size_t size) {
+    const unsigned char* p = static_cast<const unsigned char*>(data);
+    length_ += size;
+    // 先补满上次剩下的不足8字节
+    while (tail_size_ > 0 && size > 0) {
+        tail_ |= static_cast<std::uint64_t>(*p++) << (8 * tail_size_);
+        --size;
+        if (++tail_size_ == 8) {
+            word(tail_);
+            tail_ = 0;
+            tail_size_ = 0;
+        }
+    }
+    // 整组8字节直接进通道
+    while (size >= 8) {
+        word(load64(p));
+        p += 8;
+        size -= 8;
+    }
+    while (size > 0) {
+        tail_ |= static_cast<std::uint64_t>(*p++) << (8 * tail_size_++);
+        --size;
+    }
+}
+
+std::uint64_t StateHasher::digest() const {
+    StateHasher copy(*this);
+    if (copy.tail_size_ > 0) copy.word(copy.tail_ ^ (static_cast<std::uint64_t>(copy.tail_size_) << 56));
+    std::uint64_t h = copy.length_ * kMul3;
+    for (std::uint64_t lane : copy.lanes_) {
+        h ^= fmix(lane);
+        h = rotl(h, 27) * kMul1 + kMul2;
+    }
+    return fmix(h);
+}
+
+StateDigest hashState(const GameState& state) {
+    StateDigest d;
+    const Player& player = state.player;
+
+    {
+        StateHasher h(1);
+        h.add(player.getName());
+        h.add(player.level());
+        h.add(player.xp());
+        h.add(player.coins());
+        h.add(player.getWenxinFailures());
+        hashAttributes(h, player.attr());
+        d.player = h.digest();
+    }
+    {
+        StateHasher h(2);
+        UnorderedSum items;
+        for (const Item& item : player.inventory()) {
+            StateHasher e;
+            hashItem(e, item);
+            items.add(e.digest());
+        }
+        items.writeTo(h);
+        d.inventory = h.digest();
+    }
+    {
+        StateHasher h(3);
+        for (EquipmentSlot slot : {EquipmentSlot::WEAPON, EquipmentSlot::ARMOR,
+                                   EquipmentSlot::ACCESSORY1, EquipmentSlot::ACCESSORY2}) {
+            const Item* item = player.equipment().getEquippedItem(slot);
+            h.add(item != nullptr);
+            if (item) hashItem(h, *item);
+        }
+        d.equipment = h.digest();
+    }
+    {
+        StateHasher h(4);
+        UnorderedSum favors;
+        for (const auto& kv : player.getAllFavors()) {
+            StateHasher e;
+            e.add(kv.first);
+            e.add(kv.second);
+            favors.add(e.digest());
+        }
+        favors.writeTo(h);
+        d.favors = h.digest();
+    }
+    {
+        StateHasher h(5);
+        const auto& tasks = state.task_manager.tasks();
+        const auto& progress = state.task_manager.progressTable();
+        for (size_t i = 0; i < tasks.size() && i < progress.size(); ++i) {
+            h.add(tasks[i].getId());
+            h.add(static_cast<int>(progress[i].status));
+            h.add(static_cast<std::uint64_t>(progress[i].objective_overrides.size()));
+            for (const auto& o : progress[i].objective_overrides) {
+                h.add(static_cast<int>(o.first));
+                h.add(o.second);
+            }
+        }
+        d.tasks = h.digest();
+    }
+    {
+        StateHasher h(6);
+        UnorderedSum npcs;
+        for (const auto& kv : state.dialogue_memory) {
+            UnorderedSum options;
+            for (const std::string& option : kv.second) {
+                StateHasher o;
+                o.add(option);
+                options.add(o.digest());
+            }
+            StateHasher e;
+            e.add(kv.first);
+            options.writeTo(e);
+            npcs.add(e.digest());
+        }
+        npcs.writeTo(h);
+        d.dialogue = h.digest();
+    }
+    {
+        StateHasher h(7);
+        h.add(static_cast<std::uint64_t>(state.monster_spawns.size()));
+        for (const auto& s : state.monster_spawns) {
+            h.add(s.location_id);
+            h.add(s.monster_name);
+            for (int v : {s.max_count, s.current_count, s.respawn_turns, s.recommended_level,
+                          s.challenge_count, s.max_challenges}) {
+                h.add(v);
+            }
+            h.add(s.respawn_turn);
+        }
+        d.spawns = h.digest();
+    }
+    {
+        StateHasher h(8);
+        h.add(state.current_loc);
+        for (bool b : {state.in_teaching_detail, state.key_i_obtained, state.key_ii_obtained,
+                       state.key_iii_obtained, state.truth_reward_given, state.wenxintan_intro_shown,
+                       state.chapter4_shown, state.s3_reward_given, state.s4_reward_given,
+                       state.math_difficulty_spirit_first_kill, state.shop_system.refreshDue()}) {
+            h.add(b);
+        }
+        for (int v : {state.wenxintan_fail_streak, state.failed_experiment_attack_count,
+                      state.failed_experiment_kill_count, state.shop_system.getRevivalScrollPurchases()}) {
+            h.add(v);
+        }
+        h.add(state.scheduler.now());
+        d.flags = h.digest();
+    }
+    {
+        StateHasher h(9);
+        UnorderedSum locations;
+        for (const auto& kv : state.map.locations()) {
+            if (Dungeon::floorOf(kv.first) > 0) continue; // 秘境的房间是按需生成的，哈希的是下面的改动记录
+            StateHasher e;
+            e.add(kv.first);
+            e.add(static_cast<std::uint64_t>(kv.second.shop.size()));
+            for (const Item& item : kv.second.shop) hashItem(e, item);
+            locations.add(e.digest());
+        }
+        locations.writeTo(h);
+        h.add(static_cast<std::uint64_t>(state.dungeon.seed()));
+        h.add(state.dungeon.deepest());
+        h.add(static_cast<std::uint64_t>(state.dungeon.cleared().size()));
+        for (const auto& kv : state.dungeon.cleared()) {
+            h.add(kv.first);
+            h.add(static_cast<std::uint64_t>(kv.second.size()));
+            for (int room : kv.second) h.add(room);
+        }
+        d.world = h.digest();
+    }
+
+    StateHasher total(10);
+    for (std::uint64_t part : {d.player, d.inventory, d.equipment, d.favors, d.tasks,
+                               d.dialogue, d.spawns, d.flags, d.world}) {
+        total.add(part);
+    }
+    d.total = total.digest();
+    return d;
+}
+
+std::string hashToHex(std::uint64_t hash) {
+    char buf[17];
+    std::snprintf(buf, sizeof(buf), "%016llx", static_cast<unsigned long long>(hash));
+    return buf;
+}
+
+} // namespace hx
@@ -4,45 +4,25 @@
 
 #include "Task.hpp"    // 任务类头文件
 #include "Player.hpp"  // 玩家类头文件
+#include "Output.hpp"  // 游戏输出
+#include "MemoryUsage.hpp" // 内存统计工具
 #include <sstream>     // 字符串流
 #include <algorithm>   // 算法库
 #include <iostream>    // 输入输出流
 
 namespace hx {
 
-// Task类实现 - 单个任务的管理
+// Task类实现 - 单个任务的静态定义
 Task::Task(const std::string& id, const std::string& name, const std::string& description,
            TaskType type, const std::vector<TaskReward>& rewards)
-    : id_(id), name_(name), description_(description), type_(type), status_(TaskStatus::NOT_STARTED), rewards_(rewards) {}
-
-void Task::start() {
-    if (status_ == TaskStatus::NOT_STARTED) {
-        status_ = TaskStatus::IN_PROGRESS;
-    }
-}
-
-void Task::complete() {
-    if (status_ == TaskStatus::IN_PROGRESS) {
-        status_ = TaskStatus::COMPLETED;
-    }
-}
-
-void Task::fail() {
-    if (status_ == TaskStatus::IN_PROGRESS) {
-        status_ = TaskStatus::FAILED;
-    }
-}
+    : id_(id), name_(name), description_(description), type_(type), rewards_(rewards) {}
 
 void Task::addObjective(const std::string& objective) {
     objectives_.push_back(objective);
 }
 
-void Task::setObjective(size_t index, const std::string& text) {
-    if (index < objectives_.size()) objectives_[index] = text;
-}
-
-std::string Task::getStatusString() const {
-    switch (status_) {
+const char* taskStatusString(TaskStatus status) {
+    switch (status) {
         case TaskStatus::NOT_STARTED: return "未接取";
         case TaskStatus::IN_PROGRESS: return "进行中";
         case TaskStatus::COMPLETED: return "已完成";
@@ -51,6 +31,16 @@ std::string Task::getStatusString() const {
     }
 }
 
+const char* taskStatusIcon(TaskStatus status) {
+    switch (status) {
+        case TaskStatus::NOT_STARTED: return "○";
+        case TaskStatus::IN_PROGRESS: return "●";
+        case TaskStatus::COMPLETED: return "✓";
+        case TaskStatus::FAILED: return "✗";
+        default: return "";
+    }
+}
+
 std::string Task::getTypeString() const {
     switch (type_) {
         case TaskType::MAIN: return "主线";
@@ -60,27 +50,24 @@ std::string Task::getTypeString() const {
     }
 }
 
-std::string Task::getFullInfo() const {
+std::string Task::getFullInfo(const TaskProgress& progress) const {
     std::ostringstream oss;
     
     // 任务标题
-    std::string status_icon = "";
-    switch (status_) {
-        case TaskStatus::NOT_STARTED: status_icon = "○"; break;
-        case TaskStatus::IN_PROGRESS: status_icon = "●"; break;
-        case TaskStatus::COMPLETED: status_icon = "✓"; break;
-        case TaskStatus::FAILED: status_icon = "✗"; break;
-    }
-    
-    oss << "【" << getTypeString() << "任务】" << status_icon << " " << name_ << "\n";
+    oss << "【" << getTypeString() << "任务】" << taskStatusIcon(progress.status) << " " << name_ << "\n";
     oss << "━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━\n";
-    oss << "状态: " << getStatusString() << "\n";
+    oss << "状态: " << taskStatusString(progress.status) << "\n";
     oss << "描述: " << description_ << "\n\n";
     
     if (!objectives_.empty()) {
         oss << "📋 任务目标:\n";
         for (size_t i = 0; i < objectives_.size(); ++i) {
-            oss << "   " << (i + 1) << ". " << objectives_[i] << "\n";
+            // 被改写过的目标优先显示当前进度文本
+            const std::string* text = &objectives_[i];
+            for (const auto& [index, override_text] : progress.objective_overrides) {
+                if (index == i) text = &override_text;
+            }
+            oss << "   " << (i + 1) << ". " << *text << "\n";
         }
         oss << "\n";
     }
@@ -111,224 +98,177 @@ std::string Task::getFullInfo() const {
 TaskManager::TaskManager() = default;
 
 void TaskManager::addTask(const Task& task) {
+    auto it = index_.find(task.getId());
+    if (it != index_.end()) {
+        // 重复定义时覆盖旧定义并重置进度
+        tasks_[it->second] = task;
+        progress_[it->second] = TaskProgress{};
+        return;
+    }
+    index_[task.getId()] = tasks_.size();
     tasks_.push_back(task);
-}
-
-Task* TaskManager::getTask(const std::string& task_id) {
-    auto it = std::find_if(tasks_.begin(), tasks_.end(),
-        [&task_id](const Task& task) { return task.getId() == task_id; });
-    return it != tasks_.end() ? &(*it) : nullptr;
+    progress_.emplace_back();
 }
 
 const Task* TaskManager::getTask(const std::string& task_id) const {
-    auto it = std::find_if(tasks_.begin(), tasks_.end(),
-        [&task_id](const Task& task) { return task.getId() == task_id; });
-    return it != tasks_.end() ? &(*it) : nullptr;
+    auto it = index_.find(task_id);
+    return it != index_.end() ? &tasks_[it->second] : nullptr;
 }
 
-void TaskManager::startTask(const std::string& task_id) {
-    Task* task = getTask(task_id);
-    if (task) {
-        task->start();
-    }
+TaskProgress* TaskManager::findProgress(const std::string& task_id) {
+    auto it = index_.find(task_id);
+    return it != index_.end() ? &progress_[it->second] : nullptr;
 }
 
-void TaskManager::completeTask(const std::string& task_id) {
-    Task* task = getTask(task_id);
-    if (task) {
-        task->complete();
-        std::cout << "\033[31m【任务完成】" << task->getName() << " 已完成！\033[0m\n";
-    }
+const TaskProgress* TaskManager::findProgress(const std::string& task_id) const {
+    auto it = index_.find(task_id);
+    return it != index_.end() ? &progress_[it->second] : nullptr;
 }
 
-void TaskManager::failTask(const std::string& task_id) {
-    Task* task = getTask(task_id);
-    if (task) {
-        task->fail();
-    }
+TaskStatus TaskManager::getStatus(const std::string& task_id) const {
+    const TaskProgress* progress = findProgress(task_id);
+    return progress ? progress->status : TaskStatus::NOT_STARTED;
 }
 
-std::vector<Task*> TaskManager::getActiveTasks() {
-    std::vector<Task*> active;
-    for (auto& task : tasks_) {
-        if (task.getStatus() == TaskStatus::IN_PROGRESS) {
-            active.push_back(&task);
-        }
+void TaskManager::startTask(const std::string& task_id) {
+    TaskProgress* progress = findProgress(task_id);
+    if (progress && progress->status == TaskStatus::NOT_STARTED) {
+        progress->status = TaskStatus::IN_PROGRESS;
     }
-    return active;
 }
 
-std::vector<Task*> TaskManager::getCompletedTasks() {
-    std::vector<Task*> completed;
-    for (auto& task : tasks_) {
-        if (task.getStatus() == TaskStatus::COMPLETED) {
-            completed.push_back(&task);
-        }
+void TaskManager::completeTask(const std::string& task_id, bool announce) {
+    auto it = index_.find(task_id);
+    if (it == index_.end()) return;
+    TaskProgress& progress = progress_[it->second];
+    if (progress.status == TaskStatus::IN_PROGRESS) {
+        progress.status = TaskStatus::COMPLETED;
+    }
+    if (announce) {
+        console() << "\033[31m【任务完成】" << tasks_[it->second].getName() << " 已完成！\033[0m\n";
     }
-    return completed;
 }
 
-std::vector<Task*> TaskManager::getTasksByType(TaskType type) {
-    std::vector<Task*> filtered;
-    for (auto& task : tasks_) {
-        if (task.getType() == type) {
-            filtered.push_back(&task);
-        }
+void TaskManager::failTask(const std::string& task_id) {
+    TaskProgress* progress = findProgress(task_id);
+    if (progress && progress->status == TaskStatus::IN_PROGRESS) {
+        progress->status = TaskStatus::FAILED;
     }
-    return filtered;
 }
 
-std::vector<Task*> TaskManager::getAllTasks() {
-    std::vector<Task*> all;
-    for (auto& task : tasks_) {
-        all.push_back(&task);
+void TaskManager::setObjective(const std::string& task_id, size_t index, const std::string& text) {
+    auto it = index_.find(task_id);
+    if (it == index_.end() || index >= tasks_[it->second].getObjectives().size()) return;
+    auto& overrides = progress_[it->second].objective_overrides;
+    for (auto& entry : overrides) {
+        if (entry.first == index) {
+            entry.second = text;
+            return;
+        }
     }
-    return all;
+    overrides.emplace_back(static_cast<std::uint8_t>(index), text);
 }
 
 bool TaskManager::hasActiveTask(const std::string& task_id) const {
-    const Task* task = getTask(task_id);
-    return task && task->getStatus() == TaskStatus::IN_PROGRESS;
+    return getStatus(task_id) == TaskStatus::IN_PROGRESS;
 }
 
 bool TaskManager::hasCompletedTask(const std::string& task_id) const {
-    const Task* task = getTask(task_id);
-    return task && task->getStatus() == TaskStatus::COMPLETED;
+    return getStatus(task_id) == TaskStatus::COMPLETED;
 }
 
 int TaskManager::getCompletedTaskCount() const {
     int count = 0;
-    for (const auto& task : tasks_) {
-        if (task.getStatus() == TaskStatus::COMPLETED) {
+    for (const auto& progress : progress_) {
+        if (progress.status == TaskStatus::COMPLETED) {
             count++;
         }
     }
     return count;
 }
 
-void TaskManager::showTaskList() const {
-    std::cout << "\n=== 任务列表 ===\n";
-    
-    // 主线任务
-    std::cout << "\n【主线任务】\n";
-    bool has_main = false;
-    for (const auto& task : tasks_) {
-        if (task.getType() == TaskType::MAIN) {
-            std::string status_icon = "";
-            switch (task.getStatus()) {
-                case TaskStatus::NOT_STARTED: status_icon = "○"; break;
-                case TaskStatus::IN_PROGRESS: status_icon = "●"; break;
-                case TaskStatus::COMPLETED: status_icon = "✓"; break;
-                case TaskStatus::FAILED: status_icon = "✗"; break;
-            }
-            std::cout << "  " << status_icon << " " << task.getName() << " [" << task.getStatusString() << "]\n";
-            has_main = true;
+// 按主线/支线分组打印任务
+void TaskManager::printTaskSections() const {
+    const std::pair<TaskType, const char*> sections[] = {
+        {TaskType::MAIN, "主线"},
+        {TaskType::SIDE, "支线"}
+    };
+    for (const auto& [type, label] : sections) {
+        console() << "\n【" << label << "任务】\n";
+        bool has_any = false;
+        for (size_t i = 0; i < tasks_.size(); ++i) {
+            if (tasks_[i].getType() != type) continue;
+            TaskStatus status = progress_[i].status;
+            console() << "  " << taskStatusIcon(status) << " " << tasks_[i].getName()
+                      << " [" << taskStatusString(status) << "]\n";
+            has_any = true;
         }
-    }
-    if (!has_main) {
-        std::cout << "  暂无主线任务\n";
-    }
-    
-    // 支线任务
-    std::cout << "\n【支线任务】\n";
-    bool has_side = false;
-    for (const auto& task : tasks_) {
-        if (task.getType() == TaskType::SIDE) {
-            std::string status_icon = "";
-            switch (task.getStatus()) {
-                case TaskStatus::NOT_STARTED: status_icon = "○"; break;
-                case TaskStatus::IN_PROGRESS: status_icon = "●"; break;
-                case TaskStatus::COMPLETED: status_icon = "✓"; break;
-                case TaskStatus::FAILED: status_icon = "✗"; break;
-            }
-            std::cout << "  " << status_icon << " " << task.getName() << " [" << task.getStatusString() << "]\n";
-            has_side = true;
+        if (!has_any) {
+            console() << "  暂无" << label << "任务\n";
         }
     }
-    if (!has_side) {
-        std::cout << "  暂无支线任务\n";
-    }
     
-    std::cout << "\n使用 'task <任务名>' 查看详细信息\n";
-    std::cout << "状态说明: ○未接取 ●进行中 ✓已完成 ✗失败\n";
+    console() << "\n使用 'task <任务名>' 查看详细信息\n";
+    console() << "状态说明: ○未接取 ●进行中 ✓已完成 ✗失败\n";
+}
+
+void TaskManager::showTaskList() const {
+    console() << "\n=== 任务列表 ===\n";
+    printTaskSections();
 }
 
 void TaskManager::showTaskList(const Player& player) const {
-    std::cout << "\n=== 任务列表 ===\n";
+    console() << "\n=== 任务列表 ===\n";
     
     // 显示林清漪好感度
     int favor = player.getNPCFavor("林清漪");
-    std::cout << "❤️  林清漪好感度: " << favor << "\n";
-    std::cout << std::string(20, '-') << "\n";
+    console() << "❤️  林清漪好感度: " << favor << "\n";
+    console() << std::string(20, '-') << "\n";
     
-    // 主线任务
-    std::cout << "\n【主线任务】\n";
-    bool has_main = false;
-    for (const auto& task : tasks_) {
-        if (task.getType() == TaskType::MAIN) {
-            std::string status_icon = "";
-            switch (task.getStatus()) {
-                case TaskStatus::NOT_STARTED: status_icon = "○"; break;
-                case TaskStatus::IN_PROGRESS: status_icon = "●"; break;
-                case TaskStatus::COMPLETED: status_icon = "✓"; break;
-                case TaskStatus::FAILED: status_icon = "✗"; break;
-            }
-            std::cout << "  " << status_icon << " " << task.getName() << " [" << task.getStatusString() << "]\n";
-            has_main = true;
-        }
-    }
-    if (!has_main) {
-        std::cout << "  暂无主线任务\n";
-    }
-    
-    // 支线任务
-    std::cout << "\n【支线任务】\n";
-    bool has_side = false;
-    for (const auto& task : tasks_) {
-        if (task.getType() == TaskType::SIDE) {
-            std::string status_icon = "";
-            switch (task.getStatus()) {
-                case TaskStatus::NOT_STARTED: status_icon = "○"; break;
-                case TaskStatus::IN_PROGRESS: status_icon = "●"; break;
-                case TaskStatus::COMPLETED: status_icon = "✓"; break;
-                case TaskStatus::FAILED: status_icon = "✗"; break;
-            }
-            std::cout << "  " << status_icon << " " << task.getName() << " [" << task.getStatusString() << "]\n";
-            has_side = true;
-        }
-    }
-    if (!has_side) {
-        std::cout << "  暂无支线任务\n";
-    }
-    
-    std::cout << "\n使用 'task <任务名>' 查看详细信息\n";
-    std::cout << "状态说明: ○未接取 ●进行中 ✓已完成 ✗失败\n";
+    printTaskSections();
 }
 
 void TaskManager::showTaskDetails(const std::string& task_identifier) const {
     // 首先尝试按ID查找
-    const Task* task = getTask(task_identifier);
-    
-    // 如果按ID没找到，尝试按名称查找
-    if (!task) {
+    auto idx_it = index_.find(task_identifier);
+    size_t idx = tasks_.size();
+    if (idx_it != index_.end()) {
+        idx = idx_it->second;
+    } else {
+        // 如果按ID没找到，尝试按名称查找
         auto it = std::find_if(tasks_.begin(), tasks_.end(),
             [&task_identifier](const Task& t) { return t.getName() == task_identifier; });
-        task = it != tasks_.end() ? &(*it) : nullptr;
+        idx = static_cast<size_t>(it - tasks_.begin());
     }
     
-    if (task) {
-        std::cout << "\n" << task->getFullInfo() << "\n";
+    if (idx < tasks_.size()) {
+        console() << "\n" << tasks_[idx].getFullInfo(progress_[idx]) << "\n";
     } else {
-        std::cout << "未找到任务: " << task_identifier << "\n";
+        console() << "未找到任务: " << task_identifier << "\n";
     }
 }
 
-std::vector<Task> TaskManager::getAllTasksData() const {
-    return tasks_;
+bool TaskManager::restoreProgress(const std::string& task_id, const TaskProgress& progress) {
+    TaskProgress* slot = findProgress(task_id);
+    if (!slot) return false; // 存档中的任务已不存在，忽略
+    *slot = progress;
+    return true;
 }
 
-void TaskManager::setAllTasksData(const std::vector<Task>& tasks) {
-    tasks_ = tasks;
+size_t TaskManager::heapBytes() const {
+    auto str = [](const std::string& s) { return memory::bytes(s); };
+    size_t n = memory::bytes(tasks_, [&](const Task& t) {
+        return memory::bytes(t.getId()) + memory::bytes(t.getName()) + memory::bytes(t.getDescription())
+             + memory::bytes(t.getRewards(), [](const TaskReward& r) {
+                   return memory::bytes(r.item_id) + memory::bytes(r.item_name) + memory::bytes(r.description);
+               })
+             + memory::bytes(t.getObjectives(), str);
+    });
+    n += memory::bytes(progress_, [](const TaskProgress& p) {
+        return memory::bytes(p.objective_overrides, [](const auto& o) { return memory::bytes(o.second); });
+    });
+    n += memory::tableBytes(index_, [](const auto& kv) { return memory::bytes(kv.first); });
+    return n;
 }
 
 } // namespace hx
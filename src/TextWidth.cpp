@@ -0,0 +1,96 @@
+// 这是终端显示宽度的实现文件
+// 作者：大一学生
+// 功能：码点宽度表（Unicode East Asian Width 的宽字符和全角字符区间）与UTF-8解码
+
+#include "TextWidth.hpp"  // 终端显示宽度头文件
+#include <algorithm>      // upper_bound
+#include <iterator>       // begin/end
+
+namespace hx {
+
+namespace {
+
+struct Range {
+    std::uint32_t first;
+    std::uint32_t last;
+};
+
+// 占两列的区间（按起点排序）：谚文、中日韩文字和符号、全角形式、常用表情
+constexpr Range kWide[] = {
+    {0x1100, 0x115F}, {0x231A, 0x231B}, {0x2329, 0x232A}, {0x23E9, 0x23EC}, {0x23F0, 0x23F0},
+    {0x23F3, 0x23F3}, {0x25FD, 0x25FE}, {0x2614, 0x2615}, {0x2648, 0x2653}, {0x267F, 0x267F},
+    {0x2693, 0x2693}, {0x26A1, 0x26A1}, {0x26AA, 0x26AB}, {0x26BD, 0x26BE}, {0x26C4, 0x26C5},
+    {0x26CE, 0x26CE}, {0x26D4, 0x26D4}, {0x26EA, 0x26EA}, {0x26F2, 0x26F3}, {0x26F5, 0x26F5},
+    {0x26FA, 0x26FA}, {0x26FD, 0x26FD}, {0x2705, 0x2705}, {0x270A, 0x270B}, {0x2728, 0x2728},
+    {0x274C, 0x274C}, {0x274E, 0x274E}, {0x2753, 0x2755}, {0x2757, 0x2757}, {0x2795, 0x2797},
+    {0x27B0, 0x27B0}, {0x27BF, 0x27BF}, {0x2B1B, 0x2B1C}, {0x2B50, 0x2B50}, {0x2B55, 0x2B55},
+    {0x2E80, 0x303E}, {0x3041, 0x33FF}, {0x3400, 0x4DBF}, {0x4E00, 0x9FFF}, {0xA000, 0xA4CF},
+    {0xA960, 0xA97F}, {0xAC00, 0xD7A3}, {0xF900, 0xFAFF}, {0xFE10, 0xFE19}, {0xFE30, 0xFE6F},
+    {0xFF00, 0xFF60}, {0xFFE0, 0xFFE6}, {0x1F300, 0x1F64F}, {0x1F680, 0x1F6FF}, {0x1F900, 0x1F9FF},
+    {0x20000, 0x2FFFD}, {0x30000, 0x3FFFD},
+};
+
+// 不占列的区间：组合附加符号、零宽字符、变体选择符
+constexpr Range kZero[] = {
+    {0x0300, 0x036F}, {0x200B, 0x200F}, {0x20D0, 0x20FF}, {0xFE00, 0xFE0F}, {0xFE20, 0xFE2F},
+};
+
+template <size_t N>
+bool inRanges(const Range (&table)[N], std::uint32_t cp) {
+    const Range* it = std::upper_bound(std::begin(table), std::end(table), cp,
+                                       [](std::uint32_t v, const Range& r) { return v < r.first; });
+    return it != std::begin(table) && cp <= (it - 1)->last;
+}
+
+} // namespace
+
+int codepointWidth(std::uint32_t cp) {
+    if (cp < 0x20 || (cp >= 0x7F && cp < 0xA0)) return 0;  // 控制字符
+    if (cp < 0x300) return 1;                              // 拉丁字母等，最常见的情况直接返回
+    if (inRanges(kZero, cp)) return 0;
+    return inRanges(kWide, cp) ? 2 : 1;
+}
+
+int displayWidth(std::string_view text) {
+    int width = 0;
+    size_t i = 0;
+    while (i < text.size()) {
+        unsigned char c = static_cast<unsigned char>(text[i]);
+        // ANSI控制序列 ESC [ ... 字母：颜色等，不占列
+        if (c == 0x1B && i + 1 < text.size() && text[i + 1] == '[') {
+            i += 2;
+            while (i < text.size() && !(text[i] >= '@' && text[i] <= '~')) ++i;
+            ++i;
+            continue;
+        }
+        size_t len = c < 0x80 ? 1 : (c >> 5) == 0x6 ? 2 : (c >> 4) == 0xE ? 3 : (c >> 3) == 0x1E ? 4 : 0;
+        std::uint32_t cp = c;
+        if (len > 1 && i + len <= text.size()) {
+            cp = c & (0x7Fu >> len);
+            for (size_t k = 1; k < len; ++k) {
+                unsigned char cc = static_cast<unsigned char>(text[i + k]);
+                if ((cc & 0xC0) != 0x80) { len = 0; break; }
+                cp = (cp << 6) | (cc & 0x3Fu);
+            }
+        } else if (len != 1) {
+            len = 0;
+        }
+        if (len == 0) {
+            width += 1;  // 不合法的字节
+            i += 1;
+            continue;
+        }
+        width += codepointWidth(cp);
+        i += len;
+    }
+    return width;
+}
+
+std::string padRight(std::string_view text, int width) {
+    std::string out(text);
+    int w = displayWidth(text);
+    if (w < width) out.append(static_cast<size_t>(width - w), ' ');
+    return out;
+}
+
+} // namespace hx
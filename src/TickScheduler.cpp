@@ -0,0 +1,159 @@
+// 这是回合调度器的实现文件
+// 作者：大一学生
+// 功能：实现分层时间轮。第0层每个槽对应1个回合，第k层每个槽对应64^k个回合；
+//       高层的槽在低层转满一圈时"下沉"到更低层，到期任务只在第0层执行
+
+#include "TickScheduler.hpp"  // 回合调度器头文件
+#include "Metrics.hpp"        // 运行指标
+#include "MemoryUsage.hpp"    // 内存统计工具
+#include <utility>            // std::move, std::swap
+
+namespace hx {
+
+void TickScheduler::reset(std::uint64_t now) {
+    now_ = now;
+    active_count_ = 0;
+    timers_.clear();
+    free_.clear();
+    for (auto& level : wheel_) {
+        for (auto& slot : level) slot.clear();
+    }
+    overflow_.clear();
+}
+
+const TickScheduler::Timer* TickScheduler::find(TimerId id) const {
+    std::uint64_t index = (id & 0xffffffffull);
+    if (index == 0 || index > timers_.size()) return nullptr;
+    const Timer& timer = timers_[index - 1];
+    if (!timer.active || timer.generation != static_cast<std::uint32_t>(id >> 32)) return nullptr;
+    return &timer;
+}
+
+std::uint32_t TickScheduler::allocate() {
+    if (!free_.empty()) {
+        std::uint32_t index = free_.back();
+        free_.pop_back();
+        return index;
+    }
+    timers_.emplace_back();
+    return static_cast<std::uint32_t>(timers_.size() - 1);
+}
+
+void TickScheduler::release(std::uint32_t index) {
+    Timer& timer = timers_[index];
+    timer.active = false;
+    timer.generation++;
+    timer.callback = nullptr;
+    free_.push_back(index);
+    active_count_--;
+}
+
+// 按到期回合与当前回合的差异放入合适的层：两者在第k层以上的高位相同，就放在第k层
+void TickScheduler::place(TimerId id) {
+    const Timer& timer = timers_[(id & 0xffffffffull) - 1];
+    for (int level = 0; level < kLevels; ++level) {
+        int shift = kSlotBits * (level + 1);
+        if ((timer.due >> shift) == (now_ >> shift)) {
+            std::uint64_t slot = (timer.due >> (kSlotBits * level)) & (kSlots - 1);
+            wheel_[static_cast<size_t>(level)][slot].push_back(id);
+            return;
+        }
+    }
+    overflow_.push_back(id);
+}
+
+TickScheduler::TimerId TickScheduler::schedule(std::uint64_t delay, Callback callback) {
+    if (delay == 0) delay = 1;
+    std::uint32_t index = allocate();
+    Timer& timer = timers_[index];
+    timer.due = now_ + delay;
+    timer.interval = 0;
+    timer.active = true;
+    timer.callback = std::move(callback);
+    active_count_++;
+    TimerId id = makeId(index, timer.generation);
+    place(id);
+    return id;
+}
+
+TickScheduler::TimerId TickScheduler::scheduleEvery(std::uint64_t interval, Callback callback, std::uint64_t first_delay) {
+    if (interval == 0) interval = 1;
+    TimerId id = schedule(first_delay == 0 ? interval : first_delay, std::move(callback));
+    timers_[(id & 0xffffffffull) - 1].interval = interval;
+    return id;
+}
+
+bool TickScheduler::cancel(TimerId id) {
+    if (!find(id)) return false;
+    // 槽中残留的旧ID会因代数不匹配而被跳过
+    release(static_cast<std::uint32_t>((id & 0xffffffffull) - 1));
+    return true;
+}
+
+std::uint64_t TickScheduler::remaining(TimerId id) const {
+    const Timer* timer = find(id);
+    return timer ? timer->due - now_ : 0;
+}
+
+void TickScheduler::advance(std::uint64_t ticks) {
+    MetricTimer timer(Metric::WORLD_TICK);
+    for (std::uint64_t i = 0; i < ticks; ++i) {
+        tick();
+    }
+}
+
+void TickScheduler::tick() {
+    ++now_;
+
+    // 低层转满一圈时，把高层当前槽里的任务重新分配到更低的层
+    for (int level = 1; level < kLevels; ++level) {
+        if ((now_ & ((1ull << (kSlotBits * level)) - 1)) != 0) break;
+        std::uint64_t slot = (now_ >> (kSlotBits * level)) & (kSlots - 1);
+        std::vector<TimerId> moving;
+        std::swap(moving, wheel_[static_cast<size_t>(level)][slot]);
+        for (TimerId id : moving) {
+            if (find(id)) place(id);
+        }
+        if (level == kLevels - 1 && slot == 0) {
+            std::vector<TimerId> far;
+            std::swap(far, overflow_);
+            for (TimerId id : far) {
+                if (find(id)) place(id);
+            }
+        }
+    }
+
+    // 执行第0层当前槽中的到期任务
+    std::vector<TimerId> due;
+    std::swap(due, wheel_[0][now_ & (kSlots - 1)]);
+    for (TimerId id : due) {
+        if (!find(id)) continue;  // 已取消
+        std::uint32_t index = static_cast<std::uint32_t>((id & 0xffffffffull) - 1);
+        // 回调中可能新增任务导致timers_扩容，先把回调取出来再执行
+        Callback callback = std::move(timers_[index].callback);
+        std::uint64_t interval = timers_[index].interval;
+        if (interval == 0) {
+            release(index);
+            callback();
+            continue;
+        }
+        callback();
+        // 周期任务：回调中没有取消自己，就放回时间轮
+        if (find(id)) {
+            Timer& timer = timers_[index];
+            timer.callback = std::move(callback);
+            timer.due = now_ + interval;
+            place(id);
+        }
+    }
+}
+
+size_t TickScheduler::heapBytes() const {
+    size_t n = memory::bytes(timers_) + memory::bytes(free_) + memory::bytes(overflow_);
+    for (const auto& level : wheel_) {
+        for (const auto& slot : level) n += memory::bytes(slot);
+    }
+    return n;
+}
+
+} // namespace hx
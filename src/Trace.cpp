@@ -0,0 +1,193 @@
+// 这是时间线跟踪的实现文件
+// 作者：大一学生
+// 功能：每线程一个环形缓冲区（只有所属线程写，写完用原子变量发布位置），
+//       导出时把各线程的缓冲区拷出来、把时间戳换算成微秒，写成 Chrome trace event JSON
+
+#include "Trace.hpp"    // 时间线跟踪头文件
+#include <algorithm>    // min
+#include <cstdio>       // snprintf/rename/remove
+#include <fstream>      // 文件输出
+#include <memory>       // 智能指针
+#include <mutex>        // 注册表的锁
+#include <vector>       // 向量容器
+
+namespace hx {
+
+namespace {
+
+struct TraceEvent {
+    const char* name;
+    std::uint64_t start;
+    std::uint64_t end;
+    std::uint8_t detail_size;
+    char detail[trace_detail::kDetailBytes];
+};
+
+constexpr std::uint64_t kCapacity = 1u << 15;  // 每个线程保留最近的 32768 个跟踪点
+
+struct ThreadBuffer {
+    std::atomic<std::uint64_t> head{0};  // 已写入的总个数
+    std::uint32_t tid{0};
+    TraceEvent events[kCapacity];
+};
+
+struct Registry {
+    std::mutex mutex;
+    std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+    // 打开跟踪时的时间原点：时间戳计数器读数和对应的 steady_clock 纳秒
+    std::uint64_t origin_ticks{0};
+    std::int64_t origin_ns{0};
+};
+
+Registry& registry() {
+    static Registry* instance = new Registry(); // 故意不释放：线程可能在静态对象析构之后才退出
+    return *instance;
+}
+
+std::int64_t steadyNanos() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+ThreadBuffer& localBuffer() {
+    thread_local ThreadBuffer* buffer = nullptr;
+    if (!buffer) {
+        auto created = std::make_unique<ThreadBuffer>();
+        buffer = created.get();
+        Registry& reg = registry();
+        std::lock_guard<std::mutex> lock(reg.mutex);
+        created->tid = static_cast<std::uint32_t>(reg.buffers.size() + 1);
+        reg.buffers.push_back(std::move(created));
+    }
+    return *buffer;
+}
+
+void writeJsonString(std::ostream& out, const char* text, size_t size) {
+    out << '"';
+    for (size_t i = 0; i < size; ++i) {
+        char c = text[i];
+        if (c == '"' || c == '\\') out << '\\' << c;
+        else if (static_cast<unsigned char>(c) < 0x20) {
+            char escaped[8];
+            std::snprintf(escaped, sizeof(escaped), "\\u%04x", static_cast<unsigned>(c));
+            out << escaped;
+        } else out << c;
+    }
+    out << '"';
+}
+
+} // namespace
+
+void trace_detail::record(const char* name, std::uint64_t start, std::uint64_t end, std::string_view detail) noexcept {
+    ThreadBuffer& buffer = localBuffer();
+    std::uint64_t h = buffer.head.load(std::memory_order_relaxed);
+    TraceEvent& e = buffer.events[h & (kCapacity - 1)];
+    e.name = name;
+    e.start = start;
+    e.end = end;
+    e.detail_size = static_cast<std::uint8_t>(detail.size());
+    if (!detail.empty()) std::memcpy(e.detail, detail.data(), detail.size());
+    buffer.head.store(h + 1, std::memory_order_release);
+}
+
+bool tracingCompiled() {
+#ifdef HX_TRACING
+    return true;
+#else
+    return false;
+#endif
+}
+
+void setTracing(bool on) {
+    if (on) {
+        // 不去清空各线程的缓冲区（那是别的线程在写），只记下新的时间原点，导出时忽略更早的跟踪点
+        Registry& reg = registry();
+        std::lock_guard<std::mutex> lock(reg.mutex);
+        reg.origin_ns = steadyNanos();
+        reg.origin_ticks = trace_detail::now();
+    }
+    trace_detail::enabled.store(on, std::memory_order_relaxed);
+}
+
+namespace {
+
+// 拷出一个线程缓冲区里还有效的跟踪点（写入方可能同时在覆盖最旧的那些）
+std::vector<TraceEvent> copyEvents(const ThreadBuffer& buffer, std::uint64_t origin) {
+    std::uint64_t h1 = buffer.head.load(std::memory_order_acquire);
+    std::uint64_t first = h1 > kCapacity ? h1 - kCapacity : 0;
+    std::vector<TraceEvent> events;
+    events.reserve(static_cast<size_t>(h1 - first));
+    for (std::uint64_t i = first; i < h1; ++i) events.push_back(buffer.events[i & (kCapacity - 1)]);
+    // 拷贝期间被覆盖的位置作废：写入方正在写第 h2 个，它占用的是第 h2-kCapacity 个的位置
+    std::uint64_t h2 = buffer.head.load(std::memory_order_acquire);
+    std::uint64_t valid_from = h2 >= kCapacity ? h2 - kCapacity + 1 : 0;
+    size_t skip = valid_from > first ? static_cast<size_t>(std::min(valid_from - first, h1 - first)) : 0;
+    events.erase(events.begin(), events.begin() + static_cast<std::ptrdiff_t>(skip));
+    events.erase(std::remove_if(events.begin(), events.end(),
+                                [origin](const TraceEvent& e) { return e.start < origin; }),
+                 events.end());
+    return events;
+}
+
+} // namespace
+
+size_t traceEventCount() {
+    Registry& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    size_t total = 0;
+    for (const auto& buffer : reg.buffers) total += copyEvents(*buffer, reg.origin_ticks).size();
+    return total;
+}
+
+void writeChromeTrace(std::ostream& out) {
+    Registry& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+
+    // 时间戳换算：两次读数之间的计数器增量对应的纳秒数（不用计数器的平台上比例为1）
+    double ns_per_tick = 1.0;
+#ifdef HX_TRACE_RDTSC
+    std::uint64_t ticks = trace_detail::now() - reg.origin_ticks;
+    std::int64_t nanos = steadyNanos() - reg.origin_ns;
+    if (ticks > 0 && nanos > 0) ns_per_tick = static_cast<double>(nanos) / static_cast<double>(ticks);
+#endif
+
+    out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+    bool first = true;
+    char number[64];
+    for (const auto& buffer : reg.buffers) {
+        std::vector<TraceEvent> events = copyEvents(*buffer, reg.origin_ticks);
+        if (events.empty()) continue;
+        out << (first ? "\n" : ",\n");
+        first = false;
+        out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->tid
+            << ",\"args\":{\"name\":\"thread " << buffer->tid << "\"}}";
+        for (const TraceEvent& e : events) {
+            double ts = static_cast<double>(e.start - reg.origin_ticks) * ns_per_tick / 1000.0;
+            double dur = static_cast<double>(e.end - e.start) * ns_per_tick / 1000.0;
+            out << ",\n{\"name\":\"" << e.name << "\",\"cat\":\"haida\",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->tid;
+            std::snprintf(number, sizeof(number), ",\"ts\":%.3f,\"dur\":%.3f", ts, dur);
+            out << number;
+            if (e.detail_size > 0) {
+                out << ",\"args\":{\"text\":";
+                writeJsonString(out, e.detail, e.detail_size);
+                out << "}";
+            }
+            out << "}";
+        }
+    }
+    out << "\n]}\n";
+}
+
+bool writeChromeTraceFile(const std::string& path) {
+    std::string temp = path + ".tmp";
+    {
+        std::ofstream out(temp, std::ios::trunc);
+        if (!out) return false;
+        writeChromeTrace(out);
+        if (!out) return false;
+    }
+    std::remove(path.c_str());
+    return std::rename(temp.c_str(), path.c_str()) == 0;
+}
+
+} // namespace hx
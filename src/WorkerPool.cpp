@@ -0,0 +1,104 @@
+// 这是进程共用的辅助线程池的实现文件
+// 作者：大一学生
+// 功能：一个任务队列加固定数量的线程；每次 runShared 往队列里放几个辅助任务，
+//       辅助任务开始前先看调用方是否已经结束，结束了就什么也不做
+
+#include "WorkerPool.hpp"     // 辅助线程池头文件
+#include <algorithm>          // min/max
+#include <condition_variable> // 等待任务
+#include <deque>              // 任务队列
+#include <functional>         // 队列里的任务
+#include <memory>             // 共享的批次状态
+#include <mutex>              // 锁
+#include <thread>             // 池里的线程
+#include <vector>             // 向量容器
+
+namespace hx {
+
+namespace {
+
+constexpr unsigned kMaxPoolThreads = 16;  // 池的线程数上限
+
+class Pool {
+public:
+    Pool() {
+        unsigned n = std::min(std::max(1u, std::thread::hardware_concurrency()), kMaxPoolThreads);
+        for (unsigned i = 0; i < n; ++i) threads_.emplace_back([this]() { loop(); });
+    }
+
+    unsigned size() const { return static_cast<unsigned>(threads_.size()); }
+
+    void post(std::function<void()> task) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            tasks_.push_back(std::move(task));
+        }
+        cv_.notify_one();
+    }
+
+private:
+    void loop() {
+        for (;;) {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                cv_.wait(lock, [this]() { return !tasks_.empty(); });
+                task = std::move(tasks_.front());
+                tasks_.pop_front();
+            }
+            task();
+        }
+    }
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<std::function<void()>> tasks_;
+    std::vector<std::thread> threads_;
+};
+
+Pool& pool() {
+    static Pool* instance = new Pool(); // 故意不释放：线程一直阻塞在队列上，进程退出时直接结束
+    return *instance;
+}
+
+// 一次 runShared 的状态；辅助任务可能在调用方返回之后才出队，所以用共享指针
+struct Batch {
+    std::mutex mutex;
+    std::condition_variable cv;
+    int running{0};      // 正在跑 work 的辅助线程数
+    bool closed{false};  // 调用方已经跑完，之后出队的辅助任务作废
+};
+
+} // namespace
+
+void runShared(unsigned helpers, void (*work)(void*), void* arg) {
+    if (helpers == 0) {
+        work(arg);
+        return;
+    }
+    Pool& p = pool();
+    helpers = std::min(helpers, p.size());
+    auto batch = std::make_shared<Batch>();
+    for (unsigned i = 0; i < helpers; ++i) {
+        p.post([batch, work, arg]() {
+            {
+                std::lock_guard<std::mutex> lock(batch->mutex);
+                if (batch->closed) return;
+                ++batch->running;
+            }
+            work(arg);
+            std::lock_guard<std::mutex> lock(batch->mutex);
+            if (--batch->running == 0) batch->cv.notify_all();
+        });
+    }
+    work(arg);
+    std::unique_lock<std::mutex> lock(batch->mutex);
+    batch->closed = true;
+    batch->cv.wait(lock, [&]() { return batch->running == 0; });
+}
+
+unsigned sharedPoolThreads() {
+    return pool().size();
+}
+
+} // namespace hx
@@ -1,12 +1,164 @@
+#include "Bot.hpp"
 #include "Game.hpp"
+#include "Metrics.hpp"
+#include "Replay.hpp"
+#include "Trace.hpp"
 #include <cstdlib>
-#include <ctime>
-
-int main() {
-    // 初始化随机数种子
-    std::srand(static_cast<unsigned int>(std::time(nullptr)));
-    
-    hx::Game game; 
-    game.run();
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+
+// 用法：
+//   haida_mud                            正常游戏
+//   haida_mud --seed N                   用指定的随机种子游戏
+//   haida_mud --record 文件              游戏并记录随机种子和每行输入
+//   haida_mud --replay 文件 [--output 输出文件] [--expect 输出文件]
+//                                        全速回放记录；--output 保存输出，--expect 与保存过的输出比较
+//   haida_mud --bot N [--strategy 打法] [--seed N] [--record 文件] [--output 输出文件]
+//                                        让种子为N的自动玩家玩一局（打法：balanced/aggressive/cautious），
+//                                        游戏种子默认与bot相同；--record 的记录可以用 --replay 重现
+//   以上任一模式都可以加 --metrics-file 文件 [--metrics-interval 秒]
+//                                        定期把指令和子系统的耗时、内存分配统计写成 Prometheus 文本格式
+//   以上任一模式都可以加 --trace 文件  从启动起记录时间线跟踪点，退出时导出为 Chrome/Perfetto JSON
+namespace {
+
+// 退出时导出时间线（main 有多个返回点）
+struct TraceDump {
+    std::string path;
+    ~TraceDump() {
+        if (!path.empty() && hx::writeChromeTraceFile(path)) {
+            std::cerr << "时间线已导出到 " << path << "（" << hx::traceEventCount() << " 个跟踪点）\n";
+        }
+    }
+};
+
+int replayMain(const std::string& path, const std::string& output_path, const std::string& expect_path) {
+    hx::Transcript transcript;
+    if (!transcript.load(path)) {
+        std::cerr << "无法读取记录文件: " << path << "\n";
+        return 2;
+    }
+    bool keep_output = !output_path.empty() || !expect_path.empty();
+    std::ostringstream output;
+    hx::ReplayResult result = hx::replay(transcript, keep_output ? &output : nullptr);
+
+    std::cout << "回放 " << result.lines << " 行输入，用时 " << result.seconds * 1000.0 << " ms";
+    if (result.seconds > 0) std::cout << "（" << static_cast<long long>(static_cast<double>(result.lines) / result.seconds) << " 行/秒）";
+    std::cout << "\n";
+    std::cout << "状态哈希: " << hx::hashToHex(result.state_hash) << "\n";
+
+    if (!output_path.empty()) {
+        std::ofstream out(output_path, std::ios::binary);
+        out << output.str();
+    }
+    if (!expect_path.empty()) {
+        std::ifstream in(expect_path, std::ios::binary);
+        if (!in) {
+            std::cerr << "无法读取对照输出: " << expect_path << "\n";
+            return 2;
+        }
+        std::ostringstream expected;
+        expected << in.rdbuf();
+        size_t line = hx::firstDifference(expected.str(), output.str());
+        if (line != 0) {
+            std::cout << "输出不一致：第 " << line << " 行开始不同\n";
+            return 1;
+        }
+        std::cout << "输出一致\n";
+    }
+    return 0;
+}
+
+int botMain(std::uint32_t bot_seed, const std::string& strategy, bool has_seed, std::uint32_t seed,
+            const std::string& record_path, const std::string& output_path) {
+    hx::BotConfig config;
+    config.seed = bot_seed;
+    if (!strategy.empty() && !hx::parseBotStrategy(strategy, config.strategy)) {
+        std::cerr << "未知打法: " << strategy << "（可选 balanced/aggressive/cautious）\n";
+        return 2;
+    }
+    std::uint32_t game_seed = has_seed ? seed : bot_seed;
+    std::unique_ptr<hx::TranscriptWriter> recorder;
+    if (!record_path.empty()) {
+        recorder = std::make_unique<hx::TranscriptWriter>(record_path, game_seed);
+        if (!recorder->ok()) {
+            std::cerr << "无法创建记录文件: " << record_path << "\n";
+            return 2;
+        }
+    }
+    std::ostringstream output;
+    hx::BotReport report = hx::runBot(config, game_seed, output_path.empty() ? nullptr : &output, recorder.get());
+    if (!output_path.empty()) {
+        std::ofstream out(output_path, std::ios::binary);
+        out << output.str();
+    }
+
+    std::cout << "bot " << bot_seed << "（" << hx::botStrategyName(config.strategy) << "）: "
+              << hx::botStageName(report.stage) << "，Lv" << report.level << "，秘钥 " << report.keys << "/3"
+              << "，死亡 " << report.deaths << " 次\n";
+    std::cout << "输入 " << report.commands << " 行，用时 " << report.seconds * 1000.0 << " ms";
+    if (report.seconds > 0) std::cout << "（" << static_cast<long long>(static_cast<double>(report.commands) / report.seconds) << " 行/秒）";
+    std::cout << "\n";
+    std::cout << "状态哈希: " << hx::hashToHex(report.state_hash) << "\n";
+    return report.finished ? 0 : 1;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    std::string record_path, replay_path, output_path, expect_path, strategy, metrics_path, trace_path;
+    double metrics_interval = 10.0;
+    bool has_seed = false;
+    unsigned long seed = 0;
+    bool has_bot = false;
+    unsigned long bot_seed = 0;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string flag = argv[i];
+        std::string value = argv[i + 1];
+        if (flag == "--seed") { seed = std::strtoul(value.c_str(), nullptr, 10); has_seed = true; }
+        else if (flag == "--record") record_path = value;
+        else if (flag == "--replay") replay_path = value;
+        else if (flag == "--output") output_path = value;
+        else if (flag == "--expect") expect_path = value;
+        else if (flag == "--bot") { bot_seed = std::strtoul(value.c_str(), nullptr, 10); has_bot = true; }
+        else if (flag == "--strategy") strategy = value;
+        else if (flag == "--metrics-file") metrics_path = value;
+        else if (flag == "--trace") trace_path = value;
+        else if (flag == "--metrics-interval") metrics_interval = std::strtod(value.c_str(), nullptr);
+        else {
+            std::cerr << "未知参数: " << flag << "\n";
+            return 2;
+        }
+    }
+
+    std::unique_ptr<hx::MetricsExporter> exporter;
+    if (!metrics_path.empty()) exporter = std::make_unique<hx::MetricsExporter>(metrics_path, metrics_interval);
+    TraceDump trace_dump;
+    if (!trace_path.empty()) {
+        if (!hx::tracingCompiled()) std::cerr << "这个版本编译时没有打开跟踪点（ENABLE_TRACING=OFF），--trace 不会记录任何内容\n";
+        hx::setTracing(true);
+        trace_dump.path = trace_path;
+    }
+
+    if (!replay_path.empty()) return replayMain(replay_path, output_path, expect_path);
+    if (has_bot) {
+        return botMain(static_cast<std::uint32_t>(bot_seed), strategy, has_seed, static_cast<std::uint32_t>(seed),
+                       record_path, output_path);
+    }
+
+    hx::Game game(has_seed ? static_cast<std::uint32_t>(seed) : std::random_device{}());
+    if (!record_path.empty()) {
+        hx::TranscriptWriter recorder(record_path, game.seed());
+        if (!recorder.ok()) {
+            std::cerr << "无法创建记录文件: " << record_path << "\n";
+            return 2;
+        }
+        game.run(&recorder);
+    } else {
+        game.run();
+    }
     return 0;
 }